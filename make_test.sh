@@ -144,6 +144,7 @@ ILOOP_FLAGS[0]=""
 ILOOP_FLAGS[1]="DEBUG=1"
 ILOOP_FLAGS[2]="MINIMAL=1"
 ILOOP_FLAGS[3]="MINIMAL=1 DEBUG=1"
+ILOOP_FLAGS[4]="PTHREADS=1"
 VALGRIND_LOOP_FLAGS[0]="DEBUG=1"
 VALGRIND_LOOP_FLAGS[1]="DEBUG=1 ADD_FLAGS=-DS_DISABLE_SM_STRING_OPTIMIZATION"
 VALGRIND_LOOP_FLAGS[2]="MINIMAL=1 DEBUG=1"
@@ -255,9 +256,9 @@ if (($TMUX & 8)) ; then
 		echo "Coverage report generation..."
 		COVERAGE_OUT=$OUT_DOC/coverage.txt
 		$MAKE -j $MJOBS CC=$GCC PROFILING=1 2>/dev/null >/dev/null
-		for f in schar scommon sdata senc shash smap smset shmap \
-			 shset ssearch ssort sstring sstringo stree svector \
-			 stest ; do
+		for f in schar scommon sdata senc sfind sfmap shash smap smset \
+			 shmap shset simap smsearch srmap ssearch ssort sstring \
+			 sstringo stable stree svector svops svpack stest ; do
 			gcov $f.c >/dev/null 2>/dev/null
 		done
 		rm -f $COVERAGE_OUT 2>/dev/null
@@ -18,7 +18,11 @@ extern "C" {
 #include "shset.h"
 #include "smap.h"
 #include "smset.h"
+#include "srmap.h"
+#include "simap.h"
+#include "sfmap.h"
 #include "sstring.h"
+#include "stable.h"
 #include "svector.h"
 
 #ifdef __cplusplus
@@ -132,6 +132,37 @@ extern "C" {
 #define S_LIKELY(expr) S_EXPECT((expr) != 0, 1)
 #define S_UNLIKELY(expr) S_EXPECT((expr) != 0, 0)
 
+#if defined(__GNUC__) && __GNUC__ >= 4 || defined(__clang__)                   \
+	|| defined(__INTEL_COMPILER)
+#define S_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define S_PREFETCH(addr)
+#endif
+
+/*
+ * Atomic load/store (naturally aligned scalars and pointers) and fences,
+ * for data read by other threads without locks (S_ATOMICS defined if
+ * available: GCC >= 4.7, clang; otherwise plain accesses)
+ */
+#if defined(__GNUC__)                                                          \
+	&& (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 7)              \
+	|| defined(__clang__)
+#define S_ATOMICS
+#define S_LD_ACQ(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define S_ST_REL(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define S_LD_SC(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define S_ST_SC(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define S_FENCE_ACQ() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define S_FENCE_REL() __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define S_LD_ACQ(p) (*(p))
+#define S_ST_REL(p, v) (*(p) = (v))
+#define S_LD_SC(p) (*(p))
+#define S_ST_SC(p, v) (*(p) = (v))
+#define S_FENCE_ACQ()
+#define S_FENCE_REL()
+#endif
+
 #if defined(S_C99_SUPPORT) || defined(__TINYC__)
 #define S_MODERN_COMPILER
 #ifndef S_NO_VARGS
@@ -648,7 +679,7 @@ void s_memset16(void *o, const void *s, size_t n);
 	S_INLINE T FN(T v)                                                     \
 	{                                                                      \
 		size_t i;                                                      \
-		for (i = 1; i < sizeof(T) * 8 / 2; i <<= 1)                    \
+		for (i = 1; i < sizeof(T) * 8; i <<= 1)                        \
 			v |= (v >> i);                                         \
 		return v & ~(v >> 1);                                          \
 	}
@@ -33,10 +33,29 @@ extern "C" {
  * Macros
  */
 
+/*
+ * The _RF variants call 'pf(c, n)' before every potential reallocation, being
+ * 'n' the required capacity (0 for shrink), which cancels it if returning
+ * S_FALSE (e.g. for keeping the current block for concurrent readers), and
+ * 'rf(c)' after it (e.g. for updating references to the container held
+ * elsewhere)
+ */
+
+#define SD_NO_PF(c, n) S_TRUE
+#define SD_NO_RF(c)
+
 #define SD_BUILDFUNCS_COMMON(pfix, t, tail_bytes)                              \
+	SD_BUILDFUNCS_COMMON_RF(pfix, t, tail_bytes, SD_NO_PF, SD_NO_RF)
+
+#define SD_BUILDFUNCS_COMMON_RF(pfix, t, tail_bytes, pf, rf)                   \
 	S_INLINE t *pfix##_shrink(t **c)                                       \
 	{                                                                      \
-		return (t *)sd_shrink((srt_data **)c, tail_bytes);             \
+		t *r;                                                          \
+		if (!pf(c, 0))                                                 \
+			return *c;                                             \
+		r = (t *)sd_shrink((srt_data **)c, tail_bytes);                \
+		rf(c);                                                         \
+		return r;                                                      \
 	}                                                                      \
 	S_INLINE srt_bool pfix##_empty(const t *c)                             \
 	{                                                                      \
@@ -114,16 +133,29 @@ extern "C" {
 	SD_BUILDFUNCS_COMMON(pfix, t, tail_bytes)
 
 #define SD_BUILDFUNCS_FULL_ST(pfix, t, tail_bytes)                             \
+	SD_BUILDFUNCS_FULL_ST_RF(pfix, t, tail_bytes, SD_NO_PF, SD_NO_RF)
+
+#define SD_BUILDFUNCS_FULL_ST_RF(pfix, t, tail_bytes, pf, rf)                  \
 	SD_BUILDFUNCS_ST(pfix, t, sd)                                          \
 	SD_BUILDFUNCS_ST2(pfix, t, sd)                                         \
-	SD_BUILDFUNCS_COMMON(pfix, t, tail_bytes)                              \
+	SD_BUILDFUNCS_COMMON_RF(pfix, t, tail_bytes, pf, rf)                   \
 	S_INLINE size_t pfix##_grow(t **c, size_t extra_elems)                 \
 	{                                                                      \
-		return sd_grow((srt_data **)c, extra_elems, tail_bytes);       \
+		size_t r;                                                      \
+		if (c && *c && !pf(c, sd_size((srt_data *)*c) + extra_elems))  \
+			return 0;                                              \
+		r = sd_grow((srt_data **)c, extra_elems, tail_bytes);          \
+		rf(c);                                                         \
+		return r;                                                      \
 	}                                                                      \
 	S_INLINE size_t pfix##_reserve(t **c, size_t max_elems)                \
 	{                                                                      \
-		return sd_reserve((srt_data **)c, max_elems, tail_bytes);      \
+		size_t r;                                                      \
+		if (!pf(c, max_elems))                                         \
+			return c && *c ? sd_max_size((srt_data *)*c) : 0;      \
+		r = sd_reserve((srt_data **)c, max_elems, tail_bytes);         \
+		rf(c);                                                         \
+		return r;                                                      \
 	}
 
 #define SD_FREE_AUX(pfix, t)                                                   \
@@ -143,6 +175,10 @@ extern "C" {
 	SD_BUILDFUNCS_FULL_ST(pfix, t, tail_bytes)                             \
 	SD_FREE_AUX(pfix, t)
 
+#define SD_BUILDFUNCS_FULL_RF(pfix, t, tail_bytes, pf, rf)                     \
+	SD_BUILDFUNCS_FULL_ST_RF(pfix, t, tail_bytes, pf, rf)                  \
+	SD_FREE_AUX(pfix, t)
+
 /*
  * Data structures and types
  */
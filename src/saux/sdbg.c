@@ -101,7 +101,7 @@ static void ndx2s(char *out, size_t out_max, srt_tndx id)
 	if (id == ST_NIL)
 		strcpy(out, "nil");
 	else
-		snprintf(out, out_max, "%u", (unsigned)id);
+		snprintf(out, out_max, FMT_ZU, (size_t)id);
 }
 
 static int aux_sm_log_traverse(struct STraverseParams *tp)
@@ -168,8 +168,8 @@ static int aux_sm_log_traverse(struct STraverseParams *tp)
 		break;
 	}
 	ndx2s(id, sizeof(id), tp->c);
-	ndx2s(l, sizeof(l), cn->x.l);
-	ndx2s(r, sizeof(r), cn->r);
+	ndx2s(l, sizeof(l), st_node_l(tp->t, cn));
+	ndx2s(r, sizeof(r), st_node_r(tp->t, cn));
 	ss_cat_printf(log, 128, "[%s: (%s, %s) -> (%s, %s; r:%u)] ", id, k, v,
 		      l, r, cn->x.is_red);
 	return 0;
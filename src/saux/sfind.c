@@ -0,0 +1,451 @@
+/*
+ * sfind.c
+ *
+ * Element search in arrays of fixed-size elements (vector search kernels).
+ *
+ * Observations:
+ * - Every block (16 bytes for SSE2/NEON, 32 bytes for AVX2) is compared
+ *   against the target replicated in all the lanes, getting a bit mask
+ *   having SFIND_BPB bits per byte (so SFIND_BPB * element size bits per
+ *   element). The position of the first match is the mask trailing zero
+ *   count divided by the bits per element.
+ * - Search: 4 blocks are compared per loop, checking the OR of the four
+ *   comparison results (one mask extraction per 4 blocks).
+ * - Count: the comparison results (0xff bytes on match) are accumulated
+ *   as per-byte counters, adding them horizontally every 255 blocks (before
+ *   the byte counters could overflow). Being every match counted once per
+ *   element byte, the total is divided by the element size.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "sfind.h"
+
+/*
+ * Vector instruction set selection
+ */
+
+#if !defined(S_DISABLE_SIMD) && !defined(S_MINIMAL)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SFIND_SIMD
+#define SFIND_X86
+#define SFIND_VB 32 /* vector size (bytes) */
+#define SFIND_BPB 1 /* comparison mask bits per byte */
+typedef __m256i sfind_v;
+#define SFIND_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SFIND_ZERO() _mm256_setzero_si256()
+#define SFIND_OR(a, b) _mm256_or_si256(a, b)
+#define SFIND_ACC(acc, c) _mm256_sub_epi8(acc, c)
+#define SFIND_MASK(c) ((uint64_t)(uint32_t)_mm256_movemask_epi8(c))
+#define SFIND_SET8(t) _mm256_set1_epi8((char)(t))
+#define SFIND_SET16(t) _mm256_set1_epi16((short)(t))
+#define SFIND_SET32(t) _mm256_set1_epi32((int)(t))
+#define SFIND_SET64(t) _mm256_set1_epi64x((int64_t)(t))
+#define SFIND_EQ8(a, b) _mm256_cmpeq_epi8(a, b)
+#define SFIND_EQ16(a, b) _mm256_cmpeq_epi16(a, b)
+#define SFIND_EQ32(a, b) _mm256_cmpeq_epi32(a, b)
+#define SFIND_EQ64(a, b) _mm256_cmpeq_epi64(a, b)
+
+static size_t sfind_vsum(sfind_v acc)
+{
+	__m256i s = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+	__m128i x = _mm_add_epi64(_mm256_castsi256_si128(s),
+				  _mm256_extracti128_si256(s, 1));
+	return (size_t)_mm_cvtsi128_si32(x)
+	       + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SFIND_SIMD
+#define SFIND_X86
+#define SFIND_VB 16
+#define SFIND_BPB 1
+typedef __m128i sfind_v;
+#define SFIND_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SFIND_ZERO() _mm_setzero_si128()
+#define SFIND_OR(a, b) _mm_or_si128(a, b)
+#define SFIND_ACC(acc, c) _mm_sub_epi8(acc, c)
+#define SFIND_MASK(c) ((uint64_t)(uint32_t)_mm_movemask_epi8(c))
+#define SFIND_SET8(t) _mm_set1_epi8((char)(t))
+#define SFIND_SET16(t) _mm_set1_epi16((short)(t))
+#define SFIND_SET32(t) _mm_set1_epi32((int)(t))
+#define SFIND_SET64(t)                                                         \
+	_mm_set_epi32((int)((t) >> 32), (int)(t), (int)((t) >> 32), (int)(t))
+#define SFIND_EQ8(a, b) _mm_cmpeq_epi8(a, b)
+#define SFIND_EQ16(a, b) _mm_cmpeq_epi16(a, b)
+#define SFIND_EQ32(a, b) _mm_cmpeq_epi32(a, b)
+#define SFIND_EQ64(a, b) sfind_eq64(a, b)
+
+static size_t sfind_vsum(sfind_v acc)
+{
+	__m128i s = _mm_sad_epu8(acc, _mm_setzero_si128());
+	return (size_t)_mm_cvtsi128_si32(s)
+	       + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SFIND_SIMD
+#define SFIND_VB 16
+#define SFIND_BPB 4 /* 16-to-8 bit narrowing shift (no movemask) */
+typedef uint8x16_t sfind_v;
+#define SFIND_LOAD(p) vld1q_u8((const uint8_t *)(p))
+#define SFIND_ZERO() vdupq_n_u8(0)
+#define SFIND_OR(a, b) vorrq_u8(a, b)
+#define SFIND_ACC(acc, c) vsubq_u8(acc, c)
+#define SFIND_MASK(c)                                                          \
+	vget_lane_u64(                                                         \
+		vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(c), 4)),  \
+		0)
+#define SFIND_SET8(t) vdupq_n_u8(t)
+#define SFIND_SET16(t) vreinterpretq_u8_u16(vdupq_n_u16(t))
+#define SFIND_SET32(t) vreinterpretq_u8_u32(vdupq_n_u32(t))
+#define SFIND_SET64(t) vreinterpretq_u8_u64(vdupq_n_u64(t))
+#define SFIND_EQ8(a, b) vceqq_u8(a, b)
+#define SFIND_EQ16(a, b)                                                       \
+	vreinterpretq_u8_u16(                                                  \
+		vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)))
+#define SFIND_EQ32(a, b)                                                       \
+	vreinterpretq_u8_u32(                                                  \
+		vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)))
+#define SFIND_EQ64(a, b)                                                       \
+	vreinterpretq_u8_u64(                                                  \
+		vceqq_u64(vreinterpretq_u64_u8(a), vreinterpretq_u64_u8(b)))
+
+static size_t sfind_vsum(sfind_v acc)
+{
+	return (size_t)vaddlvq_u8(acc);
+}
+
+#endif
+#endif
+
+#ifdef SFIND_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+#define sfind_ctz(m) ((size_t)__builtin_ctzll(m))
+#else
+#define sfind_ctz(m) ((size_t)slog2_64((m) & (~(m) + 1)))
+#endif
+#define SFIND_EQB(p, v, EQ) EQ(SFIND_LOAD(p), v)
+#endif
+
+/*
+ * 128-bit blocks (sorted set intersection)
+ */
+
+#ifdef SFIND_X86
+typedef __m128i sisect_v;
+#define SISECT_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SISECT_OR(a, b) _mm_or_si128(a, b)
+#define SISECT_EQ32(a, b) _mm_cmpeq_epi32(a, b)
+#define SISECT_EQ64(a, b) sfind_eq64(a, b)
+#define SISECT_ROT32(b) _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1))
+#define SISECT_ROT64(b) _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2))
+#define SISECT_MASK32(c) ((unsigned)_mm_movemask_ps(_mm_castsi128_ps(c)))
+#define SISECT_MASK64(c) ((unsigned)_mm_movemask_pd(_mm_castsi128_pd(c)))
+
+/*
+ * SSE2 has no 64-bit compare: both 32-bit halves must be equal
+ */
+S_INLINE __m128i sfind_eq64(__m128i a, __m128i b)
+{
+	__m128i c = _mm_cmpeq_epi32(a, b);
+	return _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+#elif defined(SFIND_SIMD)
+typedef uint8x16_t sisect_v;
+#define SISECT_LOAD(p) SFIND_LOAD(p)
+#define SISECT_OR(a, b) SFIND_OR(a, b)
+#define SISECT_EQ32(a, b) SFIND_EQ32(a, b)
+#define SISECT_EQ64(a, b) SFIND_EQ64(a, b)
+#define SISECT_ROT32(b) vextq_u8(b, b, 4)
+#define SISECT_ROT64(b) vextq_u8(b, b, 8)
+#define SISECT_MASK32(c) sisect_lanes(SFIND_MASK(c), 16)
+#define SISECT_MASK64(c) sisect_lanes(SFIND_MASK(c), 32)
+
+/*
+ * One bit per lane, from the 4 bits per byte mask
+ */
+S_INLINE unsigned sisect_lanes(uint64_t m, unsigned bits_per_lane)
+{
+	unsigned i, r = 0;
+	for (i = 0; i < 64 / bits_per_lane; i++)
+		r |= (unsigned)((m >> (i * bits_per_lane)) & 1) << i;
+	return r;
+}
+#endif
+
+/*
+ * Typed kernels (bitwise equality)
+ */
+
+#ifdef SFIND_SIMD
+
+#define BUILD_SFIND(FF, FC, FM, T, SET, EQ)                                    \
+	static size_t FF(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		size_t i = 0;                                                  \
+		uint64_t m;                                                    \
+		sfind_v c0, c1;                                                \
+		const size_t epb = SFIND_VB / sizeof(T);                       \
+		const sfind_v v = SET(t);                                      \
+		for (; i + 4 * epb <= n; i += 4 * epb) {                       \
+			c0 = SFIND_OR(SFIND_EQB(b + i, v, EQ),                 \
+				      SFIND_EQB(b + i + epb, v, EQ));          \
+			c1 = SFIND_OR(SFIND_EQB(b + i + 2 * epb, v, EQ),       \
+				      SFIND_EQB(b + i + 3 * epb, v, EQ));      \
+			if (SFIND_MASK(SFIND_OR(c0, c1)))                      \
+				break;                                         \
+		}                                                              \
+		for (; i + epb <= n; i += epb) {                               \
+			m = SFIND_MASK(SFIND_EQB(b + i, v, EQ));               \
+			if (m)                                                 \
+				return i + sfind_ctz(m)                        \
+				       / (SFIND_BPB * sizeof(T));              \
+		}                                                              \
+		for (; i < n; i++)                                             \
+			if (b[i] == t)                                         \
+				return i;                                      \
+		return S_NPOS;                                                 \
+	}                                                                      \
+	static size_t FC(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		size_t i = 0, c = 0, k;                                        \
+		sfind_v acc;                                                   \
+		const size_t epb = SFIND_VB / sizeof(T);                       \
+		const sfind_v v = SET(t);                                      \
+		while (i + epb <= n) {                                         \
+			acc = SFIND_ZERO();                                    \
+			for (k = 0; k < 255 && i + epb <= n; k++, i += epb)    \
+				acc = SFIND_ACC(acc, SFIND_EQB(b + i, v, EQ)); \
+			c += sfind_vsum(acc);                                  \
+		}                                                              \
+		c /= sizeof(T);                                                \
+		for (; i < n; i++)                                             \
+			c += b[i] == t ? 1 : 0;                                \
+		return c;                                                      \
+	}                                                                      \
+	static size_t FM(const T *b, size_t n, T t, uint64_t *m, size_t mo)    \
+	{                                                                      \
+		size_t i = 0, c = 0, j;                                        \
+		uint64_t bm;                                                   \
+		const size_t epb = SFIND_VB / sizeof(T),                       \
+			     bpe = SFIND_BPB * sizeof(T);                      \
+		const uint64_t lo = ~(uint64_t)0 / (((uint64_t)1 << bpe) - 1); \
+		const sfind_v v = SET(t);                                      \
+		for (; i + epb <= n; i += epb) {                               \
+			bm = SFIND_MASK(SFIND_EQB(b + i, v, EQ)) & lo;         \
+			for (; bm; bm &= bm - 1, c++) {                        \
+				j = mo + i + sfind_ctz(bm) / bpe;              \
+				m[j / 64] |= (uint64_t)1 << (j % 64);          \
+			}                                                      \
+		}                                                              \
+		for (; i < n; i++)                                             \
+			if (b[i] == t) {                                       \
+				j = mo + i;                                    \
+				m[j / 64] |= (uint64_t)1 << (j % 64);          \
+				c++;                                           \
+			}                                                      \
+		return c;                                                      \
+	}
+
+#else
+
+#define BUILD_SFIND(FF, FC, FM, T, SET, EQ)                                    \
+	static size_t FF(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		size_t i = 0;                                                  \
+		for (; i < n; i++)                                             \
+			if (b[i] == t)                                         \
+				return i;                                      \
+		return S_NPOS;                                                 \
+	}                                                                      \
+	static size_t FC(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		size_t i = 0, c = 0;                                           \
+		for (; i < n; i++)                                             \
+			c += b[i] == t ? 1 : 0;                                \
+		return c;                                                      \
+	}                                                                      \
+	static size_t FM(const T *b, size_t n, T t, uint64_t *m, size_t mo)    \
+	{                                                                      \
+		size_t i = 0, c = 0, j;                                        \
+		for (; i < n; i++)                                             \
+			if (b[i] == t) {                                       \
+				j = mo + i;                                    \
+				m[j / 64] |= (uint64_t)1 << (j % 64);          \
+				c++;                                           \
+			}                                                      \
+		return c;                                                      \
+	}
+
+#endif
+
+BUILD_SFIND(sfind_first_u8, sfind_count_u8, sfind_mask_u8, uint8_t,
+	    SFIND_SET8, SFIND_EQ8)
+BUILD_SFIND(sfind_first_u16, sfind_count_u16, sfind_mask_u16, uint16_t,
+	    SFIND_SET16, SFIND_EQ16)
+BUILD_SFIND(sfind_first_u32, sfind_count_u32, sfind_mask_u32, uint32_t,
+	    SFIND_SET32, SFIND_EQ32)
+BUILD_SFIND(sfind_first_u64, sfind_count_u64, sfind_mask_u64, uint64_t,
+	    SFIND_SET64, SFIND_EQ64)
+
+/*
+ * Element size dispatch
+ */
+
+union SFindT {
+	uint8_t u8;
+	uint16_t u16;
+	uint32_t u32;
+	uint64_t u64;
+};
+
+S_INLINE srt_bool sfind_tgt(union SFindT *u, const void *t, size_t es)
+{
+	RETURN_IF(es != 1 && es != 2 && es != 4 && es != 8, S_FALSE);
+	memcpy(u, t, es);
+	return S_TRUE;
+}
+
+size_t sfind_first(const void *b, size_t n, const void *t, size_t es)
+{
+	size_t i;
+	union SFindT u;
+	RETURN_IF(!b || !t || !es, S_NPOS);
+	if (sfind_tgt(&u, t, es))
+		switch (es) {
+		case 1:
+			return sfind_first_u8((const uint8_t *)b, n, u.u8);
+		case 2:
+			return sfind_first_u16((const uint16_t *)b, n, u.u16);
+		case 4:
+			return sfind_first_u32((const uint32_t *)b, n, u.u32);
+		default:
+			return sfind_first_u64((const uint64_t *)b, n, u.u64);
+		}
+	for (i = 0; i < n; i++)
+		if (!memcmp((const char *)b + i * es, t, es))
+			return i;
+	return S_NPOS;
+}
+
+size_t sfind_count(const void *b, size_t n, const void *t, size_t es)
+{
+	size_t i, c = 0;
+	union SFindT u;
+	RETURN_IF(!b || !t || !es, 0);
+	if (sfind_tgt(&u, t, es))
+		switch (es) {
+		case 1:
+			return sfind_count_u8((const uint8_t *)b, n, u.u8);
+		case 2:
+			return sfind_count_u16((const uint16_t *)b, n, u.u16);
+		case 4:
+			return sfind_count_u32((const uint32_t *)b, n, u.u32);
+		default:
+			return sfind_count_u64((const uint64_t *)b, n, u.u64);
+		}
+	for (i = 0; i < n; i++)
+		if (!memcmp((const char *)b + i * es, t, es))
+			c++;
+	return c;
+}
+
+size_t sfind_mask(const void *b, size_t n, const void *t, size_t es,
+		  uint64_t *m, size_t mo)
+{
+	size_t i, c = 0;
+	union SFindT u;
+	RETURN_IF(!b || !t || !es || !m, 0);
+	if (sfind_tgt(&u, t, es))
+		switch (es) {
+		case 1:
+			return sfind_mask_u8((const uint8_t *)b, n, u.u8, m,
+					     mo);
+		case 2:
+			return sfind_mask_u16((const uint16_t *)b, n, u.u16, m,
+					      mo);
+		case 4:
+			return sfind_mask_u32((const uint32_t *)b, n, u.u32, m,
+					      mo);
+		default:
+			return sfind_mask_u64((const uint64_t *)b, n, u.u64, m,
+					      mo);
+		}
+	for (i = 0; i < n; i++)
+		if (!memcmp((const char *)b + i * es, t, es)) {
+			m[(mo + i) / 64] |= (uint64_t)1 << ((mo + i) % 64);
+			c++;
+		}
+	return c;
+}
+
+/*
+ * Sorted set intersection (32/64-bit integers)
+ *
+ * Blocks of 16 bytes from both sets are compared all-against-all (rotating
+ * the 'b' block one lane per step), advancing the block having the smaller
+ * last element, so the matches are found without per-element branches.
+ * The remaining elements (less than a block in any of the sets) are merged
+ * one by one.
+ */
+
+SFIND_BUILD_ISECT_MERGE(sisect_merge_i32, int32_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sisect_merge_u32, uint32_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sisect_merge_i64, int64_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sisect_merge_u64, uint64_t, SFIND_KEY_ID)
+
+#ifdef SFIND_SIMD
+
+#define BUILD_SISECT(FN, MERGE, T, EQ, ROT, MASK)                              \
+	size_t FN(const T *a, size_t na, const T *b, size_t nb, T *o)          \
+	{                                                                      \
+		unsigned m, r;                                                 \
+		sisect_v va, vb, c;                                            \
+		size_t i = 0, j = 0, k = 0;                                    \
+		const unsigned nl = 16 / sizeof(T);                            \
+		while (i + nl <= na && j + nl <= nb) {                         \
+			va = SISECT_LOAD(a + i);                               \
+			vb = SISECT_LOAD(b + j);                               \
+			c = EQ(va, vb);                                        \
+			for (r = 1; r < nl; r++) {                             \
+				vb = ROT(vb);                                  \
+				c = SISECT_OR(c, EQ(va, vb));                  \
+			}                                                      \
+			for (m = MASK(c); m; m &= m - 1)                       \
+				o[k++] = a[i + sfind_ctz(m)];                  \
+			if (a[i + nl - 1] < b[j + nl - 1]) {                   \
+				i += nl;                                       \
+			} else if (b[j + nl - 1] < a[i + nl - 1]) {            \
+				j += nl;                                       \
+			} else {                                               \
+				i += nl;                                       \
+				j += nl;                                       \
+			}                                                      \
+		}                                                              \
+		return k + MERGE(a + i, na - i, b + j, nb - j, o + k);         \
+	}
+
+#else
+
+#define BUILD_SISECT(FN, MERGE, T, EQ, ROT, MASK)                              \
+	size_t FN(const T *a, size_t na, const T *b, size_t nb, T *o)          \
+	{                                                                      \
+		return MERGE(a, na, b, nb, o);                                 \
+	}
+
+#endif
+
+BUILD_SISECT(sfind_isect_i32, sisect_merge_i32, int32_t, SISECT_EQ32,
+	     SISECT_ROT32, SISECT_MASK32)
+BUILD_SISECT(sfind_isect_u32, sisect_merge_u32, uint32_t, SISECT_EQ32,
+	     SISECT_ROT32, SISECT_MASK32)
+BUILD_SISECT(sfind_isect_i64, sisect_merge_i64, int64_t, SISECT_EQ64,
+	     SISECT_ROT64, SISECT_MASK64)
+BUILD_SISECT(sfind_isect_u64, sisect_merge_u64, uint64_t, SISECT_EQ64,
+	     SISECT_ROT64, SISECT_MASK64)
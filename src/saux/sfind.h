@@ -0,0 +1,87 @@
+#ifndef SFIND_H
+#define SFIND_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "scommon.h"
+
+/*
+ * sfind.h
+ *
+ * Element search in arrays of fixed-size elements (vector search kernels).
+ *
+ * Features:
+ * - Bitwise element equality (same as memcmp()) for 1, 2, 4 and 8 byte
+ *   elements, so it covers integer, floating point and generic elements.
+ * - SSE2, AVX2 or NEON (AArch64) vectorized kernels, selected at compile
+ *   time (e.g. -mavx2), with a scalar fallback for other targets or for
+ *   builds with S_DISABLE_SIMD or S_MINIMAL defined.
+ * - Other element sizes are handled with memcmp().
+ * - Sorted set intersection for 32 and 64-bit integers (all-against-all
+ *   block compare, using the same instruction set selection).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+/*
+ * Locate first element equal to the target (S_NPOS if not found)
+ */
+size_t sfind_first(const void *b, size_t n, const void *t, size_t es);
+
+/*
+ * Count elements equal to the target
+ */
+size_t sfind_count(const void *b, size_t n, const void *t, size_t es);
+
+/*
+ * Set bit (mo + i) in the 'm' bit array for every element 'i' equal to the
+ * target (other bits are not modified), returning the match count
+ */
+size_t sfind_mask(const void *b, size_t n, const void *t, size_t es,
+		  uint64_t *m, size_t mo);
+
+/*
+ * Sorted set intersection: elements of 'a' present in 'b' (both sorted, with
+ * unique elements) are written to 'o' (it can be 'a'), returning the count
+ */
+
+/*
+ * Scalar merge kernel template (one element per step), for the types not
+ * having a block kernel. KEY(x) gives the element order (SFIND_KEY_ID for
+ * integers), so equal keys must mean equal elements.
+ */
+#define SFIND_KEY_ID(x) (x)
+
+#define SFIND_BUILD_ISECT_MERGE(FN, T, KEY)                                    \
+	static size_t FN(const T *a, size_t na, const T *b, size_t nb, T *o)   \
+	{                                                                      \
+		size_t i = 0, j = 0, k = 0;                                    \
+		while (i < na && j < nb) {                                     \
+			if (KEY(a[i]) < KEY(b[j])) {                           \
+				i++;                                           \
+			} else if (KEY(b[j]) < KEY(a[i])) {                    \
+				j++;                                           \
+			} else {                                               \
+				o[k++] = a[i++];                               \
+				j++;                                           \
+			}                                                      \
+		}                                                              \
+		return k;                                                      \
+	}
+
+size_t sfind_isect_i32(const int32_t *a, size_t na, const int32_t *b,
+		       size_t nb, int32_t *o);
+size_t sfind_isect_u32(const uint32_t *a, size_t na, const uint32_t *b,
+		       size_t nb, uint32_t *o);
+size_t sfind_isect_i64(const int64_t *a, size_t na, const int64_t *b,
+		       size_t nb, int64_t *o);
+size_t sfind_isect_u64(const uint64_t *a, size_t na, const uint64_t *b,
+		       size_t nb, uint64_t *o);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* SFIND_H */
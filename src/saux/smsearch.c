@@ -0,0 +1,542 @@
+/*
+ * smsearch.c
+ *
+ * Multi-pattern search: Aho-Corasick DFA and Teddy filter.
+ *
+ * Observations:
+ * - DFA transitions are stored premultiplied by the number of byte
+ *   classes (i.e. as the next state row offset), and states with
+ *   matches (an own target, or a target being a suffix) are numbered
+ *   first, so a match is detected with 'st < lim'.
+ * - Matches of a state are reported following the dictionary suffix
+ *   links (next state with targets along the failure links), targets
+ *   having the same bytes being chained by id.
+ * - Teddy buckets are filled with the targets sorted by their first
+ *   bytes, so targets sharing a prefix share a bucket (fewer false
+ *   positives from the nibble tables).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "smsearch.h"
+
+/*
+ * Internal constants
+ */
+
+#define SMS_NONE 0xffffffff
+#define SMS_TB 3 /* Teddy: maximum target prefix bytes checked */
+#define SMS_NB 8 /* Teddy: buckets */
+
+/*
+ * Teddy: switch to the DFA when having more than one candidate per
+ * SMS_FALSE_RATIO bytes scanned, plus SMS_SLACK
+ */
+#define SMS_FALSE_RATIO 4
+#define SMS_SLACK 64
+
+/*
+ * Teddy: vector instruction set selection (byte shuffle required, so
+ * SSE2-only targets use the DFA for all sets)
+ */
+
+#if !defined(S_DISABLE_SIMD) && !defined(S_MINIMAL)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SMS_TEDDY
+#define SMS_VB 32 /* vector size (bytes) */
+#define SMS_BPB 1 /* candidate mask bits per byte */
+typedef __m256i sms_v;
+#define SMS_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SMS_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define SMS_SET8(c) _mm256_set1_epi8((char)(c))
+#define SMS_AND(a, b) _mm256_and_si256(a, b)
+#define SMS_HI4(v) _mm256_srli_epi16(v, 4)
+#define SMS_LUT(t, i) _mm256_shuffle_epi8(t, i)
+#define SMS_MASK(c)                                                            \
+	(~(uint64_t)(uint32_t)_mm256_movemask_epi8(                            \
+		 _mm256_cmpeq_epi8(c, _mm256_setzero_si256()))                 \
+	 & 0xffffffff)
+
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define SMS_TEDDY
+#define SMS_VB 16
+#define SMS_BPB 1
+typedef __m128i sms_v;
+#define SMS_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SMS_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define SMS_SET8(c) _mm_set1_epi8((char)(c))
+#define SMS_AND(a, b) _mm_and_si128(a, b)
+#define SMS_HI4(v) _mm_srli_epi16(v, 4)
+#define SMS_LUT(t, i) _mm_shuffle_epi8(t, i)
+#define SMS_MASK(c)                                                            \
+	(~(uint64_t)(uint32_t)_mm_movemask_epi8(                               \
+		 _mm_cmpeq_epi8(c, _mm_setzero_si128()))                       \
+	 & 0xffff)
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SMS_TEDDY
+#define SMS_VB 16
+#define SMS_BPB 4 /* 16-to-8 bit narrowing shift (no movemask) */
+typedef uint8x16_t sms_v;
+#define SMS_LOAD(p) vld1q_u8((const uint8_t *)(p))
+#define SMS_STORE(p, v) vst1q_u8((uint8_t *)(p), v)
+#define SMS_SET8(c) vdupq_n_u8((uint8_t)(c))
+#define SMS_AND(a, b) vandq_u8(a, b)
+#define SMS_HI4(v) vshrq_n_u8(v, 4)
+#define SMS_LUT(t, i) vqtbl1q_u8(t, i)
+#define SMS_MASK(c)                                                            \
+	(vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(                        \
+			       vreinterpretq_u16_u8(vtstq_u8(c, c)), 4)),      \
+		       0)                                                      \
+	 & 0x8888888888888888ULL) /* one bit per byte */
+
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define sms_ctz(m) ((size_t)__builtin_ctzll(m))
+#else
+#define sms_ctz(m) ((size_t)slog2_64((m) & (~(m) + 1)))
+#endif
+
+/*
+ * Compiled targets (single allocation: structure, per target offsets and
+ * sizes, DFA and per state data, target bytes)
+ */
+
+struct SMSearch {
+	size_t n, min, max, tbytes; /* tbytes: Teddy prefix bytes (0: none) */
+	size_t *toff, *tsz;    /* target offset (in 'pool') and size */
+	uint32_t *tbl;	       /* DFA: next state row, for every byte class */
+	uint32_t *oid;	       /* state: first target id (SMS_NONE: none) */
+	uint32_t *dict;	       /* state: next state with targets (suffix) */
+	uint32_t *same;	       /* target: next target with the same bytes */
+	uint32_t *bids;	       /* Teddy: target ids, by bucket */
+	char *pool;
+	uint32_t nc, root, lim;
+	uint32_t bkt[SMS_NB + 1]; /* Teddy: bucket ranges in 'bids' */
+	uint8_t cls[256];
+	uint8_t tlo[SMS_TB][32], thi[SMS_TB][32]; /* nibble tables (x2) */
+	uint8_t tb[SMS_TB][256];		  /* byte tables (tail) */
+};
+
+static size_t sms_add(size_t a, size_t b)
+{
+	return a > S_SIZET_MAX - b ? S_SIZET_MAX : a + b;
+}
+
+/*
+ * Aho-Corasick construction: trie, failure links (BFS), and state
+ * renumbering (states with matches first)
+ */
+
+static uint32_t sms_trie(struct SMSearch *m, uint32_t *tt, uint32_t *toid,
+			 const char *const *t, const size_t *ts)
+{
+	size_t i, j;
+	uint32_t ns = 1, st, nx, *r;
+	for (i = m->n; i-- > 0;) { /* descending, so 'same' chains ascend */
+		st = 0;
+		for (j = 0; j < ts[i]; j++) {
+			r = tt + (size_t)st * m->nc + m->cls[(uint8_t)t[i][j]];
+			nx = *r;
+			if (!nx)
+				*r = nx = ns++;
+			st = nx;
+		}
+		m->same[i] = toid[st];
+		toid[st] = (uint32_t)i;
+	}
+	return ns;
+}
+
+static void sms_links(uint32_t *tt, const uint32_t *toid, uint32_t *tfail,
+		      uint32_t *tdict, uint32_t *q, size_t nc)
+{
+	size_t c, qh = 0, qt = 0;
+	uint32_t s, f, u, fu;
+	tfail[0] = 0;
+	tdict[0] = SMS_NONE;
+	for (c = 0; c < nc; c++)
+		if ((u = tt[c]) != 0) {
+			tfail[u] = 0;
+			tdict[u] = SMS_NONE;
+			q[qt++] = u;
+		}
+	while (qh < qt) {
+		s = q[qh++];
+		f = tfail[s];
+		for (c = 0; c < nc; c++) {
+			u = tt[s * nc + c];
+			if (!u) { /* DFA: missing transition from failure */
+				tt[s * nc + c] = tt[f * nc + c];
+				continue;
+			}
+			fu = tt[f * nc + c];
+			tfail[u] = fu;
+			tdict[u] = toid[fu] != SMS_NONE ? fu : tdict[fu];
+			q[qt++] = u;
+		}
+	}
+}
+
+static void sms_renum(struct SMSearch *m, const uint32_t *tt,
+		      const uint32_t *toid, const uint32_t *tdict,
+		      uint32_t *perm, uint32_t ns)
+{
+	size_t c, nc = m->nc;
+	uint32_t s, k = 0;
+	for (s = 0; s < ns; s++)
+		if (toid[s] != SMS_NONE || tdict[s] != SMS_NONE)
+			perm[s] = k++;
+	m->lim = k * m->nc;
+	for (s = 0; s < ns; s++)
+		if (toid[s] == SMS_NONE && tdict[s] == SMS_NONE)
+			perm[s] = k++;
+	for (s = 0; s < ns; s++) {
+		k = perm[s];
+		for (c = 0; c < nc; c++)
+			m->tbl[k * nc + c] = perm[tt[s * nc + c]] * m->nc;
+		m->oid[k] = toid[s];
+		m->dict[k] = tdict[s] == SMS_NONE ? SMS_NONE : perm[tdict[s]];
+	}
+	m->root = perm[0] * m->nc;
+}
+
+/*
+ * Teddy construction: buckets and lookup tables
+ */
+
+#ifdef SMS_TEDDY
+static void sms_teddy_init(struct SMSearch *m)
+{
+	const char *a, *b;
+	size_t i, j, k, per;
+	uint32_t x, bit;
+	uint8_t c;
+	m->tbytes = S_MIN(m->min, SMS_TB);
+	for (i = 0; i < m->n; i++) { /* insertion sort by target prefix */
+		x = (uint32_t)i;
+		a = m->pool + m->toff[x];
+		for (j = i; j > 0; j--) {
+			b = m->pool + m->toff[m->bids[j - 1]];
+			if (memcmp(b, a, m->tbytes) <= 0)
+				break;
+			m->bids[j] = m->bids[j - 1];
+		}
+		m->bids[j] = x;
+	}
+	per = (m->n + SMS_NB - 1) / SMS_NB;
+	for (k = 0; k <= SMS_NB; k++)
+		m->bkt[k] = (uint32_t)S_MIN(k * per, m->n);
+	for (k = 0; k < SMS_TB; k++) {
+		memset(m->tlo[k], k < m->tbytes ? 0 : 0xff, 32);
+		memset(m->thi[k], k < m->tbytes ? 0 : 0xff, 32);
+	}
+	for (i = 0; i < m->n; i++) {
+		bit = 1U << (i / per);
+		a = m->pool + m->toff[m->bids[i]];
+		for (k = 0; k < m->tbytes; k++) {
+			c = (uint8_t)a[k];
+			m->tlo[k][c & 15] |= (uint8_t)bit;
+			m->tlo[k][16 + (c & 15)] |= (uint8_t)bit;
+			m->thi[k][c >> 4] |= (uint8_t)bit;
+			m->thi[k][16 + (c >> 4)] |= (uint8_t)bit;
+		}
+	}
+	for (k = 0; k < SMS_TB; k++)
+		for (i = 0; i < 256; i++)
+			m->tb[k][i] = m->tlo[k][i & 15] & m->thi[k][i >> 4];
+}
+#endif
+
+struct SMSearch *smsearch_alloc(const char *const *t, const size_t *ts,
+				size_t n)
+{
+	struct SMSearch h, *m;
+	uint8_t used[256];
+	uint32_t nc, ns, *tmp, *tt, *toid, *tfail, *tdict, *q;
+	size_t i, j, total = 0, ns_max, ms;
+	char *p;
+	RETURN_IF(!t || !ts || !n || n >= SMS_NONE, NULL);
+	memset(&h, 0, sizeof(h));
+	memset(used, 0, sizeof(used));
+	h.min = S_NPOS;
+	for (i = 0; i < n; i++) {
+		RETURN_IF(!t[i] || !ts[i], NULL); /* BEHAVIOR: empty target */
+		RETURN_IF(ts[i] >= S_SIZET_MAX - total, NULL);
+		total += ts[i];
+		h.min = S_MIN(h.min, ts[i]);
+		h.max = S_MAX(h.max, ts[i]);
+		for (j = 0; j < ts[i]; j++)
+			used[(uint8_t)t[i][j]] = 1;
+	}
+	/*
+	 * Byte classes: one per byte used in the targets, plus class 0,
+	 * shared by all the other bytes
+	 */
+	for (j = 0, i = 0; i < 256; i++)
+		j += used[i];
+	j = j < 256 ? 1 : 0;
+	for (i = 0; i < 256; i++)
+		h.cls[i] = used[i] ? (uint8_t)j++ : 0;
+	h.nc = nc = (uint32_t)j;
+	h.n = n;
+	/*
+	 * Temporary buffer: trie/DFA (one row per state), per state target,
+	 * failure and dictionary links, BFS queue, state permutation, and
+	 * the per target 'same' links
+	 */
+	ns_max = total + 1;
+	RETURN_IF(ns_max > SMS_NONE / nc, NULL); /* BEHAVIOR: too large */
+	RETURN_IF(ns_max > (S_SIZET_MAX / sizeof(uint32_t) - n) / (nc + 5),
+		  NULL);
+	tmp = (uint32_t *)s_malloc((ns_max * (nc + 5) + n) * sizeof(uint32_t));
+	RETURN_IF(!tmp, NULL); /* BEHAVIOR: out of memory */
+	tt = tmp;
+	toid = tt + ns_max * nc;
+	tfail = toid + ns_max;
+	tdict = tfail + ns_max;
+	q = tdict + ns_max;
+	h.same = q + 2 * ns_max;
+	memset(tt, 0, ns_max * nc * sizeof(uint32_t));
+	memset(toid, 0xff, ns_max * sizeof(uint32_t));
+	ns = sms_trie(&h, tt, toid, t, ts);
+	sms_links(tt, toid, tfail, tdict, q, nc);
+	/*
+	 * Final allocation
+	 */
+	ms = sms_add(sizeof(struct SMSearch) + 2 * n * sizeof(size_t),
+		     sms_add(((size_t)ns * (nc + 2) + 2 * n) * sizeof(uint32_t),
+			     total));
+	p = ms == S_SIZET_MAX ? NULL : (char *)s_malloc(ms);
+	if (!p) {
+		s_free(tmp);
+		return NULL; /* BEHAVIOR: out of memory */
+	}
+	m = (struct SMSearch *)p;
+	memcpy(m, &h, sizeof(h));
+	m->toff = (size_t *)(p + sizeof(struct SMSearch));
+	m->tsz = m->toff + n;
+	m->tbl = (uint32_t *)(m->tsz + n);
+	m->oid = m->tbl + (size_t)ns * nc;
+	m->dict = m->oid + ns;
+	m->same = m->dict + ns;
+	m->bids = m->same + n;
+	m->pool = (char *)(m->bids + n);
+	memcpy(m->same, h.same, n * sizeof(uint32_t));
+	sms_renum(m, tt, toid, tdict, q + ns_max, ns);
+	s_free(tmp);
+	for (i = 0, j = 0; i < n; i++) {
+		m->toff[i] = j;
+		m->tsz[i] = ts[i];
+		memcpy(m->pool + j, t[i], ts[i]);
+		j += ts[i];
+	}
+#ifdef SMS_TEDDY
+	if (n <= SMSEARCH_TEDDY_MAX)
+		sms_teddy_init(m);
+#endif
+	return m;
+}
+
+void smsearch_free(struct SMSearch *m)
+{
+	if (m)
+		s_free(m);
+}
+
+size_t smsearch_n(const struct SMSearch *m)
+{
+	return m ? m->n : 0;
+}
+
+size_t smsearch_min(const struct SMSearch *m)
+{
+	return m ? m->min : 0;
+}
+
+/*
+ * DFA search
+ */
+
+static size_t sms_ac_scan(const struct SMSearch *m, const char *s, size_t i,
+			  size_t n, smsearch_f f, void *ctx)
+{
+	size_t nm = 0;
+	uint32_t st = m->root, x, id;
+	const uint32_t *tbl = m->tbl;
+	const uint8_t *cls = m->cls;
+	for (; i < n; i++) {
+		st = tbl[st + cls[(uint8_t)s[i]]];
+		if (st >= m->lim)
+			continue;
+		for (x = st / m->nc; x != SMS_NONE; x = m->dict[x])
+			for (id = m->oid[x]; id != SMS_NONE; id = m->same[id]) {
+				nm++;
+				if (!f(ctx, i + 1 - m->tsz[id], id))
+					return nm;
+			}
+	}
+	return nm;
+}
+
+/*
+ * Leftmost match: once a match is found, the search continues until no
+ * longer target could start before it
+ */
+static size_t sms_ac_first(const struct SMSearch *m, const char *s, size_t i,
+			   size_t n, size_t *id)
+{
+	size_t o, best = S_NPOS, bid = 0;
+	uint32_t st = m->root, x, k;
+	const uint32_t *tbl = m->tbl;
+	const uint8_t *cls = m->cls;
+	for (; i < n; i++) {
+		st = tbl[st + cls[(uint8_t)s[i]]];
+		if (st >= m->lim)
+			continue;
+		for (x = st / m->nc; x != SMS_NONE; x = m->dict[x])
+			for (k = m->oid[x]; k != SMS_NONE; k = m->same[k]) {
+				o = i + 1 - m->tsz[k];
+				if (o < best || (o == best && k < bid)) {
+					best = o;
+					bid = k;
+				}
+			}
+		if (m->max < n - best)
+			n = best + m->max;
+	}
+	if (best != S_NPOS)
+		*id = bid;
+	return best;
+}
+
+/*
+ * Teddy search (f: NULL for the leftmost match)
+ */
+
+#ifdef SMS_TEDDY
+
+/*
+ * Verify the targets of the buckets 'b' at offset 'j', returning S_TRUE
+ * if done (leftmost match found, or callback stop)
+ */
+static srt_bool sms_cand(const struct SMSearch *m, const char *s, size_t j,
+			 size_t n, uint64_t b, smsearch_f f, void *ctx,
+			 size_t *nm, size_t *id)
+{
+	size_t k, kb, best = S_NPOS;
+	uint32_t x;
+	for (; b; b &= b - 1) {
+		kb = sms_ctz(b);
+		for (k = m->bkt[kb]; k < m->bkt[kb + 1]; k++) {
+			x = m->bids[k];
+			if (m->tsz[x] > n - j
+			    || memcmp(s + j, m->pool + m->toff[x], m->tsz[x]))
+				continue;
+			if (!f) {
+				best = S_MIN(best, x);
+				continue;
+			}
+			(*nm)++;
+			if (!f(ctx, j, x))
+				return S_TRUE;
+		}
+	}
+	if (best == S_NPOS)
+		return S_FALSE;
+	*id = best;
+	return S_TRUE;
+}
+
+static size_t sms_teddy(const struct SMSearch *m, const char *s, size_t i,
+			size_t n, smsearch_f f, void *ctx, size_t *nm,
+			size_t *id)
+{
+	size_t j, k, nf = 0, i0 = i, tbytes = m->tbytes;
+	uint64_t mk, b;
+	uint8_t rb[SMS_VB];
+	sms_v v, r, m15, l0, h0, l1, h1, l2, h2;
+	m15 = SMS_SET8(0x0f);
+	l0 = SMS_LOAD(m->tlo[0]);
+	h0 = SMS_LOAD(m->thi[0]);
+	l1 = SMS_LOAD(m->tlo[1]);
+	h1 = SMS_LOAD(m->thi[1]);
+	l2 = SMS_LOAD(m->tlo[2]);
+	h2 = SMS_LOAD(m->thi[2]);
+	for (; i + SMS_VB + tbytes - 1 <= n; i += SMS_VB) {
+		v = SMS_LOAD(s + i);
+		r = SMS_AND(SMS_LUT(l0, SMS_AND(v, m15)),
+			    SMS_LUT(h0, SMS_AND(SMS_HI4(v), m15)));
+		if (tbytes > 1) {
+			v = SMS_LOAD(s + i + 1);
+			r = SMS_AND(r, SMS_AND(SMS_LUT(l1, SMS_AND(v, m15)),
+					       SMS_LUT(h1, SMS_AND(SMS_HI4(v),
+								   m15))));
+		}
+		if (tbytes > 2) {
+			v = SMS_LOAD(s + i + 2);
+			r = SMS_AND(r, SMS_AND(SMS_LUT(l2, SMS_AND(v, m15)),
+					       SMS_LUT(h2, SMS_AND(SMS_HI4(v),
+								   m15))));
+		}
+		mk = SMS_MASK(r);
+		if (!mk)
+			continue;
+		SMS_STORE(rb, r);
+		for (; mk; mk &= mk - 1) {
+			j = sms_ctz(mk) / SMS_BPB;
+			if (sms_cand(m, s, i + j, n, rb[j], f, ctx, nm, id))
+				return i + j;
+			nf++;
+		}
+		if (nf > (i - i0) / SMS_FALSE_RATIO + SMS_SLACK) {
+			if (f) {
+				*nm += sms_ac_scan(m, s, i + SMS_VB, n, f, ctx);
+				return S_NPOS;
+			}
+			return sms_ac_first(m, s, i + SMS_VB, n, id);
+		}
+	}
+	for (; i + tbytes <= n; i++) {
+		for (b = 0xff, k = 0; k < tbytes; k++)
+			b &= m->tb[k][(uint8_t)s[i + k]];
+		if (b && sms_cand(m, s, i, n, b, f, ctx, nm, id))
+			return i;
+	}
+	return S_NPOS;
+}
+
+#endif
+
+size_t smsearch_first(const struct SMSearch *m, const char *s, size_t off,
+		      size_t ss, size_t *id)
+{
+	RETURN_IF(!m || !s || !id || off >= ss || ss - off < m->min, S_NPOS);
+#ifdef SMS_TEDDY
+	if (m->tbytes)
+		return sms_teddy(m, s, off, ss, NULL, NULL, NULL, id);
+#endif
+	return sms_ac_first(m, s, off, ss, id);
+}
+
+size_t smsearch_scan(const struct SMSearch *m, const char *s, size_t off,
+		     size_t ss, smsearch_f f, void *ctx)
+{
+#ifdef SMS_TEDDY
+	size_t id, nm = 0;
+#endif
+	RETURN_IF(!m || !s || !f || off >= ss || ss - off < m->min, 0);
+#ifdef SMS_TEDDY
+	if (m->tbytes) {
+		sms_teddy(m, s, off, ss, f, ctx, &nm, &id);
+		return nm;
+	}
+#endif
+	return sms_ac_scan(m, s, off, ss, f, ctx);
+}
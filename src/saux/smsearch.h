@@ -0,0 +1,73 @@
+#ifndef SMSEARCH_H
+#define SMSEARCH_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "scommon.h"
+
+/*
+ * smsearch.h
+ *
+ * Multi-pattern search (many targets, one pass over the input).
+ *
+ * Features:
+ * - Aho-Corasick automaton compiled to a dense DFA over byte classes
+ *   (bytes not present in any target share one class), with states
+ *   having matches numbered first, so the inner loop is one table load
+ *   and one compare per input byte.
+ * - Teddy filter for small sets (up to SMSEARCH_TEDDY_MAX targets):
+ *   targets are grouped in 8 buckets, and the first 1 to 3 target bytes
+ *   are checked for a whole vector of positions with nibble lookup
+ *   tables (SSSE3/AVX2 pshufb, or NEON tbl on AArch64), verifying only
+ *   the candidate positions. On inputs with too many candidates it
+ *   continues with the DFA.
+ * - Leftmost match (lowest target id on ties), or all matches through a
+ *   callback.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#define SMSEARCH_TEDDY_MAX 32
+
+struct SMSearch;
+
+/*
+ * Match callback: match offset, target id (return S_FALSE for stopping)
+ */
+typedef srt_bool (*smsearch_f)(void *ctx, size_t off, size_t id);
+
+/*
+ * Compile 'n' targets (non-empty, copied), returning NULL if out of
+ * memory, or if the automaton is too large
+ */
+struct SMSearch *smsearch_alloc(const char *const *t, const size_t *ts,
+				size_t n);
+void smsearch_free(struct SMSearch *m);
+
+/*
+ * Number of targets, and minimum target size
+ */
+size_t smsearch_n(const struct SMSearch *m);
+size_t smsearch_min(const struct SMSearch *m);
+
+/*
+ * Leftmost match in s[off, ss), setting the target id in 'id' (lowest
+ * id if more than one target matches at that offset)
+ */
+size_t smsearch_first(const struct SMSearch *m, const char *s, size_t off,
+		      size_t ss, size_t *id);
+
+/*
+ * Report all matches in s[off, ss), overlapping matches included, in no
+ * particular order, returning the number of matches reported
+ */
+size_t smsearch_scan(const struct SMSearch *m, const char *s, size_t off,
+		     size_t ss, smsearch_f f, void *ctx);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* SMSEARCH_H */
@@ -1,9 +1,10 @@
 /*
  * ssearch.c
  *
- * Real-time string search using the Rabin-Karp algorithm.
+ * Real-time string search using the Rabin-Karp algorithm, and first/last
+ * byte filter for short targets.
  *
- * Copyright (c) 2015-2019 F. Aragon. All rights reserved.
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
  */
 
@@ -14,6 +15,74 @@
 #define S_ENABLE_FIND_CSUM_FAST_TO_SLOW_ALGORITHM_SWITCH
 #endif
 
+/*
+ * ss_find_fl: vector instruction set selection (first/last byte filter)
+ */
+
+#if !defined(S_DISABLE_SIMD) && !defined(S_MINIMAL)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SSF_SIMD
+#define SSF_VB 32 /* vector size (bytes) */
+#define SSF_BPB 1 /* comparison mask bits per byte */
+typedef __m256i ssf_v;
+#define SSF_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SSF_SET8(c) _mm256_set1_epi8((char)(c))
+#define SSF_EQ8(a, b) _mm256_cmpeq_epi8(a, b)
+#define SSF_AND(a, b) _mm256_and_si256(a, b)
+#define SSF_MASK(c) ((uint64_t)(uint32_t)_mm256_movemask_epi8(c))
+
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SSF_SIMD
+#define SSF_VB 16
+#define SSF_BPB 1
+typedef __m128i ssf_v;
+#define SSF_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SSF_SET8(c) _mm_set1_epi8((char)(c))
+#define SSF_EQ8(a, b) _mm_cmpeq_epi8(a, b)
+#define SSF_AND(a, b) _mm_and_si128(a, b)
+#define SSF_MASK(c) ((uint64_t)(uint32_t)_mm_movemask_epi8(c))
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SSF_SIMD
+#define SSF_VB 16
+#define SSF_BPB 4 /* 16-to-8 bit narrowing shift (no movemask) */
+typedef uint8x16_t ssf_v;
+#define SSF_LOAD(p) vld1q_u8((const uint8_t *)(p))
+#define SSF_SET8(c) vdupq_n_u8((uint8_t)(c))
+#define SSF_EQ8(a, b) vceqq_u8(a, b)
+#define SSF_AND(a, b) vandq_u8(a, b)
+#define SSF_MASK(c)                                                            \
+	(vget_lane_u64(vreinterpret_u64_u8(                                    \
+			       vshrn_n_u16(vreinterpretq_u16_u8(c), 4)),       \
+		       0)                                                      \
+	 & 0x8888888888888888ULL) /* one bit per byte */
+
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ssf_ctz(m) ((size_t)__builtin_ctzll(m))
+#else
+#define ssf_ctz(m) ((size_t)slog2_64((m) & (~(m) + 1)))
+#endif
+
+#ifndef SSF_SIMD
+#define SSF_VB 8 /* SWAR: 64-bit words */
+#define SSF_BPB 8
+#endif
+
+/*
+ * False candidates allowed before switching to the checksum search: one
+ * per SSF_FALSE_RATIO bytes scanned, plus SSF_SLACK (being the target
+ * size limited to SS_FIND_FL_MAX, the verification cost is bounded)
+ */
+#define SSF_FALSE_RATIO 8
+#define SSF_SLACK 64
+
 /*
  * ss_find_csum_* helpers
  */
@@ -38,8 +107,10 @@
 			csum_collision_count = 1;                              \
 		} else {                                                       \
 			if (++csum_collision_count > (2 + ts / 2)) {           \
-				return ss_find_csum_slow(s0, (size_t)(s - s0), \
-							 ss, t, ts);           \
+				/* continue after current window start */      \
+				return ss_find_csum_slow(                      \
+					s0, (size_t)(s - s0) - ts + 1, ss, t,  \
+					ts);                                   \
 			}                                                      \
 		}                                                              \
 	}
@@ -143,3 +214,115 @@ size_t ss_find_csum_fast(const char *s0, size_t off, size_t ss, const char *t,
 	S_FIND_CSUM_SEARCH2(FCSUM_FAST, S_FIND_CSUM_ALG_SWITCH);
 	return S_NPOS;
 }
+
+/*
+ * First/last byte filter: every block of SSF_VB positions is compared
+ * against the target first, second, and last bytes (three loads per
+ * block, at offsets 0, 1, and ts - 1), verifying only the positions where
+ * all match. Adversarial inputs (e.g. many positions passing the filter)
+ * would make it slow, so once the false candidates go over the limit,
+ * the search continues with ss_find_csum_fast(), keeping the real-time
+ * guarantee.
+ */
+size_t ss_find_fl(const char *s0, size_t off, size_t ss, const char *t,
+		  size_t ts)
+{
+	uint64_t m;
+	const char *s;
+	size_t i = 0, j, n, nf = 0;
+#ifdef SSF_SIMD
+	ssf_v vf, v2, vl;
+#else
+	uint64_t x, wf, w2, wl;
+	const uint64_t w1 = 0x0101010101010101ULL,
+		       w7 = 0x7f7f7f7f7f7f7f7fULL;
+#endif
+	RETURN_IF(off >= ss || ss - off < ts, S_NPOS);
+	if (ts < 2)
+		return ss_find_csum_fast(s0, off, ss, t, ts);
+	s = s0 + off;
+	n = ss - off - ts + 1; /* candidate positions */
+#ifdef SSF_SIMD
+	vf = SSF_SET8(t[0]);
+	v2 = SSF_SET8(t[1]);
+	vl = SSF_SET8(t[ts - 1]);
+#else
+	wf = w1 * (unsigned char)t[0];
+	w2 = w1 * (unsigned char)t[1];
+	wl = w1 * (unsigned char)t[ts - 1];
+#endif
+	for (; i + SSF_VB <= n; i += SSF_VB) {
+#ifdef SSF_SIMD
+		m = SSF_MASK(SSF_AND(
+			SSF_AND(SSF_EQ8(SSF_LOAD(s + i), vf),
+				SSF_EQ8(SSF_LOAD(s + i + 1), v2)),
+			SSF_EQ8(SSF_LOAD(s + i + ts - 1), vl)));
+#else
+		/* zero bytes: positions matching the three bytes */
+		x = (S_LD_LE_U64(s + i) ^ wf) | (S_LD_LE_U64(s + i + 1) ^ w2)
+		    | (S_LD_LE_U64(s + i + ts - 1) ^ wl);
+		m = ~(((x & w7) + w7) | x | w7);
+#endif
+		for (; m; m &= m - 1) {
+			j = i + ssf_ctz(m) / SSF_BPB;
+			if (!memcmp(s + j + 2, t + 2, ts - 2))
+				return off + j;
+			nf++;
+		}
+		if (nf > i / SSF_FALSE_RATIO + SSF_SLACK)
+			return ss_find_csum_fast(s0, off + i + SSF_VB, ss, t,
+						 ts);
+	}
+	for (; i < n; i++)
+		if (s[i] == t[0] && s[i + ts - 1] == t[ts - 1]
+		    && !memcmp(s + i + 1, t + 1, ts - 2))
+			return off + i;
+	return S_NPOS;
+}
+
+void ss_find_pat_init(struct SSearchPat *p, const char *t, size_t ts)
+{
+	size_t i, d;
+	uint32_t dmax = (uint32_t)S_MIN(ts, 0xffffffff);
+	p->t = t;
+	p->ts = ts;
+	for (i = 0; i < 256; i++)
+		p->shift[i] = dmax;
+	for (i = 0; i + 1 < ts; i++) { /* shift: distance to the last byte */
+		d = ts - 1 - i;
+		p->shift[(unsigned char)t[i]] = (uint32_t)S_MIN(d, dmax);
+	}
+}
+
+/*
+ * Boyer-Moore-Horspool (shorter shifts than the maximum, capped to 32 bits
+ * for huge targets, are still valid). The verification work (target size
+ * per window matching the last byte but not the target) is limited to the
+ * scanned size plus SSF_SLACK targets, continuing with ss_find_csum_fast()
+ * when over the limit.
+ */
+size_t ss_find_pat(const char *s0, size_t off, size_t ss,
+		   const struct SSearchPat *p)
+{
+	unsigned char c;
+	const char *s, *t = p->t;
+	size_t i = 0, n, ts = p->ts, work = 0;
+	RETURN_IF(!ts || off >= ss || ss - off < ts, S_NPOS);
+	if (ts <= SS_FIND_FL_MAX)
+		return ss_find_fl(s0, off, ss, t, ts);
+	s = s0 + off;
+	n = ss - off - ts + 1; /* candidate positions */
+	while (i < n) {
+		c = (unsigned char)s[i + ts - 1];
+		if (c == (unsigned char)t[ts - 1]) {
+			if (!memcmp(s + i, t, ts - 1))
+				return off + i;
+			work += ts;
+			if (work > i + ts * SSF_SLACK)
+				return ss_find_csum_fast(s0, off + i + 1, ss, t,
+							 ts);
+		}
+		i += p->shift[c];
+	}
+	return S_NPOS;
+}
@@ -9,14 +9,19 @@ extern "C" {
 /*
  * ssearch.h
  *
- * Real-time string search using the Rabin-Karp algorithm.
+ * Real-time string search using the Rabin-Karp algorithm, and first/last
+ * byte filter for short targets.
  *
  * Features:
  * - Real-time search (O(n) time complexity).
  * - Search in raw data.
  * - Over 1 GB/s sustained speed on 3-way 3GHz OooE CPU (single thread).
+ * - Short targets (SS_FIND_FL_MIN to SS_FIND_FL_MAX bytes): SSE2, AVX2 or
+ *   NEON (AArch64) first/last byte filter, selected at compile time, with
+ *   a SWAR (64-bit word) fallback for other targets or for builds with
+ *   S_DISABLE_SIMD or S_MINIMAL defined.
  *
- * Copyright (c) 2015-2019 F. Aragon. All rights reserved.
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
  *
  * O(n) string search using a rolling hash. Two hashes are used, one more
@@ -52,6 +57,10 @@ extern "C" {
  * ss_find_csum_slow: O(n) (half the speed of ss_find_csum_fast in good cases,
  * and just a bit faster in worst cases -as the "fast" algorithm switch
  * requires recomputing again the hash of the target pattern-).
+ * ss_find_fl: O(n), because it switches to ss_find_csum_fast() when the
+ * false candidates (positions matching the target first, second, and
+ * last bytes) get over one per 8 bytes scanned. In good cases it scans 16
+ * or 32 bytes per step (SIMD) or 8 (SWAR), instead of one.
  *
  * References:
  *   - Rabin-Karp search algorithm (search using a rolling hash)
@@ -103,8 +112,26 @@ extern "C" {
 #undef S_ENABLE_FIND_CSUM_INNER_LOOP_UNROLLING
 #endif
 
+#define SS_FIND_FL_MIN 2
+#define SS_FIND_FL_MAX 64
+
+/*
+ * Precomputed search (repeated search of the same target): first/last
+ * byte filter for short targets, and Boyer-Moore-Horspool for longer
+ * ones (bad character shift table computed once, switching to the
+ * checksum search on adversarial inputs)
+ */
+struct SSearchPat {
+	const char *t;
+	size_t ts;
+	uint32_t shift[256];
+};
+
 size_t ss_find_csum_slow(const char *s0, size_t off, size_t ss, const char *t, size_t ts);
 size_t ss_find_csum_fast(const char *s0, size_t off, size_t ss, const char *t, size_t ts);
+size_t ss_find_fl(const char *s0, size_t off, size_t ss, const char *t, size_t ts);
+void ss_find_pat_init(struct SSearchPat *p, const char *t, size_t ts);
+size_t ss_find_pat(const char *s0, size_t off, size_t ss, const struct SSearchPat *p);
 
 #ifdef __cplusplus
 } /* extern "C" { */
@@ -8,6 +8,96 @@
  */
 
 #include "ssort.h"
+#ifdef S_PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * Internal constants
+ */
+
+/*
+ * Minimum number of elements for using the LSD radix sort (below that, the
+ * in-place MSD radix sort is faster, as the histogram and scratch buffer
+ * setup is not amortized). See the "sort crossover" section in bench.cc.
+ */
+#ifndef SSORT_LSD_MIN_ELEMS_16
+#define SSORT_LSD_MIN_ELEMS_16 256
+#endif
+#ifndef SSORT_LSD_MIN_ELEMS_32
+#define SSORT_LSD_MIN_ELEMS_32 1024
+#endif
+#ifndef SSORT_LSD_MIN_ELEMS_64
+#define SSORT_LSD_MIN_ELEMS_64 768
+#endif
+
+#define SSORT_LSD_BITS 11 /* max LSD digit size */
+#define SSORT_LSD_CNT(TC, DBITS)                                               \
+	(((sizeof(TC) * 8 + (DBITS)-1) / (DBITS)) << (DBITS))
+
+/*
+ * Parallel sort: minimum number of elements for using more than one thread,
+ * maximum number of threads, and MSD partitioning pass bucket count
+ */
+#ifndef SSORT_PAR_MIN_ELEMS
+#define SSORT_PAR_MIN_ELEMS 65536
+#endif
+#define SSORT_PAR_MAX_THREADS 64
+#define SSORT_PAR_NB 256
+
+/*
+ * Generic element sort: insertion sort threshold, ninther pivot selection
+ * threshold, and partial insertion sort element move limit
+ */
+#define SSORT_GEN_INS 24
+#define SSORT_GEN_NINTHER 128
+#define SSORT_GEN_PINS_LIMIT 8
+#define SSORT_MERGE_RUN 16 /* stable sort: insertion sorted run size */
+#define SSORT_SEL_INS 16   /* radix select: insertion sort threshold */
+
+#define SSORT_KEY(TC, x, OFF) ((TC)((TC)(x) + (OFF)))
+#define SSORT_PAR_BKT(TC, x, OFF, sh)                                          \
+	((size_t)((SSORT_KEY(TC, x, OFF) >> (sh)) & (SSORT_PAR_NB - 1)))
+#define SSORT_FLIP(TC, x, sb) ((x) ^ (((x) & (sb)) ? (TC)~(TC)0 : (sb)))
+#define SSORT_UNFLIP(TC, x, sb) ((x) ^ (((x) & (sb)) ? (sb) : (TC)~(TC)0))
+#define SSORT_SEL_LESS(TC, a, b, OFF)                                          \
+	(SSORT_KEY(TC, a, OFF) < SSORT_KEY(TC, b, OFF))
+#define SSORT_SEL_DIGIT(TC, x, OFF, sh) ((SSORT_KEY(TC, x, OFF) >> (sh)) & 0xff)
+
+/*
+ * Internal data structures
+ */
+
+struct SSortGen {
+	char *b;
+	size_t es;
+	int (*cmpf)(const void *, const void *);
+	int64_t (*keyf)(const void *);
+	int64_t *k; /* extracted keys (key sort) */
+	size_t is;  /* item size (stable sort: es, index sort: index size) */
+};
+
+struct SSortPar;
+struct SSortParThr;
+
+typedef void (*ssort_par_wf)(struct SSortPar *c, struct SSortParThr *a);
+
+struct SSortParThr {
+	struct SSortPar *c;
+	size_t id, i0, i1; /* thread id, chunk */
+	size_t *cnt, *lc;  /* partitioning counters, LSD sort counters */
+	uint64_t acc;
+};
+
+struct SSortPar {
+	void *b, *tmp;
+	size_t elems, elem_size, nthreads, phase, shift;
+	srt_bool fp;
+	ssort_par_wf wf;
+	int (*cmpf)(const void *, const void *);
+	size_t owner[SSORT_PAR_NB], bkt[SSORT_PAR_NB + 1];
+	struct SSortParThr t[SSORT_PAR_MAX_THREADS];
+};
 
 /*
  * Templates
@@ -46,8 +136,8 @@
 #define BUILD_SORT3(FN, T, SWAPF, SORT2F)                                      \
 	S_INLINE void FN(T *b)                                                 \
 	{                                                                      \
-		if (b[0] > b[2])                                               \
-			SWAPF(b, 0, 2);                                        \
+		SORT2F(b);                                                     \
+		SORT2F(b + 1);                                                 \
 		SORT2F(b);                                                     \
 	}
 
@@ -58,10 +148,9 @@
 		SORT2F(b + 2);                                                 \
 		if (b[2] < b[0])                                               \
 			SWAPF(b, 0, 2);                                        \
+		if (b[3] < b[1])                                               \
+			SWAPF(b, 1, 3);                                        \
 		SORT2F(b + 1);                                                 \
-		if (b[2] < b[1])                                               \
-			SWAPF(b, 1, 2);                                        \
-		SORT2F(b + 2);                                                 \
 	}
 
 #define BUILD_MSD_RADIX_SORT(FN, T, TC, MSBF, SWPF, S2F, S3F, S4F, OFF)        \
@@ -119,8 +208,828 @@
 			FN##_aux(acc, MSBF(acc), b, elems);                    \
 	}
 
+/*
+ * LSD radix sort: one histogram pass for all digits, then one stable
+ * scatter pass per digit, ping-ponging between the input and a scratch
+ * buffer. Digits having the same value for all the elements are skipped.
+ */
+#define BUILD_LSD_RADIX_SORT(FN, T, TC, OFF, DBITS)                            \
+	static void FN##_buf(T *b, size_t elems, T *dst, size_t *cnt)          \
+	{                                                                      \
+		size_t i, d, sh, acc, tmpc, *c,                                \
+			nd = (sizeof(TC) * 8 + (DBITS)-1) / (DBITS),           \
+			nb = (size_t)1 << (DBITS), mask = nb - 1;              \
+		TC k;                                                          \
+		T *src = b, *t;                                                \
+		memset(cnt, 0, sizeof(size_t) * nd * nb);                      \
+		for (i = 0; i < elems; i++) {                                  \
+			k = (TC)((TC)b[i] + (OFF));                            \
+			for (d = sh = 0; d < nd; d++, sh += (DBITS))           \
+				cnt[d * nb + ((k >> sh) & mask)]++;            \
+		}                                                              \
+		for (d = sh = 0; d < nd; d++, sh += (DBITS)) {                 \
+			c = cnt + d * nb;                                      \
+			k = (TC)((TC)src[0] + (OFF));                          \
+			if (c[(k >> sh) & mask] == elems)                      \
+				continue; /* constant digit */                 \
+			for (i = acc = 0; i < nb; i++) {                       \
+				tmpc = c[i];                                   \
+				c[i] = acc;                                    \
+				acc += tmpc;                                   \
+			}                                                      \
+			for (i = 0; i < elems; i++) {                          \
+				k = (TC)((TC)src[i] + (OFF));                  \
+				dst[c[(k >> sh) & mask]++] = src[i];           \
+			}                                                      \
+			t = src;                                               \
+			src = dst;                                             \
+			dst = t;                                               \
+		}                                                              \
+		if (src != b)                                                  \
+			memcpy(b, src, sizeof(T) * elems);                     \
+	}                                                                      \
+	static srt_bool FN(T *b, size_t elems)                                 \
+	{                                                                      \
+		size_t *cnt, ncnt = SSORT_LSD_CNT(TC, DBITS);                  \
+		RETURN_IF(elems > S_SIZET_MAX / sizeof(T) - ncnt, S_FALSE);    \
+		cnt = (size_t *)s_malloc(sizeof(size_t) * ncnt                 \
+					 + sizeof(T) * elems);                 \
+		RETURN_IF(!cnt, S_FALSE);                                      \
+		FN##_buf(b, elems, (T *)(cnt + ncnt), cnt);                    \
+		s_free(cnt);                                                   \
+		return S_TRUE;                                                 \
+	}
+
+/*
+ * Parallel radix sort: MSD partitioning pass into SSORT_PAR_NB buckets,
+ * using the 8 most significant bits not shared by all the elements (per
+ * chunk histograms and stable scatter into the scratch buffer), followed
+ * by the per-bucket sorts (buckets distributed to threads by size, each
+ * bucket using its scratch buffer area for the LSD sort).
+ */
+#define BUILD_PAR_RADIX_SORT(FN, T, TC, OFF, MSBF, LSDF, MSDF, LSD_MIN)        \
+	static void FN##_w(struct SSortPar *c, struct SSortParThr *a)          \
+	{                                                                      \
+		T *b = (T *)c->b, *tmp = (T *)c->tmp;                          \
+		size_t i, j, e, *h = a->cnt, i0 = a->i0, i1 = a->i1;           \
+		TC k, kp, acc = 0, sb = (TC)((TC)1 << (sizeof(TC) * 8 - 1));   \
+		switch (c->phase) {                                            \
+		case 0: /* FP key flip, bits changing across the chunk */      \
+			for (i = i0; c->fp && i < i1; i++)                     \
+				b[i] = (T)SSORT_FLIP(TC, b[i], sb);            \
+			kp = SSORT_KEY(TC, b[i0], OFF);                        \
+			for (i = i0 + 1; i < i1; i++, kp = k) {                \
+				k = SSORT_KEY(TC, b[i], OFF);                  \
+				acc |= (TC)(k ^ kp);                           \
+			}                                                      \
+			a->acc = acc;                                          \
+			break;                                                 \
+		case 1: /* chunk histogram */                                  \
+			memset(h, 0, sizeof(size_t) * SSORT_PAR_NB);           \
+			for (i = i0; i < i1; i++)                              \
+				h[SSORT_PAR_BKT(TC, b[i], OFF, c->shift)]++;   \
+			break;                                                 \
+		case 2: /* chunk scatter (h: chunk offsets per bucket) */      \
+			for (i = i0; i < i1; i++) {                            \
+				j = SSORT_PAR_BKT(TC, b[i], OFF, c->shift);    \
+				tmp[h[j]++] = b[i];                            \
+			}                                                      \
+			break;                                                 \
+		case 3: /* bucket sort, using the bucket scratch area */       \
+			for (j = 0; j < SSORT_PAR_NB; j++) {                   \
+				if (c->owner[j] != a->id)                      \
+					continue;                              \
+				i = c->bkt[j];                                 \
+				e = c->bkt[j + 1] - i;                         \
+				memcpy(b + i, tmp + i, e * sizeof(T));         \
+				if (e >= (LSD_MIN))                            \
+					LSDF##_buf(b + i, e, tmp + i, a->lc);  \
+				else if (e > 1)                                \
+					MSDF(b + i, e);                        \
+				for (e += i; c->fp && i < e; i++)              \
+					b[i] = (T)SSORT_UNFLIP(TC, b[i], sb);  \
+			}                                                      \
+			break;                                                 \
+		}                                                              \
+	}                                                                      \
+	static srt_bool FN(T *b, size_t elems, size_t nthreads, srt_bool fp)   \
+	{                                                                      \
+		struct SSortPar c;                                             \
+		size_t i, j, acc;                                              \
+		TC k, k0, kacc = 0;                                            \
+		RETURN_IF(!ssort_par_init(&c, elems, sizeof(T), nthreads,      \
+					  SSORT_LSD_CNT(TC, SSORT_LSD_BITS)),  \
+			  S_FALSE);                                            \
+		c.b = b;                                                       \
+		c.fp = fp;                                                     \
+		c.wf = (ssort_par_wf)FN##_w;                                   \
+		ssort_par_run(&c, 0);                                          \
+		k0 = SSORT_KEY(TC, b[0], OFF);                                 \
+		for (i = 0; i < c.nthreads; i++) {                             \
+			k = SSORT_KEY(TC, b[c.t[i].i0], OFF);                  \
+			kacc |= (TC)(c.t[i].acc | (k ^ k0));                   \
+		}                                                              \
+		i = kacc ? slog2_64(MSBF(kacc)) : 0;                           \
+		c.shift = i >= 7 ? i - 7 : 0;                                  \
+		ssort_par_run(&c, 1);                                          \
+		for (j = acc = 0; j < SSORT_PAR_NB; j++) {                     \
+			c.bkt[j] = acc;                                        \
+			for (i = 0; i < c.nthreads; i++) {                     \
+				acc += c.t[i].cnt[j];                          \
+				c.t[i].cnt[j] = acc - c.t[i].cnt[j];           \
+			}                                                      \
+		}                                                              \
+		c.bkt[SSORT_PAR_NB] = acc;                                     \
+		ssort_par_run(&c, 2);                                          \
+		ssort_par_balance(&c);                                         \
+		ssort_par_run(&c, 3);                                          \
+		ssort_par_free(&c);                                            \
+		return S_TRUE;                                                 \
+	}
+
+/*
+ * Radix select: histogram of the current range 8-bit digit (MSD first),
+ * 3-way partition around the digit holding the k-th element, and repeat
+ * on its bucket (at most sizeof(T) passes over shrinking ranges: O(n))
+ */
+#define BUILD_RADIX_SELECT(FN, T, TC, OFF)                                     \
+	static void FN##_ins(T *b, size_t lo, size_t hi)                       \
+	{                                                                      \
+		T t;                                                           \
+		size_t i, j;                                                   \
+		for (i = lo + 1; i < hi; i++)                                  \
+			for (j = i; j > lo; j--) {                             \
+				if (!SSORT_SEL_LESS(TC, b[j], b[j - 1], OFF))  \
+					break;                                 \
+				t = b[j];                                      \
+				b[j] = b[j - 1];                               \
+				b[j - 1] = t;                                  \
+			}                                                      \
+	}                                                                      \
+	void FN(T *b, size_t elems, size_t k)                                  \
+	{                                                                      \
+		T t;                                                           \
+		TC x, d;                                                       \
+		size_t i, lt, gt, acc, lo = 0, hi = elems, cnt[256];           \
+		unsigned sh = (sizeof(T) - 1) * 8;                             \
+		SSORT_SEL_CHECK(b, elems, k);                                  \
+		for (;; sh -= 8) {                                             \
+			if (hi - lo <= SSORT_SEL_INS) {                        \
+				FN##_ins(b, lo, hi);                           \
+				return;                                        \
+			}                                                      \
+			memset(cnt, 0, sizeof(cnt));                           \
+			for (i = lo; i < hi; i++)                              \
+				cnt[SSORT_SEL_DIGIT(TC, b[i], OFF, sh)]++;     \
+			for (d = 0, acc = lo; acc + cnt[d] <= k; d++)          \
+				acc += cnt[d];                                 \
+			if (cnt[d] < hi - lo) {                                \
+				for (lt = i = lo, gt = hi; i < gt;) {          \
+					x = (TC)SSORT_SEL_DIGIT(TC, b[i], OFF, \
+								sh);           \
+					if (x < d) {                           \
+						t = b[lt];                     \
+						b[lt++] = b[i];                \
+						b[i++] = t;                    \
+					} else if (x > d) {                    \
+						t = b[--gt];                   \
+						b[gt] = b[i];                  \
+						b[i] = t;                      \
+					} else {                               \
+						i++;                           \
+					}                                      \
+				}                                              \
+				lo = lt;                                       \
+				hi = gt;                                       \
+			}                                                      \
+			if (!sh)                                               \
+				return;                                        \
+		}                                                              \
+	}
+
+/*
+ * Top-k (integer keys, i.e. after SSORT_KEY/SSORT_FLIP): the input is
+ * streamed through a 2k element buffer (the output), discarding elements
+ * not above the current k-th largest, and selecting the k largest every
+ * time the buffer gets full (O(n) total, with no extra space)
+ */
+#define BUILD_TOP_K(FN, T, TC, KEY, UNKEY, P, SELF, SORTF)                     \
+	size_t FN(const T *b, size_t elems, size_t k, T *o)                    \
+	{                                                                      \
+		TC x, thr = 0, *u = (TC *)o;                                   \
+		const TC *in = (const TC *)b;                                  \
+		size_t i, n = 0, m;                                            \
+		srt_bool full = S_FALSE;                                       \
+		RETURN_IF(!b || !o || !k, 0);                                  \
+		m = k <= elems / 2 ? 2 * k : elems;                            \
+		for (i = 0; i < elems; i++) {                                  \
+			x = KEY(TC, in[i], P);                                 \
+			if (full && x <= thr)                                  \
+				continue;                                      \
+			u[n++] = x;                                            \
+			if (n == m && n > k) {                                 \
+				SELF(u, n, n - k);                             \
+				memmove(u, u + n - k, k * sizeof(TC));         \
+				n = k;                                         \
+				thr = u[0];                                    \
+				full = S_TRUE;                                 \
+			}                                                      \
+		}                                                              \
+		if (n > k) {                                                   \
+			SELF(u, n, n - k);                                     \
+			memmove(u, u + n - k, k * sizeof(TC));                 \
+			n = k;                                                 \
+		}                                                              \
+		SORTF(u, n);                                                   \
+		for (i = 0; i < n / 2; i++) {                                  \
+			x = u[i];                                              \
+			u[i] = u[n - 1 - i];                                   \
+			u[n - 1 - i] = x;                                      \
+		}                                                              \
+		for (i = 0; i < n; i++)                                        \
+			u[i] = UNKEY(TC, u[i], P);                             \
+		return n;                                                      \
+	}
+
+/*
+ * Pattern-defeating quicksort (index-based, so the same code is used for
+ * comparison callback and extracted key sorts): median of 3 pivot (ninther
+ * for large partitions), equal element partitioning when the pivot equals
+ * the preceding partition pivot, partial insertion sort for already sorted
+ * partitions, and heap sort after log2(n) unbalanced partitions, for
+ * O(n log n) worst case.
+ */
+#define BUILD_PDQSORT(FN, CTX, LESS, SWAP)                                     \
+	static void FN##_sort2(CTX *c, size_t i, size_t j)                     \
+	{                                                                      \
+		if (LESS(c, j, i))                                             \
+			SWAP(c, i, j);                                         \
+	}                                                                      \
+	static void FN##_sort3(CTX *c, size_t i, size_t j, size_t k)           \
+	{                                                                      \
+		FN##_sort2(c, i, j);                                           \
+		FN##_sort2(c, j, k);                                           \
+		FN##_sort2(c, i, j);                                           \
+	}                                                                      \
+	static void FN##_ins(CTX *c, size_t lo, size_t hi)                     \
+	{                                                                      \
+		size_t i, j;                                                   \
+		for (i = lo + 1; i < hi; i++)                                  \
+			for (j = i; j > lo && LESS(c, j, j - 1); j--)          \
+				SWAP(c, j, j - 1);                             \
+	}                                                                      \
+	static srt_bool FN##_partial_ins(CTX *c, size_t lo, size_t hi)         \
+	{                                                                      \
+		size_t i, j, moves = 0;                                        \
+		for (i = lo + 1; i < hi; i++)                                  \
+			for (j = i; j > lo && LESS(c, j, j - 1); j--) {        \
+				if (++moves > SSORT_GEN_PINS_LIMIT)            \
+					return S_FALSE;                        \
+				SWAP(c, j, j - 1);                             \
+			}                                                      \
+		return S_TRUE;                                                 \
+	}                                                                      \
+	static void FN##_sift(CTX *c, size_t lo, size_t r, size_t n)           \
+	{                                                                      \
+		size_t ch;                                                     \
+		for (; (ch = 2 * r + 1) < n; r = ch) {                         \
+			if (ch + 1 < n && LESS(c, lo + ch, lo + ch + 1))       \
+				ch++;                                          \
+			if (!LESS(c, lo + r, lo + ch))                         \
+				break;                                         \
+			SWAP(c, lo + r, lo + ch);                              \
+		}                                                              \
+	}                                                                      \
+	static void FN##_heap(CTX *c, size_t lo, size_t hi)                    \
+	{                                                                      \
+		size_t i, n = hi - lo;                                         \
+		for (i = n / 2; i > 0; i--)                                    \
+			FN##_sift(c, lo, i - 1, n);                            \
+		for (i = n - 1; i > 0; i--) {                                  \
+			SWAP(c, lo, lo + i);                                   \
+			FN##_sift(c, lo, 0, i);                                \
+		}                                                              \
+	}                                                                      \
+	static size_t FN##_part_r(CTX *c, size_t lo, size_t hi, srt_bool *ok)  \
+	{                                                                      \
+		size_t f = lo + 1, l = hi - 1;                                 \
+		for (; f < hi && LESS(c, f, lo); f++)                          \
+			;                                                      \
+		for (; l >= f && !LESS(c, l, lo); l--)                         \
+			;                                                      \
+		*ok = l < f ? S_TRUE : S_FALSE;                                \
+		while (f < l) {                                                \
+			SWAP(c, f, l);                                         \
+			for (f++; LESS(c, f, lo); f++)                         \
+				;                                              \
+			for (l--; !LESS(c, l, lo); l--)                        \
+				;                                              \
+		}                                                              \
+		SWAP(c, lo, f - 1);                                            \
+		return f - 1;                                                  \
+	}                                                                      \
+	static size_t FN##_part_l(CTX *c, size_t lo, size_t hi)                \
+	{                                                                      \
+		size_t f = lo + 1, l = hi - 1;                                 \
+		for (; l > lo && LESS(c, lo, l); l--)                          \
+			;                                                      \
+		for (; f < l && !LESS(c, lo, f); f++)                          \
+			;                                                      \
+		while (f < l) {                                                \
+			SWAP(c, f, l);                                         \
+			for (l--; LESS(c, lo, l); l--)                         \
+				;                                              \
+			for (f++; !LESS(c, lo, f); f++)                        \
+				;                                              \
+		}                                                              \
+		SWAP(c, lo, l);                                                \
+		return l;                                                      \
+	}                                                                      \
+	static void FN##_loop(CTX *c, size_t lo, size_t hi, size_t bad,        \
+			      srt_bool leftmost)                               \
+	{                                                                      \
+		size_t n, m, p, ln, rn;                                        \
+		srt_bool ok;                                                   \
+		while ((n = hi - lo) > SSORT_GEN_INS) {                        \
+			m = lo + n / 2;                                        \
+			if (n > SSORT_GEN_NINTHER) {                           \
+				FN##_sort3(c, lo, m, hi - 1);                  \
+				FN##_sort3(c, lo + 1, m - 1, hi - 2);          \
+				FN##_sort3(c, lo + 2, m + 1, hi - 3);          \
+				FN##_sort3(c, m - 1, m, m + 1);                \
+				SWAP(c, lo, m);                                \
+			} else {                                               \
+				FN##_sort3(c, m, lo, hi - 1);                  \
+			}                                                      \
+			if (!leftmost && !LESS(c, lo - 1, lo)) {               \
+				lo = FN##_part_l(c, lo, hi) + 1;               \
+				continue;                                      \
+			}                                                      \
+			p = FN##_part_r(c, lo, hi, &ok);                       \
+			ln = p - lo;                                           \
+			rn = hi - p - 1;                                       \
+			if (ln < n / 8 || rn < n / 8) {                        \
+				if (!--bad) {                                  \
+					FN##_heap(c, lo, hi);                  \
+					return;                                \
+				}                                              \
+				if (ln >= SSORT_GEN_INS) {                     \
+					SWAP(c, lo, lo + ln / 4);              \
+					SWAP(c, p - 1, p - ln / 4);            \
+				}                                              \
+				if (rn >= SSORT_GEN_INS) {                     \
+					SWAP(c, p + 1, p + 1 + rn / 4);        \
+					SWAP(c, hi - 1, hi - rn / 4);          \
+				}                                              \
+			} else if (ok && FN##_partial_ins(c, lo, p)            \
+				   && FN##_partial_ins(c, p + 1, hi)) {        \
+				return;                                        \
+			}                                                      \
+			if (ln < rn) {                                         \
+				FN##_loop(c, lo, p, bad, leftmost);            \
+				lo = p + 1;                                    \
+				leftmost = S_FALSE;                            \
+			} else {                                               \
+				FN##_loop(c, p + 1, hi, bad, S_FALSE);         \
+				hi = p;                                        \
+			}                                                      \
+		}                                                              \
+		FN##_ins(c, lo, hi);                                           \
+	}                                                                      \
+	static void FN(CTX *c, size_t elems)                                   \
+	{                                                                      \
+		size_t bad = 1, n = elems;                                     \
+		for (; n >>= 1;)                                               \
+			bad++;                                                 \
+		FN##_loop(c, 0, elems, bad, S_TRUE);                           \
+	}
+
+/*
+ * Introselect: quickselect using the pdqsort partitioning (equal elements
+ * grouped when the pivot equals the previous one), with heap sort of the
+ * remaining range after log2(n) unbalanced partitions
+ */
+#define BUILD_PDQSELECT(FN, CTX, LESS, SWAP, PDQ)                              \
+	static void FN(CTX *c, size_t elems, size_t k)                         \
+	{                                                                      \
+		size_t n, m, p, lo = 0, hi = elems, bad = 1;                   \
+		srt_bool ok, leftmost = S_TRUE;                                \
+		for (n = elems; n >>= 1;)                                      \
+			bad++;                                                 \
+		while ((n = hi - lo) > SSORT_GEN_INS) {                        \
+			m = lo + n / 2;                                        \
+			if (n > SSORT_GEN_NINTHER) {                           \
+				PDQ##_sort3(c, lo, m, hi - 1);                 \
+				PDQ##_sort3(c, lo + 1, m - 1, hi - 2);         \
+				PDQ##_sort3(c, lo + 2, m + 1, hi - 3);         \
+				PDQ##_sort3(c, m - 1, m, m + 1);               \
+				SWAP(c, lo, m);                                \
+			} else {                                               \
+				PDQ##_sort3(c, m, lo, hi - 1);                 \
+			}                                                      \
+			if (!leftmost && !LESS(c, lo - 1, lo)) {               \
+				p = PDQ##_part_l(c, lo, hi);                   \
+				if (k <= p)                                    \
+					return;                                \
+				lo = p + 1;                                    \
+				continue;                                      \
+			}                                                      \
+			p = PDQ##_part_r(c, lo, hi, &ok);                      \
+			if ((p - lo < n / 8 || hi - p - 1 < n / 8) && !--bad) { \
+				PDQ##_heap(c, lo, hi);                         \
+				return;                                        \
+			}                                                      \
+			if (k == p)                                            \
+				return;                                        \
+			if (k < p) {                                           \
+				hi = p;                                        \
+			} else {                                               \
+				lo = p + 1;                                    \
+				leftmost = S_FALSE;                            \
+			}                                                      \
+		}                                                              \
+		PDQ##_ins(c, lo, hi);                                          \
+	}
+
+#define SSORT_SWAP_N(a, b, t, n)                                               \
+	memcpy(t, a, n);                                                       \
+	memcpy(a, b, n);                                                       \
+	memcpy(b, t, n)
+
+/*
+ * Element swap (constant size copies for the common element sizes)
+ */
+S_INLINE void ssort_swap_es(char *a, char *b, size_t es)
+{
+	uint64_t t[4];
+	if (a == b)
+		return;
+	switch (es) {
+	case 4:
+		SSORT_SWAP_N(a, b, t, 4);
+		return;
+	case 8:
+		SSORT_SWAP_N(a, b, t, 8);
+		return;
+	case 16:
+		SSORT_SWAP_N(a, b, t, 16);
+		return;
+	case 32:
+		SSORT_SWAP_N(a, b, t, 32);
+		return;
+	default:
+		break;
+	}
+	for (; es > sizeof(t); es -= sizeof(t)) {
+		SSORT_SWAP_N(a, b, t, sizeof(t));
+		a += sizeof(t);
+		b += sizeof(t);
+	}
+	SSORT_SWAP_N(a, b, t, es);
+}
+
+#define SSORT_GEN_E(c, i) ((c)->b + (i) * (c)->es)
+#define SSORT_GEN_LESS(c, i, j)                                                \
+	((c)->cmpf(SSORT_GEN_E(c, i), SSORT_GEN_E(c, j)) < 0)
+#define SSORT_GEN_SWAP(c, i, j)                                                \
+	ssort_swap_es(SSORT_GEN_E(c, i), SSORT_GEN_E(c, j), (c)->es)
+#define SSORT_KEYF_LESS(c, i, j)                                               \
+	((c)->keyf(SSORT_GEN_E(c, i)) < (c)->keyf(SSORT_GEN_E(c, j)))
+#define SSORT_KEY_LESS(c, i, j) ((c)->k[i] < (c)->k[j])
+
+S_INLINE void ssort_key_swap(struct SSortGen *c, size_t i, size_t j)
+{
+	int64_t t = c->k[i];
+	c->k[i] = c->k[j];
+	c->k[j] = t;
+	SSORT_GEN_SWAP(c, i, j);
+}
+
+/*
+ * Stable merge sort (items of c->is bytes): insertion sorted runs, then
+ * bottom-up merge passes ping-ponging with the scratch buffer, or in-place
+ * rotation-based merges if no scratch buffer is available (O(n log^2 n))
+ */
+#define BUILD_MERGE_SORT(FN, LESS)                                             \
+	static void FN##_merge(struct SSortGen *c, const char *src, char *dst, \
+			       size_t l, size_t m, size_t r)                   \
+	{                                                                      \
+		size_t is = c->is, j = m, o = l;                               \
+		for (; l < m && j < r; o++)                                    \
+			if (LESS(c, src + j * is, src + l * is))               \
+				memcpy(dst + o * is, src + is * j++, is);      \
+			else                                                   \
+				memcpy(dst + o * is, src + is * l++, is);      \
+		if (l < m)                                                     \
+			memcpy(dst + o * is, src + l * is, (m - l) * is);      \
+		else if (j < r)                                                \
+			memcpy(dst + o * is, src + j * is, (r - j) * is);      \
+	}                                                                      \
+	static void FN##_rev(struct SSortGen *c, char *b, size_t l, size_t r)  \
+	{                                                                      \
+		size_t is = c->is;                                             \
+		for (; l + 1 < r; l++, r--)                                    \
+			ssort_swap_es(b + l * is, b + (r - 1) * is, is);       \
+	}                                                                      \
+	static void FN##_ipmerge(struct SSortGen *c, char *b, size_t l,        \
+				 size_t m, size_t r)                           \
+	{                                                                      \
+		size_t i, j, lo, hi, h, is = c->is;                            \
+		if (l >= m || m >= r)                                          \
+			return;                                                \
+		if (r - l == 2) {                                              \
+			if (LESS(c, b + m * is, b + l * is))                   \
+				ssort_swap_es(b + l * is, b + m * is, is);     \
+			return;                                                \
+		}                                                              \
+		if (m - l > r - m) {                                           \
+			i = l + (m - l) / 2;                                   \
+			for (lo = m, hi = r; lo < hi;) {                       \
+				h = lo + (hi - lo) / 2;                        \
+				if (LESS(c, b + h * is, b + i * is))           \
+					lo = h + 1;                            \
+				else                                           \
+					hi = h;                                \
+			}                                                      \
+			j = lo;                                                \
+		} else {                                                       \
+			j = m + (r - m) / 2;                                   \
+			for (lo = l, hi = m; lo < hi;) {                       \
+				h = lo + (hi - lo) / 2;                        \
+				if (LESS(c, b + j * is, b + h * is))           \
+					hi = h;                                \
+				else                                           \
+					lo = h + 1;                            \
+			}                                                      \
+			i = lo;                                                \
+		}                                                              \
+		FN##_rev(c, b, i, m);                                          \
+		FN##_rev(c, b, m, j);                                          \
+		FN##_rev(c, b, i, j);                                          \
+		FN##_ipmerge(c, b, l, i, i + (j - m));                         \
+		FN##_ipmerge(c, b, i + (j - m), j, r);                         \
+	}                                                                      \
+	static void FN(struct SSortGen *c, char *b, char *tmp, size_t n)       \
+	{                                                                      \
+		size_t i, j, l, w, is = c->is;                                 \
+		char *src = b, *dst = tmp, *t;                                 \
+		for (l = 0; l < n; l += SSORT_MERGE_RUN)                       \
+			for (i = l + 1; i < n && i < l + SSORT_MERGE_RUN; i++) \
+				for (j = i * is;                               \
+				     j > l * is && LESS(c, b + j, b + j - is); \
+				     j -= is)                                  \
+					ssort_swap_es(b + j, b + j - is, is);  \
+		for (w = SSORT_MERGE_RUN; w < n; w *= 2) {                     \
+			for (l = 0; l < n - w; l += 2 * w)                     \
+				if (!tmp)                                      \
+					FN##_ipmerge(c, b, l, l + w,           \
+						     S_MIN(l + 2 * w, n));     \
+				else                                           \
+					FN##_merge(c, src, dst, l, l + w,      \
+						   S_MIN(l + 2 * w, n));       \
+			if (tmp) {                                             \
+				if (l < n)                                     \
+					memcpy(dst + l * is, src + l * is,     \
+					       (n - l) * is);                  \
+				t = src;                                       \
+				src = dst;                                     \
+				dst = t;                                       \
+			}                                                      \
+		}                                                              \
+		if (src != b)                                                  \
+			memcpy(b, src, n * is);                                \
+	}
+
+/*
+ * Stable LSD radix argsort: 64-bit keys (clobbered) and their indexes are
+ * scattered together, skipping constant digits
+ */
+#define BUILD_ARG_RADIX_SORT(FN, TI)                                           \
+	srt_bool FN(uint64_t *k, size_t elems, TI *idx)                        \
+	{                                                                      \
+		size_t i, d, sh, acc, tmpc, *cnt, *c,                          \
+			nd = (64 + SSORT_LSD_BITS - 1) / SSORT_LSD_BITS,       \
+			nb = (size_t)1 << SSORT_LSD_BITS, mask = nb - 1,       \
+			ncnt = nd * nb;                                        \
+		uint64_t *sk = k, *dk, *tk;                                    \
+		TI *si = idx, *di, *ti;                                        \
+		RETURN_IF(!k || !idx, S_FALSE);                                \
+		for (i = 0; i < elems; i++)                                    \
+			idx[i] = (TI)i;                                        \
+		RETURN_IF(elems <= 1, S_TRUE);                                 \
+		RETURN_IF(elems > (S_SIZET_MAX - sizeof(size_t) * ncnt)        \
+					  / (sizeof(uint64_t) + sizeof(TI)),   \
+			  S_FALSE);                                            \
+		cnt = (size_t *)s_malloc(sizeof(size_t) * ncnt                 \
+					 + (sizeof(uint64_t) + sizeof(TI))     \
+						   * elems);                   \
+		RETURN_IF(!cnt, S_FALSE);                                      \
+		dk = (uint64_t *)(cnt + ncnt);                                 \
+		di = (TI *)(dk + elems);                                       \
+		memset(cnt, 0, sizeof(size_t) * ncnt);                         \
+		for (i = 0; i < elems; i++)                                    \
+			for (d = sh = 0; d < nd; d++, sh += SSORT_LSD_BITS)    \
+				cnt[d * nb + ((k[i] >> sh) & mask)]++;         \
+		for (d = sh = 0; d < nd; d++, sh += SSORT_LSD_BITS) {          \
+			c = cnt + d * nb;                                      \
+			if (c[(sk[0] >> sh) & mask] == elems)                  \
+				continue; /* constant digit */                 \
+			for (i = acc = 0; i < nb; i++) {                       \
+				tmpc = c[i];                                   \
+				c[i] = acc;                                    \
+				acc += tmpc;                                   \
+			}                                                      \
+			for (i = 0; i < elems; i++) {                          \
+				tmpc = c[(sk[i] >> sh) & mask]++;              \
+				dk[tmpc] = sk[i];                              \
+				di[tmpc] = si[i];                              \
+			}                                                      \
+			tk = sk;                                               \
+			sk = dk;                                               \
+			dk = tk;                                               \
+			ti = si;                                               \
+			si = di;                                               \
+			di = ti;                                               \
+		}                                                              \
+		if (si != idx)                                                 \
+			memcpy(idx, si, sizeof(TI) * elems);                   \
+		s_free(cnt);                                                   \
+		return S_TRUE;                                                 \
+	}
+
+#define SSORT_STB_LESS(c, pa, pb) ((c)->cmpf(pa, pb) < 0)
+#define SSORT_ARG_LESS(c, TI, pa, pb)                                          \
+	((c)->cmpf((c)->b + *(const TI *)(pa) * (c)->es,                       \
+		   (c)->b + *(const TI *)(pb) * (c)->es)                       \
+	 < 0)
+#define SSORT_ARG32_LESS(c, pa, pb) SSORT_ARG_LESS(c, uint32_t, pa, pb)
+#define SSORT_ARG64_LESS(c, pa, pb) SSORT_ARG_LESS(c, uint64_t, pa, pb)
+
+/* clang-format off */
+BUILD_PDQSORT(s_pdq_gen, struct SSortGen, SSORT_GEN_LESS, SSORT_GEN_SWAP)
+BUILD_PDQSORT(s_pdq_keyf, struct SSortGen, SSORT_KEYF_LESS, SSORT_GEN_SWAP)
+BUILD_PDQSORT(s_pdq_key, struct SSortGen, SSORT_KEY_LESS, ssort_key_swap)
+BUILD_PDQSELECT(s_pdq_select_gen, struct SSortGen, SSORT_GEN_LESS,
+		SSORT_GEN_SWAP, s_pdq_gen)
+BUILD_MERGE_SORT(s_merge_gen, SSORT_STB_LESS)
+BUILD_MERGE_SORT(s_merge_arg32, SSORT_ARG32_LESS)
+BUILD_MERGE_SORT(s_merge_arg64, SSORT_ARG64_LESS)
+/* clang-format on */
+
 #ifndef S_MINIMAL
 
+/*
+ * Parallel sort support: the scratch buffer and all the counters are
+ * allocated once, being every phase run by all the threads (the calling
+ * thread included) over its chunk, or over its buckets.
+ */
+
+static srt_bool ssort_par_init(struct SSortPar *c, size_t elems,
+			       size_t elem_size, size_t nthreads, size_t nlc)
+{
+	size_t i, chunk, *cnt, ncnt = SSORT_PAR_NB + nlc;
+	RETURN_IF(nthreads < 2 || elems < SSORT_PAR_MIN_ELEMS, S_FALSE);
+	if (nthreads > SSORT_PAR_MAX_THREADS)
+		nthreads = SSORT_PAR_MAX_THREADS;
+	RETURN_IF(elems > (S_SIZET_MAX - sizeof(size_t) * nthreads * ncnt)
+				  / elem_size,
+		  S_FALSE);
+	cnt = (size_t *)s_malloc(sizeof(size_t) * nthreads * ncnt
+				 + elem_size * elems);
+	RETURN_IF(!cnt, S_FALSE);
+	memset(c, 0, sizeof(*c));
+	c->tmp = cnt + nthreads * ncnt;
+	c->elems = elems;
+	c->elem_size = elem_size;
+	c->nthreads = nthreads;
+	chunk = elems / nthreads;
+	for (i = 0; i < nthreads; i++) {
+		c->t[i].c = c;
+		c->t[i].id = i;
+		c->t[i].i0 = chunk * i;
+		c->t[i].i1 = i == nthreads - 1 ? elems : chunk * (i + 1);
+		c->t[i].cnt = cnt + ncnt * i;
+		c->t[i].lc = c->t[i].cnt + SSORT_PAR_NB;
+	}
+	return S_TRUE;
+}
+
+static void ssort_par_free(struct SSortPar *c)
+{
+	s_free(c->t[0].cnt);
+}
+
+#ifdef S_PTHREADS
+static void *ssort_par_thr(void *a)
+{
+	struct SSortParThr *t = (struct SSortParThr *)a;
+	t->c->wf(t->c, t);
+	return NULL;
+}
+#endif
+
+static void ssort_par_run(struct SSortPar *c, size_t phase)
+{
+	size_t i;
+#ifdef S_PTHREADS
+	pthread_t th[SSORT_PAR_MAX_THREADS];
+	int r[SSORT_PAR_MAX_THREADS];
+	c->phase = phase;
+	for (i = 1; i < c->nthreads; i++)
+		r[i] = pthread_create(&th[i], NULL, ssort_par_thr, &c->t[i]);
+	c->wf(c, &c->t[0]);
+	for (i = 1; i < c->nthreads; i++)
+		if (r[i]) /* thread not created: run it in the calling thread */
+			c->wf(c, &c->t[i]);
+		else
+			pthread_join(th[i], NULL);
+#else
+	c->phase = phase;
+	for (i = 0; i < c->nthreads; i++)
+		c->wf(c, &c->t[i]);
+#endif
+}
+
+/*
+ * Bucket to thread assignment, by bucket position (contiguous bucket
+ * ranges of similar total size)
+ */
+static void ssort_par_balance(struct SSortPar *c)
+{
+	size_t j, per = c->elems / c->nthreads + 1;
+	for (j = 0; j < SSORT_PAR_NB; j++)
+		c->owner[j] =
+			(c->bkt[j] + (c->bkt[j + 1] - c->bkt[j]) / 2) / per;
+}
+
+/*
+ * Parallel merge sort (generic elements): per chunk sort, then merge rounds
+ * (phase n: runs of 2^(n-1) chunks), ping-ponging with the scratch buffer.
+ * Every merge is split across the threads of its run pair (merge path): the
+ * output range of each thread is mapped to the input ranges by co-ranking,
+ * so all the threads work in every round.
+ */
+
+static void ssort_par_merge(struct SSortPar *c, const char *src, char *dst,
+			    size_t i, size_t m, size_t j, size_t r, size_t o)
+{
+	size_t es = c->elem_size;
+	for (o *= es; i < m && j < r; o += es)
+		if (c->cmpf(src + j * es, src + i * es) < 0)
+			memcpy(dst + o, src + es * j++, es);
+		else
+			memcpy(dst + o, src + es * i++, es);
+	if (i < m)
+		memcpy(dst + o, src + i * es, (m - i) * es);
+	else if (j < r)
+		memcpy(dst + o, src + j * es, (r - j) * es);
+}
+
+/*
+ * Co-rank: number of elements taken from the 'a' run for the first 'd'
+ * merge outputs (equal elements: 'a' first, as ssort_par_merge())
+ */
+static size_t ssort_par_corank(const struct SSortPar *c, const char *a,
+			       size_t na, const char *b, size_t nb, size_t d)
+{
+	size_t i, es = c->elem_size, lo = d > nb ? d - nb : 0,
+		  hi = S_MIN(d, na);
+	while (lo < hi) {
+		i = lo + (hi - lo) / 2;
+		if (c->cmpf(a + i * es, b + (d - i - 1) * es) <= 0)
+			lo = i + 1; /* a[i] goes before b[d - i - 1] */
+		else
+			hi = i;
+	}
+	return lo;
+}
+
+static void ssort_par_gen_w(struct SSortPar *c, struct SSortParThr *a)
+{
+	size_t step, p, g, l, m, r, n, d0, d1, i0, i1, es = c->elem_size;
+	char *src, *dst;
+	if (!c->phase) {
+		ssort_gen((char *)c->b + a->i0 * es, a->i1 - a->i0, es,
+			  c->cmpf);
+		return;
+	}
+	step = (size_t)1 << (c->phase - 1);
+	p = a->id - a->id % (2 * step); /* first thread of the run pair */
+	g = S_MIN(2 * step, c->nthreads - p);
+	src = (char *)(c->phase % 2 ? c->b : c->tmp);
+	dst = (char *)(c->phase % 2 ? c->tmp : c->b);
+	l = c->t[p].i0;
+	m = p + step < c->nthreads ? c->t[p + step].i0 : c->elems;
+	r = p + 2 * step < c->nthreads ? c->t[p + 2 * step].i0 : c->elems;
+	n = r - l;
+	d0 = n / g * (a->id - p);
+	d1 = a->id - p + 1 == g ? n : d0 + n / g;
+	i0 = ssort_par_corank(c, src + l * es, m - l, src + m * es, r - m, d0);
+	i1 = ssort_par_corank(c, src + l * es, m - l, src + m * es, r - m, d1);
+	ssort_par_merge(c, src, dst, l + i0, l + i1, m + d0 - i0, m + d1 - i1,
+			l + d0);
+}
+
 /* clang-format off */
 
 BUILD_COUNT_SORT_x8(s_count_sort_i8, int8_t, size_t, 1<<7)
@@ -164,6 +1073,31 @@ BUILD_MSD_RADIX_SORT(s_msd_radix_sort_i64, int64_t, uint64_t, s_msb64,
 		     (uint64_t)1<<63)
 BUILD_MSD_RADIX_SORT(s_msd_radix_sort_u64, uint64_t, uint64_t, s_msb64,
 		     s_swap_u64, s_sort2_u64, s_sort3_u64, s_sort4_u64, 0)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_i16, int16_t, uint16_t, 1<<15, 8)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_u16, uint16_t, uint16_t, 0, 8)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_i32, int32_t, uint32_t, 1UL<<31, 11)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_u32, uint32_t, uint32_t, 0, 11)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_i64, int64_t, uint64_t, (uint64_t)1<<63,
+		     11)
+BUILD_LSD_RADIX_SORT(s_lsd_radix_sort_u64, uint64_t, uint64_t, 0, 11)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_i16, int16_t, uint16_t, 1<<15, s_msb16,
+		     s_lsd_radix_sort_i16, s_msd_radix_sort_i16,
+		     SSORT_LSD_MIN_ELEMS_16)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_u16, uint16_t, uint16_t, 0, s_msb16,
+		     s_lsd_radix_sort_u16, s_msd_radix_sort_u16,
+		     SSORT_LSD_MIN_ELEMS_16)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_i32, int32_t, uint32_t, 1UL<<31, s_msb32,
+		     s_lsd_radix_sort_i32, s_msd_radix_sort_i32,
+		     SSORT_LSD_MIN_ELEMS_32)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_u32, uint32_t, uint32_t, 0, s_msb32,
+		     s_lsd_radix_sort_u32, s_msd_radix_sort_u32,
+		     SSORT_LSD_MIN_ELEMS_32)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_i64, int64_t, uint64_t, (uint64_t)1<<63,
+		     s_msb64, s_lsd_radix_sort_i64, s_msd_radix_sort_i64,
+		     SSORT_LSD_MIN_ELEMS_64)
+BUILD_PAR_RADIX_SORT(s_par_radix_sort_u64, uint64_t, uint64_t, 0, s_msb64,
+		     s_lsd_radix_sort_u64, s_msd_radix_sort_u64,
+		     SSORT_LSD_MIN_ELEMS_64)
 
 /*
  * Sort functions
@@ -172,6 +1106,9 @@ BUILD_MSD_RADIX_SORT(s_msd_radix_sort_u64, uint64_t, uint64_t, s_msb64,
 #define SSORT_CHECK(b, elems)                                                  \
 	if (!b || elems <= 1)                                                  \
 	return
+#define SSORT_SEL_CHECK(b, elems, k)                                           \
+	if (!b || k >= elems)                                                  \
+	return
 
 void ssort_i8(int8_t *b, size_t elems)
 {
@@ -196,37 +1133,383 @@ void ssort_u8(uint8_t *b, size_t elems)
 void ssort_i16(int16_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
-	s_msd_radix_sort_i16(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_16 || !s_lsd_radix_sort_i16(b, elems))
+		s_msd_radix_sort_i16(b, elems);
 }
 
 void ssort_u16(uint16_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
-	s_msd_radix_sort_u16(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_16 || !s_lsd_radix_sort_u16(b, elems))
+		s_msd_radix_sort_u16(b, elems);
 }
 
 void ssort_i32(int32_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
-	s_msd_radix_sort_i32(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_32 || !s_lsd_radix_sort_i32(b, elems))
+		s_msd_radix_sort_i32(b, elems);
 }
 
 void ssort_u32(uint32_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
-	s_msd_radix_sort_u32(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_32 || !s_lsd_radix_sort_u32(b, elems))
+		s_msd_radix_sort_u32(b, elems);
 }
 
 void ssort_i64(int64_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
-	s_msd_radix_sort_i64(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_64 || !s_lsd_radix_sort_i64(b, elems))
+		s_msd_radix_sort_i64(b, elems);
 }
 
 void ssort_u64(uint64_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	if (elems < SSORT_LSD_MIN_ELEMS_64 || !s_lsd_radix_sort_u64(b, elems))
+		s_msd_radix_sort_u64(b, elems);
+}
+
+/*
+ * Floating point: the key flip maps the IEEE-754 bit patterns to unsigned
+ * integers having the same order (the buffer is accessed as integers only)
+ */
+
+#define BUILD_FP_SORT(FN, T, TU, SORTF, SIGN)                                  \
+	void FN(T *b, size_t elems)                                            \
+	{                                                                      \
+		size_t i;                                                      \
+		TU *u = (TU *)b;                                               \
+		SSORT_CHECK(b, elems);                                         \
+		for (i = 0; i < elems; i++)                                    \
+			u[i] = SSORT_FLIP(TU, u[i], SIGN);                     \
+		SORTF(u, elems);                                               \
+		for (i = 0; i < elems; i++)                                    \
+			u[i] = SSORT_UNFLIP(TU, u[i], SIGN);                   \
+	}
+
+BUILD_FP_SORT(ssort_f32, float, uint32_t, ssort_u32, (uint32_t)1 << 31)
+BUILD_FP_SORT(ssort_f64, double, uint64_t, ssort_u64, (uint64_t)1 << 63)
+
+void ssort_msd_i16(int16_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	s_msd_radix_sort_i16(b, elems);
+}
+
+srt_bool ssort_lsd_i16(int16_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_i16(b, elems);
+}
+
+void ssort_msd_u16(uint16_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	s_msd_radix_sort_u16(b, elems);
+}
+
+srt_bool ssort_lsd_u16(uint16_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_u16(b, elems);
+}
+
+void ssort_msd_i32(int32_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	s_msd_radix_sort_i32(b, elems);
+}
+
+srt_bool ssort_lsd_i32(int32_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_i32(b, elems);
+}
+
+void ssort_msd_u32(uint32_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	s_msd_radix_sort_u32(b, elems);
+}
+
+srt_bool ssort_lsd_u32(uint32_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_u32(b, elems);
+}
+
+void ssort_msd_i64(int64_t *b, size_t elems)
+{
+	SSORT_CHECK(b, elems);
+	s_msd_radix_sort_i64(b, elems);
+}
+
+srt_bool ssort_lsd_i64(int64_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_i64(b, elems);
+}
+
+void ssort_msd_u64(uint64_t *b, size_t elems)
 {
 	SSORT_CHECK(b, elems);
 	s_msd_radix_sort_u64(b, elems);
 }
 
+srt_bool ssort_lsd_u64(uint64_t *b, size_t elems)
+{
+	if (!b || elems <= 1)
+		return S_TRUE;
+	return s_lsd_radix_sort_u64(b, elems);
+}
+
+/*
+ * Parallel sort functions (falling back to the single-thread sort if the
+ * input is small, or on scratch buffer allocation failure)
+ */
+
+#define BUILD_SSORT_PAR(FN, T, PARF, SORTF)                                    \
+	void FN(T *b, size_t elems, size_t nthreads)                           \
+	{                                                                      \
+		SSORT_CHECK(b, elems);                                         \
+		if (!PARF(b, elems, nthreads, S_FALSE))                        \
+			SORTF(b, elems);                                       \
+	}
+
+#define BUILD_SSORT_PAR_FP(FN, T, TU, PARF, SORTF)                             \
+	void FN(T *b, size_t elems, size_t nthreads)                           \
+	{                                                                      \
+		SSORT_CHECK(b, elems);                                         \
+		if (!PARF((TU *)b, elems, nthreads, S_TRUE))                   \
+			SORTF(b, elems);                                       \
+	}
+
+BUILD_SSORT_PAR(ssort_par_i16, int16_t, s_par_radix_sort_i16, ssort_i16)
+BUILD_SSORT_PAR(ssort_par_u16, uint16_t, s_par_radix_sort_u16, ssort_u16)
+BUILD_SSORT_PAR(ssort_par_i32, int32_t, s_par_radix_sort_i32, ssort_i32)
+BUILD_SSORT_PAR(ssort_par_u32, uint32_t, s_par_radix_sort_u32, ssort_u32)
+BUILD_SSORT_PAR(ssort_par_i64, int64_t, s_par_radix_sort_i64, ssort_i64)
+BUILD_SSORT_PAR(ssort_par_u64, uint64_t, s_par_radix_sort_u64, ssort_u64)
+BUILD_SSORT_PAR_FP(ssort_par_f32, float, uint32_t, s_par_radix_sort_u32,
+		   ssort_f32)
+BUILD_SSORT_PAR_FP(ssort_par_f64, double, uint64_t, s_par_radix_sort_u64,
+		   ssort_f64)
+
+BUILD_ARG_RADIX_SORT(ssort_arg_radix32, uint32_t)
+BUILD_ARG_RADIX_SORT(ssort_arg_radix64, uint64_t)
+
+void ssort_par_gen(void *b, size_t elems, size_t elem_size,
+		   int (*cmpf)(const void *, const void *), size_t nthreads)
+{
+	struct SSortPar c;
+	size_t r;
+	SSORT_CHECK(b, elems);
+	if (!cmpf || !elem_size)
+		return;
+	if (!ssort_par_init(&c, elems, elem_size, nthreads, 0)) {
+		ssort_gen(b, elems, elem_size, cmpf);
+		return;
+	}
+	c.b = b;
+	c.cmpf = cmpf;
+	c.wf = ssort_par_gen_w;
+	for (r = 0; r == 0 || ((size_t)1 << (r - 1)) < c.nthreads; r++)
+		ssort_par_run(&c, r);
+	if ((r - 1) % 2) /* last merge round output in the scratch buffer */
+		memcpy(b, c.tmp, elems * elem_size);
+	ssort_par_free(&c);
+}
+
+/*
+ * Selection functions (nth element, top-k)
+ */
+
+#define BUILD_FP_SELECT(FN, T, TU, SELF, SIGN)                                 \
+	void FN(T *b, size_t elems, size_t k)                                  \
+	{                                                                      \
+		size_t i;                                                      \
+		TU *u = (TU *)b;                                               \
+		SSORT_SEL_CHECK(b, elems, k);                                  \
+		for (i = 0; i < elems; i++)                                    \
+			u[i] = SSORT_FLIP(TU, u[i], SIGN);                     \
+		SELF(u, elems, k);                                             \
+		for (i = 0; i < elems; i++)                                    \
+			u[i] = SSORT_UNFLIP(TU, u[i], SIGN);                   \
+	}
+
+/* clang-format off */
+BUILD_RADIX_SELECT(ssort_select_i8, int8_t, uint8_t, 1<<7)
+BUILD_RADIX_SELECT(ssort_select_u8, uint8_t, uint8_t, 0)
+BUILD_RADIX_SELECT(ssort_select_i16, int16_t, uint16_t, 1<<15)
+BUILD_RADIX_SELECT(ssort_select_u16, uint16_t, uint16_t, 0)
+BUILD_RADIX_SELECT(ssort_select_i32, int32_t, uint32_t, 1UL<<31)
+BUILD_RADIX_SELECT(ssort_select_u32, uint32_t, uint32_t, 0)
+BUILD_RADIX_SELECT(ssort_select_i64, int64_t, uint64_t, (uint64_t)1<<63)
+BUILD_RADIX_SELECT(ssort_select_u64, uint64_t, uint64_t, 0)
+BUILD_FP_SELECT(ssort_select_f32, float, uint32_t, ssort_select_u32,
+		(uint32_t)1 << 31)
+BUILD_FP_SELECT(ssort_select_f64, double, uint64_t, ssort_select_u64,
+		(uint64_t)1 << 63)
+BUILD_TOP_K(ssort_top_k_i8, int8_t, uint8_t, SSORT_KEY, SSORT_KEY, 1<<7,
+	    ssort_select_u8, ssort_u8)
+BUILD_TOP_K(ssort_top_k_u8, uint8_t, uint8_t, SSORT_KEY, SSORT_KEY, 0,
+	    ssort_select_u8, ssort_u8)
+BUILD_TOP_K(ssort_top_k_i16, int16_t, uint16_t, SSORT_KEY, SSORT_KEY, 1<<15,
+	    ssort_select_u16, ssort_u16)
+BUILD_TOP_K(ssort_top_k_u16, uint16_t, uint16_t, SSORT_KEY, SSORT_KEY, 0,
+	    ssort_select_u16, ssort_u16)
+BUILD_TOP_K(ssort_top_k_i32, int32_t, uint32_t, SSORT_KEY, SSORT_KEY,
+	    1UL<<31, ssort_select_u32, ssort_u32)
+BUILD_TOP_K(ssort_top_k_u32, uint32_t, uint32_t, SSORT_KEY, SSORT_KEY, 0,
+	    ssort_select_u32, ssort_u32)
+BUILD_TOP_K(ssort_top_k_i64, int64_t, uint64_t, SSORT_KEY, SSORT_KEY,
+	    (uint64_t)1<<63, ssort_select_u64, ssort_u64)
+BUILD_TOP_K(ssort_top_k_u64, uint64_t, uint64_t, SSORT_KEY, SSORT_KEY, 0,
+	    ssort_select_u64, ssort_u64)
+BUILD_TOP_K(ssort_top_k_f32, float, uint32_t, SSORT_FLIP, SSORT_UNFLIP,
+	    (uint32_t)1 << 31, ssort_select_u32, ssort_u32)
+BUILD_TOP_K(ssort_top_k_f64, double, uint64_t, SSORT_FLIP, SSORT_UNFLIP,
+	    (uint64_t)1 << 63, ssort_select_u64, ssort_u64)
+/* clang-format on */
+
 #endif /* #ifndef S_MINIMAL */
+
+/*
+ * Generic element sort
+ */
+
+void ssort_gen(void *b, size_t elems, size_t elem_size,
+	       int (*cmpf)(const void *, const void *))
+{
+	struct SSortGen c;
+	if (!b || elems <= 1 || !elem_size || !cmpf)
+		return;
+	c.b = (char *)b;
+	c.es = elem_size;
+	c.cmpf = cmpf;
+	s_pdq_gen(&c, elems);
+}
+
+void ssort_gen_key(void *b, size_t elems, size_t elem_size,
+		   int64_t (*keyf)(const void *))
+{
+	size_t i;
+	struct SSortGen c;
+	if (!b || elems <= 1 || !elem_size || !keyf)
+		return;
+	c.b = (char *)b;
+	c.es = elem_size;
+	c.keyf = keyf;
+	c.k = elems <= S_SIZET_MAX / sizeof(int64_t)
+		      ? (int64_t *)s_malloc(elems * sizeof(int64_t))
+		      : NULL;
+	if (!c.k) { /* key extraction on every comparison */
+		s_pdq_keyf(&c, elems);
+		return;
+	}
+	for (i = 0; i < elems; i++)
+		c.k[i] = keyf(SSORT_GEN_E(&c, i));
+	s_pdq_key(&c, elems);
+	s_free(c.k);
+}
+
+void ssort_gen_stable(void *b, size_t elems, size_t elem_size,
+		      int (*cmpf)(const void *, const void *))
+{
+	char *tmp;
+	struct SSortGen c;
+	if (!b || elems <= 1 || !elem_size || !cmpf)
+		return;
+	c.cmpf = cmpf;
+	c.is = elem_size;
+	tmp = elems <= S_SIZET_MAX / elem_size
+		      ? (char *)s_malloc(elems * elem_size)
+		      : NULL;
+	s_merge_gen(&c, (char *)b, tmp, elems); /* tmp: NULL -> in-place */
+	s_free(tmp);
+}
+
+#define BUILD_ARG_GEN(FN, TI, SORTF)                                           \
+	srt_bool FN(const void *b, size_t elems, size_t elem_size,             \
+		    int (*cmpf)(const void *, const void *), TI *idx)          \
+	{                                                                      \
+		size_t i;                                                      \
+		TI *tmp;                                                       \
+		struct SSortGen c;                                             \
+		RETURN_IF(!b || !idx || !elem_size || !cmpf, S_FALSE);         \
+		for (i = 0; i < elems; i++)                                    \
+			idx[i] = (TI)i;                                        \
+		RETURN_IF(elems <= 1, S_TRUE);                                 \
+		RETURN_IF(elems > S_SIZET_MAX / sizeof(TI), S_FALSE);          \
+		tmp = (TI *)s_malloc(elems * sizeof(TI));                      \
+		RETURN_IF(!tmp, S_FALSE);                                      \
+		c.b = (char *)b;                                               \
+		c.es = elem_size;                                              \
+		c.cmpf = cmpf;                                                 \
+		c.is = sizeof(TI);                                             \
+		SORTF(&c, (char *)idx, (char *)tmp, elems);                    \
+		s_free(tmp);                                                   \
+		return S_TRUE;                                                 \
+	}
+
+BUILD_ARG_GEN(ssort_arg_gen32, uint32_t, s_merge_arg32)
+BUILD_ARG_GEN(ssort_arg_gen64, uint64_t, s_merge_arg64)
+
+/*
+ * Generic element selection
+ */
+
+void ssort_select_gen(void *b, size_t elems, size_t elem_size,
+		      int (*cmpf)(const void *, const void *), size_t k)
+{
+	struct SSortGen c;
+	if (!b || k >= elems || !elem_size || !cmpf)
+		return;
+	c.b = (char *)b;
+	c.es = elem_size;
+	c.cmpf = cmpf;
+	s_pdq_select_gen(&c, elems, k);
+}
+
+size_t ssort_top_k_gen(const void *b, size_t elems, size_t elem_size,
+		       int (*cmpf)(const void *, const void *), size_t k,
+		       void *o)
+{
+	size_t i, n = 0, m, es = elem_size;
+	const char *in = (const char *)b;
+	srt_bool full = S_FALSE;
+	struct SSortGen c;
+	RETURN_IF(!b || !o || !k || !elem_size || !cmpf, 0);
+	c.b = (char *)o;
+	c.es = elem_size;
+	c.cmpf = cmpf;
+	m = k <= elems / 2 ? 2 * k : elems;
+	for (i = 0; i < elems; i++, in += es) {
+		if (full && cmpf(in, c.b) <= 0) /* c.b[0]: k-th largest */
+			continue;
+		memcpy(c.b + n++ * es, in, es);
+		if (n == m && n > k) {
+			s_pdq_select_gen(&c, n, n - k);
+			memmove(c.b, c.b + (n - k) * es, k * es);
+			n = k;
+			full = S_TRUE;
+		}
+	}
+	if (n > k) {
+		s_pdq_select_gen(&c, n, n - k);
+		memmove(c.b, c.b + (n - k) * es, k * es);
+		n = k;
+	}
+	s_pdq_gen(&c, n);
+	for (i = 0; i < n / 2; i++)
+		ssort_swap_es(c.b + i * es, c.b + (n - 1 - i) * es, es);
+	return n;
+}
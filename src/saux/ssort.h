@@ -21,6 +21,52 @@ extern "C" {
  *     case only happens when having duplicated elements (e.g. if you
  *     sort more than 2^16 16-bit elements, it would start being really O(n),
  *     for that specific case).
+ * - Fast 16/32/64-bit integer sort for large inputs
+ *   - Algorithm: LSD radix sort (8-bit digits for 16-bit elements, 11-bit
+ *     digits for 32/64-bit elements), skipping constant digits
+ *   - Space complexity: O(n) (scratch buffer)
+ *   - Time complexity: O(n)
+ * - ssort_i16/u16/i32/u32/i64/u64 use the MSD radix sort for small inputs,
+ *   and the LSD radix sort for large inputs (falling back to MSD if the
+ *   scratch buffer can not be allocated)
+ * - Float/double sort
+ *   - Algorithm: IEEE-754 key flip (sign bit set: all bits inverted,
+ *     otherwise: sign bit set), 32/64-bit unsigned radix sort, and flip back
+ *   - Total order: -NaN < -inf < ... < -0.0 < 0.0 < ... < inf < NaN
+ *     (NaNs ordered by their payload bits)
+ *   - Space/time complexity: same as the 32/64-bit integer sort
+ * - Generic element sort (ssort_gen, ssort_gen_key)
+ *   - Algorithm: pattern-defeating quicksort (median of 3/ninther pivot,
+ *     equal element partitioning, partial insertion sort for sorted
+ *     inputs, heap sort fallback after too many unbalanced partitions)
+ *   - Space complexity: O(log n) stack (ssort_gen_key: O(n), as the keys
+ *     are extracted once, so no callback is called when comparing)
+ *   - Time complexity: O(n log n) worst case, O(n) for sorted inputs
+ * - Stable sort and argsort (index permutation)
+ *   - ssort_gen_stable: bottom-up merge sort (O(n log n), O(n) scratch
+ *     buffer), or in-place rotation-based merges if the scratch buffer can
+ *     not be allocated (O(n log^2 n))
+ *   - ssort_arg_gen32/64: same merge sort, over 32/64-bit indexes
+ *   - ssort_arg_radix32/64: LSD radix sort over 64-bit ordered keys (e.g.
+ *     integers with the sign bit flipped), moving the indexes with the
+ *     keys (O(n), O(n) scratch buffer)
+ * - Selection (ssort_select_*: k-th element in place, smaller elements
+ *   before it, and greater after it)
+ *   - Integer/float/double: MSD radix select (8-bit digits, 3-way digit
+ *     partition), O(n), O(1) space
+ *   - Generic elements: introselect (quickselect with pdqsort partitioning,
+ *     heap sort fallback), O(n) expected, O(n log n) worst case
+ * - Top-k (ssort_top_k_*: k largest elements, in descending order)
+ *   - Input streamed through a 2k element output buffer, selecting the k
+ *     largest when it gets full: O(n) (plus O(k log k) for the final sort)
+ * - Parallel sort (ssort_par_*)
+ *   - Integer/float/double: MSD partitioning pass (8 bits, per-chunk
+ *     histograms and scatter, one chunk per thread), then per-bucket LSD/MSD
+ *     radix sort, with buckets distributed to threads
+ *   - Generic elements: per-chunk sort, then pairwise merge rounds
+ *   - Space complexity: O(n) (one scratch buffer for all the phases)
+ *   - Threads are used only if built with S_PTHREADS (make PTHREADS=1),
+ *     otherwise the same phases run in the calling thread
  *
  * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
@@ -29,6 +75,9 @@ extern "C" {
 #include "scommon.h"
 
 typedef void (*ssort_f)(void *, size_t);
+typedef void (*ssort_par_f)(void *, size_t, size_t);
+typedef void (*ssort_sel_f)(void *, size_t, size_t);
+typedef size_t (*ssort_top_k_f)(const void *, size_t, size_t, void *);
 
 void ssort_i8(int8_t *b, size_t elems);
 void ssort_u8(uint8_t *b, size_t elems);
@@ -38,6 +87,69 @@ void ssort_i32(int32_t *b, size_t elems);
 void ssort_u32(uint32_t *b, size_t elems);
 void ssort_i64(int64_t *b, size_t elems);
 void ssort_u64(uint64_t *b, size_t elems);
+void ssort_f32(float *b, size_t elems);
+void ssort_f64(double *b, size_t elems);
+void ssort_msd_i16(int16_t *b, size_t elems);
+void ssort_msd_u16(uint16_t *b, size_t elems);
+void ssort_msd_i32(int32_t *b, size_t elems);
+void ssort_msd_u32(uint32_t *b, size_t elems);
+void ssort_msd_i64(int64_t *b, size_t elems);
+void ssort_msd_u64(uint64_t *b, size_t elems);
+srt_bool ssort_lsd_i16(int16_t *b, size_t elems);
+srt_bool ssort_lsd_u16(uint16_t *b, size_t elems);
+srt_bool ssort_lsd_i32(int32_t *b, size_t elems);
+srt_bool ssort_lsd_u32(uint32_t *b, size_t elems);
+srt_bool ssort_lsd_i64(int64_t *b, size_t elems);
+srt_bool ssort_lsd_u64(uint64_t *b, size_t elems);
+void ssort_gen(void *b, size_t elems, size_t elem_size,
+	       int (*cmpf)(const void *, const void *));
+void ssort_gen_key(void *b, size_t elems, size_t elem_size,
+		   int64_t (*keyf)(const void *));
+void ssort_gen_stable(void *b, size_t elems, size_t elem_size,
+		      int (*cmpf)(const void *, const void *));
+srt_bool ssort_arg_gen32(const void *b, size_t elems, size_t elem_size,
+			 int (*cmpf)(const void *, const void *),
+			 uint32_t *idx);
+srt_bool ssort_arg_gen64(const void *b, size_t elems, size_t elem_size,
+			 int (*cmpf)(const void *, const void *),
+			 uint64_t *idx);
+srt_bool ssort_arg_radix32(uint64_t *k, size_t elems, uint32_t *idx);
+srt_bool ssort_arg_radix64(uint64_t *k, size_t elems, uint64_t *idx);
+void ssort_par_i16(int16_t *b, size_t elems, size_t nthreads);
+void ssort_par_u16(uint16_t *b, size_t elems, size_t nthreads);
+void ssort_par_i32(int32_t *b, size_t elems, size_t nthreads);
+void ssort_par_u32(uint32_t *b, size_t elems, size_t nthreads);
+void ssort_par_i64(int64_t *b, size_t elems, size_t nthreads);
+void ssort_par_u64(uint64_t *b, size_t elems, size_t nthreads);
+void ssort_par_f32(float *b, size_t elems, size_t nthreads);
+void ssort_par_f64(double *b, size_t elems, size_t nthreads);
+void ssort_par_gen(void *b, size_t elems, size_t elem_size,
+		   int (*cmpf)(const void *, const void *), size_t nthreads);
+void ssort_select_i8(int8_t *b, size_t elems, size_t k);
+void ssort_select_u8(uint8_t *b, size_t elems, size_t k);
+void ssort_select_i16(int16_t *b, size_t elems, size_t k);
+void ssort_select_u16(uint16_t *b, size_t elems, size_t k);
+void ssort_select_i32(int32_t *b, size_t elems, size_t k);
+void ssort_select_u32(uint32_t *b, size_t elems, size_t k);
+void ssort_select_i64(int64_t *b, size_t elems, size_t k);
+void ssort_select_u64(uint64_t *b, size_t elems, size_t k);
+void ssort_select_f32(float *b, size_t elems, size_t k);
+void ssort_select_f64(double *b, size_t elems, size_t k);
+size_t ssort_top_k_i8(const int8_t *b, size_t elems, size_t k, int8_t *o);
+size_t ssort_top_k_u8(const uint8_t *b, size_t elems, size_t k, uint8_t *o);
+size_t ssort_top_k_i16(const int16_t *b, size_t elems, size_t k, int16_t *o);
+size_t ssort_top_k_u16(const uint16_t *b, size_t elems, size_t k, uint16_t *o);
+size_t ssort_top_k_i32(const int32_t *b, size_t elems, size_t k, int32_t *o);
+size_t ssort_top_k_u32(const uint32_t *b, size_t elems, size_t k, uint32_t *o);
+size_t ssort_top_k_i64(const int64_t *b, size_t elems, size_t k, int64_t *o);
+size_t ssort_top_k_u64(const uint64_t *b, size_t elems, size_t k, uint64_t *o);
+size_t ssort_top_k_f32(const float *b, size_t elems, size_t k, float *o);
+size_t ssort_top_k_f64(const double *b, size_t elems, size_t k, double *o);
+void ssort_select_gen(void *b, size_t elems, size_t elem_size,
+		      int (*cmpf)(const void *, const void *), size_t k);
+size_t ssort_top_k_gen(const void *b, size_t elems, size_t elem_size,
+		       int (*cmpf)(const void *, const void *), size_t k,
+		       void *o);
 
 #ifdef __cplusplus
 } /* extern "C" { */
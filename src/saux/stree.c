@@ -27,8 +27,8 @@
 #define STN_SET_RBB(t, cn)                                                     \
 	{                                                                      \
 		cn->x.is_red = S_TRUE;                                         \
-		set_red(t, cn->x.l, S_FALSE);                                  \
-		set_red(t, cn->r, S_FALSE);                                    \
+		set_red(t, st_node_l(t, cn), S_FALSE);                         \
+		set_red(t, st_node_r(t, cn), S_FALSE);                         \
 	}
 
 /*
@@ -36,6 +36,8 @@
  */
 
 #define CW_SIZE 4 /* Node context window size (must be 4) */
+#define RBT_MAX_DEPTH_LOG2 65
+#define RBT_MAX_DEPTH (2 * RBT_MAX_DEPTH_LOG2)
 
 enum STNDir { ST_Left = 0, ST_Right = 1 };
 
@@ -50,23 +52,267 @@ struct NodeContext {
 	srt_tnode *n; /* Pointer to the node (base_ptr + x * sizeof(node)) */
 };
 
+/*
+ * Snapshot state: undo log with the previous version of the nodes written
+ * after taking the snapshots. Log entries for the same node index are
+ * chained (newest to oldest). A snapshot taken at epoch 'e' reads, for a
+ * given node index, the oldest log entry with epoch >= e, or the tree node
+ * if not modified since the snapshot.
+ *
+ * Snapshot reads run concurrently with the tree writes (one writer thread,
+ * one reader thread per snapshot), so memory reachable by the readers is
+ * never moved or modified once published:
+ * - Log entries are appended to fixed-size chunks, and the per node index
+ *   slots (newest log entry, and its epoch) are kept in fixed-size leaves,
+ *   both addressed through directories that are never reallocated.
+ * - A slot is published (release) after writing its log entry, and a
+ *   release fence separates it from the node write, so a reader copying
+ *   the node and then loading the slot (after an acquire fence) takes the
+ *   log entry if the node copy could be affected by the write.
+ * - When a node is logged, its heap data (e.g. strings) is moved to the
+ *   log entry (the tree node gets a copy), so node copies taken by the
+ *   readers reference memory that is not modified.
+ * - Reallocated tree blocks are kept until no snapshot older than the
+ *   reallocation is alive (same for log chunks, until no alive snapshot
+ *   can reach them). Tree shrink is ignored while snapshots are alive.
+ * - Detaching the tree waits for the readers copying a node from it.
+ */
+
+#define ST_COW_IX_BITS 12  /* node index slots per leaf (log2) */
+#define ST_COW_LOG_BITS 10 /* log entries per chunk (log2) */
+#define ST_COW_DIR_BITS 6  /* directory first segment size (log2) */
+#define ST_COW_DIR_SEGS 48 /* directory segments (segment s: 64 << s) */
+#define ST_VIEW_BUFS 4	   /* node copies per snapshot (rotating) */
+
+#define ST_ALIGN8(s) (((s) + 7) & ~(size_t)7)
+
+struct STreeCowDir { /* segmented pointer array (segments never move) */
+	void **seg[ST_COW_DIR_SEGS];
+};
+
+struct STreeCowRetired {
+	void *p;	/* previous tree block */
+	uint32_t epoch; /* epoch when replaced */
+};
+
+struct STreeView;
+
+struct STreeCow {
+	srt_tree *t;		  /* Source tree (NULL if detached) */
+	struct STreeCowDir ix;	  /* node index leaves (slot: entry, epoch) */
+	struct STreeCowDir log;	  /* log chunks (header + node copy) */
+	struct STreeView *views;  /* alive snapshots */
+	srt_vector *retired;	  /* tree blocks kept for the readers */
+	srt_tree_dup dup_f;	  /* node copy (dynamic memory, optional) */
+	srt_tree_callback free_f; /* node delete (optional) */
+	size_t hdr_size;	  /* source tree header size */
+	size_t elem_size;	  /* node size */
+	size_t entry_size;	  /* log entry size */
+	srt_tndx max_size;	  /* nodes >= max_size are not logged */
+	uint32_t log_h, log_n;	  /* first alive and next log entry */
+	uint32_t epoch;		  /* current epoch */
+};
+
+struct STreeCowEntry {
+	srt_tndx x;	     /* node index */
+	uint32_t epoch;	     /* epoch when the node was logged */
+	uint32_t prev;	     /* previous entry for the same node */
+	uint32_t prev_epoch; /* previous entry epoch (0: none) */
+};
+
+/* Log entry size (header + node copy), rounded up for entry alignment */
+#define ST_COW_ENTRY_SIZE(elem_size)                                           \
+	ST_ALIGN8(sizeof(struct STreeCowEntry) + (elem_size))
+
+struct STreeView {
+	srt_tree t;
+	struct STreeView *next; /* next alive snapshot */
+	size_t buf;		/* next node copy buffer */
+	uint32_t epoch;
+	uint32_t busy; /* reader copying a node from the source tree */
+};
+
+/* Snapshot allocation size (header + node copy buffers) */
+#define ST_VIEW_SIZE(elem_size)                                                \
+	(ST_ALIGN8(sizeof(struct STreeView))                                   \
+	 + ST_VIEW_BUFS * ST_ALIGN8(elem_size))
+
 /*
  * Internal functions
  */
 
-S_INLINE void set_lr(srt_tnode *n, enum STNDir d, srt_tndx v)
+static void **st_cow_dir(struct STreeCowDir *d, uint64_t k, srt_bool alloc)
+{
+	uint64_t q = (k >> ST_COW_DIR_BITS) + 1;
+	unsigned s = slog2(q);
+	void **seg = S_LD_ACQ(&d->seg[s]);
+	if (!seg && alloc) {
+		seg = (void **)s_calloc((size_t)1 << (ST_COW_DIR_BITS + s),
+					sizeof(void *));
+		if (seg)
+			S_ST_REL(&d->seg[s], seg);
+	}
+	RETURN_IF(!seg, NULL);
+	return seg + (k - ((((uint64_t)1 << s) - 1) << ST_COW_DIR_BITS));
+}
+
+static void st_cow_dir_free(struct STreeCowDir *d)
+{
+	size_t s, i, ns;
+	for (s = 0; s < ST_COW_DIR_SEGS; s++)
+		if (d->seg[s]) {
+			ns = (size_t)1 << (ST_COW_DIR_BITS + s);
+			for (i = 0; i < ns; i++)
+				if (d->seg[s][i])
+					s_free(d->seg[s][i]);
+			s_free(d->seg[s]);
+		}
+}
+
+/* Node index slot: newest log entry, and its epoch (0: not logged) */
+static uint32_t *st_cow_slot(struct STreeCow *c, srt_tndx x, srt_bool alloc)
+{
+	uint32_t *leaf;
+	void **l = st_cow_dir(&c->ix, x >> ST_COW_IX_BITS, alloc);
+	RETURN_IF(!l, NULL);
+	leaf = (uint32_t *)S_LD_ACQ(l);
+	if (!leaf && alloc) {
+		leaf = (uint32_t *)s_calloc((size_t)2 << ST_COW_IX_BITS,
+					    sizeof(uint32_t));
+		if (leaf)
+			S_ST_REL(l, (void *)leaf);
+	}
+	RETURN_IF(!leaf, NULL);
+	return leaf + 2 * (size_t)(x & S_NBITMASK64(ST_COW_IX_BITS));
+}
+
+static struct STreeCowEntry *st_cow_entry(struct STreeCow *c, uint32_t n,
+					  srt_bool alloc)
+{
+	char *ch;
+	void **l = st_cow_dir(&c->log, n >> ST_COW_LOG_BITS, alloc);
+	RETURN_IF(!l, NULL);
+	ch = (char *)S_LD_ACQ(l);
+	if (!ch && alloc) {
+		ch = (char *)s_malloc(c->entry_size << ST_COW_LOG_BITS);
+		if (ch)
+			S_ST_REL(l, (void *)ch);
+	}
+	RETURN_IF(!ch, NULL);
+	return (struct STreeCowEntry *)(ch
+					+ (n & S_NBITMASK(ST_COW_LOG_BITS))
+						  * c->entry_size);
+}
+
+static void st_cow_log(srt_tree *t, srt_tndx x)
+{
+	uint32_t *slot, se, n;
+	struct STreeCowEntry *e;
+	struct STreeCow *c = t->cow;
+	srt_tnode *nd;
+	/*
+	 * Slots past the tree size are not logged: a slot is vacated by
+	 * st_delete(), which logs it in that epoch, so the snapshots using
+	 * it already have their version in the log (the slot contents may
+	 * reference freed memory, e.g. strings moved to other node)
+	 */
+	if (x >= c->max_size || x >= st_size(t))
+		return;
+	slot = st_cow_slot(c, x, S_TRUE);
+	se = slot ? slot[1] : 0;
+	if (slot && se == c->epoch)
+		return; /* already logged in the current epoch */
+	n = c->log_n;
+	e = slot ? st_cow_entry(c, n, S_TRUE) : NULL;
+	if (!e) {
+		S_ERROR("not enough memory");
+		return;
+	}
+	nd = (srt_tnode *)st_elem_addr(t, x);
+	e->x = x;
+	e->epoch = c->epoch;
+	e->prev = slot[0];
+	e->prev_epoch = se;
+	memcpy(e + 1, nd, c->elem_size);
+	c->log_n = n + 1;
+	S_ST_REL(slot, n);
+	S_ST_REL(slot + 1, c->epoch);
+	S_FENCE_REL();
+	/*
+	 * The log entry keeps the node heap data, as readers could have a
+	 * copy of the node referencing it
+	 */
+	if (c->dup_f)
+		c->dup_f(nd, (const srt_tnode *)(e + 1));
+}
+
+/*
+ * Node access for writing (node previous version is logged if shared with
+ * snapshots)
+ */
+S_INLINE srt_tnode *get_node_w(srt_tree *t, srt_tndx node_id)
+{
+	RETURN_IF(node_id == ST_NIL, NULL);
+	if (t->cow)
+		st_cow_log(t, node_id);
+	return (srt_tnode *)st_elem_addr(t, node_id);
+}
+
+static void st_cow_log_all(srt_tree *t)
+{
+	size_t i, ts = st_size(t);
+	if (t->cow)
+		for (i = 0; i < ts; i++)
+			st_cow_log(t, (srt_tndx)i);
+}
+
+S_INLINE void set_lr(const srt_tree *t, srt_tnode *n, enum STNDir d,
+		     srt_tndx v)
 {
 	if (n) {
 		if (d == ST_Left)
-			n->x.l = v;
+			st_node_set_l(t, n, v);
 		else
-			n->r = v;
+			st_node_set_r(t, n, v);
 	}
 }
 
-S_INLINE srt_tndx get_lr(const srt_tnode *n, enum STNDir d)
+S_INLINE srt_tndx get_lr(const srt_tree *t, const srt_tnode *n, enum STNDir d)
+{
+	return d == ST_Left ? st_node_l(t, n) : st_node_r(t, n);
+}
+
+/*
+ * Parent search in multi mode: equal keys can be at both sides of a node,
+ * so both subtrees are visited when the key matches (O(log n + k))
+ */
+static srt_tnode *locate_parent_multi(srt_tree *t,
+				      const struct NodeContext *son,
+				      enum STNDir *d)
 {
-	return d == ST_Left ? n->x.l : n->r;
+	int cmp;
+	size_t level = 0;
+	srt_tndx s[2 * RBT_MAX_DEPTH_LOG2], c = t->root, l, r;
+	srt_tnode *cn;
+	for (;;) {
+		if (c == ST_NIL) {
+			if (!level)
+				return NULL;
+			c = s[--level];
+			continue;
+		}
+		cn = get_node_w(t, c);
+		l = st_node_l(t, cn);
+		r = st_node_r(t, cn);
+		if (l == son->x || r == son->x) {
+			*d = l == son->x ? ST_Left : ST_Right;
+			return cn;
+		}
+		cmp = t->cmp_f(cn, son->n);
+		if (!cmp && r != ST_NIL)
+			s[level++] = r;
+		c = cmp < 0 ? r : l;
+	}
 }
 
 S_INLINE srt_tnode *locate_parent(srt_tree *t, const struct NodeContext *son,
@@ -76,12 +322,16 @@ S_INLINE srt_tnode *locate_parent(srt_tree *t, const struct NodeContext *son,
 	srt_tnode *cn;
 	if (t->root == son->x)
 		return son->n;
-	cn = get_node(t, t->root);
-	for (; cn && cn->x.l != son->x && cn->r != son->x;) {
-		lr = get_lr(cn, t->cmp_f(cn, son->n) < 0 ? ST_Right : ST_Left);
-		cn = get_node(t, lr);
+	if (st_is_multi(t))
+		return locate_parent_multi(t, son, d);
+	cn = get_node_w(t, t->root);
+	for (; cn && st_node_l(t, cn) != son->x
+	       && st_node_r(t, cn) != son->x;) {
+		lr = get_lr(t, cn,
+			    t->cmp_f(cn, son->n) < 0 ? ST_Right : ST_Left);
+		cn = get_node_w(t, lr);
 	}
-	*d = cn && cn->x.l == son->x ? ST_Left : ST_Right;
+	*d = cn && st_node_l(t, cn) == son->x ? ST_Left : ST_Right;
 	return cn;
 }
 
@@ -89,7 +339,7 @@ S_INLINE void update_node_data(const srt_tree *t, srt_tnode *tgt,
 			       const srt_tnode *src)
 {
 	size_t node_header_size = sizeof(srt_tnode),
-	       copy_size = t->d.elem_size - node_header_size;
+	       copy_size = st_node_size(t) - node_header_size;
 	char *tgtp = (char *)tgt + node_header_size;
 	const char *srcp = (const char *)src + node_header_size;
 	memcpy(tgtp, srcp, copy_size);
@@ -107,7 +357,8 @@ S_INLINE void new_node(const srt_tree *t, srt_tnode *tgt, const srt_tnode *src,
 		update_node_data(t, tgt, src);
 	else
 		rw_f(tgt, src, existing);
-	tgt->x.l = tgt->r = ST_NIL;
+	st_node_set_l(t, tgt, ST_NIL);
+	st_node_set_r(t, tgt, ST_NIL);
 	tgt->x.is_red = ir;
 }
 
@@ -120,7 +371,7 @@ S_INLINE srt_bool is_red(const srt_tree *t, srt_tndx node_id)
 S_INLINE void set_red(srt_tree *t, srt_tndx node_id, srt_bool red)
 {
 	if (node_id != ST_NIL)
-		get_node(t, node_id)->x.is_red = red;
+		get_node_w(t, node_id)->x.is_red = red;
 }
 
 /* counter-direction */
@@ -129,17 +380,49 @@ S_INLINE enum STNDir cd(enum STNDir d)
 	return d == ST_Left ? ST_Right : ST_Left;
 }
 
+/*
+ * Augmented data update (node data computed from its children data)
+ */
+
+S_INLINE void st_aug_node(srt_tree *t, srt_tnode *n)
+{
+	t->aug_f(n, get_node_r(t, st_node_l(t, n)),
+		 get_node_r(t, st_node_r(t, n)));
+}
+
+/* Update the nodes from the root to the node n, bottom-up */
+static void st_aug_path(srt_tree *t, const srt_tnode *n)
+{
+	int r;
+	size_t level = 0;
+	srt_tndx s[RBT_MAX_DEPTH], c = t->root;
+	const srt_tnode *cn;
+	for (; c != ST_NIL && level < RBT_MAX_DEPTH;) {
+		cn = get_node_r(t, c);
+		s[level++] = c;
+		if (!(r = t->cmp_f(cn, n)))
+			break;
+		c = get_lr(t, cn, r < 0 ? ST_Right : ST_Left);
+	}
+	while (level > 0)
+		st_aug_node(t, get_node_w(t, s[--level]));
+}
+
 	/*
 	 * Node rotation auxiliary functions
 	 */
 
 #define F_rotate1X                                                             \
-	srt_tndx y = get_lr(xn, xd);                                           \
-	srt_tnode *yn = get_node(t, y);                                        \
-	set_lr(xn, xd, get_lr(yn, d));                                         \
-	set_lr(yn, d, x);                                                      \
+	srt_tndx y = get_lr(t, xn, xd);                                        \
+	srt_tnode *yn = get_node_w(t, y);                                      \
+	set_lr(t, xn, xd, get_lr(t, yn, d));                                   \
+	set_lr(t, yn, d, x);                                                   \
 	set_red(t, x, S_TRUE);                                                 \
-	set_red(t, y, S_FALSE);
+	set_red(t, y, S_FALSE);                                                \
+	if (t->aug_f) {                                                        \
+		st_aug_node(t, xn);                                            \
+		st_aug_node(t, yn);                                            \
+	}
 
 S_INLINE srt_tndx rot1x(srt_tree *t, srt_tnode *xn, srt_tndx x, enum STNDir d,
 			enum STNDir xd)
@@ -152,7 +435,7 @@ S_INLINE void rot1x_p(srt_tree *t, srt_tnode *xn, srt_tndx x, enum STNDir d,
 		      enum STNDir xd, srt_tnode *xpn)
 {
 	F_rotate1X;
-	set_lr(xpn, d, y);
+	set_lr(t, xpn, d, y);
 }
 
 S_INLINE srt_tnode *rot1x_y(srt_tree *t, srt_tnode *xn, srt_tndx x,
@@ -166,8 +449,8 @@ S_INLINE srt_tnode *rot1x_y(srt_tree *t, srt_tnode *xn, srt_tndx x,
 S_INLINE srt_tndx rot2x(srt_tree *t, srt_tnode *xn, srt_tndx x, enum STNDir d,
 			enum STNDir xd)
 {
-	srt_tndx child = get_lr(xn, xd);
-	srt_tnode *child_node = get_node(t, child);
+	srt_tndx child = get_lr(t, xn, xd);
+	srt_tnode *child_node = get_node_w(t, child);
 	rot1x_p(t, child_node, child, xd, d, xn);
 	return rot1x(t, xn, x, d, xd);
 }
@@ -191,32 +474,37 @@ S_INLINE void st_checkfix_root(srt_tree *t, srt_tndx pivot, srt_tndx new_pivot)
  */
 static size_t st_assert_aux(const srt_tree *t, srt_tndx ndx)
 {
-	size_t l, r;
+	int cl, cr;
+	size_t hl, hr;
+	srt_tndx l, r;
 	const srt_tnode *n;
 	RETURN_IF(!t, 0);
 	RETURN_IF(ndx == ST_NIL, 1);
 	n = get_node_r(t, ndx);
-	if (is_red(t, ndx) && (is_red(t, n->x.l) || is_red(t, n->r))) {
+	l = st_node_l(t, n);
+	r = st_node_r(t, n);
+	if (is_red(t, ndx) && (is_red(t, l) || is_red(t, r))) {
 #ifdef DEBUG_stree
 		fprintf(stderr, "st_assert: violation: two red nodes\n");
 #endif
 		return 0;
 	}
-	if (n->x.l != ST_NIL && t->cmp_f(get_node_r(t, n->x.l), n) >= 0
-	    && n->r != ST_NIL && t->cmp_f(get_node_r(t, n->r), n) <= 0) {
+	cl = l != ST_NIL ? t->cmp_f(get_node_r(t, l), n) : -1;
+	cr = r != ST_NIL ? t->cmp_f(get_node_r(t, r), n) : 1;
+	if (st_is_multi(t) ? cl > 0 || cr < 0 : cl >= 0 && cr <= 0) {
 #ifdef DEBUG_stree
 		fprintf(stderr, "st_assert: tree structure violation\n");
 #endif
 		return 0;
 	}
-	l = st_assert_aux(t, n->x.l);
-	r = st_assert_aux(t, n->r);
-	if (l && r) {
-		if (l == r)
-			return is_red(t, ndx) ? l : l + 1;
+	hl = st_assert_aux(t, l);
+	hr = st_assert_aux(t, r);
+	if (hl && hr) {
+		if (hl == hr)
+			return is_red(t, ndx) ? hl : hl + 1;
 #ifdef DEBUG_stree
 		fprintf(stderr, "st_assert: height mismatch l %u r %u\n",
-			(unsigned)l, (unsigned)r);
+			(unsigned)hl, (unsigned)hr);
 #endif
 		return 0;
 	}
@@ -236,7 +524,9 @@ srt_tree *st_alloc_raw(srt_cmp cmp_f, srt_bool ext_buf, void *buffer,
 	sd_reset((srt_data *)t, sizeof(srt_tree), elem_size, max_size, ext_buf,
 		 S_FALSE);
 	t->cmp_f = cmp_f;
+	t->aug_f = NULL;
 	t->root = 0;
+	t->cow = NULL;
 	return t;
 }
 
@@ -251,17 +541,57 @@ srt_tree *st_alloc(srt_cmp cmp_f, size_t elem_size, size_t init_size)
 	return t;
 }
 
+srt_tree *st_alloc_wide(srt_cmp cmp_f, size_t elem_size, size_t init_size)
+{
+	srt_tree *t;
+	RETURN_IF(!elem_size, st_void);
+	t = st_alloc(cmp_f, elem_size + sizeof(struct S_NodeW), init_size);
+	if (t && t != st_void)
+		t->d.f.flag2 = 1; /* wide node links */
+	return t;
+}
+
+srt_tree *st_alloc_multi(srt_cmp cmp_f, size_t elem_size, size_t init_size)
+{
+	srt_tree *t = st_alloc(cmp_f, elem_size, init_size);
+	if (t && t != st_void)
+		t->d.f.flag3 = 1; /* duplicate keys */
+	return t;
+}
+
+srt_bool st_set_aug(srt_tree *t, srt_tree_aug aug_f)
+{
+	RETURN_IF(!t || t == st_void || st_is_snapshot(t) || st_size(t),
+		  S_FALSE);
+	t->aug_f = aug_f;
+	return S_TRUE;
+}
+
 /*
  * Operations
  */
 
 srt_tree *st_dup(const srt_tree *t)
 {
+	size_t i, ts;
 	srt_tree *t2;
 	RETURN_IF(!t, NULL);
-	t2 = st_alloc(t->cmp_f, t->d.elem_size, t->d.size);
-	RETURN_IF(!t2, NULL);
-	memcpy(t2, t, t->d.header_size + t->d.size * t->d.elem_size);
+	ts = st_size(t);
+	t2 = st_alloc(t->cmp_f, t->d.elem_size, ts);
+	RETURN_IF(!t2 || t2 == st_void, NULL); /* BEHAVIOR: not enough memory */
+	t2->d.f.flag2 = t->d.f.flag2;
+	t2->d.f.flag3 = t->d.f.flag3;
+	t2->aug_f = t->aug_f;
+	if (st_is_snapshot(t)) /* nodes could be in the snapshot undo log */
+		for (i = 0; i < ts; i++)
+			copy_node(t, get_node_w(t2, (srt_tndx)i),
+				  get_node_r(t, (srt_tndx)i));
+	else
+		memcpy(st_get_buffer(t2), st_get_buffer_r(t),
+		       ts * t->d.elem_size);
+	t2->d.sub_type = t->d.sub_type;
+	st_set_size(t2, ts);
+	t2->root = t->root;
 	return t2;
 }
 
@@ -273,7 +603,7 @@ srt_bool st_insert(srt_tree **tt, const srt_tnode *n)
 srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 {
 	srt_tree *t;
-	srt_tnode auxn = EMPTY_STN;
+	srt_tnode auxn0 = EMPTY_STN, *auxn = &auxn0;
 	size_t ts, c, cp, cpp, cppp;
 	enum STNDir ld = ST_Left; /* last walk direction */
 	enum STNDir d = ST_Left;  /* current walk direction */
@@ -283,19 +613,22 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 	srt_tndx pd, v;
 	int64_t cmp;
 	/* BEHAVIOR: valid tree, with space for one extra element */
-	RETURN_IF(!tt || !*tt || !n || !st_grow(tt, 1), S_FALSE);
+	RETURN_IF(!tt || !*tt || !n || st_is_snapshot(*tt) || !st_grow(tt, 1),
+		  S_FALSE);
 	t = *tt;
 	ts = st_size(t);
 	/* BEHAVIOR: tree reaching capability limit */
-	RETURN_IF(ts >= ST_NIL, S_FALSE);
+	RETURN_IF(ts > st_ndx_max(t), S_FALSE);
 	/*
 	 * Trivial case: insert node into empty tree
 	 */
 	if (!ts) {
-		srt_tnode *node = get_node(t, 0);
+		srt_tnode *node = get_node_w(t, 0);
 		new_node(t, node, n, S_FALSE, rw_f, S_FALSE);
 		t->root = 0;
 		st_set_size(t, 1);
+		if (t->aug_f)
+			st_aug_node(t, node);
 		return S_TRUE;
 	}
 	/*
@@ -304,13 +637,19 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 	/*
 	 * Prepare a 4-level node tracking window
 	 */
-	auxn.r = t->root;
+	if (st_is_wide(t)) { /* fake root parent, with the link extension */
+		auxn = (srt_tnode *)s_alloca(t->d.elem_size);
+		RETURN_IF(!auxn, S_FALSE);
+		*auxn = auxn0;
+		st_node_set_l(t, auxn, ST_NIL);
+	}
+	st_node_set_r(t, auxn, t->root);
 	/* c: current node (cn) */
 	w[0].x = t->root;
-	w[0].n = get_node(t, t->root);
+	w[0].n = get_node_w(t, t->root);
 	/* cppp: cn parent parent parent node */
 	w[1].x = ST_NIL;
-	w[1].n = &auxn;
+	w[1].n = auxn;
 	/* cpp: cn parent parent node */
 	w[2].x = ST_NIL;
 	w[2].n = NULL;
@@ -327,11 +666,11 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 		if (w[c].x == ST_NIL) {
 			/* New node: */
 			w[c].x = (srt_tndx)ts;
-			w[c].n = get_node(t, (srt_tndx)ts);
+			w[c].n = get_node_w(t, (srt_tndx)ts);
 			new_node(t, w[c].n, n, S_TRUE, rw_f, S_FALSE);
 			/* Update parent node: */
-			set_lr(w[cp].n, d, w[c].x);
-			if (get_lr(w[cp].n, cd(d)) != ST_NIL)
+			set_lr(t, w[cp].n, d, w[c].x);
+			if (get_lr(t, w[cp].n, cd(d)) != ST_NIL)
 				w[c].n->x.is_red = S_TRUE;
 			/* Ensure root is black: */
 			set_red(t, t->root, S_FALSE);
@@ -340,7 +679,8 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 			done = S_TRUE;
 		} else {
 			/* Two red sons? -> red parent + black sons */
-			if (is_red(t, w[c].n->x.l) && is_red(t, w[c].n->r))
+			if (is_red(t, st_node_l(t, w[c].n))
+			    && is_red(t, st_node_r(t, w[c].n)))
 				STN_SET_RBB(t, w[c].n);
 		}
 		/* Check for double red case (current and parent are red) */
@@ -348,15 +688,16 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 		cppp = (c + 1) % CW_SIZE;
 		if (w[cpp].n && w[c].n->x.is_red && w[cp].n->x.is_red) {
 			xld = cd(ld);
-			pd = get_lr(w[cp].n, ld);
+			pd = get_lr(t, w[cp].n, ld);
 			v = w[c].x == pd
 				    ? rot1x(t, w[cpp].n, w[cpp].x, xld, ld)
 				    : rot2x(t, w[cpp].n, w[cpp].x, xld, ld);
 			if (w[cppp].n) {
-				enum STNDir d2 = w[cppp].n->r == w[cpp].x
-							 ? ST_Right
-							 : ST_Left;
-				set_lr(w[cppp].n, d2, v);
+				enum STNDir d2 =
+					st_node_r(t, w[cppp].n) == w[cpp].x
+						? ST_Right
+						: ST_Left;
+				set_lr(t, w[cppp].n, d2, v);
 				st_checkfix_root(t, w[cpp].x, v);
 			} else {
 				t->root = v;
@@ -365,21 +706,23 @@ srt_bool st_insert_rw(srt_tree **tt, const srt_tnode *n, srt_tree_rewrite rw_f)
 		if (done)
 			break;
 		cmp = t->cmp_f(w[c].n, n);
-		if (!cmp) {
+		if (!cmp && !st_is_multi(t)) {
 			if (rw_f)
 				rw_f(w[c].n, n, S_TRUE);
 			else
 				update_node_data(t, w[c].n, n);
 			break;
 		}
-		/* Step down: left or right */
+		/* Step down: left or right (equal keys: right, if multi) */
 		ld = d;
-		d = cmp < 0 ? ST_Right : ST_Left;
+		d = cmp <= 0 ? ST_Right : ST_Left;
 		/* Node context window shift */
-		w[cppp].x = get_lr(w[c].n, d);
-		w[cppp].n = get_node(t, w[cppp].x);
+		w[cppp].x = get_lr(t, w[c].n, d);
+		w[cppp].n = get_node_w(t, w[cppp].x);
 		c = cppp;
 	}
+	if (t->aug_f)
+		st_aug_path(t, n);
 	return S_TRUE;
 }
 
@@ -387,7 +730,7 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 {
 	size_t ts0;
 	srt_tndx ts;
-	srt_tnode auxn = EMPTY_STN;
+	srt_tnode auxn0 = EMPTY_STN, *auxn = &auxn0;
 	srt_tndx c, cp, cpp, cppp;
 	struct NodeContext found = {ST_NIL, NULL};
 	enum STNDir d0 = ST_Right;
@@ -398,23 +741,29 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 	srt_tnode *ndn;
 	srt_tndx y;
 	enum STNDir xd, xd0, d2;
-	srt_tndx s, sz;
+	srt_tndx s, sz, p;
 	srt_tnode *yn, *sn, *cpp_d2n;
 	/* BEHAVIOR: valid request */
-	RETURN_IF(!t || !n, S_FALSE);
+	RETURN_IF(!t || !n || st_is_snapshot(t), S_FALSE);
 	/* Check empty tree: */
 	ts0 = st_size(t);
-	RETURN_IF(ts0 == 0 || ts0 >= ST_NIL, S_FALSE);
+	RETURN_IF(ts0 == 0 || ts0 - 1 > st_ndx_max(t), S_FALSE);
 	ts = (srt_tndx)ts0;
 	/*
 	 * Prepare a 4-level node tracking window (in this case a 3-level
 	 * would be enough, using 4 in order to avoid the division by 3,
 	 * which is more expensive than by 4 in most CPUs).
 	 */
-	auxn.r = t->root;
+	if (st_is_wide(t)) { /* fake root parent, with the link extension */
+		auxn = (srt_tnode *)s_alloca(t->d.elem_size);
+		RETURN_IF(!auxn, S_FALSE);
+		*auxn = auxn0;
+		st_node_set_l(t, auxn, ST_NIL);
+	}
+	st_node_set_r(t, auxn, t->root);
 	/* c: current node (cn) */
 	w[0].x = t->root;
-	w[0].n = get_node(t, t->root);
+	w[0].n = get_node_w(t, t->root);
 	/* cppp: cn parent parent parent node */
 	w[1].x = ST_NIL;
 	w[1].n = NULL;
@@ -423,7 +772,7 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 	w[2].n = NULL;
 	/* cp: cn parent node */
 	w[3].x = ST_NIL;
-	w[3].n = &auxn;
+	w[3].n = auxn;
 	c = 0;
 	cp = 3;
 	cpp = 2;
@@ -434,7 +783,7 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 		cmp = t->cmp_f(w[c].n, n);
 		d = cmp < 0 ? ST_Right : ST_Left;
 		if (!cmp) {
-			S_ASSERT(found.n == NULL);
+			S_ASSERT(found.n == NULL || st_is_multi(t));
 			if (ts == 1) { /* Trivial case: one node */
 				if (callback)
 					callback((void *)w[c].n);
@@ -445,15 +794,15 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 		}
 		for (;;) {
 			/* Push child red node down */
-			nd = get_lr(w[c].n, d);
-			ndn = get_node(t, nd);
+			nd = get_lr(t, w[c].n, d);
+			ndn = get_node_w(t, nd);
 			if (w[c].n->x.is_red || (ndn && ndn->x.is_red))
 				break;
 			xd = cd(d);
-			if (is_red(t, get_lr(w[c].n, xd))) {
+			if (is_red(t, get_lr(t, w[c].n, xd))) {
 				yn = rot1x_y(t, w[c].n, w[c].x, d, xd, &y);
 				if (w[cp].n)
-					set_lr(w[cp].n, d0, y);
+					set_lr(t, w[cp].n, d0, y);
 				/* Fix tree root if required: */
 				st_checkfix_root(t, w[c].x, y);
 				/* Update parent */
@@ -463,12 +812,12 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 			}
 			/* s/sn: same-parent brother node */
 			xd0 = cd(d0);
-			s = get_lr(w[cp].n, xd0);
+			s = get_lr(t, w[cp].n, xd0);
 			if (s == ST_NIL)
 				break;
-			sn = get_node(t, s);
-			if (!is_red(t, get_lr(sn, xd0))
-			    && !is_red(t, get_lr(sn, d0))) {
+			sn = get_node_w(t, s);
+			if (!is_red(t, get_lr(t, sn, xd0))
+			    && !is_red(t, get_lr(t, sn, d0))) {
 				/* Color flip */
 				set_red(t, w[cp].x, S_FALSE);
 				set_red(t, s, S_TRUE);
@@ -477,29 +826,30 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 			}
 			if (!w[cpp].n)
 				break;
-			d2 = w[cpp].n->r == w[cp].x ? ST_Right : ST_Left;
-			if (is_red(t, get_lr(sn, d0))) {
+			d2 = st_node_r(t, w[cpp].n) == w[cp].x ? ST_Right
+							       : ST_Left;
+			if (is_red(t, get_lr(t, sn, d0))) {
 				y = rot2x(t, w[cp].n, w[cp].x, d0, xd0);
-				set_lr(w[cpp].n, d2, y);
+				set_lr(t, w[cpp].n, d2, y);
 				st_checkfix_root(t, w[cp].x, y);
 			} else {
-				if (is_red(t, get_lr(sn, xd0))) {
+				if (is_red(t, get_lr(t, sn, xd0))) {
 					y = rot1x(t, w[cp].n, w[cp].x, d0, xd0);
-					set_lr(w[cpp].n, d2, y);
+					set_lr(t, w[cpp].n, d2, y);
 					st_checkfix_root(t, w[cp].x, y);
 				}
 			}
-			cpp_d2n = get_node(t, get_lr(w[cpp].n, d2));
+			cpp_d2n = get_node_w(t, get_lr(t, w[cpp].n, d2));
 			/* Fix coloring */
 			STN_SET_RBB(t, cpp_d2n);
 			w[c].n->x.is_red = cpp_d2n->x.is_red;
 			break;
 		}
-		w[cppp].x = get_lr(w[c].n, d);
+		w[cppp].x = get_lr(t, w[c].n, d);
 		if (w[cppp].x == ST_NIL) /* bottom reached */
 			break;
 		/* Node context window shift */
-		w[cppp].n = get_node(t, w[cppp].x);
+		w[cppp].n = get_node_w(t, w[cppp].x);
 		c = cppp;
 		cp = (c + 3) % CW_SIZE;
 		cpp = (c + 2) % CW_SIZE;
@@ -520,12 +870,14 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 			found.x = w[c].x;
 		}
 		if (!w[cp].n) { /* Root node deletion (???) */
-			t->root =
-				w[c].n->x.l != ST_NIL ? w[c].n->x.l : w[c].n->r;
+			t->root = st_node_l(t, w[c].n) != ST_NIL
+					  ? st_node_l(t, w[c].n)
+					  : st_node_r(t, w[c].n);
 		} else {
-			ds = w[c].n->x.l == ST_NIL ? ST_Right : ST_Left;
-			dt = w[cp].n->r == w[c].x ? ST_Right : ST_Left;
-			set_lr(w[cp].n, dt, get_lr(w[c].n, ds));
+			ds = st_node_l(t, w[c].n) == ST_NIL ? ST_Right : ST_Left;
+			dt = st_node_r(t, w[cp].n) == w[c].x ? ST_Right
+							     : ST_Left;
+			set_lr(t, w[cp].n, dt, get_lr(t, w[c].n, ds));
 		}
 		/*
 		 * If deleted node is not the last node in the linear space,
@@ -537,25 +889,30 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 		 */
 		S_ASSERT(ts - 1 < ST_NIL);
 		sz = ts - 1; /* BEHAVIOR */
+		p = w[cp].x; /* removed node parent (ST_NIL: root) */
 		if (w[c].x != sz) {
 			srt_tnode *fpn;
 			struct NodeContext ct;
 			enum STNDir dl = ST_Left;
 			ct.x = sz;
-			ct.n = get_node(t, sz);
+			ct.n = get_node_w(t, sz);
 			/* TODO: cache this (!) */
 			fpn = locate_parent(t, &ct, &dl);
 			if (fpn) {
 				copy_node(t, w[c].n, ct.n);
-				set_lr(fpn, dl, w[c].x);
+				set_lr(t, fpn, dl, w[c].x);
 				if (t->root == sz)
 					t->root = w[c].x;
 			} else {
 				/* BEHAVIOR: this should never be reached */
 				S_ASSERT(S_FALSE);
 			}
+			if (p == sz)
+				p = w[c].x;
 		}
 		st_set_size(t, ts - 1);
+		if (t->aug_f && p != ST_NIL)
+			st_aug_path(t, get_node_r(t, p));
 	}
 	/* Set root node as black */
 	set_red(t, t->root, S_FALSE);
@@ -565,15 +922,676 @@ srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback)
 const srt_tnode *st_locate(const srt_tree *t, const srt_tnode *n)
 {
 	int r;
-	const srt_tnode *cn = get_node_r(t, t->root);
+	const srt_tnode *cn;
+	RETURN_IF(!st_size(t), NULL);
+	if (st_is_multi(t)) { /* first of the equal nodes */
+		cn = get_node_r(t, st_locate_bound(t, n, ST_BoundGE));
+		return cn && !t->cmp_f(cn, n) ? cn : NULL;
+	}
+	cn = get_node_r(t, t->root);
 	for (;;)
 		if (!(r = t->cmp_f(cn, n))
 		    || !(cn = get_node_r(
-				 t, get_lr(cn, r < 0 ? ST_Right : ST_Left))))
+				 t, get_lr(t, cn, r < 0 ? ST_Right : ST_Left))))
 			break;
 	return cn;
 }
 
+srt_tndx st_locate_bound(const srt_tree *t, const srt_tnode *n,
+			 enum eSTBound b)
+{
+	int r;
+	srt_tndx c, best = ST_NIL;
+	const srt_tnode *cn;
+	RETURN_IF(!t || !st_size(t), ST_NIL);
+	for (c = t->root; c != ST_NIL;) {
+		cn = get_node_r(t, c);
+		r = t->cmp_f(cn, n);
+		if (b == ST_BoundLE) {
+			if (r <= 0) {
+				best = c;
+				if (!r && !st_is_multi(t))
+					break;
+				c = st_node_r(t, cn);
+			} else
+				c = st_node_l(t, cn);
+		} else {
+			if (r > 0 || (!r && b == ST_BoundGE)) {
+				best = c;
+				if (!r && !st_is_multi(t))
+					break;
+				c = st_node_l(t, cn);
+			} else
+				c = st_node_r(t, cn);
+		}
+	}
+	return best;
+}
+
+/*
+ * Range delete, split and join
+ *
+ * Bulk operations don't rebalance node by node: nodes are flattened in
+ * order, and the tree is rebuilt from the sorted array (perfectly balanced,
+ * with just the nodes from the last incomplete level colored as red).
+ */
+
+size_t st_count_range(const srt_tree *t, const srt_tnode *n_min,
+		      const srt_tnode *n_max, size_t limit)
+{
+	srt_tndx s[RBT_MAX_DEPTH], c;
+	size_t level = 0, cnt = 0;
+	const srt_tnode *cn;
+	RETURN_IF(!t || !st_size(t) || !limit, 0);
+	c = t->root;
+	for (;;) {
+		for (; c != ST_NIL;) {
+			cn = get_node_r(t, c);
+			if (t->cmp_f(cn, n_min) >= 0) {
+				s[level++] = c;
+				c = st_node_l(t, cn);
+			} else
+				c = st_node_r(t, cn);
+		}
+		if (!level)
+			break;
+		cn = get_node_r(t, s[--level]);
+		if (t->cmp_f(cn, n_max) > 0 || ++cnt >= limit)
+			break;
+		c = st_node_r(t, cn);
+	}
+	return cnt;
+}
+
+static void st_flatten(const srt_tree *t, char *out)
+{
+	srt_tndx s[RBT_MAX_DEPTH], c = t->root;
+	size_t level = 0, es = t->d.elem_size;
+	const srt_tnode *cn;
+	for (;;) {
+		for (; c != ST_NIL; c = st_node_l(t, cn)) {
+			cn = get_node_r(t, c);
+			s[level++] = c;
+		}
+		if (!level)
+			break;
+		cn = get_node_r(t, s[--level]);
+		memcpy(out, cn, es);
+		out += es;
+		c = st_node_r(t, cn);
+	}
+}
+
+/* First element >= n (gt: first element > n) */
+static size_t st_flat_bound(const srt_tree *t, const char *a, size_t na,
+			    const srt_tnode *n, srt_bool gt)
+{
+	int r;
+	size_t lo = 0, hi = na, mid, es = t->d.elem_size;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		r = t->cmp_f((const srt_tnode *)(a + mid * es), n);
+		if (r < 0 || (!r && gt))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static srt_tndx st_build_aux(srt_tree *t, size_t lo, size_t hi, size_t depth,
+			     size_t red_depth)
+{
+	size_t mid;
+	srt_tnode *n;
+	RETURN_IF(lo >= hi, ST_NIL);
+	mid = lo + (hi - lo) / 2;
+	n = get_node_w(t, (srt_tndx)mid);
+	st_node_set_l(t, n, st_build_aux(t, lo, mid, depth + 1, red_depth));
+	st_node_set_r(t, n, st_build_aux(t, mid + 1, hi, depth + 1, red_depth));
+	n->x.is_red = depth == red_depth ? S_TRUE : S_FALSE;
+	if (t->aug_f)
+		st_aug_node(t, n);
+	return (srt_tndx)mid;
+}
+
+/* Rebuild tree links, having the nodes already sorted in linear space */
+static void st_rebuild(srt_tree *t)
+{
+	size_t ts = st_size(t);
+	t->root = ts ? st_build_aux(t, 0, ts, 0, slog2(ts + 1)) : 0;
+}
+
+size_t st_delete_range(srt_tree *t, const srt_tnode *n_min,
+		       const srt_tnode *n_max, srt_tree_callback callback)
+{
+	char *buf;
+	srt_tnode *aux;
+	size_t ts, es, k, lim, i, lo, hi;
+	RETURN_IF(!t || !n_min || !n_max || st_is_snapshot(t), 0);
+	ts = st_size(t);
+	RETURN_IF(!ts || t->cmp_f(n_min, n_max) > 0, 0);
+	/*
+	 * Few nodes in the range: deleting one by one is cheaper than
+	 * rebuilding the tree (k * log n < n)
+	 */
+	lim = ts / (slog2(ts) + 1) + 1;
+	k = st_count_range(t, n_min, n_max, lim);
+	if (k < lim) {
+		aux = (srt_tnode *)s_alloca(t->d.elem_size);
+		ASSERT_RETURN_IF(!aux, 0); /* BEHAVIOR: stack error */
+		for (i = 0; i < k; i++) {
+			copy_node(t, aux,
+				  get_node_r(t, st_locate_bound(t, n_min,
+								ST_BoundGE)));
+			st_delete(t, aux, callback);
+		}
+		return k;
+	}
+	es = t->d.elem_size;
+	buf = (char *)s_malloc(ts * es);
+	RETURN_IF(!buf, 0); /* BEHAVIOR: not enough memory */
+	st_flatten(t, buf);
+	lo = st_flat_bound(t, buf, ts, n_min, S_FALSE);
+	hi = st_flat_bound(t, buf, ts, n_max, S_TRUE);
+	st_cow_log_all(t);
+	if (callback)
+		for (i = lo; i < hi; i++)
+			callback(buf + i * es);
+	memcpy(st_get_buffer(t), buf, lo * es);
+	memcpy(st_get_buffer(t) + lo * es, buf + hi * es, (ts - hi) * es);
+	st_set_size(t, ts - (hi - lo));
+	st_rebuild(t);
+	s_free(buf);
+	return hi - lo;
+}
+
+srt_tree *st_split(srt_tree *t, const srt_tnode *n)
+{
+	char *buf;
+	srt_tree *t2;
+	size_t ts, es, p;
+	RETURN_IF(!t || !n || st_is_snapshot(t), NULL);
+	ts = st_size(t);
+	es = t->d.elem_size;
+	buf = ts ? (char *)s_malloc(ts * es) : NULL;
+	RETURN_IF(ts && !buf, NULL); /* BEHAVIOR: not enough memory */
+	if (ts)
+		st_flatten(t, buf);
+	p = st_flat_bound(t, buf, ts, n, S_FALSE);
+	t2 = st_alloc(t->cmp_f, es, ts - p);
+	if (!t2 || t2 == st_void) { /* BEHAVIOR: not enough memory */
+		if (buf)
+			s_free(buf);
+		return NULL;
+	}
+	t2->d.sub_type = t->d.sub_type;
+	t2->d.f.flag2 = t->d.f.flag2;
+	t2->d.f.flag3 = t->d.f.flag3;
+	t2->aug_f = t->aug_f;
+	if (p < ts) {
+		st_cow_log_all(t);
+		memcpy(st_get_buffer(t2), buf + p * es, (ts - p) * es);
+		st_set_size(t2, ts - p);
+		st_rebuild(t2);
+		memcpy(st_get_buffer(t), buf, p * es);
+		st_set_size(t, p);
+		st_rebuild(t);
+	}
+	if (buf)
+		s_free(buf);
+	return t2;
+}
+
+S_INLINE const srt_tnode *st_edge_node(const srt_tree *t, enum STNDir d)
+{
+	const srt_tnode *cn = get_node_r(t, t->root), *next;
+	for (; (next = get_node_r(t, get_lr(t, cn, d))); cn = next)
+		;
+	return cn;
+}
+
+srt_bool st_join(srt_tree **t, srt_tree *t2)
+{
+	char *buf;
+	size_t ts, ts2, es;
+	RETURN_IF(!t || !*t || !t2 || st_is_snapshot(*t) || st_is_snapshot(t2)
+			  || (*t)->d.elem_size != t2->d.elem_size
+			  || st_is_wide(*t) != st_is_wide(t2)
+			  || st_is_multi(*t) != st_is_multi(t2),
+		  S_FALSE);
+	ts = st_size(*t);
+	ts2 = st_size(t2);
+	RETURN_IF(!ts2, S_TRUE);
+	RETURN_IF(ts + ts2 - 1 > st_ndx_max(*t), S_FALSE);
+	RETURN_IF(ts && (*t)->cmp_f(st_edge_node(*t, ST_Right),
+				    st_edge_node(t2, ST_Left))
+				>= (st_is_multi(*t) ? 1 : 0),
+		  S_FALSE);
+	RETURN_IF(st_reserve(t, ts + ts2) < ts + ts2, S_FALSE);
+	st_cow_log_all(*t);
+	st_cow_log_all(t2);
+	es = (*t)->d.elem_size;
+	if (ts) {
+		buf = (char *)s_malloc(ts * es);
+		RETURN_IF(!buf, S_FALSE); /* BEHAVIOR: not enough memory */
+		st_flatten(*t, buf);
+		memcpy(st_get_buffer(*t), buf, ts * es);
+		s_free(buf);
+	}
+	st_flatten(t2, (char *)st_get_buffer(*t) + ts * es);
+	st_set_size(*t, ts + ts2);
+	st_rebuild(*t);
+	st_set_size(t2, 0);
+	return S_TRUE;
+}
+
+srt_bool st_optimize(srt_tree *t)
+{
+	char *buf;
+	srt_tnode *n, *c;
+	size_t ts, es, i, k, lo, hi, mid, depth, level_end, red_depth;
+	RETURN_IF(!t || st_is_snapshot(t), S_FALSE);
+	ts = st_size(t);
+	RETURN_IF(ts < 2, S_TRUE);
+	es = t->d.elem_size;
+	buf = (char *)s_malloc(ts * es);
+	RETURN_IF(!buf, S_FALSE); /* BEHAVIOR: not enough memory */
+	st_flatten(t, buf);
+	st_cow_log_all(t);
+	/*
+	 * Balanced tree built in breadth-first order: pending nodes keep
+	 * their sorted range [lo, hi) in the link fields until processed
+	 */
+	n = get_node_w(t, 0);
+	st_node_set_l(t, n, 0);
+	st_node_set_r(t, n, (srt_tndx)ts);
+	red_depth = slog2(ts + 1);
+	for (i = depth = 0, k = level_end = 1; i < ts; i++) {
+		if (i == level_end) {
+			depth++;
+			level_end = k;
+		}
+		n = get_node_w(t, (srt_tndx)i);
+		lo = (size_t)st_node_l(t, n);
+		hi = (size_t)st_node_r(t, n);
+		mid = lo + (hi - lo) / 2;
+		memcpy(n, buf + mid * es, es);
+		n->x.is_red = depth == red_depth ? S_TRUE : S_FALSE;
+		st_node_set_l(t, n, ST_NIL);
+		st_node_set_r(t, n, ST_NIL);
+		if (lo < mid) {
+			st_node_set_l(t, n, (srt_tndx)k);
+			c = get_node_w(t, (srt_tndx)k++);
+			st_node_set_l(t, c, (srt_tndx)lo);
+			st_node_set_r(t, c, (srt_tndx)mid);
+		}
+		if (mid + 1 < hi) {
+			st_node_set_r(t, n, (srt_tndx)k);
+			c = get_node_w(t, (srt_tndx)k++);
+			st_node_set_l(t, c, (srt_tndx)(mid + 1));
+			st_node_set_r(t, c, (srt_tndx)hi);
+		}
+	}
+	t->root = 0;
+	if (t->aug_f) /* children are stored after their parent */
+		for (i = ts; i-- > 0;)
+			st_aug_node(t, get_node_w(t, (srt_tndx)i));
+	s_free(buf);
+	return S_TRUE;
+}
+
+/*
+ * In-order iterator (explicit stack, no callbacks)
+ */
+
+struct STIter {
+	const srt_tree *t;
+	size_t level;
+	srt_tndx s[RBT_MAX_DEPTH];
+};
+
+static void st_iter_push_left(struct STIter *it, srt_tndx c)
+{
+	for (; c != ST_NIL; c = st_node_l(it->t, get_node_r(it->t, c)))
+		it->s[it->level++] = c;
+}
+
+static void st_iter_init(struct STIter *it, const srt_tree *t)
+{
+	it->t = t;
+	it->level = 0;
+	if (st_size(t))
+		st_iter_push_left(it, t->root);
+}
+
+S_INLINE srt_tndx st_iter_get(const struct STIter *it)
+{
+	return it->level ? it->s[it->level - 1] : ST_NIL;
+}
+
+static void st_iter_next(struct STIter *it)
+{
+	srt_tndx c = it->s[--it->level];
+	st_iter_push_left(it, st_node_r(it->t, get_node_r(it->t, c)));
+}
+
+size_t st_merge_walk(const srt_tree *t1, const srt_tree *t2, st_merge_f f,
+		     void *context)
+{
+	int r;
+	size_t cnt = 0;
+	srt_tndx i1, i2;
+	struct STIter a, b;
+	RETURN_IF(!t1 || !t2 || !f, 0);
+	st_iter_init(&a, t1);
+	st_iter_init(&b, t2);
+	for (;;) {
+		i1 = st_iter_get(&a);
+		i2 = st_iter_get(&b);
+		if (i1 == ST_NIL && i2 == ST_NIL)
+			break;
+		r = i1 == ST_NIL ? 1
+		    : i2 == ST_NIL
+			    ? -1
+			    : t1->cmp_f(get_node_r(t1, i1), get_node_r(t2, i2));
+		if (r < 0)
+			i2 = ST_NIL;
+		else if (r > 0)
+			i1 = ST_NIL;
+		if (!f(i1, i2, context))
+			break;
+		cnt++;
+		if (i1 != ST_NIL)
+			st_iter_next(&a);
+		if (i2 != ST_NIL)
+			st_iter_next(&b);
+	}
+	return cnt;
+}
+
+struct STMergeCtx {
+	srt_tree *t;
+	const srt_tree *t1, *t2;
+	enum eSTMerge op;
+	srt_tree_dup dup_f;
+};
+
+static srt_bool st_merge_aux(srt_tndx i1, srt_tndx i2, void *context)
+{
+	srt_tnode *n;
+	const srt_tnode *src;
+	struct STMergeCtx *c = (struct STMergeCtx *)context;
+	size_t ts = st_size(c->t);
+	switch (c->op) {
+	case ST_MergeDiff:
+		src = i2 == ST_NIL ? get_node_r(c->t1, i1) : NULL;
+		break;
+	case ST_MergeIntersect:
+		src = i1 != ST_NIL && i2 != ST_NIL ? get_node_r(c->t1, i1)
+						   : NULL;
+		break;
+	default: /* ST_MergeUnion: t2 elements override t1 ones */
+		src = i2 != ST_NIL ? get_node_r(c->t2, i2)
+				   : get_node_r(c->t1, i1);
+		break;
+	}
+	if (src) {
+		n = get_node_w(c->t, (srt_tndx)ts);
+		memcpy(n, src, c->t->d.elem_size);
+		if (c->dup_f)
+			c->dup_f(n, src);
+		st_set_size(c->t, ts + 1);
+	}
+	return S_TRUE;
+}
+
+srt_bool st_merge(srt_tree *t, const srt_tree *t1, const srt_tree *t2,
+		  enum eSTMerge op, srt_tree_dup dup_f)
+{
+	size_t ss;
+	struct STMergeCtx c;
+	RETURN_IF(!t || !t1 || !t2 || st_is_snapshot(t) || st_size(t)
+			  || t->d.elem_size != t1->d.elem_size
+			  || t1->d.elem_size != t2->d.elem_size
+			  || st_is_wide(t) != st_is_wide(t1)
+			  || st_is_wide(t1) != st_is_wide(t2),
+		  S_FALSE);
+	ss = op == ST_MergeDiff
+		     ? st_size(t1)
+		     : op == ST_MergeIntersect ? S_MIN(st_size(t1), st_size(t2))
+					       : st_size(t1) + st_size(t2);
+	RETURN_IF(st_max_size(t) < ss, S_FALSE);
+	c.t = t;
+	c.t1 = t1;
+	c.t2 = t2;
+	c.op = op;
+	c.dup_f = dup_f;
+	st_merge_walk(t1, t2, st_merge_aux, &c);
+	st_rebuild(t);
+	return S_TRUE;
+}
+
+/*
+ * Snapshots
+ */
+
+static void st_cow_free_entries(struct STreeCow *c, uint32_t i, uint32_t n)
+{
+	if (c->free_f)
+		for (; i != n; i++)
+			c->free_f(st_cow_entry(c, i, S_FALSE) + 1);
+}
+
+static void st_cow_free(struct STreeCow *c)
+{
+	size_t i, nr = sv_size(c->retired);
+	st_cow_free_entries(c, c->log_h, c->log_n);
+	st_cow_dir_free(&c->ix);
+	st_cow_dir_free(&c->log);
+	for (i = 0; i < nr; i++)
+		s_free(((struct STreeCowRetired *)sv_elem_addr(c->retired, i))
+			       ->p);
+	if (c->t)
+		c->t->cow = NULL;
+	sv_free(&c->retired);
+	s_free(c);
+}
+
+/*
+ * Free the log chunks and the tree blocks not reachable from snapshots with
+ * epoch >= min_epoch
+ */
+static void st_cow_reclaim(struct STreeCow *c, uint32_t min_epoch)
+{
+	void **l;
+	uint32_t n;
+	size_t i, nr = sv_size(c->retired);
+	struct STreeCowRetired *r;
+	for (; c->log_h >> ST_COW_LOG_BITS != c->log_n >> ST_COW_LOG_BITS;
+	     c->log_h = n) {
+		n = (c->log_h | S_NBITMASK(ST_COW_LOG_BITS)) + 1;
+		if (st_cow_entry(c, n - 1, S_FALSE)->epoch >= min_epoch)
+			break;
+		st_cow_free_entries(c, c->log_h, n);
+		l = st_cow_dir(&c->log, c->log_h >> ST_COW_LOG_BITS, S_FALSE);
+		s_free(*l);
+		*l = NULL;
+	}
+	for (i = 0; i < nr;) {
+		r = (struct STreeCowRetired *)sv_elem_addr(c->retired, i);
+		if (r->epoch >= min_epoch) {
+			i++;
+			continue;
+		}
+		s_free(r->p);
+		memcpy(r, sv_elem_addr(c->retired, --nr),
+		       sizeof(struct STreeCowRetired));
+		sv_set_size(c->retired, nr);
+	}
+}
+
+srt_tree *st_snapshot(srt_tree *t, srt_tree_dup dup_f,
+		      srt_tree_callback free_f)
+{
+	struct STreeCow *c;
+	struct STreeView *v;
+	size_t ts;
+	RETURN_IF(!t || t == st_void || st_is_snapshot(t), NULL);
+	ts = st_size(t);
+	c = t->cow;
+	if (!c) {
+		c = (struct STreeCow *)s_calloc(1, sizeof(struct STreeCow));
+		RETURN_IF(!c, NULL); /* BEHAVIOR: not enough memory */
+		c->retired = sv_alloc(sizeof(struct STreeCowRetired), 0, NULL);
+		if (!c->retired) {
+			s_free(c);
+			return NULL; /* BEHAVIOR: not enough memory */
+		}
+		c->dup_f = dup_f;
+		c->free_f = free_f;
+		c->hdr_size = t->d.header_size;
+		c->elem_size = t->d.elem_size;
+		c->entry_size = ST_COW_ENTRY_SIZE(t->d.elem_size);
+	}
+	v = (struct STreeView *)s_malloc(ST_VIEW_SIZE(t->d.elem_size));
+	if (!v) {
+		if (!t->cow)
+			st_cow_free(c);
+		return NULL; /* BEHAVIOR: not enough memory */
+	}
+	S_ST_REL(&c->t, t);
+	c->epoch++;
+	if (ts > c->max_size)
+		c->max_size = (srt_tndx)ts;
+	t->cow = c;
+	sd_reset((srt_data *)&v->t, sizeof(struct STreeView), t->d.elem_size,
+		 ts, S_FALSE, S_FALSE);
+	v->t.d.f.flag1 = 1; /* snapshot */
+	v->t.d.f.flag2 = t->d.f.flag2;
+	v->t.d.f.flag3 = t->d.f.flag3;
+	v->t.d.sub_type = t->d.sub_type;
+	st_set_size(&v->t, ts);
+	v->t.root = t->root;
+	v->t.cmp_f = t->cmp_f;
+	v->t.aug_f = t->aug_f;
+	v->t.cow = c;
+	v->next = c->views;
+	v->buf = 0;
+	v->epoch = c->epoch;
+	v->busy = 0;
+	c->views = v;
+	return &v->t;
+}
+
+void st_snapshot_release(srt_tree *v)
+{
+	uint32_t e_min;
+	struct STreeCow *c;
+	struct STreeView **p, *w;
+	if (!st_is_snapshot(v) || !v->cow)
+		return;
+	c = v->cow;
+	v->cow = NULL;
+	st_set_size(v, 0);
+	for (p = &c->views; *p != (struct STreeView *)v; p = &(*p)->next)
+		;
+	*p = (*p)->next;
+	if (!c->views) {
+		st_cow_free(c);
+		return;
+	}
+	for (w = c->views, e_min = c->epoch; w; w = w->next)
+		if (w->epoch < e_min)
+			e_min = w->epoch;
+	st_cow_reclaim(c, e_min);
+}
+
+void st_snapshot_detach(srt_tree *t)
+{
+	struct STreeView *w;
+	if (t && !st_is_snapshot(t) && t->cow) {
+		st_cow_log_all(t);
+		t->cow->max_size = 0;
+		S_ST_SC(&t->cow->t, (srt_tree *)NULL);
+		/*
+		 * Wait for the readers copying a node from the tree (the tree
+		 * memory could be released after returning)
+		 */
+		for (w = t->cow->views; w; w = w->next)
+			while (S_LD_SC(&w->busy))
+				;
+		t->cow = NULL;
+	}
+}
+
+srt_bool st_snapshot_unshare(srt_tree **t, size_t n)
+{
+	srt_tree *t2;
+	struct STreeCowRetired r;
+	size_t ts = st_size(*t);
+	RETURN_IF(st_is_snapshot(*t) || (*t)->d.f.ext_buffer, S_TRUE);
+	RETURN_IF(!n, S_FALSE); /* BEHAVIOR: shrink ignored */
+	RETURN_IF(n <= st_max_size(*t), S_TRUE); /* no reallocation */
+	t2 = (srt_tree *)s_malloc(st_alloc_size(*t));
+	r.p = *t;
+	r.epoch = (*t)->cow->epoch;
+	if (!t2 || !sv_push(&(*t)->cow->retired, &r)) {
+		if (t2)
+			s_free(t2);
+		st_set_alloc_errors(*t);
+		return S_FALSE; /* BEHAVIOR: not enough memory */
+	}
+	memcpy(t2, *t, (*t)->d.header_size + ts * (*t)->d.elem_size);
+	*t = t2;
+	return S_TRUE;
+}
+
+void st_snapshot_track(srt_tree *t)
+{
+	if (!st_is_snapshot(t))
+		S_ST_REL(&t->cow->t, t);
+}
+
+const srt_tnode *st_snapshot_node(const srt_tree *v, srt_tndx node_id)
+{
+	char *buf;
+	uint32_t *slot, i;
+	const srt_tree *t;
+	const struct STreeCowEntry *e;
+	struct STreeCow *c = v->cow;
+	struct STreeView *w = (struct STreeView *)v; /* CONSTNESS: buffers */
+	RETURN_IF(!c, NULL);
+	/*
+	 * Optimistic source tree node copy, discarded if the node slot shows
+	 * it was logged, i.e. the copy could overlap the write (the tree block
+	 * is not released while 'busy' is set)
+	 */
+	buf = (char *)w + ST_ALIGN8(sizeof(struct STreeView))
+	      + w->buf * ST_ALIGN8(c->elem_size);
+	S_ST_SC(&w->busy, 1);
+	t = S_LD_SC(&c->t);
+	if (t)
+		memcpy(buf,
+		       (const char *)t + c->hdr_size + node_id * c->elem_size,
+		       c->elem_size);
+	S_ST_REL(&w->busy, 0);
+	S_FENCE_ACQ();
+	slot = st_cow_slot(c, node_id, S_FALSE);
+	if (!slot || S_LD_ACQ(slot + 1) < w->epoch) {
+		/* BEHAVIOR: node not modified since the snapshot */
+		S_ASSERT(t);
+		w->buf = (w->buf + 1) % ST_VIEW_BUFS;
+		return (const srt_tnode *)buf;
+	}
+	for (i = S_LD_ACQ(slot);; i = e->prev) {
+		e = st_cow_entry(c, i, S_FALSE);
+		if (e->prev_epoch < w->epoch)
+			break;
+	}
+	return (const srt_tnode *)(e + 1);
+}
+
 /*
  * Depth-first tree traversal
  */
@@ -587,8 +1605,6 @@ enum eTMode { TR_Preorder, TR_Inorder, TR_Postorder };
  * Aux space: using the stack -i.e. "free"-, O(2 * log(n))
  */
 
-#define RBT_MAX_DEPTH_LOG2 65
-
 static ssize_t srt_treer_aux(const srt_tree *t, st_traverse f, void *context,
 			     enum eTMode m)
 {
@@ -624,22 +1640,22 @@ static ssize_t srt_treer_aux(const srt_tree *t, st_traverse f, void *context,
 				f(&tp);
 			}
 			cn_aux = get_node_r(t, p[tp.level].c);
-			if (cn_aux->x.l != ST_NIL) {
+			if (st_node_l(t, cn_aux) != ST_NIL) {
 				p[tp.level].s = STS_ScanLeft;
 				tp.level++;
 				cn_aux = get_node_r(t, p[tp.level - 1].c);
-				p[tp.level].c = cn_aux->x.l;
+				p[tp.level].c = st_node_l(t, cn_aux);
 			} else {
 				if (f_ino) {
 					tp.c = p[tp.level].c;
 					f(&tp);
 				}
-				if (cn_aux->r != ST_NIL) {
+				if (st_node_r(t, cn_aux) != ST_NIL) {
 					p[tp.level].s = STS_ScanRight;
 					tp.level++;
 					cn_aux = get_node_r(t,
 							    p[tp.level - 1].c);
-					p[tp.level].c = cn_aux->r;
+					p[tp.level].c = st_node_r(t, cn_aux);
 				} else {
 					if (f_post) {
 						tp.c = p[tp.level].c;
@@ -659,12 +1675,12 @@ static ssize_t srt_treer_aux(const srt_tree *t, st_traverse f, void *context,
 				f(&tp);
 			}
 			cn_aux = get_node_r(t, p[tp.level].c);
-			if (cn_aux->r != ST_NIL) {
+			if (st_node_r(t, cn_aux) != ST_NIL) {
 				p[tp.level].s = STS_ScanRight;
 				tp.level++;
 				p[tp.level].p = p[tp.level - 1].c;
 				cn_aux = get_node_r(t, p[tp.level - 1].c);
-				p[tp.level].c = cn_aux->r;
+				p[tp.level].c = st_node_r(t, cn_aux);
 				p[tp.level].s = STS_ScanStart;
 			} else {
 				if (f_post) {
@@ -716,9 +1732,9 @@ ssize_t st_traverse_levelorder(const srt_tree *t, st_traverse f, void *context)
 	RETURN_IF(!t, -1); /* BEHAVIOR: invalid parameter */
 	ts = st_size(t);
 	RETURN_IF(!ts, 0); /* empty */
-	curr = sv_alloc_t(SV_U32, ts / 2);
-	next = sv_alloc_t(SV_U32, ts / 2);
-	sv_push_u32(&curr, t->root);
+	curr = sv_alloc_t(SV_U64, ts / 2);
+	next = sv_alloc_t(SV_U64, ts / 2);
+	sv_push_u64(&curr, t->root);
 	for (;; tp.max_level = ++tp.level) {
 		if (f) {
 			tp.c = ST_NIL; /* report starting new tree level */
@@ -726,16 +1742,16 @@ ssize_t st_traverse_levelorder(const srt_tree *t, st_traverse f, void *context)
 		}
 		le = sv_size(curr);
 		for (i = 0; i < le; i++) {
-			n = (srt_tndx)sv_at_u32(curr, i);
+			n = (srt_tndx)sv_at_u64(curr, i);
 			node = get_node_r(t, n);
 			if (f) {
 				tp.c = n;
 				f(&tp);
 			}
-			if (node->x.l != ST_NIL)
-				sv_push_u32(&next, node->x.l);
-			if (node->r != ST_NIL)
-				sv_push_u32(&next, node->r);
+			if (st_node_l(t, node) != ST_NIL)
+				sv_push_u64(&next, st_node_l(t, node));
+			if (st_node_r(t, node) != ST_NIL)
+				sv_push_u64(&next, st_node_r(t, node));
 		}
 		ne = sv_size(next);
 		if (ne == 0) /* next level is empty */
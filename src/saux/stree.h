@@ -13,6 +13,32 @@ extern "C" {
  * #DOC with up to 2^31 nodes. Internal representation is intended for
  * #DOC tight memory usage, being implemented as a vector, so pinter
  * #DOC usage is avoided.
+ * #DOC
+ * #DOC Trees allocated with st_alloc_wide() use 63-bit node links instead
+ * #DOC (8 extra bytes per node), for trees over 2^31 nodes.
+ * #DOC
+ * #DOC Trees allocated with st_alloc_multi() keep duplicate keys, which are
+ * #DOC stored as regular nodes (new nodes are inserted after the existing
+ * #DOC ones, so insertion order is kept for equal keys).
+ * #DOC
+ * #DOC Augmented trees (st_set_aug()) keep per-node data computed from the
+ * #DOC node children (e.g. subtree maximum), updated on every rotation and
+ * #DOC on the insert/delete path, i.e. O(log n) extra callback calls.
+ * #DOC
+ * #DOC Snapshots (st_snapshot()) are O(1) read-only trees sharing the node
+ * #DOC storage with the source tree. Once a snapshot is taken, the first
+ * #DOC write to a node saves the previous node version into an undo log
+ * #DOC (versioned node indexes), so every tree write costs O(log n) extra
+ * #DOC node copies while snapshots are alive.
+ * #DOC Snapshot reads can run concurrently with the source tree writes,
+ * #DOC without locking: published log entries are never moved or modified,
+ * #DOC and reallocated tree blocks are kept until no older snapshot is
+ * #DOC alive. Rules: one writer thread (taking and releasing snapshots, and
+ * #DOC writing to the tree), and one reader thread per snapshot (snapshots
+ * #DOC are O(1), so every reader thread can have its own one). Node
+ * #DOC references obtained from a snapshot are valid until the next access
+ * #DOC to it (copy the data, if required). Tree shrink is ignored while
+ * #DOC snapshots are alive.
  *
  * Copyright (c) 2015-2019 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
@@ -24,27 +50,44 @@ extern "C" {
  * Structures and types
  */
 
+/*
+ * Node links: 31-bit left, 32-bit right (compact mode), or 63-bit for both
+ * (wide mode, high bits stored at the end of the node)
+ */
 #define ST_NODE_BITS 31
-#define ST_NIL ((((uint32_t)1) << ST_NODE_BITS) - 1)
-#define ST_NDX_MAX (ST_NIL - 1)
+#define ST_NODE_BITS_W 63
+#define ST_NIL_C ((((uint32_t)1) << ST_NODE_BITS) - 1) /* compact link nil */
+#define ST_NIL ((((uint64_t)1) << ST_NODE_BITS_W) - 1)
+#define ST_NDX_MAX ((srt_tndx)ST_NIL_C - 1)
+#define ST_NDX_MAX_W (ST_NIL - 1)
 
-typedef uint32_t srt_tndx;
+/* 64-bit for both modes (ABI change: it was uint32_t, with ST_NIL_C as nil) */
+typedef uint64_t srt_tndx;
 
 typedef int (*srt_cmp)(const void *tree_node, const void *new_node);
 typedef void (*srt_tree_callback)(void *tree_node);
+typedef void (*srt_tree_aug)(void *tree_node, const void *l, const void *r);
+
+struct STreeCow; /* Snapshot state (opaque) */
 
 struct S_Node {
 	struct {
-		srt_tndx is_red : 1;
-		srt_tndx l : ST_NODE_BITS;
+		uint32_t is_red : 1;
+		uint32_t l : ST_NODE_BITS;
 	} x;
-	srt_tndx r;
+	uint32_t r;
+};
+
+struct S_NodeW { /* Wide mode link high bits (at the end of the node) */
+	uint32_t l, r;
 };
 
 struct S_Tree {
 	struct SDataFull d;
 	srt_tndx root;
 	srt_cmp cmp_f;
+	srt_tree_aug aug_f;   /* Augmented node data update (optional) */
+	struct STreeCow *cow; /* Snapshot state (NULL if no snapshots) */
 };
 
 typedef struct S_Node srt_tnode;
@@ -58,15 +101,26 @@ struct STraverseParams {
 	ssize_t max_level;
 };
 
+enum eSTMerge { ST_MergeDiff, ST_MergeIntersect, ST_MergeUnion };
+
+enum eSTBound {
+	ST_BoundGE, /* first node >= key (lower bound / ceiling) */
+	ST_BoundGT, /* first node > key (upper bound) */
+	ST_BoundLE  /* last node <= key (floor) */
+};
+
 typedef int (*st_traverse)(struct STraverseParams *p);
 typedef void (*srt_tree_rewrite)(srt_tnode *node, const srt_tnode *new_data,
 				 srt_bool existing);
+typedef void (*srt_tree_dup)(srt_tnode *tgt, const srt_tnode *src);
+/* Node indexes are srt_tndx (64-bit, ABI change: it was uint32_t) */
+typedef srt_bool (*st_merge_f)(srt_tndx i1, srt_tndx i2, void *context);
 
 /*
  * Constants
  */
 
-#define EMPTY_STN { { 0, ST_NIL }, ST_NIL }
+#define EMPTY_STN { { 0, ST_NIL_C }, ST_NIL_C }
 
 /*
  * Functions
@@ -88,7 +142,33 @@ srt_tree *st_alloc_raw(srt_cmp cmp_f, srt_bool ext_buf,
 /* #NOTAPI: |Allocate tree (heap)|compare function;element size;space preallocated to store n elements|allocated tree|O(1)|1;2| */
 srt_tree *st_alloc(srt_cmp cmp_f, size_t elem_size, size_t init_size);
 
-SD_BUILDFUNCS_FULL(st, srt_tree, 0)
+/* #NOTAPI: |Allocate tree with wide node indexes (heap), for more than 2^31 - 1 nodes (node size is increased by 8 bytes)|compare function;element size;space preallocated to store n elements|allocated tree|O(1)|1;2| */
+srt_tree *st_alloc_wide(srt_cmp cmp_f, size_t elem_size, size_t init_size);
+
+/* #NOTAPI: |Allocate tree allowing duplicate keys (heap)|compare function;element size;space preallocated to store n elements|allocated tree|O(1)|1;2| */
+srt_tree *st_alloc_multi(srt_cmp cmp_f, size_t elem_size, size_t init_size);
+
+srt_bool st_snapshot_unshare(srt_tree **t, size_t n);
+void st_snapshot_track(srt_tree *t);
+
+/*
+ * Reallocation hooks (snapshot readers may be accessing the tree block, so
+ * it is moved to a new one, keeping the previous one until not referenced)
+ */
+S_INLINE srt_bool st_pf(srt_tree **t, size_t n)
+{
+	if (t && *t && *t != (srt_tree *)sd_void && (*t)->cow)
+		return st_snapshot_unshare(t, n);
+	return S_TRUE;
+}
+
+S_INLINE void st_rf(srt_tree **t)
+{
+	if (t && *t && *t != (srt_tree *)sd_void && (*t)->cow)
+		st_snapshot_track(*t);
+}
+
+SD_BUILDFUNCS_FULL_RF(st, srt_tree, 0, st_pf, st_rf)
 
 /*
 #NOTAPI: |Free one or more trees (heap)|tree;more trees (optional)|-|O(1)|1;2|
@@ -123,6 +203,9 @@ size_t st_len(const srt_tree *t)
  * Operations
  */
 
+/* #NOTAPI: |Set augmented node data callback (unique key trees), called for updating a node from its children (NULL if no child), e.g. for keeping subtree maximum values|empty tree; callback (NULL: none)|S_TRUE: OK; S_FALSE: invalid or non-empty tree|O(1)|1;2| */
+srt_bool st_set_aug(srt_tree *t, srt_tree_aug aug_f);
+
 /* #NOTAPI: |Duplicate tree|tree|output tree|O(n)|0;2| */
 srt_tree *st_dup(const srt_tree *t);
 
@@ -135,9 +218,38 @@ srt_bool st_insert_rw(srt_tree **t, const srt_tnode *n, srt_tree_rewrite rw_f);
 /* #NOTAPI: |Delete tree element|tree; element to delete; node delete handling callback (optional if e.g. nodes use no extra dynamic memory references)|S_TRUE: found and deleted; S_FALSE: not found|O(log n)|1;2| */
 srt_bool st_delete(srt_tree *t, const srt_tnode *n, srt_tree_callback callback);
 
+/* #NOTAPI: |Delete all nodes in a given range|tree; lower bound node; upper bound node; node delete handling callback (optional)|Number of deleted nodes|O(k log n) when deleting few nodes, O(n) otherwise (tree rebuild, without per-node rebalancing)|1;2| */
+size_t st_delete_range(srt_tree *t, const srt_tnode *n_min,
+		       const srt_tnode *n_max, srt_tree_callback callback);
+
+/* #NOTAPI: |Split tree: move nodes >= n into a new tree|tree; split node|New tree with the moved nodes; NULL if not enough memory|O(n)|1;2| */
+srt_tree *st_split(srt_tree *t, const srt_tnode *n);
+
+/* #NOTAPI: |Join trees: move all nodes from t2 into t (all t2 nodes must be greater than t nodes)|tree; tree (emptied on success)|S_TRUE: OK; S_FALSE: error (node order, node size, or not enough memory)|O(n)|1;2| */
+srt_bool st_join(srt_tree **t, srt_tree *t2);
+
+/* #NOTAPI: |Rewrite the tree node array in breadth-first order of a balanced tree (node indexes are remapped)|tree|S_TRUE: OK; S_FALSE: not enough memory, or snapshot|O(n); Aux space: n * node size|1;2| */
+srt_bool st_optimize(srt_tree *t);
+
+/* #NOTAPI: |Walk two trees in order at the same time|tree; tree; callback, called with the node index from every tree for equal keys, or with one of them being ST_NIL for keys only in one tree (return S_FALSE for stopping); callback context|Number of callback calls|O(n + m)|1;2| */
+size_t st_merge_walk(const srt_tree *t1, const srt_tree *t2, st_merge_f f,
+		     void *context);
+
+/* #NOTAPI: |Set operation of two trees of the same type (ST_MergeDiff: t1 nodes not in t2; ST_MergeIntersect: t1 nodes also in t2; ST_MergeUnion: all nodes, t2 ones having precedence)|output tree (empty, with enough space for the result: t1 size for diff, min size for intersection, or the sum of sizes for union); tree; tree; operation; node copy callback for nodes with dynamic memory (optional)|S_TRUE: OK; S_FALSE: invalid parameters or not enough space|O(n + m)|1;2| */
+srt_bool st_merge(srt_tree *t, const srt_tree *t1, const srt_tree *t2,
+		  enum eSTMerge op, srt_tree_dup dup_f);
+
 /* #NOTAPI: |Locate node|tree; node|Reference to the located node; NULL if not found|O(log n)|1;2| */
 const srt_tnode *st_locate(const srt_tree *t, const srt_tnode *n);
 
+/* #NOTAPI: |Count nodes in a given range|tree; lower bound node; upper bound node; maximum count|Number of nodes in the range (up to the maximum count)|O(log n + k)|1;2| */
+size_t st_count_range(const srt_tree *t, const srt_tnode *n_min,
+		      const srt_tnode *n_max, size_t limit);
+
+/* #NOTAPI: |Locate nearest node (single root to leaf descent)|tree; node; bound type (ST_BoundGE: first node >= n, ST_BoundGT: first node > n, ST_BoundLE: last node <= n)|Located node index; ST_NIL if not found|O(log n)|1;2| */
+srt_tndx st_locate_bound(const srt_tree *t, const srt_tnode *n,
+			 enum eSTBound b);
+
 /* #NOTAPI: |Full tree traversal: pre-order|tree; traverse callback; callback context|Number of levels stepped down|O(n)|1;2| */
 ssize_t st_traverse_preorder(const srt_tree *t, st_traverse f, void *context);
 
@@ -150,6 +262,29 @@ ssize_t st_traverse_postorder(const srt_tree *t, st_traverse f, void *context);
 /* #NOTAPI: |Bread-first tree traversal|tree; traverse callback; callback contest|Number of levels stepped down|O(n); Aux space: n/2 * sizeof(srt_tndx)|1;2| */
 ssize_t st_traverse_levelorder(const srt_tree *t, st_traverse f, void *context);
 
+/*
+ * Snapshots
+ */
+
+/* #NOTAPI: |Take tree snapshot (read-only tree, copy-on-write; it can be read from other thread while the tree is being written, see stree.h)|tree (st_snapshot_detach() is required before freeing it); node copy callback for nodes with dynamic memory (optional); node delete callback (optional)|Snapshot (release it with st_snapshot_release() and s_free(), or with sm_free() for maps); NULL if not enough memory|O(1)|1;2| */
+srt_tree *st_snapshot(srt_tree *t, srt_tree_dup dup_f,
+		      srt_tree_callback free_f);
+
+/* #NOTAPI: |Release snapshot (it becomes an empty tree)|snapshot|-|O(1); O(m) when m undo log entries are no longer reachable|1;2| */
+void st_snapshot_release(srt_tree *v);
+
+/* #NOTAPI: |Detach snapshots from the tree (e.g. before clearing it), copying all shared nodes into the snapshot undo log (it waits for the snapshot readers copying a node from the tree)|tree|-|O(n)|1;2| */
+void st_snapshot_detach(srt_tree *t);
+
+/* #NOTAPI: |Snapshot node access|snapshot; node index|Node reference|O(1) average|1;2| */
+const srt_tnode *st_snapshot_node(const srt_tree *v, srt_tndx node_id);
+
+/* #NOTAPI: |Check if tree is a snapshot|tree|S_TRUE: snapshot (read-only); S_FALSE: regular tree|O(1)|1;2| */
+S_INLINE srt_bool st_is_snapshot(const srt_tree *t)
+{
+	return t && t->d.f.flag1 ? S_TRUE : S_FALSE;
+}
+
 /*
  * Other
  */
@@ -170,9 +305,80 @@ S_INLINE srt_tnode *get_node(srt_tree *t, srt_tndx node_id)
 S_INLINE const srt_tnode *get_node_r(const srt_tree *t, srt_tndx node_id)
 {
 	RETURN_IF(node_id == ST_NIL, NULL);
+	RETURN_IF(t->d.f.flag1, st_snapshot_node(t, node_id));
 	return (const srt_tnode *)st_elem_addr_r(t, node_id);
 }
 
+/* #NOTAPI: |Check if tree uses wide node indexes|tree|S_TRUE: wide (63-bit) node indexes; S_FALSE: compact (31-bit) node indexes|O(1)|1;2| */
+S_INLINE srt_bool st_is_wide(const srt_tree *t)
+{
+	return t && t->d.f.flag2 ? S_TRUE : S_FALSE;
+}
+
+/* #NOTAPI: |Check if tree allows duplicate keys|tree|S_TRUE: multi mode (duplicate keys allowed); S_FALSE: unique keys|O(1)|1;2| */
+S_INLINE srt_bool st_is_multi(const srt_tree *t)
+{
+	return t && t->d.f.flag3 ? S_TRUE : S_FALSE;
+}
+
+/* #NOTAPI: |Maximum node index|tree|Maximum node index|O(1)|1;2| */
+S_INLINE srt_tndx st_ndx_max(const srt_tree *t)
+{
+	return st_is_wide(t) ? ST_NDX_MAX_W : ST_NDX_MAX;
+}
+
+/* #NOTAPI: |Node data size (node size without wide mode link extension)|tree|Node data size|O(1)|1;2| */
+S_INLINE size_t st_node_size(const srt_tree *t)
+{
+	return t->d.elem_size - (t->d.f.flag2 ? sizeof(struct S_NodeW) : 0);
+}
+
+S_INLINE struct S_NodeW *st_node_w(const srt_tree *t, srt_tnode *n)
+{
+	return (struct S_NodeW *)((char *)n + st_node_size(t));
+}
+
+S_INLINE const struct S_NodeW *st_node_w_r(const srt_tree *t,
+					   const srt_tnode *n)
+{
+	return (const struct S_NodeW *)((const char *)n + st_node_size(t));
+}
+
+/* #NOTAPI: |Node left link|tree; node|Left node index; ST_NIL if none|O(1)|1;2| */
+S_INLINE srt_tndx st_node_l(const srt_tree *t, const srt_tnode *n)
+{
+	if (t->d.f.flag2)
+		return n->x.l | (srt_tndx)st_node_w_r(t, n)->l << ST_NODE_BITS;
+	return n->x.l == ST_NIL_C ? ST_NIL : n->x.l;
+}
+
+/* #NOTAPI: |Node right link|tree; node|Right node index; ST_NIL if none|O(1)|1;2| */
+S_INLINE srt_tndx st_node_r(const srt_tree *t, const srt_tnode *n)
+{
+	if (t->d.f.flag2)
+		return n->r | (srt_tndx)st_node_w_r(t, n)->r << 32;
+	return n->r == ST_NIL_C ? ST_NIL : n->r;
+}
+
+/* #NOTAPI: |Set node left link|tree; node; node index (ST_NIL for none)|-|O(1)|1;2| */
+S_INLINE void st_node_set_l(const srt_tree *t, srt_tnode *n, srt_tndx v)
+{
+	n->x.l = (uint32_t)v & ST_NIL_C;
+	if (t->d.f.flag2)
+		st_node_w(t, n)->l = (uint32_t)(v >> ST_NODE_BITS);
+}
+
+/* #NOTAPI: |Set node right link|tree; node; node index (ST_NIL for none)|-|O(1)|1;2| */
+S_INLINE void st_node_set_r(const srt_tree *t, srt_tnode *n, srt_tndx v)
+{
+	if (t->d.f.flag2) {
+		n->r = (uint32_t)v;
+		st_node_w(t, n)->r = (uint32_t)(v >> 32);
+	} else {
+		n->r = v == ST_NIL ? ST_NIL_C : (uint32_t)v;
+	}
+}
+
 /* #NOTAPI: |Fast unsorted enumeration|tree; element, 0 to n - 1, being n the number of elements|Reference to the located node; NULL if not found|O(1)|0;2| */
 S_INLINE srt_tnode *st_enum(srt_tree *t, srt_tndx index)
 {
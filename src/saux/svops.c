@@ -0,0 +1,336 @@
+/*
+ * svops.c
+ *
+ * Reductions and element-wise operations over arrays of numeric elements
+ * (vector arithmetic kernels).
+ *
+ * Observations:
+ * - Kernels are plain loops over the buffer, with no aliasing and no
+ *   per-element branches, so the compiler vectorizes them (-O3).
+ *   Floating point reductions use SVOPS_LANES independent accumulators,
+ *   as floating point addition and NaN-aware min/max are not associative
+ *   (the compiler can not reorder a single accumulator). Integer min/max
+ *   use a single accumulator (vectorized by the compiler as a min/max
+ *   reduction).
+ * - Exact integer sums: 8/16/32-bit elements are added in blocks of
+ *   SVOPS_BLK elements (no 64-bit overflow is possible within a block),
+ *   adding the block sums to a 128-bit accumulator. 64-bit elements are
+ *   split in 32-bit halves (x = h * 2^32 + l), summed the same way. The
+ *   range is checked once, on the final sum, so intermediate values out
+ *   of the 64-bit range (e.g. INT64_MAX + 1 - 1) are not an error, and
+ *   per-thread partial sums can be combined in any order.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "svops.h"
+#ifdef S_PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * Internal constants
+ */
+
+#define SVOPS_LANES 8
+#define SVOPS_BLK 65536		    /* 2^16 x 2^32: no 64-bit overflow */
+#define SVOPS_PAR_MIN_ELEMS 65536 /* minimum elements per thread */
+
+/*
+ * 128-bit accumulation
+ */
+
+static void svops_acc_add2(struct SVOpsAcc *acc, uint64_t lo, uint64_t hi)
+{
+	acc->lo += lo;
+	acc->hi += hi + (acc->lo < lo ? 1 : 0);
+}
+
+#define SVOPS_ACC_I(acc, x)                                                    \
+	svops_acc_add2(acc, (uint64_t)(x), (x) < 0 ? (uint64_t)-1 : 0)
+#define SVOPS_ACC_U(acc, x) svops_acc_add2(acc, (uint64_t)(x), 0)
+
+void svops_acc_add(struct SVOpsAcc *acc, const struct SVOpsAcc *x)
+{
+	svops_acc_add2(acc, x->lo, x->hi);
+}
+
+srt_bool svops_acc_i64(const struct SVOpsAcc *acc, int64_t *r)
+{
+	uint64_t sx = (acc->lo >> 63) ? (uint64_t)-1 : 0;
+	if (acc->hi != sx) {
+		*r = (acc->hi >> 63) ? INT64_MIN : INT64_MAX;
+		return S_FALSE;
+	}
+	*r = sx ? -(int64_t)~acc->lo - 1 : (int64_t)acc->lo;
+	return S_TRUE;
+}
+
+srt_bool svops_acc_u64(const struct SVOpsAcc *acc, uint64_t *r)
+{
+	if (acc->hi) {
+		*r = (acc->hi >> 63) ? 0 : (uint64_t)-1;
+		return S_FALSE;
+	}
+	*r = acc->lo;
+	return S_TRUE;
+}
+
+/*
+ * Templates
+ */
+
+#define BUILD_SVOPS_SUM(FN, T, TS, ACCM)                                       \
+	void FN(const T *b, size_t n, struct SVOpsAcc *s)                      \
+	{                                                                      \
+		TS bs;                                                         \
+		size_t i, j, m;                                                \
+		s->lo = s->hi = 0;                                             \
+		for (i = 0; i < n; i = m) {                                    \
+			m = n - i > SVOPS_BLK ? i + SVOPS_BLK : n;             \
+			for (bs = 0, j = i; j < m; j++)                        \
+				bs += b[j];                                    \
+			ACCM(s, bs);                                           \
+		}                                                              \
+	}
+
+/*
+ * 64-bit elements: x = h * 2^32 + l (l: low 32 bits, unsigned; h: high 32
+ * bits, with sign if T is signed)
+ */
+#define BUILD_SVOPS_SUM64(FN, T)                                               \
+	void FN(const T *b, size_t n, struct SVOpsAcc *s)                      \
+	{                                                                      \
+		T bh;                                                          \
+		uint64_t bl;                                                   \
+		size_t i, j, m;                                                \
+		s->lo = s->hi = 0;                                             \
+		for (i = 0; i < n; i = m) {                                    \
+			m = n - i > SVOPS_BLK ? i + SVOPS_BLK : n;             \
+			for (bl = 0, bh = 0, j = i; j < m; j++) {              \
+				bl += (uint64_t)b[j] & 0xffffffff;             \
+				bh += b[j] >> 32;                              \
+			}                                                      \
+			SVOPS_ACC_U(s, bl);                                    \
+			svops_acc_add2(s, (uint64_t)bh << 32,                  \
+				       (uint64_t)(bh >> 32));                  \
+		}                                                              \
+	}
+
+#define BUILD_SVOPS_SUMD(FN, T)                                                \
+	double FN(const T *b, size_t n)                                        \
+	{                                                                      \
+		size_t i, j;                                                   \
+		double s[SVOPS_LANES], r = 0;                                  \
+		for (j = 0; j < SVOPS_LANES; j++)                              \
+			s[j] = 0;                                              \
+		for (i = 0; i + SVOPS_LANES <= n; i += SVOPS_LANES)            \
+			for (j = 0; j < SVOPS_LANES; j++)                      \
+				s[j] += (double)b[i + j];                      \
+		for (; i < n; i++)                                             \
+			r += (double)b[i];                                     \
+		for (j = 0; j < SVOPS_LANES; j++)                              \
+			r += s[j];                                             \
+		return r;                                                      \
+	}
+
+#define BUILD_SVOPS_MINMAX(FN, T)                                              \
+	void FN(const T *b, size_t n, T *mn, T *mx)                            \
+	{                                                                      \
+		T x, lo = b[0], hi = b[0];                                     \
+		size_t i;                                                      \
+		for (i = 1; i < n; i++) {                                      \
+			x = b[i];                                              \
+			lo = x < lo ? x : lo;                                  \
+			hi = x > hi ? x : hi;                                  \
+		}                                                              \
+		*mn = lo;                                                      \
+		*mx = hi;                                                      \
+	}
+
+#define BUILD_SVOPS_MINMAX_FP(FN, T)                                           \
+	void FN(const T *b, size_t n, T *mn, T *mx)                            \
+	{                                                                      \
+		T x, lo, hi, l[SVOPS_LANES], h[SVOPS_LANES];                   \
+		size_t i = 0, j;                                               \
+		while (i + 1 < n && b[i] != b[i])                              \
+			i++;                                                   \
+		lo = hi = b[i];                                                \
+		for (j = 0; j < SVOPS_LANES; j++)                              \
+			l[j] = h[j] = lo;                                      \
+		for (; i + SVOPS_LANES <= n; i += SVOPS_LANES)                 \
+			for (j = 0; j < SVOPS_LANES; j++) {                    \
+				x = b[i + j];                                  \
+				l[j] = x < l[j] ? x : l[j];                    \
+				h[j] = x > h[j] ? x : h[j];                    \
+			}                                                      \
+		for (; i < n; i++) {                                           \
+			lo = b[i] < lo ? b[i] : lo;                            \
+			hi = b[i] > hi ? b[i] : hi;                            \
+		}                                                              \
+		for (j = 0; j < SVOPS_LANES; j++) {                            \
+			lo = l[j] < lo ? l[j] : lo;                            \
+			hi = h[j] > hi ? h[j] : hi;                            \
+		}                                                              \
+		*mn = lo;                                                      \
+		*mx = hi;                                                      \
+	}
+
+#define BUILD_SVOPS_ADD(FN, T, TU)                                             \
+	void FN(T *a, const T *b, size_t n)                                    \
+	{                                                                      \
+		size_t i;                                                      \
+		for (i = 0; i < n; i++)                                        \
+			a[i] = (T)((TU)a[i] + (TU)b[i]);                       \
+	}
+
+#define BUILD_SVOPS_SCALE(FN, T, TMIN, TMAX)                                   \
+	void FN(T *a, size_t n, double f)                                      \
+	{                                                                      \
+		size_t i;                                                      \
+		double x;                                                      \
+		if (f != f)                                                    \
+			return;                                                \
+		for (i = 0; i < n; i++) {                                      \
+			x = (double)a[i] * f;                                  \
+			a[i] = x <= (double)TMIN                               \
+				       ? TMIN                                  \
+				       : x >= (double)TMAX ? TMAX : (T)x;      \
+		}                                                              \
+	}
+
+#define BUILD_SVOPS_SCALE_FP(FN, T)                                            \
+	void FN(T *a, size_t n, double f)                                      \
+	{                                                                      \
+		size_t i;                                                      \
+		for (i = 0; i < n; i++)                                        \
+			a[i] = (T)(a[i] * f);                                  \
+	}
+
+#define BUILD_SVOPS_CLAMP(FN, T)                                               \
+	void FN(T *a, size_t n, const T *lo, const T *hi)                      \
+	{                                                                      \
+		size_t i;                                                      \
+		T x, l = *lo, h = *hi;                                         \
+		for (i = 0; i < n; i++) {                                      \
+			x = a[i];                                              \
+			x = x < l ? l : x;                                     \
+			a[i] = x > h ? h : x;                                  \
+		}                                                              \
+	}
+
+/* clang-format off */
+BUILD_SVOPS_SUM(svops_sum_i8, int8_t, int64_t, SVOPS_ACC_I)
+BUILD_SVOPS_SUM(svops_sum_u8, uint8_t, uint64_t, SVOPS_ACC_U)
+BUILD_SVOPS_SUM(svops_sum_i16, int16_t, int64_t, SVOPS_ACC_I)
+BUILD_SVOPS_SUM(svops_sum_u16, uint16_t, uint64_t, SVOPS_ACC_U)
+BUILD_SVOPS_SUM(svops_sum_i32, int32_t, int64_t, SVOPS_ACC_I)
+BUILD_SVOPS_SUM(svops_sum_u32, uint32_t, uint64_t, SVOPS_ACC_U)
+BUILD_SVOPS_SUM64(svops_sum_i64, int64_t)
+BUILD_SVOPS_SUM64(svops_sum_u64, uint64_t)
+BUILD_SVOPS_SUMD(svops_sumd_i8, int8_t)
+BUILD_SVOPS_SUMD(svops_sumd_u8, uint8_t)
+BUILD_SVOPS_SUMD(svops_sumd_i16, int16_t)
+BUILD_SVOPS_SUMD(svops_sumd_u16, uint16_t)
+BUILD_SVOPS_SUMD(svops_sumd_i32, int32_t)
+BUILD_SVOPS_SUMD(svops_sumd_u32, uint32_t)
+BUILD_SVOPS_SUMD(svops_sumd_i64, int64_t)
+BUILD_SVOPS_SUMD(svops_sumd_u64, uint64_t)
+BUILD_SVOPS_SUMD(svops_sumd_f, float)
+BUILD_SVOPS_SUMD(svops_sumd_d, double)
+BUILD_SVOPS_MINMAX(svops_minmax_i8, int8_t)
+BUILD_SVOPS_MINMAX(svops_minmax_u8, uint8_t)
+BUILD_SVOPS_MINMAX(svops_minmax_i16, int16_t)
+BUILD_SVOPS_MINMAX(svops_minmax_u16, uint16_t)
+BUILD_SVOPS_MINMAX(svops_minmax_i32, int32_t)
+BUILD_SVOPS_MINMAX(svops_minmax_u32, uint32_t)
+BUILD_SVOPS_MINMAX(svops_minmax_i64, int64_t)
+BUILD_SVOPS_MINMAX(svops_minmax_u64, uint64_t)
+BUILD_SVOPS_MINMAX_FP(svops_minmax_f, float)
+BUILD_SVOPS_MINMAX_FP(svops_minmax_d, double)
+BUILD_SVOPS_ADD(svops_add_i8, int8_t, uint8_t)
+BUILD_SVOPS_ADD(svops_add_u8, uint8_t, uint8_t)
+BUILD_SVOPS_ADD(svops_add_i16, int16_t, uint16_t)
+BUILD_SVOPS_ADD(svops_add_u16, uint16_t, uint16_t)
+BUILD_SVOPS_ADD(svops_add_i32, int32_t, uint32_t)
+BUILD_SVOPS_ADD(svops_add_u32, uint32_t, uint32_t)
+BUILD_SVOPS_ADD(svops_add_i64, int64_t, uint64_t)
+BUILD_SVOPS_ADD(svops_add_u64, uint64_t, uint64_t)
+BUILD_SVOPS_ADD(svops_add_f, float, float)
+BUILD_SVOPS_ADD(svops_add_d, double, double)
+BUILD_SVOPS_SCALE(svops_scale_i8, int8_t, -128, 127)
+BUILD_SVOPS_SCALE(svops_scale_u8, uint8_t, 0, 255)
+BUILD_SVOPS_SCALE(svops_scale_i16, int16_t, -32768, 32767)
+BUILD_SVOPS_SCALE(svops_scale_u16, uint16_t, 0, 65535)
+BUILD_SVOPS_SCALE(svops_scale_i32, int32_t, INT32_MIN, INT32_MAX)
+BUILD_SVOPS_SCALE(svops_scale_u32, uint32_t, 0, UINT32_MAX)
+BUILD_SVOPS_SCALE(svops_scale_i64, int64_t, INT64_MIN, INT64_MAX)
+BUILD_SVOPS_SCALE(svops_scale_u64, uint64_t, 0, (uint64_t)-1)
+BUILD_SVOPS_SCALE_FP(svops_scale_f, float)
+BUILD_SVOPS_SCALE_FP(svops_scale_d, double)
+BUILD_SVOPS_CLAMP(svops_clamp_i8, int8_t)
+BUILD_SVOPS_CLAMP(svops_clamp_u8, uint8_t)
+BUILD_SVOPS_CLAMP(svops_clamp_i16, int16_t)
+BUILD_SVOPS_CLAMP(svops_clamp_u16, uint16_t)
+BUILD_SVOPS_CLAMP(svops_clamp_i32, int32_t)
+BUILD_SVOPS_CLAMP(svops_clamp_u32, uint32_t)
+BUILD_SVOPS_CLAMP(svops_clamp_i64, int64_t)
+BUILD_SVOPS_CLAMP(svops_clamp_u64, uint64_t)
+BUILD_SVOPS_CLAMP(svops_clamp_f, float)
+BUILD_SVOPS_CLAMP(svops_clamp_d, double)
+/* clang-format on */
+
+/*
+ * Parallel execution
+ */
+
+struct SVOpsThr {
+	svops_par_wf wf;
+	void *ctx;
+	size_t i0, i1, id;
+};
+
+#ifdef S_PTHREADS
+static void *svops_thr(void *a)
+{
+	struct SVOpsThr *t = (struct SVOpsThr *)a;
+	t->wf(t->ctx, t->i0, t->i1, t->id);
+	return NULL;
+}
+#endif
+
+size_t svops_par(size_t elems, size_t nthreads, svops_par_wf wf, void *ctx)
+{
+	size_t i, chunk;
+	struct SVOpsThr t[SVOPS_MAX_THREADS];
+#ifdef S_PTHREADS
+	pthread_t th[SVOPS_MAX_THREADS];
+	int r[SVOPS_MAX_THREADS];
+#endif
+	RETURN_IF(!wf, 0);
+	nthreads = S_MIN(nthreads, elems / SVOPS_PAR_MIN_ELEMS);
+	nthreads = S_MIN(S_MAX(nthreads, 1), SVOPS_MAX_THREADS);
+	chunk = elems / nthreads;
+	for (i = 0; i < nthreads; i++) {
+		t[i].wf = wf;
+		t[i].ctx = ctx;
+		t[i].id = i;
+		t[i].i0 = chunk * i;
+		t[i].i1 = i == nthreads - 1 ? elems : chunk * (i + 1);
+	}
+#ifdef S_PTHREADS
+	for (i = 1; i < nthreads; i++)
+		r[i] = pthread_create(&th[i], NULL, svops_thr, &t[i]);
+	wf(ctx, t[0].i0, t[0].i1, 0);
+	for (i = 1; i < nthreads; i++)
+		if (r[i]) /* thread not created: run it in the calling thread */
+			wf(ctx, t[i].i0, t[i].i1, i);
+		else
+			pthread_join(th[i], NULL);
+#else
+	for (i = 0; i < nthreads; i++)
+		wf(ctx, t[i].i0, t[i].i1, i);
+#endif
+	return nthreads;
+}
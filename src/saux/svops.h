@@ -0,0 +1,158 @@
+#ifndef SVOPS_H
+#define SVOPS_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "scommon.h"
+
+/*
+ * svops.h
+ *
+ * Reductions and element-wise operations over arrays of numeric elements
+ * (vector arithmetic kernels).
+ *
+ * Features:
+ * - Sum, min/max, element-wise add, scale and clamp for 8/16/32/64-bit
+ *   signed/unsigned integers, float and double.
+ * - Loops written for compiler vectorization (SSE2/AVX2/NEON, depending
+ *   on the target flags), with no per-element checks.
+ * - Exact integer sums (128-bit accumulation), with the range checked
+ *   once, on the result.
+ * - Parallel execution helper: one contiguous chunk per thread, threads
+ *   being used only if built with S_PTHREADS (make PTHREADS=1).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#define SVOPS_MAX_THREADS 64
+
+/*
+ * 128-bit two's complement accumulator (exact integer sums)
+ */
+struct SVOpsAcc {
+	uint64_t lo, hi;
+};
+
+typedef void (*svops_sum_fn)(const void *, size_t, struct SVOpsAcc *);
+typedef double (*svops_sum_d_fn)(const void *, size_t);
+typedef void (*svops_minmax_fn)(const void *, size_t, void *, void *);
+typedef void (*svops_add_fn)(void *, const void *, size_t);
+typedef void (*svops_scale_fn)(void *, size_t, double);
+typedef void (*svops_clamp_fn)(void *, size_t, const void *, const void *);
+typedef void (*svops_par_wf)(void *ctx, size_t i0, size_t i1, size_t id);
+
+/*
+ * Exact sum (no overflow is possible)
+ */
+void svops_sum_i8(const int8_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_i16(const int16_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_i32(const int32_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_i64(const int64_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_u8(const uint8_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_u16(const uint16_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_u32(const uint32_t *b, size_t n, struct SVOpsAcc *s);
+void svops_sum_u64(const uint64_t *b, size_t n, struct SVOpsAcc *s);
+
+/*
+ * Sum, accumulated as double
+ */
+double svops_sumd_i8(const int8_t *b, size_t n);
+double svops_sumd_u8(const uint8_t *b, size_t n);
+double svops_sumd_i16(const int16_t *b, size_t n);
+double svops_sumd_u16(const uint16_t *b, size_t n);
+double svops_sumd_i32(const int32_t *b, size_t n);
+double svops_sumd_u32(const uint32_t *b, size_t n);
+double svops_sumd_i64(const int64_t *b, size_t n);
+double svops_sumd_u64(const uint64_t *b, size_t n);
+double svops_sumd_f(const float *b, size_t n);
+double svops_sumd_d(const double *b, size_t n);
+
+/*
+ * Minimum and maximum (n > 0; NaN elements are ignored, unless all are NaN)
+ */
+void svops_minmax_i8(const int8_t *b, size_t n, int8_t *mn, int8_t *mx);
+void svops_minmax_u8(const uint8_t *b, size_t n, uint8_t *mn, uint8_t *mx);
+void svops_minmax_i16(const int16_t *b, size_t n, int16_t *mn, int16_t *mx);
+void svops_minmax_u16(const uint16_t *b, size_t n, uint16_t *mn,
+		      uint16_t *mx);
+void svops_minmax_i32(const int32_t *b, size_t n, int32_t *mn, int32_t *mx);
+void svops_minmax_u32(const uint32_t *b, size_t n, uint32_t *mn,
+		      uint32_t *mx);
+void svops_minmax_i64(const int64_t *b, size_t n, int64_t *mn, int64_t *mx);
+void svops_minmax_u64(const uint64_t *b, size_t n, uint64_t *mn,
+		      uint64_t *mx);
+void svops_minmax_f(const float *b, size_t n, float *mn, float *mx);
+void svops_minmax_d(const double *b, size_t n, double *mn, double *mx);
+
+/*
+ * Element-wise a[i] += b[i] (integers: modular arithmetic)
+ */
+void svops_add_i8(int8_t *a, const int8_t *b, size_t n);
+void svops_add_u8(uint8_t *a, const uint8_t *b, size_t n);
+void svops_add_i16(int16_t *a, const int16_t *b, size_t n);
+void svops_add_u16(uint16_t *a, const uint16_t *b, size_t n);
+void svops_add_i32(int32_t *a, const int32_t *b, size_t n);
+void svops_add_u32(uint32_t *a, const uint32_t *b, size_t n);
+void svops_add_i64(int64_t *a, const int64_t *b, size_t n);
+void svops_add_u64(uint64_t *a, const uint64_t *b, size_t n);
+void svops_add_f(float *a, const float *b, size_t n);
+void svops_add_d(double *a, const double *b, size_t n);
+
+/*
+ * Element-wise a[i] *= f (integers: computed as double, truncated and
+ * saturated to the element range; NaN factor: no change)
+ */
+void svops_scale_i8(int8_t *a, size_t n, double f);
+void svops_scale_u8(uint8_t *a, size_t n, double f);
+void svops_scale_i16(int16_t *a, size_t n, double f);
+void svops_scale_u16(uint16_t *a, size_t n, double f);
+void svops_scale_i32(int32_t *a, size_t n, double f);
+void svops_scale_u32(uint32_t *a, size_t n, double f);
+void svops_scale_i64(int64_t *a, size_t n, double f);
+void svops_scale_u64(uint64_t *a, size_t n, double f);
+void svops_scale_f(float *a, size_t n, double f);
+void svops_scale_d(double *a, size_t n, double f);
+
+/*
+ * Element-wise clamp to [*lo, *hi]
+ */
+void svops_clamp_i8(int8_t *a, size_t n, const int8_t *lo, const int8_t *hi);
+void svops_clamp_u8(uint8_t *a, size_t n, const uint8_t *lo,
+		    const uint8_t *hi);
+void svops_clamp_i16(int16_t *a, size_t n, const int16_t *lo,
+		     const int16_t *hi);
+void svops_clamp_u16(uint16_t *a, size_t n, const uint16_t *lo,
+		     const uint16_t *hi);
+void svops_clamp_i32(int32_t *a, size_t n, const int32_t *lo,
+		     const int32_t *hi);
+void svops_clamp_u32(uint32_t *a, size_t n, const uint32_t *lo,
+		     const uint32_t *hi);
+void svops_clamp_i64(int64_t *a, size_t n, const int64_t *lo,
+		     const int64_t *hi);
+void svops_clamp_u64(uint64_t *a, size_t n, const uint64_t *lo,
+		     const uint64_t *hi);
+void svops_clamp_f(float *a, size_t n, const float *lo, const float *hi);
+void svops_clamp_d(double *a, size_t n, const double *lo, const double *hi);
+
+/*
+ * 128-bit accumulation, and conversion to 64-bit (S_FALSE if out of
+ * range, with the result saturated)
+ */
+void svops_acc_add(struct SVOpsAcc *acc, const struct SVOpsAcc *x);
+srt_bool svops_acc_i64(const struct SVOpsAcc *acc, int64_t *r);
+srt_bool svops_acc_u64(const struct SVOpsAcc *acc, uint64_t *r);
+
+/*
+ * Run 'wf' over [0, elems) split in up to 'nthreads' contiguous chunks
+ * (one thread per chunk, the calling thread included), returning the
+ * number of chunks. Small inputs are processed as a single chunk.
+ */
+size_t svops_par(size_t elems, size_t nthreads, svops_par_wf wf, void *ctx);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* SVOPS_H */
@@ -0,0 +1,332 @@
+/*
+ * svpack.c
+ *
+ * Integer block codec: frame of reference or delta, plus bit-packing.
+ *
+ * Observations:
+ * - Block format: element count - 1 (1 byte), mode (bit 7: delta) and
+ *   bits per key (1 byte), base size in bytes (1 byte), base (little
+ *   endian), and packed words (64-bit, little endian).
+ * - Key 'i' goes to lane 'i % SVPACK_LANES', keys in the same lane being
+ *   packed consecutively. Words are interleaved by lane, so the same
+ *   shift is applied to all lanes at every step (no per-key branches).
+ * - Delta mode uses the difference against the key SVPACK_LANES
+ *   positions before (instead of the previous key), so the prefix sum
+ *   is computed for all lanes in parallel, while unpacking.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "svpack.h"
+
+/*
+ * Internal constants
+ */
+
+#define SVPACK_DELTA 0x80
+#define SVPACK_BITS_MASK 0x7f
+
+/*
+ * Vector instruction set selection (little endian targets, so packed words
+ * are loaded directly from the byte stream)
+ */
+
+#if !defined(S_DISABLE_SIMD) && !defined(S_MINIMAL)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SVPACK_SIMD
+#define SVPACK_VL 4 /* 64-bit words per vector */
+typedef __m256i svpack_v;
+#define SVPACK_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SVPACK_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define SVPACK_SET64(x) _mm256_set1_epi64x((long long)(x))
+#define SVPACK_SRL(v, s) _mm256_srl_epi64(v, _mm_cvtsi32_si128((int)(s)))
+#define SVPACK_SLL(v, s) _mm256_sll_epi64(v, _mm_cvtsi32_si128((int)(s)))
+#define SVPACK_OR(a, b) _mm256_or_si256(a, b)
+#define SVPACK_AND(a, b) _mm256_and_si256(a, b)
+#define SVPACK_ADD(a, b) _mm256_add_epi64(a, b)
+
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SVPACK_SIMD
+#define SVPACK_VL 2
+typedef __m128i svpack_v;
+#define SVPACK_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SVPACK_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define SVPACK_SET64(x)                                                        \
+	_mm_set_epi32((int)((x) >> 32), (int)(x), (int)((x) >> 32), (int)(x))
+#define SVPACK_SRL(v, s) _mm_srl_epi64(v, _mm_cvtsi32_si128((int)(s)))
+#define SVPACK_SLL(v, s) _mm_sll_epi64(v, _mm_cvtsi32_si128((int)(s)))
+#define SVPACK_OR(a, b) _mm_or_si128(a, b)
+#define SVPACK_AND(a, b) _mm_and_si128(a, b)
+#define SVPACK_ADD(a, b) _mm_add_epi64(a, b)
+
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define SVPACK_SIMD
+#define SVPACK_VL 2
+typedef uint64x2_t svpack_v;
+#define SVPACK_LOAD(p) vld1q_u64((const uint64_t *)(p))
+#define SVPACK_STORE(p, v) vst1q_u64(p, v)
+#define SVPACK_SET64(x) vdupq_n_u64(x)
+#define SVPACK_SRL(v, s) vshlq_u64(v, vdupq_n_s64(-(int64_t)(s)))
+#define SVPACK_SLL(v, s) vshlq_u64(v, vdupq_n_s64((int64_t)(s)))
+#define SVPACK_OR(a, b) vorrq_u64(a, b)
+#define SVPACK_AND(a, b) vandq_u64(a, b)
+#define SVPACK_ADD(a, b) vaddq_u64(a, b)
+
+#endif
+#endif
+
+/*
+ * Keys
+ */
+
+#define BUILD_SVPACK_KEYS(FK, FU, TU)                                          \
+	static void FK(uint64_t *k, const void *b, size_t n, TU sb)            \
+	{                                                                      \
+		size_t i;                                                      \
+		const TU *p = (const TU *)b;                                   \
+		for (i = 0; i < n; i++)                                        \
+			k[i] = (uint64_t)(TU)(p[i] ^ sb);                      \
+	}                                                                      \
+	static void FU(void *b, const uint64_t *k, size_t n, TU sb)            \
+	{                                                                      \
+		size_t i;                                                      \
+		TU *p = (TU *)b;                                               \
+		for (i = 0; i < n; i++)                                        \
+			p[i] = (TU)((TU)k[i] ^ sb);                            \
+	}
+
+BUILD_SVPACK_KEYS(svpack_keys8, svpack_unkeys8, uint8_t)
+BUILD_SVPACK_KEYS(svpack_keys16, svpack_unkeys16, uint16_t)
+BUILD_SVPACK_KEYS(svpack_keys32, svpack_unkeys32, uint32_t)
+BUILD_SVPACK_KEYS(svpack_keys64, svpack_unkeys64, uint64_t)
+
+void svpack_keys(uint64_t *k, const void *b, size_t n, size_t es,
+		 srt_bool sign)
+{
+	switch (es) {
+	case 1:
+		svpack_keys8(k, b, n, (uint8_t)(sign ? 0x80 : 0));
+		break;
+	case 2:
+		svpack_keys16(k, b, n, (uint16_t)(sign ? 0x8000 : 0));
+		break;
+	case 4:
+		svpack_keys32(k, b, n, sign ? 0x80000000 : 0);
+		break;
+	case 8:
+		svpack_keys64(k, b, n, sign ? (uint64_t)1 << 63 : 0);
+		break;
+	default:
+		break;
+	}
+}
+
+void svpack_unkeys(void *b, const uint64_t *k, size_t n, size_t es,
+		   srt_bool sign)
+{
+	switch (es) {
+	case 1:
+		svpack_unkeys8(b, k, n, (uint8_t)(sign ? 0x80 : 0));
+		break;
+	case 2:
+		svpack_unkeys16(b, k, n, (uint16_t)(sign ? 0x8000 : 0));
+		break;
+	case 4:
+		svpack_unkeys32(b, k, n, sign ? 0x80000000 : 0);
+		break;
+	case 8:
+		svpack_unkeys64(b, k, n, sign ? (uint64_t)1 << 63 : 0);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Bit-packing
+ */
+
+S_INLINE size_t svpack_bits(uint64_t x)
+{
+	return x ? slog2(x) + 1 : 0;
+}
+
+S_INLINE size_t svpack_bytes(uint64_t x)
+{
+	return (svpack_bits(x) + 7) / 8;
+}
+
+/*
+ * Words per lane for 'l' keys per lane of 'b' bits
+ */
+S_INLINE size_t svpack_wpl(size_t l, size_t b)
+{
+	return (l * b + 63) / 64;
+}
+
+static void svpack_pack(uint64_t *w, const uint64_t *r, size_t l, size_t b)
+{
+	size_t i, j, p, q, s;
+	memset(w, 0, svpack_wpl(l, b) * SVPACK_LANES * sizeof(w[0]));
+	for (i = 0, p = 0; i < l; i++, p += b) {
+		q = (p / 64) * SVPACK_LANES;
+		s = p % 64;
+		for (j = 0; j < SVPACK_LANES; j++)
+			w[q + j] |= r[i * SVPACK_LANES + j] << s;
+		if (s + b > 64)
+			for (j = 0; j < SVPACK_LANES; j++)
+				w[q + SVPACK_LANES + j] |=
+					r[i * SVPACK_LANES + j] >> (64 - s);
+	}
+}
+
+S_INLINE uint64_t svpack_mask(size_t b)
+{
+	return b < 64 ? ((uint64_t)1 << b) - 1 : (uint64_t)-1;
+}
+
+/*
+ * Unpack 'l' keys per lane from the packed words ('w': little endian
+ * 64-bit words, interleaved by lane), adding the base (frame of reference)
+ * or the previous key of the same lane (delta)
+ */
+#ifdef SVPACK_SIMD
+static void svpack_unpack(uint64_t *r, const uint8_t *w, size_t l, size_t b,
+			  uint64_t base, srt_bool delta)
+{
+	size_t i, h, p, q, s;
+	svpack_v m = SVPACK_SET64(svpack_mask(b)), vb = SVPACK_SET64(base), x,
+		 a[SVPACK_LANES / SVPACK_VL];
+	for (h = 0; h < SVPACK_LANES / SVPACK_VL; h++)
+		a[h] = vb;
+	for (i = 0, p = 0; i < l; i++, p += b) {
+		q = (p / 64) * SVPACK_LANES * 8;
+		s = p % 64;
+		for (h = 0; h < SVPACK_LANES; h += SVPACK_VL) {
+			x = SVPACK_SRL(SVPACK_LOAD(w + q + h * 8), s);
+			if (s + b > 64)
+				x = SVPACK_OR(x, SVPACK_SLL(SVPACK_LOAD(
+							    w + q + 8 * h
+							    + 8 * SVPACK_LANES),
+							    64 - s));
+			x = SVPACK_AND(x, m);
+			if (delta)
+				x = a[h / SVPACK_VL] =
+					SVPACK_ADD(a[h / SVPACK_VL], x);
+			else
+				x = SVPACK_ADD(x, vb);
+			SVPACK_STORE(r + i * SVPACK_LANES + h, x);
+		}
+	}
+}
+#else
+static void svpack_unpack(uint64_t *r, const uint8_t *w, size_t l, size_t b,
+			  uint64_t base, srt_bool delta)
+{
+	size_t i, j, p, q, s;
+	uint64_t m = svpack_mask(b), x, a[SVPACK_LANES];
+	for (j = 0; j < SVPACK_LANES; j++)
+		a[j] = base;
+	for (i = 0, p = 0; i < l; i++, p += b) {
+		q = (p / 64) * SVPACK_LANES * 8;
+		s = p % 64;
+		for (j = 0; j < SVPACK_LANES; j++) {
+			x = S_LD_LE_U64(w + q + j * 8) >> s;
+			if (s + b > 64)
+				x |= S_LD_LE_U64(w + q + 8 * (j + SVPACK_LANES))
+				     << (64 - s);
+			x &= m;
+			r[i * SVPACK_LANES + j] = delta ? (a[j] += x)
+							: x + base;
+		}
+	}
+}
+#endif
+
+/*
+ * Block codec
+ */
+
+size_t svpack_enc(uint8_t *o, const uint64_t *k, size_t n)
+{
+	uint64_t r[SVPACK_BLK], w[SVPACK_BLK], mn, mx, dm = 0, base;
+	size_t i, l, b, nw, nb;
+	srt_bool delta = S_TRUE;
+	RETURN_IF(!o || !k || !n || n > SVPACK_BLK, 0);
+	mn = mx = k[0];
+	for (i = 1; i < n; i++) {
+		mn = k[i] < mn ? k[i] : mn;
+		mx = k[i] > mx ? k[i] : mx;
+		if (k[i] < k[i - 1])
+			delta = S_FALSE;
+	}
+	for (i = SVPACK_LANES; i < n && delta; i++)
+		dm |= k[i] - k[i - SVPACK_LANES];
+	for (i = 1; i < n && i < SVPACK_LANES && delta; i++)
+		dm |= k[i] - k[0];
+	b = svpack_bits(mx - mn);
+	if (delta && svpack_bits(dm) < b) {
+		b = svpack_bits(dm);
+		base = k[0];
+		for (i = 0; i < n && i < SVPACK_LANES; i++)
+			r[i] = k[i] - base;
+		for (; i < n; i++)
+			r[i] = k[i] - k[i - SVPACK_LANES];
+	} else {
+		delta = S_FALSE;
+		base = mn;
+		for (i = 0; i < n; i++)
+			r[i] = k[i] - base;
+	}
+	l = (n + SVPACK_LANES - 1) / SVPACK_LANES;
+	for (i = n; i < l * SVPACK_LANES; i++)
+		r[i] = 0;
+	nb = svpack_bytes(base);
+	o[0] = (uint8_t)(n - 1);
+	o[1] = (uint8_t)((delta ? SVPACK_DELTA : 0) | b);
+	o[2] = (uint8_t)nb;
+	o += SVPACK_HDR;
+	for (i = 0; i < nb; i++)
+		o[i] = (uint8_t)(base >> (8 * i));
+	o += nb;
+	nw = svpack_wpl(l, b) * SVPACK_LANES;
+	if (b) {
+		svpack_pack(w, r, l, b);
+		for (i = 0; i < nw; i++)
+			S_ST_LE_U64(o + i * 8, w[i]);
+	}
+	return SVPACK_HDR + nb + nw * 8;
+}
+
+size_t svpack_dec(uint64_t *k, size_t *n, const uint8_t *b, size_t bs)
+{
+	uint64_t base = 0;
+	size_t i, l, nbits, nb, nw, bytes;
+	srt_bool delta;
+	RETURN_IF(!k || !n || !b || bs < SVPACK_HDR, 0);
+	*n = (size_t)b[0] + 1;
+	delta = b[1] & SVPACK_DELTA ? S_TRUE : S_FALSE;
+	nbits = b[1] & SVPACK_BITS_MASK;
+	nb = b[2];
+	RETURN_IF(*n > SVPACK_BLK || nbits > 64 || nb > 8,
+		  0); /* BEHAVIOR: invalid block */
+	l = (*n + SVPACK_LANES - 1) / SVPACK_LANES;
+	nw = svpack_wpl(l, nbits) * SVPACK_LANES;
+	bytes = SVPACK_HDR + nb + nw * 8;
+	RETURN_IF(bytes > bs, 0); /* BEHAVIOR: truncated block */
+	b += SVPACK_HDR;
+	for (i = 0; i < nb; i++)
+		base |= (uint64_t)b[i] << (8 * i);
+	b += nb;
+	if (nbits)
+		svpack_unpack(k, b, l, nbits, base, delta);
+	else
+		for (i = 0; i < l * SVPACK_LANES; i++)
+			k[i] = base;
+	return bytes;
+}
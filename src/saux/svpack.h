@@ -0,0 +1,66 @@
+#ifndef SVPACK_H
+#define SVPACK_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "scommon.h"
+
+/*
+ * svpack.h
+ *
+ * Integer block codec: frame of reference or delta, plus bit-packing
+ * (compressed integer vector kernels).
+ *
+ * Features:
+ * - Blocks of up to SVPACK_BLK 64-bit keys, every block being encoded
+ *   independently (so it can be decoded alone).
+ * - Per-block choice between frame of reference (key - block minimum)
+ *   and delta (key - key 4 positions before, for non-decreasing blocks),
+ *   taking the one requiring fewer bits.
+ * - Bit-packing in SVPACK_LANES interleaved lanes of 64-bit words (same
+ *   layout idea as SIMD-BP128), unpacking all lanes with the same shift.
+ *   SSE2, AVX2 or NEON (AArch64) unpacking, selected at compile time, with
+ *   a scalar fallback (S_DISABLE_SIMD, S_MINIMAL, or other targets).
+ * - Byte stream is endianness-independent (little endian words).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#define SVPACK_BLK 128
+#define SVPACK_LANES 4
+#define SVPACK_HDR 3 /* element count, mode and bits, base size */
+
+/*
+ * Maximum encoded block size for keys of 'es' bytes
+ */
+#define SVPACK_BLK_MAX(es) (SVPACK_HDR + 8 + SVPACK_BLK * (es))
+
+/*
+ * Ordered keys from 1/2/4/8 byte integer elements (signed: sign bit
+ * flipped), and back
+ */
+void svpack_keys(uint64_t *k, const void *b, size_t n, size_t es,
+		 srt_bool sign);
+void svpack_unkeys(void *b, const uint64_t *k, size_t n, size_t es,
+		   srt_bool sign);
+
+/*
+ * Encode 'n' keys (1 <= n <= SVPACK_BLK), returning the bytes written to
+ * 'o' (at most SVPACK_BLK_MAX(8), or SVPACK_BLK_MAX(es) for keys of 'es'
+ * bytes)
+ */
+size_t svpack_enc(uint8_t *o, const uint64_t *k, size_t n);
+
+/*
+ * Decode one block into 'k' (room for SVPACK_BLK keys required), setting
+ * the key count in 'n', and returning the bytes read (0: invalid block)
+ */
+size_t svpack_dec(uint64_t *k, size_t *n, const uint8_t *b, size_t bs);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* SVPACK_H */
@@ -0,0 +1,367 @@
+/*
+ * sfmap.c
+ *
+ * Flat map handling.
+ *
+ * Observations:
+ * - Keys and values are stored in Eytzinger order (1-based: node k having
+ *   its children at 2k and 2k + 1), so the search is a fixed-trip descent
+ *   with no data-dependent branches: the comparison result is added to
+ *   the next index, and the lower bound is recovered at the end from the
+ *   index bits (dropping the trailing right turns).
+ * - The keys 3 levels below the current node are contiguous (8 keys of 8
+ *   bytes, one cache line), being prefetched on every step.
+ * - Slots exposed to the user are the Eytzinger indexes (1..n).
+ * - Unsigned 64-bit keys (SV_U64 input) are stored with the sign bit
+ *   flipped, so the signed comparison gives the unsigned order. The flip
+ *   is applied to every key going in or out of the map.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "sfmap.h"
+#include "saux/scommon.h"
+
+/*
+ * Internal constants
+ */
+
+#define SFM_PF_STRIDE 8 /* descendants 3 levels below (8 x 8 bytes) */
+
+/*
+ * Internal data structures
+ */
+
+union SFMapE {
+	int64_t i;
+	double d;
+};
+
+struct SFMap {
+	size_t size;
+	enum eSFM_Type t;
+	srt_bool uk; /* unsigned keys (SFM_II built from SV_U64) */
+	union SFMapE *k, *v; /* k[0], v[0]: not used */
+};
+
+/*
+ * Internal functions
+ */
+
+S_INLINE srt_bool sfm_chk_t(const srt_fmap *m, enum eSFM_Type t)
+{
+	return m && m->t == t ? S_TRUE : S_FALSE;
+}
+
+/* Key conversion between the user and the stored form (involution) */
+S_INLINE int64_t sfm_ki(const srt_fmap *m, int64_t k)
+{
+	return m->uk ? (int64_t)((uint64_t)k ^ ((uint64_t)1 << 63)) : k;
+}
+
+S_INLINE size_t sfm_first_aux(size_t n)
+{
+	size_t k = 1;
+	RETURN_IF(!n, S_NPOS);
+	while (2 * k <= n)
+		k *= 2;
+	return k;
+}
+
+/*
+ * In-order successor: leftmost node of the right subtree, or the first
+ * ancestor reached from a left child
+ */
+S_INLINE size_t sfm_next_aux(size_t n, size_t k)
+{
+	if (2 * k + 1 <= n) {
+		for (k = 2 * k + 1; 2 * k <= n;)
+			k *= 2;
+		return k;
+	}
+	while (k & 1)
+		k >>= 1;
+	k >>= 1;
+	return k ? k : S_NPOS;
+}
+
+#define SFM_BUILD_BOUND(FN, T, F, OP)                                          \
+	static size_t FN(const srt_fmap *m, T x)                               \
+	{                                                                      \
+		size_t k = 1, n = m->size;                                     \
+		const union SFMapE *e = m->k;                                  \
+		while (k <= n) { /* prefetch index clamped to the array */     \
+			S_PREFETCH(e + S_MIN(SFM_PF_STRIDE * k, n));           \
+			k = 2 * k + (e[k].F OP x ? 1 : 0);                     \
+		}                                                              \
+		while (k & 1)                                                  \
+			k >>= 1;                                               \
+		k >>= 1;                                                       \
+		return k ? k : S_NPOS;                                         \
+	}
+
+SFM_BUILD_BOUND(sfm_lb_i, int64_t, i, <)
+SFM_BUILD_BOUND(sfm_ub_i, int64_t, i, <=)
+SFM_BUILD_BOUND(sfm_lb_d, double, d, <)
+SFM_BUILD_BOUND(sfm_ub_d, double, d, <=)
+
+static int64_t sfm_sv_i(const srt_vector *v, size_t i)
+{
+	switch (v->d.sub_type) {
+	case SV_I8:
+		return sv_at_i8(v, i);
+	case SV_U8:
+		return sv_at_u8(v, i);
+	case SV_I16:
+		return sv_at_i16(v, i);
+	case SV_U16:
+		return sv_at_u16(v, i);
+	case SV_I32:
+		return sv_at_i32(v, i);
+	case SV_U32:
+		return sv_at_u32(v, i);
+	case SV_I64:
+		return sv_at_i64(v, i);
+	case SV_U64:
+		return (int64_t)sv_at_u64(v, i);
+	default:
+		break;
+	}
+	return 0;
+}
+
+static double sfm_sv_d(const srt_vector *v, size_t i)
+{
+	return v->d.sub_type == SV_F ? (double)sv_at_f(v, i) : sv_at_d(v, i);
+}
+
+S_INLINE srt_bool sfm_sv_int(const srt_vector *v)
+{
+	return v->d.sub_type < SV_F ? S_TRUE : S_FALSE;
+}
+
+/*
+ * Allocation
+ */
+
+srt_fmap *sfm_alloc(const srt_vector *keys, const srt_vector *values)
+{
+	srt_fmap *m;
+	size_t i, k, n, es = sizeof(union SFMapE);
+	RETURN_IF(!keys || !values, NULL);
+	RETURN_IF(keys->d.sub_type > SV_LAST_NUM
+			  || values->d.sub_type > SV_LAST_NUM
+			  || sfm_sv_int(keys) != sfm_sv_int(values),
+		  NULL); /* BEHAVIOR: non-supported vector types */
+	n = sv_size(keys);
+	RETURN_IF(sv_size(values) != n, NULL);
+	RETURN_IF(n >= (S_SIZET_MAX - sizeof(srt_fmap)) / (2 * es) - 1, NULL);
+	m = (srt_fmap *)s_malloc(sizeof(srt_fmap) + 2 * es * (n + 1));
+	RETURN_IF(!m, NULL);
+	m->size = n;
+	m->t = sfm_sv_int(keys) ? SFM_II : SFM_DD;
+	m->uk = keys->d.sub_type == SV_U64 ? S_TRUE : S_FALSE;
+	m->k = (union SFMapE *)(m + 1);
+	m->v = m->k + n + 1;
+	for (i = 0, k = sfm_first_aux(n); i < n; i++, k = sfm_next_aux(n, k)) {
+		if (m->t == SFM_II) {
+			m->k[k].i = sfm_ki(m, sfm_sv_i(keys, i));
+			m->v[k].i = sfm_sv_i(values, i);
+			if (i > 0
+			    && !(m->k[k].i > sfm_ki(m, sfm_sv_i(keys, i - 1))))
+				break;
+		} else {
+			m->k[k].d = sfm_sv_d(keys, i);
+			m->v[k].d = sfm_sv_d(values, i);
+			if (i > 0 && !(m->k[k].d > sfm_sv_d(keys, i - 1)))
+				break;
+		}
+	}
+	if (i < n) { /* BEHAVIOR: non-sorted or repeated keys */
+		s_free(m);
+		return NULL;
+	}
+	return m;
+}
+
+srt_fmap *sfm_from_map(const srt_map *m)
+{
+	srt_fmap *fm;
+	srt_vector *kv = NULL, *vv = NULL;
+	RETURN_IF(!m, NULL);
+	switch (m->d.sub_type) {
+	case SM0_II32:
+	case SM0_UU32:
+	case SM0_II:
+	case SM0_FF:
+	case SM0_DD:
+		break;
+	default:
+		return NULL; /* BEHAVIOR: non-supported map type */
+	}
+	sm_sort_to_vectors(m, &kv, &vv);
+	fm = sfm_alloc(kv, vv);
+#ifdef S_USE_VA_ARGS
+	sv_free(&kv, &vv);
+#else
+	sv_free(&kv);
+	sv_free(&vv);
+#endif
+	return fm;
+}
+
+void sfm_free_aux(srt_fmap **m, ...)
+{
+	va_list ap;
+	srt_fmap **next;
+	va_start(ap, m);
+	next = m;
+	while (!s_varg_tail_ptr_tag(next)) { /* last element tag */
+		if (next && *next) {
+			s_free(*next);
+			*next = NULL;
+		}
+		next = (srt_fmap **)va_arg(ap, srt_fmap **);
+	}
+	va_end(ap);
+}
+
+size_t sfm_size(const srt_fmap *m)
+{
+	return m ? m->size : 0;
+}
+
+enum eSFM_Type sfm_type(const srt_fmap *m)
+{
+	return m ? m->t : SFM_II;
+}
+
+/*
+ * Accessors
+ */
+
+int64_t sfm_at_ii(const srt_fmap *m, int64_t k)
+{
+	size_t s;
+	RETURN_IF(!sfm_chk_t(m, SFM_II), 0);
+	k = sfm_ki(m, k);
+	s = sfm_lb_i(m, k);
+	return s != S_NPOS && m->k[s].i == k ? m->v[s].i : 0;
+}
+
+double sfm_at_dd(const srt_fmap *m, double k)
+{
+	size_t s;
+	RETURN_IF(!sfm_chk_t(m, SFM_DD), 0);
+	s = sfm_lb_d(m, k);
+	return s != S_NPOS && m->k[s].d == k ? m->v[s].d : 0;
+}
+
+/*
+ * Existence check
+ */
+
+size_t sfm_count_i(const srt_fmap *m, int64_t k)
+{
+	size_t s;
+	RETURN_IF(!sfm_chk_t(m, SFM_II), 0);
+	k = sfm_ki(m, k);
+	s = sfm_lb_i(m, k);
+	return s != S_NPOS && m->k[s].i == k ? 1 : 0;
+}
+
+size_t sfm_count_d(const srt_fmap *m, double k)
+{
+	size_t s;
+	RETURN_IF(!sfm_chk_t(m, SFM_DD), 0);
+	s = sfm_lb_d(m, k);
+	return s != S_NPOS && m->k[s].d == k ? 1 : 0;
+}
+
+/*
+ * Bounds / slot access
+ */
+
+size_t sfm_lower_bound_i(const srt_fmap *m, int64_t k)
+{
+	return sfm_chk_t(m, SFM_II) ? sfm_lb_i(m, sfm_ki(m, k)) : S_NPOS;
+}
+
+size_t sfm_lower_bound_d(const srt_fmap *m, double k)
+{
+	return sfm_chk_t(m, SFM_DD) ? sfm_lb_d(m, k) : S_NPOS;
+}
+
+size_t sfm_upper_bound_i(const srt_fmap *m, int64_t k)
+{
+	return sfm_chk_t(m, SFM_II) ? sfm_ub_i(m, sfm_ki(m, k)) : S_NPOS;
+}
+
+size_t sfm_upper_bound_d(const srt_fmap *m, double k)
+{
+	return sfm_chk_t(m, SFM_DD) ? sfm_ub_d(m, k) : S_NPOS;
+}
+
+size_t sfm_first(const srt_fmap *m)
+{
+	return m ? sfm_first_aux(m->size) : S_NPOS;
+}
+
+size_t sfm_next(const srt_fmap *m, size_t slot)
+{
+	RETURN_IF(!m || !slot || slot > m->size, S_NPOS);
+	return sfm_next_aux(m->size, slot);
+}
+
+#define SFM_BUILD_IT(FN, T, t, a, F)                                           \
+	T FN(const srt_fmap *m, size_t slot)                                   \
+	{                                                                      \
+		RETURN_IF(!sfm_chk_t(m, t) || !slot || slot > m->size, 0);     \
+		return m->a[slot].F;                                           \
+	}
+
+SFM_BUILD_IT(sfm_it_ii_v, int64_t, SFM_II, v, i)
+SFM_BUILD_IT(sfm_it_d_k, double, SFM_DD, k, d)
+SFM_BUILD_IT(sfm_it_dd_v, double, SFM_DD, v, d)
+
+int64_t sfm_it_i_k(const srt_fmap *m, size_t slot)
+{
+	RETURN_IF(!sfm_chk_t(m, SFM_II) || !slot || slot > m->size, 0);
+	return sfm_ki(m, m->k[slot].i);
+}
+
+/*
+ * Enumeration
+ */
+
+size_t sfm_itr_ii(const srt_fmap *m, int64_t key_min, int64_t key_max,
+		  srt_map_it_ii f, void *context)
+{
+	size_t cnt = 0, s;
+	RETURN_IF(!sfm_chk_t(m, SFM_II), 0);
+	key_min = sfm_ki(m, key_min);
+	key_max = sfm_ki(m, key_max);
+	RETURN_IF(key_min > key_max, 0);
+	for (s = sfm_lb_i(m, key_min); s != S_NPOS && m->k[s].i <= key_max;
+	     s = sfm_next_aux(m->size, s)) {
+		if (f && !f(sfm_ki(m, m->k[s].i), m->v[s].i, context))
+			break;
+		cnt++;
+	}
+	return cnt;
+}
+
+size_t sfm_itr_dd(const srt_fmap *m, double key_min, double key_max,
+		  srt_map_it_dd f, void *context)
+{
+	size_t cnt = 0, s;
+	RETURN_IF(!sfm_chk_t(m, SFM_DD) || key_min > key_max, 0);
+	for (s = sfm_lb_d(m, key_min); s != S_NPOS && m->k[s].d <= key_max;
+	     s = sfm_next_aux(m->size, s)) {
+		if (f && !f(m->k[s].d, m->v[s].d, context))
+			break;
+		cnt++;
+	}
+	return cnt;
+}
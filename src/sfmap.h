@@ -0,0 +1,158 @@
+#ifndef SFMAP_H
+#define SFMAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * sfmap.h
+ *
+ * #SHORTDOC flat map handling (read-only sorted key-value storage)
+ *
+ * #DOC Flat map functions handle read-only key-value storage for data that
+ * #DOC is built once and then only read (e.g. lookup tables rebuilt
+ * #DOC periodically). Keys and values are stored in two arrays (no per-node
+ * #DOC links), with the keys in Eytzinger order (implicit binary search
+ * #DOC tree, in breadth-first order), so the branchless search touches
+ * #DOC consecutive memory for the first levels and next levels are
+ * #DOC prefetched while comparing.
+ * #DOC
+ * #DOC Flat maps are built from sorted key and value vectors, e.g. the
+ * #DOC output of sm_sort_to_vectors(), or directly from a numeric srt_map.
+ * #DOC Element access is done through slot indexes (sfm_lower_bound_*(),
+ * #DOC sfm_upper_bound_*(), sfm_next() and sfm_it_*() accessors), similar
+ * #DOC to the srt_map ones.
+ * #DOC
+ * #DOC
+ * #DOC Supported map modes (enum eSFM_Type):
+ * #DOC
+ * #DOC
+ * #DOC 	SFM_II: int64_t key, int64_t value (built from integer vectors).
+ * #DOC 	When built from a SV_U64 key vector, keys are ordered as unsigned
+ * #DOC 	(key parameters and results being the int64_t cast of the
+ * #DOC 	uint64_t key)
+ * #DOC
+ * #DOC 	SFM_DD: double key, double value (built from float/double vectors)
+ * #DOC
+ * #DOC
+ * #DOC Callback types for the sfm_itr_*() functions (same as srt_map ones):
+ * #DOC
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_it_ii)(int64_t k, int64_t v, void *context);
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_it_dd)(double k, double v, void *context);
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "smap.h"
+
+/*
+ * Structures
+ */
+
+enum eSFM_Type { SFM_II, SFM_DD };
+
+struct SFMap;
+
+typedef struct SFMap srt_fmap;
+
+/*
+ * Allocation
+ */
+
+/* #API: |Allocate flat map (heap) from sorted key and value vectors (integer vectors: SFM_II, float/double vectors: SFM_DD)|keys (sorted, unique); values (same size and type family)|map; NULL if out of memory, invalid or non-sorted input|O(n)|1;2| */
+srt_fmap *sfm_alloc(const srt_vector *keys, const srt_vector *values);
+
+/* #API: |Allocate flat map (heap) from a map (SM_II32, SM_UU32, SM_II, SM_FF, SM_DD)|map|flat map; NULL if out of memory or non-supported map type|O(n)|1;2| */
+srt_fmap *sfm_from_map(const srt_map *m);
+
+/*
+#API: |Free one or more flat maps (heap)|map; more maps (optional)|-|O(1)|1;2|
+void sfm_free(srt_fmap **m, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define sfm_free(...) sfm_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define sfm_free(m) sfm_free_aux(m, S_INVALID_PTR_VARG_TAIL)
+#endif
+void sfm_free_aux(srt_fmap **m, ...);
+
+/* #API: |Get map size|map|Map number of elements|O(1)|1;2| */
+size_t sfm_size(const srt_fmap *m);
+
+/* #API: |Get map type|map|Map type|O(1)|1;2| */
+enum eSFM_Type sfm_type(const srt_fmap *m);
+
+/*
+ * Accessors
+ */
+
+/* #API: |Access to int-int map element|map; key|value (0 if not found)|O(log n)|1;2| */
+int64_t sfm_at_ii(const srt_fmap *m, int64_t k);
+
+/* #API: |Access to double-double map element|map; key|value (0 if not found)|O(log n)|1;2| */
+double sfm_at_dd(const srt_fmap *m, double k);
+
+/*
+ * Existence check
+ */
+
+/* #API: |Map element count/check (SFM_II)|map; key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+size_t sfm_count_i(const srt_fmap *m, int64_t k);
+
+/* #API: |Map element count/check (SFM_DD)|map; key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+size_t sfm_count_d(const srt_fmap *m, double k);
+
+/*
+ * Bounds / slot access
+ */
+
+/* #API: |Locate first element with key >= k (lower bound) (SFM_II)|map; key|Slot (for sfm_it_*); S_NPOS if not found|O(log n)|1;2| */
+size_t sfm_lower_bound_i(const srt_fmap *m, int64_t k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SFM_DD)|map; key|Slot (for sfm_it_*); S_NPOS if not found|O(log n)|1;2| */
+size_t sfm_lower_bound_d(const srt_fmap *m, double k);
+
+/* #API: |Locate first element with key > k (upper bound) (SFM_II)|map; key|Slot (for sfm_it_*); S_NPOS if not found|O(log n)|1;2| */
+size_t sfm_upper_bound_i(const srt_fmap *m, int64_t k);
+
+/* #API: |Locate first element with key > k (upper bound) (SFM_DD)|map; key|Slot (for sfm_it_*); S_NPOS if not found|O(log n)|1;2| */
+size_t sfm_upper_bound_d(const srt_fmap *m, double k);
+
+/* #API: |Get first element slot (smallest key)|map|Slot (for sfm_it_*); S_NPOS if empty|O(log n)|1;2| */
+size_t sfm_first(const srt_fmap *m);
+
+/* #API: |Get next element slot (key order)|map; slot|Slot (for sfm_it_*); S_NPOS if no more elements|O(1) amortized|1;2| */
+size_t sfm_next(const srt_fmap *m, size_t slot);
+
+/* #API: |Get key at slot (SFM_II)|map; slot|Key (0 if invalid slot)|O(1)|1;2| */
+int64_t sfm_it_i_k(const srt_fmap *m, size_t slot);
+
+/* #API: |Get value at slot (SFM_II)|map; slot|Value (0 if invalid slot)|O(1)|1;2| */
+int64_t sfm_it_ii_v(const srt_fmap *m, size_t slot);
+
+/* #API: |Get key at slot (SFM_DD)|map; slot|Key (0 if invalid slot)|O(1)|1;2| */
+double sfm_it_d_k(const srt_fmap *m, size_t slot);
+
+/* #API: |Get value at slot (SFM_DD)|map; slot|Value (0 if invalid slot)|O(1)|1;2| */
+double sfm_it_dd_v(const srt_fmap *m, size_t slot);
+
+/*
+ * Enumeration
+ */
+
+/* #API: |Enumerate int-int map elements in key range, in key order|map; key lower bound; key upper bound; callback function (NULL: count only); callback function context|Number of elements processed|O(log n + k)|1;2| */
+size_t sfm_itr_ii(const srt_fmap *m, int64_t key_min, int64_t key_max,
+		  srt_map_it_ii f, void *context);
+
+/* #API: |Enumerate double-double map elements in key range, in key order|map; key lower bound; key upper bound; callback function (NULL: count only); callback function context|Number of elements processed|O(log n + k)|1;2| */
+size_t sfm_itr_dd(const srt_fmap *m, double key_min, double key_max,
+		  srt_map_it_dd f, void *context);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* #ifndef SFMAP_H */
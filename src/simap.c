@@ -0,0 +1,222 @@
+/*
+ * simap.c
+ *
+ * Interval map handling.
+ *
+ * Observations:
+ * - Red-Black tree sorted by (lo, hi), every node keeping the maximum hi
+ *   of its subtree (updated by the tree code through the augmented node
+ *   data callback, on rotations and on the insert/delete path).
+ * - Queries are in-order walks skipping the subtrees having a maximum hi
+ *   below the query lower bound, and stopping at the first node having a
+ *   lo above the query upper bound.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "simap.h"
+#include "saux/scommon.h"
+
+/*
+ * Internal constants
+ */
+
+#define SIM_SUBTYPE(t) ((uint8_t)(0x80 | (t))) /* not colliding with maps */
+
+/*
+ * Internal data structures
+ */
+
+struct SIMapNode {
+	srt_tnode n;
+	int64_t lo, hi;
+	int64_t max_hi; /* subtree maximum hi (augmented data) */
+	union {
+		int64_t i;
+		const void *p;
+	} v;
+};
+
+union SIMapItrF {
+	srt_imap_it_ii ii;
+	srt_imap_it_ip ip;
+};
+
+/*
+ * Internal functions
+ */
+
+static int cmp_sim(const struct SIMapNode *a, const struct SIMapNode *b)
+{
+	if (a->lo != b->lo)
+		return a->lo > b->lo ? 1 : -1;
+	return a->hi > b->hi ? 1 : a->hi < b->hi ? -1 : 0;
+}
+
+static void aug_sim(void *node, const void *l, const void *r)
+{
+	struct SIMapNode *n = (struct SIMapNode *)node;
+	n->max_hi = n->hi;
+	if (l && ((const struct SIMapNode *)l)->max_hi > n->max_hi)
+		n->max_hi = ((const struct SIMapNode *)l)->max_hi;
+	if (r && ((const struct SIMapNode *)r)->max_hi > n->max_hi)
+		n->max_hi = ((const struct SIMapNode *)r)->max_hi;
+}
+
+S_INLINE srt_bool sim_chk_t(const srt_imap *m, enum eSIM_Type t)
+{
+	return m && m->d.sub_type == SIM_SUBTYPE(t) ? S_TRUE : S_FALSE;
+}
+
+static srt_bool sim_insert(srt_imap **m, enum eSIM_Type t,
+			   const struct SIMapNode *n)
+{
+	RETURN_IF(!m || !sim_chk_t(*m, t), S_FALSE);
+	RETURN_IF(n->lo > n->hi, S_FALSE); /* BEHAVIOR: invalid interval */
+	return st_insert((srt_tree **)m, &n->n);
+}
+
+/*
+ * In-order walk of the intervals overlapping [lo, hi]
+ */
+static size_t sim_itr_aux(const srt_imap *m, enum eSIM_Type t, int64_t lo,
+			  int64_t hi, union SIMapItrF f, void *context)
+{
+	size_t level = 0, cnt = 0, ts, max_depth;
+	srt_tndx *s, c;
+	const struct SIMapNode *cn;
+	RETURN_IF(!sim_chk_t(m, t) || lo > hi, 0);
+	ts = st_size(m);
+	RETURN_IF(!ts, 0);
+	max_depth = 2 * (slog2(ts) + 1) + 3;
+	s = (srt_tndx *)s_alloca(sizeof(srt_tndx) * max_depth);
+	ASSERT_RETURN_IF(!s, 0); /* BEHAVIOR: stack error */
+	for (c = m->root;;) {
+		for (; c != ST_NIL && level < max_depth;) {
+			cn = (const struct SIMapNode *)get_node_r(m, c);
+			if (cn->max_hi < lo) /* no overlap in the subtree */
+				break;
+			s[level++] = c;
+			c = st_node_l(m, &cn->n);
+		}
+		if (!level)
+			break;
+		cn = (const struct SIMapNode *)get_node_r(m, s[--level]);
+		if (cn->lo > hi) /* next nodes start after the query end */
+			break;
+		if (cn->hi >= lo) {
+			if (t == SIM_II && f.ii
+			    && !f.ii(cn->lo, cn->hi, cn->v.i, context))
+				break;
+			if (t == SIM_IP && f.ip
+			    && !f.ip(cn->lo, cn->hi, cn->v.p, context))
+				break;
+			cnt++;
+		}
+		c = st_node_r(m, &cn->n);
+	}
+	return cnt;
+}
+
+/*
+ * Allocation
+ */
+
+srt_imap *sim_alloc(enum eSIM_Type t, size_t init_size)
+{
+	srt_imap *m = st_alloc((srt_cmp)cmp_sim, sizeof(struct SIMapNode),
+			       init_size);
+	RETURN_IF(!m || !st_set_aug(m, aug_sim), NULL); /* BEHAVIOR */
+	m->d.sub_type = SIM_SUBTYPE(t);
+	return m;
+}
+
+srt_imap *sim_dup(const srt_imap *src)
+{
+	srt_imap *m;
+	RETURN_IF(!src || !(src->d.sub_type & 0x80), NULL); /* BEHAVIOR */
+	m = st_dup(src);
+	/* BEHAVIOR: not enough memory */
+	RETURN_IF(!m || m == (srt_imap *)sd_void, NULL);
+	m->d.sub_type = src->d.sub_type;
+	return m;
+}
+
+void sim_clear(srt_imap *m)
+{
+	if (m && (m->d.sub_type & 0x80))
+		st_set_size(m, 0);
+}
+
+size_t sim_size(const srt_imap *m)
+{
+	return st_size(m);
+}
+
+/*
+ * Insert / delete
+ */
+
+srt_bool sim_insert_ii(srt_imap **m, int64_t lo, int64_t hi, int64_t v)
+{
+	struct SIMapNode n;
+	n.lo = lo;
+	n.hi = n.max_hi = hi;
+	n.v.i = v;
+	return sim_insert(m, SIM_II, &n);
+}
+
+srt_bool sim_insert_ip(srt_imap **m, int64_t lo, int64_t hi, const void *v)
+{
+	struct SIMapNode n;
+	n.lo = lo;
+	n.hi = n.max_hi = hi;
+	n.v.p = v;
+	return sim_insert(m, SIM_IP, &n);
+}
+
+srt_bool sim_delete(srt_imap *m, int64_t lo, int64_t hi)
+{
+	struct SIMapNode n;
+	RETURN_IF(!m || !(m->d.sub_type & 0x80), S_FALSE);
+	n.lo = lo;
+	n.hi = hi;
+	return st_delete(m, &n.n, NULL);
+}
+
+/*
+ * Queries
+ */
+
+size_t sim_stab_ii(const srt_imap *m, int64_t x, srt_imap_it_ii f,
+		   void *context)
+{
+	union SIMapItrF g;
+	g.ii = f;
+	return sim_itr_aux(m, SIM_II, x, x, g, context);
+}
+
+size_t sim_stab_ip(const srt_imap *m, int64_t x, srt_imap_it_ip f,
+		   void *context)
+{
+	union SIMapItrF g;
+	g.ip = f;
+	return sim_itr_aux(m, SIM_IP, x, x, g, context);
+}
+
+size_t sim_overlap_ii(const srt_imap *m, int64_t lo, int64_t hi,
+		      srt_imap_it_ii f, void *context)
+{
+	union SIMapItrF g;
+	g.ii = f;
+	return sim_itr_aux(m, SIM_II, lo, hi, g, context);
+}
+
+size_t sim_overlap_ip(const srt_imap *m, int64_t lo, int64_t hi,
+		      srt_imap_it_ip f, void *context)
+{
+	union SIMapItrF g;
+	g.ip = f;
+	return sim_itr_aux(m, SIM_IP, lo, hi, g, context);
+}
@@ -0,0 +1,122 @@
+#ifndef SIMAP_H
+#define SIMAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * simap.h
+ *
+ * #SHORTDOC interval map handling (interval-value storage)
+ *
+ * #DOC Interval map functions handle storage of closed integer intervals
+ * #DOC [lo, hi] with an associated value (e.g. IP ranges, time windows),
+ * #DOC allowing to locate the intervals containing a point (stabbing
+ * #DOC query) or overlapping a given interval (overlap query), without
+ * #DOC scanning all the intervals.
+ * #DOC
+ * #DOC It is implemented as a Red-Black tree (same storage as srt_map: a
+ * #DOC single memory block, with index-linked nodes), with intervals sorted
+ * #DOC by (lo, hi), being every node augmented with the maximum hi value of
+ * #DOC its subtree, so subtrees with no possible overlap are skipped.
+ * #DOC Inserting an already existing interval overwrites its value.
+ * #DOC
+ * #DOC
+ * #DOC Supported modes (enum eSIM_Type):
+ * #DOC
+ * #DOC
+ * #DOC 	SIM_II: int64_t interval, int64_t value
+ * #DOC
+ * #DOC 	SIM_IP: int64_t interval, pointer value
+ * #DOC
+ * #DOC
+ * #DOC Callback types for the sim_stab_*() and sim_overlap_*() functions:
+ * #DOC
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_imap_it_ii)(int64_t lo, int64_t hi, int64_t v, void *context);
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_imap_it_ip)(int64_t lo, int64_t hi, const void *v, void *context);
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "saux/stree.h"
+
+/*
+ * Structures
+ */
+
+enum eSIM_Type { SIM_II, SIM_IP };
+
+typedef srt_tree srt_imap; /* Opaque structure (accessors are provided) */
+
+typedef srt_bool (*srt_imap_it_ii)(int64_t lo, int64_t hi, int64_t v,
+				   void *context);
+typedef srt_bool (*srt_imap_it_ip)(int64_t lo, int64_t hi, const void *v,
+				   void *context);
+
+/*
+ * Allocation
+ */
+
+/* #API: |Allocate interval map (heap)|map type; initial reserve|map|O(1)|1;2| */
+srt_imap *sim_alloc(enum eSIM_Type t, size_t initial_num_elems_reserve);
+
+/* #API: |Duplicate interval map|input map|output map|O(n)|1;2| */
+srt_imap *sim_dup(const srt_imap *src);
+
+/* #API: |Reset/clean interval map (keeping map type)|map|-|O(1)|1;2| */
+void sim_clear(srt_imap *m);
+
+/*
+#API: |Free one or more interval maps (heap)|map; more maps (optional)|-|O(1)|1;2|
+void sim_free(srt_imap **m, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define sim_free(...) st_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define sim_free(m) st_free_aux(m, S_INVALID_PTR_VARG_TAIL)
+#endif
+
+/* #API: |Get interval map size|map|Number of intervals|O(1)|1;2| */
+size_t sim_size(const srt_imap *m);
+
+/*
+ * Insert / delete
+ */
+
+/* #API: |Insert interval into int-int interval map|map; interval lower bound; interval upper bound (>= lower bound); value|S_TRUE: OK, S_FALSE: insertion error or invalid interval|O(log n)|1;2| */
+srt_bool sim_insert_ii(srt_imap **m, int64_t lo, int64_t hi, int64_t v);
+
+/* #API: |Insert interval into int-pointer interval map|map; interval lower bound; interval upper bound (>= lower bound); value|S_TRUE: OK, S_FALSE: insertion error or invalid interval|O(log n)|1;2| */
+srt_bool sim_insert_ip(srt_imap **m, int64_t lo, int64_t hi, const void *v);
+
+/* #API: |Delete interval|map; interval lower bound; interval upper bound|S_TRUE: found and deleted; S_FALSE: not found|O(log n)|1;2| */
+srt_bool sim_delete(srt_imap *m, int64_t lo, int64_t hi);
+
+/*
+ * Queries
+ */
+
+/* #API: |Intervals containing a point (int-int map), in (lo, hi) order|map; point; callback function (NULL: count only); callback function context|Number of intervals processed|O(log n + k) typical, O(min(n, k log n)) worst case|1;2| */
+size_t sim_stab_ii(const srt_imap *m, int64_t x, srt_imap_it_ii f,
+		   void *context);
+
+/* #API: |Intervals containing a point (int-pointer map), in (lo, hi) order|map; point; callback function (NULL: count only); callback function context|Number of intervals processed|O(log n + k) typical, O(min(n, k log n)) worst case|1;2| */
+size_t sim_stab_ip(const srt_imap *m, int64_t x, srt_imap_it_ip f,
+		   void *context);
+
+/* #API: |Intervals overlapping a given interval (int-int map), in (lo, hi) order|map; interval lower bound; interval upper bound; callback function (NULL: count only); callback function context|Number of intervals processed|O(log n + k) typical, O(min(n, k log n)) worst case|1;2| */
+size_t sim_overlap_ii(const srt_imap *m, int64_t lo, int64_t hi,
+		      srt_imap_it_ii f, void *context);
+
+/* #API: |Intervals overlapping a given interval (int-pointer map), in (lo, hi) order|map; interval lower bound; interval upper bound; callback function (NULL: count only); callback function context|Number of intervals processed|O(log n + k) typical, O(min(n, k log n)) worst case|1;2| */
+size_t sim_overlap_ip(const srt_imap *m, int64_t lo, int64_t hi,
+		      srt_imap_it_ip f, void *context);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* #ifndef SIMAP_H */
@@ -148,8 +148,53 @@ static void aux_ss_delete(void *node)
 	sso_free(&((struct SMapSS *)node)->s);
 }
 
+#define BUILD_DUP_XS(FN, T)                                                    \
+	static void FN(srt_tnode *tgt, const srt_tnode *src)                   \
+	{                                                                      \
+		sso1_set(&((T *)tgt)->v, sso1_get(&((const T *)src)->v));      \
+	}
+
+BUILD_DUP_XS(aux_is_dup, struct SMapIS)
+BUILD_DUP_XS(aux_ds_dup, struct SMapDS)
+
+static void aux_sx_dup(srt_tnode *tgt, const srt_tnode *src)
+{
+	sso1_set(&((struct SMapS *)tgt)->k,
+		 sso1_get(&((const struct SMapS *)src)->k));
+}
+
+static void aux_ss_dup(srt_tnode *tgt, const srt_tnode *src)
+{
+	const struct SMapSS *ms = (const struct SMapSS *)src;
+	sso_set(&((struct SMapSS *)tgt)->s, sso_get(&ms->s),
+		sso_get_s2(&ms->s));
+}
+
 /* clang-format on */
 
+/*
+ * Node copy for elements using external dynamic memory (string data)
+ */
+static srt_tree_dup sm_dup_callback(int t)
+{
+	switch (t) {
+	case SM0_IS:
+		return aux_is_dup;
+	case SM0_DS:
+		return aux_ds_dup;
+	case SM0_S:
+	case SM0_SI:
+	case SM0_SD:
+	case SM0_SP:
+		return aux_sx_dup;
+	case SM0_SS:
+		return aux_ss_dup;
+	default:
+		break;
+	}
+	return NULL; /* no additional action required */
+}
+
 struct SV2X {
 	srt_vector *kv, *vv;
 };
@@ -432,6 +477,24 @@ srt_map *sm_alloc0(enum eSM_Type0 t, size_t init_size)
 	return m;
 }
 
+srt_map *sm_alloc0_wide(enum eSM_Type0 t, size_t init_size)
+{
+	srt_map *m = (srt_map *)st_alloc_wide(
+		type2cmpf(t), sm_elem_size((int)t), init_size);
+	if (m)
+		m->d.sub_type = (uint8_t)t;
+	return m;
+}
+
+srt_map *sm_alloc0_multi(enum eSM_Type0 t, size_t init_size)
+{
+	srt_map *m = (srt_map *)st_alloc_multi(
+		type2cmpf(t), sm_elem_size((int)t), init_size);
+	if (m)
+		m->d.sub_type = (uint8_t)t;
+	return m;
+}
+
 void sm_free_aux(srt_map **m, ...)
 {
 	va_list ap;
@@ -457,6 +520,12 @@ srt_map *sm_dup(const srt_map *src)
 void sm_clear(srt_map *m)
 {
 	int t;
+	if (st_is_snapshot(m)) {
+		st_snapshot_release(m);
+		return;
+	}
+	if (m && m->cow) /* snapshot nodes are moved to their undo log */
+		st_snapshot_detach(m);
 	if (!m || !m->d.size)
 		return;
 	t = m->d.sub_type;
@@ -472,26 +541,34 @@ void sm_clear(srt_map *m)
 	st_set_size((srt_tree *)m, 0);
 }
 
+srt_map *sm_snapshot(srt_map *m)
+{
+	int t;
+	RETURN_IF(!m, NULL); /* BEHAVIOR */
+	t = m->d.sub_type;
+	return st_snapshot(m, sm_dup_callback(t),
+			   t < SM0_NumTypes ? sm_ctx[t].delete_callback : NULL);
+}
+
 /*
  * Copy
  */
 
-srt_map *sm_cpy(srt_map **m, const srt_map *src)
+/*
+ * Prepare target map for a copy of ss elements from a map of the same type
+ * as src (reusing its allocated memory if possible)
+ */
+static srt_bool sm_cpy_prepare(srt_map **m, const srt_map *src, size_t ss)
 {
-	srt_tndx i;
-	enum eSM_Type0 t;
-	size_t ss, src_buf_size;
-	RETURN_IF(!m || !src, NULL); /* BEHAVIOR */
-	t = (enum eSM_Type0)src->d.sub_type;
-	ss = sm_size(src);
-	src_buf_size = src->d.elem_size * src->d.size;
-	RETURN_IF(ss > ST_NDX_MAX, NULL); /* BEHAVIOR */
+	enum eSM_Type0 t = (enum eSM_Type0)src->d.sub_type;
 	if (*m) {
 		sm_clear(*m);
-		if (!sm_chk_t(*m, (int)t)) {
+		if (!sm_chk_t(*m, (int)t) || st_is_wide(*m) != st_is_wide(src)
+		    || st_is_multi(*m) != st_is_multi(src)) {
 			/*
-			 * Case of changing map type, reusing allocated memory,
-			 * but changing container configuration.
+			 * Case of changing map type or node mode, reusing
+			 * allocated memory, but changing container
+			 * configuration.
 			 */
 			size_t raw_size = (*m)->d.elem_size * (*m)->d.max_size,
 			       new_max_size = raw_size / src->d.elem_size;
@@ -499,63 +576,53 @@ srt_map *sm_cpy(srt_map **m, const srt_map *src)
 			(*m)->d.max_size = new_max_size;
 			(*m)->cmp_f = src->cmp_f;
 			(*m)->d.sub_type = src->d.sub_type;
+			(*m)->d.f.flag2 = src->d.f.flag2;
+			(*m)->d.f.flag3 = src->d.f.flag3;
 		}
 		sm_reserve(m, ss);
 	} else {
-		*m = sm_alloc0(t, ss);
-		RETURN_IF(!*m, NULL); /* BEHAVIOR: allocation error */
+		if (st_is_wide(src))
+			*m = sm_alloc0_wide(t, ss);
+		else
+			*m = st_is_multi(src) ? sm_alloc0_multi(t, ss)
+					      : sm_alloc0(t, ss);
+		RETURN_IF(!*m, S_FALSE); /* BEHAVIOR: allocation error */
 	}
-	RETURN_IF(sm_max_size(*m) < ss, *m); /* BEHAVIOR: not enough space */
+	return sm_max_size(*m) >= ss ? S_TRUE : S_FALSE;
+}
+
+srt_map *sm_cpy(srt_map **m, const srt_map *src)
+{
+	srt_tndx i;
+	srt_tree_dup dup_f;
+	size_t ss, src_buf_size;
+	RETURN_IF(!m || !src || st_is_snapshot(*m), NULL); /* BEHAVIOR */
+	ss = sm_size(src);
+	src_buf_size = src->d.elem_size * src->d.size;
+	RETURN_IF(ss > st_ndx_max(src), NULL); /* BEHAVIOR */
+	/* BEHAVIOR: not enough space (NULL if allocation error) */
+	RETURN_IF(!sm_cpy_prepare(m, src, ss), *m);
 	/*
 	 * Bulk tree copy: tree structure can be copied as is, because of
-	 * of using indexes instead of pointers.
+	 * of using indexes instead of pointers. Snapshots have no node
+	 * buffer, so their nodes are copied one by one.
 	 */
-	memcpy(sm_get_buffer(*m), sm_get_buffer_r(src), src_buf_size);
+	if (st_is_snapshot(src)) {
+		for (i = 0; i < ss; i++)
+			memcpy(st_enum(*m, i), st_enum_r(src, i),
+			       src->d.elem_size);
+	} else {
+		memcpy(sm_get_buffer(*m), sm_get_buffer_r(src), src_buf_size);
+	}
 	sm_set_size(*m, ss);
 	(*m)->root = src->root;
 	/*
 	 * Copy elements using external dynamic memory (string data)
 	 */
-	switch (t) {
-	case SM0_IS:
-		for (i = 0; i < ss; i++) {
-			const struct SMapIS *ms =
-				(const struct SMapIS *)st_enum_r(src, i);
-			struct SMapIS *mt = (struct SMapIS *)st_enum(*m, i);
-			sso1_set(&mt->v, sso1_get(&ms->v));
-		}
-		break;
-	case SM0_DS:
-		for (i = 0; i < ss; i++) {
-			const struct SMapDS *ms =
-				(const struct SMapDS *)st_enum_r(src, i);
-			struct SMapDS *mt = (struct SMapDS *)st_enum(*m, i);
-			sso1_set(&mt->v, sso1_get(&ms->v));
-		}
-		break;
-	case SM0_S:
-	case SM0_SI:
-	case SM0_SD:
-	case SM0_SP:
-		for (i = 0; i < ss; i++) {
-			const struct SMapS *ms =
-				(const struct SMapS *)st_enum_r(src, i);
-			struct SMapS *mt = (struct SMapS *)st_enum(*m, i);
-			sso1_set(&mt->k, sso1_get(&ms->k));
-		}
-		break;
-	case SM0_SS:
-		for (i = 0; i < ss; i++) {
-			const struct SMapSS *ms =
-				(const struct SMapSS *)st_enum_r(src, i);
-			struct SMapSS *mt = (struct SMapSS *)st_enum(*m, i);
-			sso_set(&mt->s, sso_get(&ms->s), sso_get_s2(&ms->s));
-		}
-		break;
-	default:
-		/* no additional action required */
-		break;
-	}
+	dup_f = sm_dup_callback(src->d.sub_type);
+	if (dup_f)
+		for (i = 0; i < ss; i++)
+			dup_f(st_enum(*m, i), st_enum_r(src, i));
 	return *m;
 }
 
@@ -625,13 +692,20 @@ const srt_string *sm_at_ss(const srt_map *m, const srt_string *k)
 	 * Existence check
 	 */
 
+static size_t sm_count_aux(const srt_map *m, const srt_tnode *n)
+{
+	if (st_is_multi(m))
+		return st_count_range(m, n, n, S_SIZET_MAX);
+	return st_locate(m, n) ? 1 : 0;
+}
+
 #define BUILD_SM_COUNT(FN, CHK, TS, TK)                                        \
 	size_t FN(const srt_map *m, TK k)                                      \
 	{                                                                      \
 		TS n;                                                          \
 		RETURN_IF(!(CHK), S_FALSE);                                    \
 		n.k = k;                                                       \
-		return st_locate(m, (const srt_tnode *)&n) ? 1 : 0;            \
+		return sm_count_aux(m, (const srt_tnode *)&n);                 \
 	}
 
 BUILD_SM_COUNT(sm_count_i32, sm_chk_i32x(m), struct SMapi, int32_t)
@@ -645,9 +719,52 @@ size_t sm_count_s(const srt_map *m, const srt_string *k)
 	struct SMapS n;
 	RETURN_IF(!sm_chk_sx(m), S_FALSE);
 	sso1_setref(&n.k, k);
-	return st_locate(m, (const srt_tnode *)&n) ? 1 : 0;
+	return sm_count_aux(m, (const srt_tnode *)&n);
 }
 
+/*
+ * Nearest key lookup
+ */
+
+#define BUILD_SM_BOUND(FN, CHK, TS, TK, B)                                     \
+	srt_tndx FN(const srt_map *m, TK k)                                    \
+	{                                                                      \
+		TS n;                                                          \
+		RETURN_IF(!(CHK), ST_NIL);                                     \
+		n.k = k;                                                       \
+		return st_locate_bound(m, (const srt_tnode *)&n, B);           \
+	}
+
+#define BUILD_SM_BOUND_S(FN, B)                                                \
+	srt_tndx FN(const srt_map *m, const srt_string *k)                     \
+	{                                                                      \
+		struct SMapS n;                                                \
+		RETURN_IF(!sm_chk_sx(m), ST_NIL);                              \
+		sso1_setref(&n.k, k);                                          \
+		return st_locate_bound(m, (const srt_tnode *)&n, B);           \
+	}
+
+#define BUILD_SM_BOUNDS(LB, UB, FL, CE, CHK, TS, TK)                           \
+	BUILD_SM_BOUND(LB, CHK, TS, TK, ST_BoundGE)                            \
+	BUILD_SM_BOUND(UB, CHK, TS, TK, ST_BoundGT)                            \
+	BUILD_SM_BOUND(FL, CHK, TS, TK, ST_BoundLE)                            \
+	BUILD_SM_BOUND(CE, CHK, TS, TK, ST_BoundGE)
+
+BUILD_SM_BOUNDS(sm_lower_bound_i32, sm_upper_bound_i32, sm_floor_i32,
+		sm_ceil_i32, sm_chk_i32x(m), struct SMapi, int32_t)
+BUILD_SM_BOUNDS(sm_lower_bound_u32, sm_upper_bound_u32, sm_floor_u32,
+		sm_ceil_u32, sm_chk_u32x(m), struct SMapu, uint32_t)
+BUILD_SM_BOUNDS(sm_lower_bound_i, sm_upper_bound_i, sm_floor_i, sm_ceil_i,
+		sm_chk_ix(m), struct SMapI, int64_t)
+BUILD_SM_BOUNDS(sm_lower_bound_f, sm_upper_bound_f, sm_floor_f, sm_ceil_f,
+		sm_chk_fx(m), struct SMapF, float)
+BUILD_SM_BOUNDS(sm_lower_bound_d, sm_upper_bound_d, sm_floor_d, sm_ceil_d,
+		sm_chk_dx(m), struct SMapD, double)
+BUILD_SM_BOUND_S(sm_lower_bound_s, ST_BoundGE)
+BUILD_SM_BOUND_S(sm_upper_bound_s, ST_BoundGT)
+BUILD_SM_BOUND_S(sm_floor_s, ST_BoundLE)
+BUILD_SM_BOUND_S(sm_ceil_s, ST_BoundGE)
+
 /*
  * Insert
  */
@@ -914,6 +1031,210 @@ srt_bool sm_delete_s(srt_map *m, const srt_string *k)
 	return st_delete(m, (const srt_tnode *)&sx, callback);
 }
 
+/*
+ * Range delete, split and join
+ */
+
+#define BUILD_SM_DELETE_RANGE(FN, CHK, TS, TK)                                 \
+	size_t FN(srt_map *m, TK kmin, TK kmax)                                \
+	{                                                                      \
+		TS n_min, n_max;                                               \
+		RETURN_IF(!(CHK), 0);                                          \
+		n_min.k = kmin;                                                \
+		n_max.k = kmax;                                                \
+		return st_delete_range(m, (const srt_tnode *)&n_min,           \
+				       (const srt_tnode *)&n_max,              \
+				       sm_ctx[m->d.sub_type].delete_callback); \
+	}
+
+#define BUILD_SM_SPLIT(FN, CHK, TS, TK)                                        \
+	srt_map *FN(srt_map *m, TK k)                                          \
+	{                                                                      \
+		TS n;                                                          \
+		RETURN_IF(!(CHK), NULL);                                       \
+		n.k = k;                                                       \
+		return st_split(m, (const srt_tnode *)&n);                     \
+	}
+
+BUILD_SM_DELETE_RANGE(sm_delete_range_i32, sm_chk_i32x(m), struct SMapi,
+		      int32_t)
+BUILD_SM_DELETE_RANGE(sm_delete_range_u32, sm_chk_u32x(m), struct SMapu,
+		      uint32_t)
+BUILD_SM_DELETE_RANGE(sm_delete_range_i, sm_chk_ix(m), struct SMapI, int64_t)
+BUILD_SM_DELETE_RANGE(sm_delete_range_f, sm_chk_fx(m), struct SMapF, float)
+BUILD_SM_DELETE_RANGE(sm_delete_range_d, sm_chk_dx(m), struct SMapD, double)
+BUILD_SM_SPLIT(sm_split_i32, sm_chk_i32x(m), struct SMapi, int32_t)
+BUILD_SM_SPLIT(sm_split_u32, sm_chk_u32x(m), struct SMapu, uint32_t)
+BUILD_SM_SPLIT(sm_split_i, sm_chk_ix(m), struct SMapI, int64_t)
+BUILD_SM_SPLIT(sm_split_f, sm_chk_fx(m), struct SMapF, float)
+BUILD_SM_SPLIT(sm_split_d, sm_chk_dx(m), struct SMapD, double)
+
+size_t sm_delete_range_s(srt_map *m, const srt_string *kmin,
+			 const srt_string *kmax)
+{
+	struct SMapS n_min, n_max;
+	RETURN_IF(!sm_chk_sx(m), 0);
+	sso1_setref(&n_min.k, kmin);
+	sso1_setref(&n_max.k, kmax);
+	return st_delete_range(m, (const srt_tnode *)&n_min,
+			       (const srt_tnode *)&n_max,
+			       sm_ctx[m->d.sub_type].delete_callback);
+}
+
+srt_map *sm_split_s(srt_map *m, const srt_string *k)
+{
+	struct SMapS n;
+	RETURN_IF(!sm_chk_sx(m), NULL);
+	sso1_setref(&n.k, k);
+	return st_split(m, (const srt_tnode *)&n);
+}
+
+srt_bool sm_join(srt_map **m, srt_map *m2)
+{
+	RETURN_IF(!m || !*m || !m2 || (*m)->d.sub_type != m2->d.sub_type,
+		  S_FALSE);
+	return st_join((srt_tree **)m, m2);
+}
+
+srt_bool sm_optimize(srt_map *m)
+{
+	return st_optimize(m);
+}
+
+/*
+ * Merge-style operations (in-order walk of both maps at once)
+ */
+
+static srt_map *sm_merge(srt_map **m, const srt_map *m1, const srt_map *m2,
+			 enum eSTMerge op)
+{
+	size_t ss;
+	RETURN_IF(!m || !m1 || !m2 || *m == m1 || *m == m2
+			  || st_is_snapshot(*m)
+			  || m1->d.sub_type != m2->d.sub_type
+			  || st_is_wide(m1) != st_is_wide(m2)
+			  || st_is_multi(m1) != st_is_multi(m2),
+		  NULL); /* BEHAVIOR */
+	ss = op == ST_MergeDiff
+		     ? sm_size(m1)
+		     : op == ST_MergeIntersect ? S_MIN(sm_size(m1), sm_size(m2))
+					       : sm_size(m1) + sm_size(m2);
+	RETURN_IF(ss > st_ndx_max(m1), NULL); /* BEHAVIOR */
+	/* BEHAVIOR: not enough space (NULL if allocation error) */
+	RETURN_IF(!sm_cpy_prepare(m, m1, ss), *m);
+	st_merge(*m, m1, m2, op, sm_dup_callback(m1->d.sub_type));
+	return *m;
+}
+
+srt_map *sm_diff(srt_map **m, const srt_map *m1, const srt_map *m2)
+{
+	return sm_merge(m, m1, m2, ST_MergeDiff);
+}
+
+srt_map *sm_intersect(srt_map **m, const srt_map *m1, const srt_map *m2)
+{
+	return sm_merge(m, m1, m2, ST_MergeIntersect);
+}
+
+srt_map *sm_union(srt_map **m, const srt_map *m1, const srt_map *m2)
+{
+	return sm_merge(m, m1, m2, ST_MergeUnion);
+}
+
+#define SM_V_EQ(T) (((const T *)a)->v == ((const T *)b)->v)
+/* Floating point: bit pattern, so unchanged NaN values compare equal */
+#define SM_V_EQ_FP(T)                                                          \
+	(!memcmp(&((const T *)a)->v, &((const T *)b)->v,                       \
+		 sizeof(((const T *)a)->v)))
+
+static srt_bool sm_node_v_eq(int t, const srt_tnode *a, const srt_tnode *b)
+{
+	switch (t) {
+	case SM0_II32:
+		return SM_V_EQ(struct SMapii);
+	case SM0_UU32:
+		return SM_V_EQ(struct SMapuu);
+	case SM0_II:
+		return SM_V_EQ(struct SMapII);
+	case SM0_FF:
+		return SM_V_EQ_FP(struct SMapFF);
+	case SM0_DD:
+		return SM_V_EQ_FP(struct SMapDD);
+	case SM0_IP:
+		return SM_V_EQ(struct SMapIP);
+	case SM0_DP:
+		return SM_V_EQ(struct SMapDP);
+	case SM0_SI:
+		return SM_V_EQ(struct SMapSI);
+	case SM0_SD:
+		return SM_V_EQ_FP(struct SMapSD);
+	case SM0_SP:
+		return SM_V_EQ(struct SMapSP);
+	case SM0_IS:
+		return !ss_cmp(sso1_get(&((const struct SMapIS *)a)->v),
+			       sso1_get(&((const struct SMapIS *)b)->v));
+	case SM0_DS:
+		return !ss_cmp(sso1_get(&((const struct SMapDS *)a)->v),
+			       sso1_get(&((const struct SMapDS *)b)->v));
+	case SM0_SS:
+		return !ss_cmp(sso_get_s2(&((const struct SMapSS *)a)->s),
+			       sso_get_s2(&((const struct SMapSS *)b)->s));
+	default: /* sets: no value */
+		break;
+	}
+	return S_TRUE;
+}
+
+#undef SM_V_EQ
+#undef SM_V_EQ_FP
+
+struct SMDiffCtx {
+	const srt_map *m_old, *m_new;
+	srt_map_diff f;
+	void *context;
+	size_t cnt;
+};
+
+static srt_bool sm_diff_itr_aux(srt_tndx i_old, srt_tndx i_new, void *context)
+{
+	enum eSM_Diff d;
+	struct SMDiffCtx *c = (struct SMDiffCtx *)context;
+	if (i_old == ST_NIL)
+		d = SM_DiffAdded;
+	else if (i_new == ST_NIL)
+		d = SM_DiffRemoved;
+	else if (!sm_node_v_eq(c->m_old->d.sub_type,
+			       st_enum_r(c->m_old, i_old),
+			       st_enum_r(c->m_new, i_new)))
+		d = SM_DiffChanged;
+	else
+		return S_TRUE; /* same key and value */
+	RETURN_IF(c->f && !c->f(d, i_old, i_new, c->context), S_FALSE);
+	c->cnt++;
+	return S_TRUE;
+}
+
+size_t sm_diff_itr(const srt_map *m_old, const srt_map *m_new, srt_map_diff f,
+		   void *context)
+{
+	struct SMDiffCtx c;
+	/*
+	 * BEHAVIOR: maps of the same type (compact and wide node modes can
+	 * be mixed, as the node payload layout is the same); multimaps are
+	 * not supported (equal keys would be paired arbitrarily)
+	 */
+	RETURN_IF(!m_old || !m_new || m_old->d.sub_type != m_new->d.sub_type
+			  || st_is_multi(m_old) || st_is_multi(m_new),
+		  0);
+	c.m_old = m_old;
+	c.m_new = m_new;
+	c.f = f;
+	c.context = context;
+	c.cnt = 0;
+	st_merge_walk(m_old, m_new, sm_diff_itr_aux, &c);
+	return c.cnt;
+}
+
 /*
  * Enumeration / export data
  */
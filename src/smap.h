@@ -12,6 +12,10 @@ extern "C" {
  * #DOC Map functions handle key-value storage, which is implemented as a
  * #DOC Red-Black tree (O(log n) time complexity for insert/read/delete)
  * #DOC
+ * #DOC Multimaps (sm_alloc_multi()) keep duplicate keys as regular tree
+ * #DOC nodes, without per-key containers, so equal key ranges are
+ * #DOC counted and enumerated in O(log n + k).
+ * #DOC
  * #DOC
  * #DOC Supported key/value modes (enum eSM_Type):
  * #DOC
@@ -71,6 +75,13 @@ extern "C" {
  * #DOC	typedef srt_bool (*srt_map_it_ss)(const srt_string *, const srt_string *, void *context);
  * #DOC
  * #DOC	typedef srt_bool (*srt_map_it_sp)(const srt_string *, const void *, void *context);
+ * #DOC
+ * #DOC
+ * #DOC Callback type for sm_diff_itr() (element indexes for the sm_it_*()
+ * #DOC functions, ST_NIL for elements not present in one of the maps):
+ * #DOC
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_diff)(enum eSM_Diff d, srt_tndx i_old, srt_tndx i_new, void *context);
  *
  * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
@@ -236,6 +247,11 @@ typedef srt_bool (*srt_map_it_ds)(double k, const srt_string *, void *context);
 typedef srt_bool (*srt_map_it_dp)(double k, const void *, void *context);
 typedef srt_bool (*srt_map_it_sd)(const srt_string *, double v, void *context);
 
+enum eSM_Diff { SM_DiffAdded, SM_DiffRemoved, SM_DiffChanged };
+
+typedef srt_bool (*srt_map_diff)(enum eSM_Diff d, srt_tndx i_old,
+				 srt_tndx i_new, void *context);
+
 /*
  * Allocation
  */
@@ -271,6 +287,24 @@ S_INLINE srt_map *sm_alloc(enum eSM_Type t, size_t initial_num_elems_reserve)
 	return sm_alloc0((enum eSM_Type0)t, initial_num_elems_reserve);
 }
 
+srt_map *sm_alloc0_wide(enum eSM_Type0 t, size_t initial_num_elems_reserve);
+
+/* #API: |Allocate map with 63-bit node indexes (heap), for more than 2^31 - 1 elements (8 extra bytes per element)|map type; initial reserve|map|O(1)|1;2| */
+S_INLINE srt_map *sm_alloc_wide(enum eSM_Type t,
+				size_t initial_num_elems_reserve)
+{
+	return sm_alloc0_wide((enum eSM_Type0)t, initial_num_elems_reserve);
+}
+
+srt_map *sm_alloc0_multi(enum eSM_Type0 t, size_t initial_num_elems_reserve);
+
+/* #API: |Allocate multimap (heap): map allowing duplicate keys (insert functions always add a new element; sm_at_*() returns the first inserted element with the given key; sm_delete_*() removes one element with the given key, and sm_delete_range_*(m, k, k) all of them; sm_count_*() returns the number of elements with the given key; sm_itr_*(m, k, k, ...) enumerates the equal key range)|map type; initial reserve|map|O(1)|1;2| */
+S_INLINE srt_map *sm_alloc_multi(enum eSM_Type t,
+				 size_t initial_num_elems_reserve)
+{
+	return sm_alloc0_multi((enum eSM_Type0)t, initial_num_elems_reserve);
+}
+
 /* #NOTAPI: |Get map node size from map type|map type|bytes required for storing a single node|O(1)|1;2| */
 S_INLINE uint8_t sm_elem_size(int t)
 {
@@ -325,6 +359,9 @@ srt_map *sm_dup(const srt_map *src);
 /* #API: |Reset/clean map (keeping map type)|map|-|O(1) for simple maps, O(n) for maps having nodes with strings|1;2| */
 void sm_clear(srt_map *m);
 
+/* #API: |Take map snapshot (read-only map sharing the nodes with the source map, using copy-on-write when the source map is modified). The snapshot can be read from other thread while the map is written, without locking (one writer thread, also taking and releasing the snapshots, and one reader thread per snapshot). References returned by snapshot reads (e.g. strings) are valid until the next snapshot access. Map shrink is ignored while snapshots are alive|map|snapshot (release it with sm_free()); NULL if not enough memory|O(1); first write on a shared node: O(1) extra|1;2| */
+srt_map *sm_snapshot(srt_map *m);
+
 /*
 #API: |Free one or more maps (heap)|map; more maps (optional)|-|O(1) for simple maps, O(n) for maps having nodes with strings|1;2|
 void sm_free(srt_map **m, ...)
@@ -336,7 +373,7 @@ void sm_free(srt_map **m, ...)
 #endif
 void sm_free_aux(srt_map **m, ...);
 
-SD_BUILDFUNCS_FULL_ST(sm, srt_map, 0)
+SD_BUILDFUNCS_FULL_ST_RF(sm, srt_map, 0, st_pf, st_rf)
 
 /*
 #API: |Ensure space for extra elements|map;number of extra elements|extra size allocated|O(1)|1;2|
@@ -415,24 +452,103 @@ double sm_at_sd(const srt_map *m, const srt_string *k);
  * Existence check
  */
 
-/* #API: |Map element count/check (SM_II32)|map; key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check (SM_II32)|map; key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_i32(const srt_map *m, int32_t k);
 
-/* #API: |Map element count/check|map (SM_UU32); key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check|map (SM_UU32); key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_u32(const srt_map *m, uint32_t k);
 
-/* #API: |Map element count/check|map (SM_II); key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check|map (SM_II); key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_i(const srt_map *m, int64_t k);
 
-/* #API: |Map element count/check|map (SM_FF); key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check|map (SM_FF); key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_f(const srt_map *m, float k);
 
-/* #API: |Map element count/check|map (SM_D*); key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check|map (SM_D*); key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_d(const srt_map *m, double k);
 
-/* #API: |Map element count/check|map (SM_S*); key|S_TRUE: element found; S_FALSE: not in the map|O(log n)|1;2| */
+/* #API: |Map element count/check|map (SM_S*); key|S_TRUE: element found; S_FALSE: not in the map (multimap: number of elements with that key)|O(log n); multimap: O(log n + k)|1;2| */
 size_t sm_count_s(const srt_map *m, const srt_string *k);
 
+/*
+ * Nearest key lookup
+ *
+ * Returned node index can be used with the sm_it_*_k() and sm_it_*_v()
+ * accessors, being valid until the map is modified.
+ */
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_II32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_i32(const srt_map *m, int32_t k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_UU32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_u32(const srt_map *m, uint32_t k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_I*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_i(const srt_map *m, int64_t k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_FF)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_f(const srt_map *m, float k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_D*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_d(const srt_map *m, double k);
+
+/* #API: |Locate first element with key >= k (lower bound) (SM_S*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_lower_bound_s(const srt_map *m, const srt_string *k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_II32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_i32(const srt_map *m, int32_t k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_UU32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_u32(const srt_map *m, uint32_t k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_I*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_i(const srt_map *m, int64_t k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_FF)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_f(const srt_map *m, float k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_D*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_d(const srt_map *m, double k);
+
+/* #API: |Locate first element with key > k (upper bound) (SM_S*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_upper_bound_s(const srt_map *m, const srt_string *k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_II32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_i32(const srt_map *m, int32_t k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_UU32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_u32(const srt_map *m, uint32_t k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_I*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_i(const srt_map *m, int64_t k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_FF)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_f(const srt_map *m, float k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_D*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_d(const srt_map *m, double k);
+
+/* #API: |Locate last element with key <= k (floor) (SM_S*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_floor_s(const srt_map *m, const srt_string *k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_II32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_i32(const srt_map *m, int32_t k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_UU32)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_u32(const srt_map *m, uint32_t k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_I*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_i(const srt_map *m, int64_t k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_FF)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_f(const srt_map *m, float k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_D*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_d(const srt_map *m, double k);
+
+/* #API: |Locate first element with key >= k (ceiling, same as lower bound) (SM_S*)|map; key|Element index (for sm_it_*); ST_NIL if not found|O(log n)|1;2| */
+srt_tndx sm_ceil_s(const srt_map *m, const srt_string *k);
+
 /*
  * Insert
  */
@@ -519,6 +635,73 @@ srt_bool sm_delete_d(srt_map *m, double k);
 /* #API: |Delete map element (SM_S*)|map; key|S_TRUE: found and deleted; S_FALSE: not found|O(log n)|1;2| */
 srt_bool sm_delete_s(srt_map *m, const srt_string *k);
 
+/*
+ * Range delete, split and join
+ */
+
+/* #API: |Delete map elements in a given key range (SM_II32)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_i32(srt_map *m, int32_t kmin, int32_t kmax);
+
+/* #API: |Delete map elements in a given key range (SM_UU32)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_u32(srt_map *m, uint32_t kmin, uint32_t kmax);
+
+/* #API: |Delete map elements in a given key range (SM_I*)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_i(srt_map *m, int64_t kmin, int64_t kmax);
+
+/* #API: |Delete map elements in a given key range (SM_FF)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_f(srt_map *m, float kmin, float kmax);
+
+/* #API: |Delete map elements in a given key range (SM_D*)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_d(srt_map *m, double kmin, double kmax);
+
+/* #API: |Delete map elements in a given key range (SM_S*)|map; key lower bound; key upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion (tree rebuild, without per-element rebalancing)|1;2| */
+size_t sm_delete_range_s(srt_map *m, const srt_string *kmin, const srt_string *kmax);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_II32)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_i32(srt_map *m, int32_t k);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_UU32)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_u32(srt_map *m, uint32_t k);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_I*)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_i(srt_map *m, int64_t k);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_FF)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_f(srt_map *m, float k);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_D*)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_d(srt_map *m, double k);
+
+/* #API: |Split map: move elements with key >= k into a new map (SM_S*)|map; key|New map with the moved elements; NULL if not enough memory|O(n)|1;2| */
+srt_map *sm_split_s(srt_map *m, const srt_string *k);
+
+/* #API: |Join maps: move all elements from m2 into m (all m2 keys must be greater than m keys)|map; map of the same type (emptied on success)|S_TRUE: OK; S_FALSE: type or key order mismatch, or not enough memory|O(n)|1;2| */
+srt_bool sm_join(srt_map **m, srt_map *m2);
+
+/*
+ * Memory layout
+ */
+
+/* #API: |Optimize map memory layout for lookups: nodes are rewritten in breadth-first order of a balanced tree, so the top tree levels share cache lines (e.g. after a bulk build of read-mostly maps). Element indexes (srt_tndx) are remapped, so previously obtained ones are invalidated|map|S_TRUE: OK; S_FALSE: not enough memory, or snapshot|O(n); Aux space: n * node size|1;2| */
+srt_bool sm_optimize(srt_map *m);
+
+/*
+ * Merge-style operations (both maps are walked in order at the same time)
+ */
+
+/* #API: |Map difference: elements from m1 with keys not in m2|output map; map; map of the same type|output map (NULL if invalid parameters or not enough memory)|O(n + m)|1;2| */
+srt_map *sm_diff(srt_map **m, const srt_map *m1, const srt_map *m2);
+
+/* #API: |Map intersection: elements from m1 with keys also in m2|output map; map; map of the same type|output map (NULL if invalid parameters or not enough memory)|O(n + m)|1;2| */
+srt_map *sm_intersect(srt_map **m, const srt_map *m1, const srt_map *m2);
+
+/* #API: |Map union: elements from m1 and m2 (m2 values have precedence for keys in both maps)|output map; map; map of the same type|output map (NULL if invalid parameters or not enough memory)|O(n + m)|1;2| */
+srt_map *sm_union(srt_map **m, const srt_map *m1, const srt_map *m2);
+
+/* #API: |Enumerate changes between two maps in key order: added (key only in m_new), removed (key only in m_old), and changed (same key, different value) elements. Floating point values are compared by bit pattern (e.g. an unchanged NaN is not a change). Compact and wide maps can be compared; multimaps are not supported|old map; new map of the same type; callback function (optional, return S_FALSE for stopping); callback function context|Changes processed (0 for multimaps)|O(n + m)|1;2| */
+size_t sm_diff_itr(const srt_map *m_old, const srt_map *m_new, srt_map_diff f,
+		   void *context);
+
 /*
  * Enumeration / export data
  */
@@ -716,9 +899,10 @@ S_INLINE const void *sm_it_sp_v(const srt_map *m, srt_tndx i)
 		size_t ts, nelems, rbt_max_depth;                              \
 		struct STreeScan *p;                                           \
 		const srt_tnode *cn;                                           \
-		int cmpmin, cmpmax;                                            \
+		int cmpmin, cmpmax, eqd;                                       \
 		RETURN_IF(!m, 0);			 /* null tree */       \
 		RETURN_IF(m->d.sub_type != MAP_TYPE, 0); /* wrong type */      \
+		eqd = st_is_multi(m) ? 0 : 1; /* multi: step down if equal */ \
 		ts = sm_size(m);                                               \
 		RETURN_IF(!ts, S_FALSE); /* empty tree */                      \
 		level = 0;                                                     \
@@ -737,11 +921,12 @@ S_INLINE const void *sm_it_sp_v(const srt_map *m, srt_tndx i)
 				cn = get_node_r(m, p[level].c);                \
 				cmpmin = TR_CMP_MIN;                           \
 				cmpmax = TR_CMP_MAX;                           \
-				if (cn->x.l != ST_NIL && cmpmin > 0) {         \
+				if (st_node_l(m, cn) != ST_NIL                 \
+				    && cmpmin >= eqd) {                        \
 					p[level].s = STS_ScanLeft;             \
 					level++;                               \
 					cn = get_node_r(m, p[level - 1].c);    \
-					p[level].c = cn->x.l;                  \
+					p[level].c = st_node_l(m, cn);         \
 				} else {                                       \
 					/* node with null left children */     \
 					if (cmpmin >= 0 && cmpmax <= 0) {      \
@@ -749,12 +934,13 @@ S_INLINE const void *sm_it_sp_v(const srt_map *m, srt_tndx i)
 							return nelems;         \
 						nelems++;                      \
 					}                                      \
-					if (cn->r != ST_NIL && cmpmax < 0) {   \
+					if (st_node_r(m, cn) != ST_NIL         \
+					    && cmpmax <= -eqd) {               \
 						p[level].s = STS_ScanRight;    \
 						level++;                       \
 						cn = get_node_r(               \
 							m, p[level - 1].c);    \
-						p[level].c = cn->r;            \
+						p[level].c = st_node_r(m, cn); \
 					} else {                               \
 						p[level].s = STS_ScanDone;     \
 						level--;                       \
@@ -773,12 +959,13 @@ S_INLINE const void *sm_it_sp_v(const srt_map *m, srt_tndx i)
 						return nelems;                 \
 					nelems++;                              \
 				}                                              \
-				if (cn->r != ST_NIL && cmpmax < 0) {           \
+				if (st_node_r(m, cn) != ST_NIL                 \
+				    && cmpmax <= -eqd) {                       \
 					p[level].s = STS_ScanRight;            \
 					level++;                               \
 					p[level].p = p[level - 1].c;           \
 					cn = get_node_r(m, p[level - 1].c);    \
-					p[level].c = cn->r;                    \
+					p[level].c = st_node_r(m, cn);         \
 					p[level].s = STS_ScanStart;            \
 				} else {                                       \
 					p[level].s = STS_ScanDone;             \
@@ -102,6 +102,20 @@ S_INLINE srt_set *sms_alloc(enum eSMS_Type t, size_t initial_num_elems_reserve)
 	return sm_alloc0((enum eSM_Type0)t, initial_num_elems_reserve);
 }
 
+/* #API: |Allocate set with 63-bit node indexes (heap), for more than 2^31 - 1 elements (8 extra bytes per element)|set type; initial reserve|set|O(1)|1;2| */
+S_INLINE srt_set *sms_alloc_wide(enum eSMS_Type t,
+				 size_t initial_num_elems_reserve)
+{
+	return sm_alloc0_wide((enum eSM_Type0)t, initial_num_elems_reserve);
+}
+
+/* #API: |Allocate multiset (heap): set allowing duplicate elements (sms_count_*() returns the number of equal elements)|set type; initial reserve|set|O(1)|1;2| */
+S_INLINE srt_set *sms_alloc_multi(enum eSMS_Type t,
+				  size_t initial_num_elems_reserve)
+{
+	return sm_alloc0_multi((enum eSM_Type0)t, initial_num_elems_reserve);
+}
+
 /* #API: |Duplicate set|input set|output set|O(n)|1;2| */
 S_INLINE srt_set *sms_dup(const srt_set *src)
 {
@@ -114,6 +128,12 @@ S_INLINE void sms_clear(srt_set *s)
 	sm_clear(s);
 }
 
+/* #API: |Take set snapshot (read-only set sharing the nodes with the source set, using copy-on-write when the source set is modified). It can be read from other thread while the set is written (see sm_snapshot())|set|snapshot (release it with sms_free()); NULL if not enough memory|O(1); first write on a shared node: O(1) extra|1;2| */
+S_INLINE srt_set *sms_snapshot(srt_set *s)
+{
+	return sm_snapshot(s);
+}
+
 /*
 #API: |Free one or more sets (heap)|set; more sets (optional)|-|O(1) for simple sets, O(n) for string sets|1;2|
 void sms_free(srt_map **s, ...)
@@ -124,7 +144,7 @@ void sms_free(srt_map **s, ...)
 #define sms_free(m) sm_free_aux(m, S_INVALID_PTR_VARG_TAIL)
 #endif
 
-SD_BUILDFUNCS_FULL_ST(sms, srt_set, 0)
+SD_BUILDFUNCS_FULL_ST_RF(sms, srt_set, 0, st_pf, st_rf)
 
 /*
 #API: |Ensure space for extra elements|set;number of extra elements|extra size allocated|O(1)|1;2|
@@ -167,42 +187,166 @@ S_INLINE srt_set *sms_cpy(srt_set **s, const srt_set *src)
  * Existence check
  */
 
-/* #API: |Set element count/check (SMS_U32)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_U32)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_u32(const srt_set *s, uint32_t k)
 {
 	return sm_count_u32(s, k);
 }
 
-/* #API: |Set element count/check (SMS_I32)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_I32)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_i32(const srt_set *s, int32_t k)
 {
 	return sm_count_i32(s, k);
 }
 
-/* #API: |Set element count/check (SMS_I)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_I)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_i(const srt_set *s, int64_t k)
 {
 	return sm_count_i(s, k);
 }
 
-/* #API: |Set element count/check (SMS_F)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_F)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_f(const srt_set *s, float k)
 {
 	return sm_count_f(s, k);
 }
 
-/* #API: |Set element count/check (SMS_D)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_D)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_d(const srt_set *s, double k)
 {
 	return sm_count_d(s, k);
 }
 
-/* #API: |Set element count/check (SMS_S)|set; key|S_TRUE: element found; S_FALSE: not in the set|O(log n)|1;2| */
+/* #API: |Set element count/check (SMS_S)|set; key|S_TRUE: element found; S_FALSE: not in the set (multiset: number of equal elements)|O(log n); multiset: O(log n + k)|1;2| */
 S_INLINE size_t sms_count_s(const srt_set *s, const srt_string *k)
 {
 	return sm_count_s(s, k);
 }
 
+/*
+ * Nearest key lookup
+ */
+
+/* #API: |Locate first element >= k (lower bound) (SMS_I32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_i32(const srt_set *s, int32_t k);
+*/
+#define sms_lower_bound_i32(s, k) sm_lower_bound_i32(s, k)
+
+/* #API: |Locate first element >= k (lower bound) (SMS_U32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_u32(const srt_set *s, uint32_t k);
+*/
+#define sms_lower_bound_u32(s, k) sm_lower_bound_u32(s, k)
+
+/* #API: |Locate first element >= k (lower bound) (SMS_I)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_i(const srt_set *s, int64_t k);
+*/
+#define sms_lower_bound_i(s, k) sm_lower_bound_i(s, k)
+
+/* #API: |Locate first element >= k (lower bound) (SMS_F)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_f(const srt_set *s, float k);
+*/
+#define sms_lower_bound_f(s, k) sm_lower_bound_f(s, k)
+
+/* #API: |Locate first element >= k (lower bound) (SMS_D)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_d(const srt_set *s, double k);
+*/
+#define sms_lower_bound_d(s, k) sm_lower_bound_d(s, k)
+
+/* #API: |Locate first element >= k (lower bound) (SMS_S)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_lower_bound_s(const srt_set *s, const srt_string *k);
+*/
+#define sms_lower_bound_s(s, k) sm_lower_bound_s(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_I32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_i32(const srt_set *s, int32_t k);
+*/
+#define sms_upper_bound_i32(s, k) sm_upper_bound_i32(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_U32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_u32(const srt_set *s, uint32_t k);
+*/
+#define sms_upper_bound_u32(s, k) sm_upper_bound_u32(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_I)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_i(const srt_set *s, int64_t k);
+*/
+#define sms_upper_bound_i(s, k) sm_upper_bound_i(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_F)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_f(const srt_set *s, float k);
+*/
+#define sms_upper_bound_f(s, k) sm_upper_bound_f(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_D)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_d(const srt_set *s, double k);
+*/
+#define sms_upper_bound_d(s, k) sm_upper_bound_d(s, k)
+
+/* #API: |Locate first element > k (upper bound) (SMS_S)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_upper_bound_s(const srt_set *s, const srt_string *k);
+*/
+#define sms_upper_bound_s(s, k) sm_upper_bound_s(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_I32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_i32(const srt_set *s, int32_t k);
+*/
+#define sms_floor_i32(s, k) sm_floor_i32(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_U32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_u32(const srt_set *s, uint32_t k);
+*/
+#define sms_floor_u32(s, k) sm_floor_u32(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_I)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_i(const srt_set *s, int64_t k);
+*/
+#define sms_floor_i(s, k) sm_floor_i(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_F)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_f(const srt_set *s, float k);
+*/
+#define sms_floor_f(s, k) sm_floor_f(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_D)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_d(const srt_set *s, double k);
+*/
+#define sms_floor_d(s, k) sm_floor_d(s, k)
+
+/* #API: |Locate last element <= k (floor) (SMS_S)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_floor_s(const srt_set *s, const srt_string *k);
+*/
+#define sms_floor_s(s, k) sm_floor_s(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_I32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_i32(const srt_set *s, int32_t k);
+*/
+#define sms_ceil_i32(s, k) sm_ceil_i32(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_U32)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_u32(const srt_set *s, uint32_t k);
+*/
+#define sms_ceil_u32(s, k) sm_ceil_u32(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_I)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_i(const srt_set *s, int64_t k);
+*/
+#define sms_ceil_i(s, k) sm_ceil_i(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_F)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_f(const srt_set *s, float k);
+*/
+#define sms_ceil_f(s, k) sm_ceil_f(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_D)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_d(const srt_set *s, double k);
+*/
+#define sms_ceil_d(s, k) sm_ceil_d(s, k)
+
+/* #API: |Locate first element >= k (ceiling, same as lower bound) (SMS_S)|set; key|Element index (for sms_it_*); ST_NIL if not found|O(log n)|1;2|
+srt_tndx sms_ceil_s(const srt_set *s, const srt_string *k);
+*/
+#define sms_ceil_s(s, k) sm_ceil_s(s, k)
+
 /*
  * Insert
  */
@@ -312,6 +456,107 @@ S_INLINE srt_bool sms_delete_s(srt_set *s, const srt_string *k)
 	return sm_delete_s(s, k);
 }
 
+/*
+ * Range delete, split and join
+ */
+
+/* #API: |Delete set elements in a given range (SMS_I32)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_i32(srt_set *s, int32_t kmin, int32_t kmax);
+*/
+#define sms_delete_range_i32(s, kmin, kmax) sm_delete_range_i32(s, kmin, kmax)
+
+/* #API: |Delete set elements in a given range (SMS_U32)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_u32(srt_set *s, uint32_t kmin, uint32_t kmax);
+*/
+#define sms_delete_range_u32(s, kmin, kmax) sm_delete_range_u32(s, kmin, kmax)
+
+/* #API: |Delete set elements in a given range (SMS_I)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_i(srt_set *s, int64_t kmin, int64_t kmax);
+*/
+#define sms_delete_range_i(s, kmin, kmax) sm_delete_range_i(s, kmin, kmax)
+
+/* #API: |Delete set elements in a given range (SMS_F)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_f(srt_set *s, float kmin, float kmax);
+*/
+#define sms_delete_range_f(s, kmin, kmax) sm_delete_range_f(s, kmin, kmax)
+
+/* #API: |Delete set elements in a given range (SMS_D)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_d(srt_set *s, double kmin, double kmax);
+*/
+#define sms_delete_range_d(s, kmin, kmax) sm_delete_range_d(s, kmin, kmax)
+
+/* #API: |Delete set elements in a given range (SMS_S)|set; lower bound; upper bound|Number of deleted elements|O(k log n) for few elements; O(n) for bulk deletion|1;2|
+size_t sms_delete_range_s(srt_set *s, const srt_string *kmin, const srt_string *kmax);
+*/
+#define sms_delete_range_s(s, kmin, kmax) sm_delete_range_s(s, kmin, kmax)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_I32)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_i32(srt_set *s, int32_t k);
+*/
+#define sms_split_i32(s, k) sm_split_i32(s, k)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_U32)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_u32(srt_set *s, uint32_t k);
+*/
+#define sms_split_u32(s, k) sm_split_u32(s, k)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_I)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_i(srt_set *s, int64_t k);
+*/
+#define sms_split_i(s, k) sm_split_i(s, k)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_F)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_f(srt_set *s, float k);
+*/
+#define sms_split_f(s, k) sm_split_f(s, k)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_D)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_d(srt_set *s, double k);
+*/
+#define sms_split_d(s, k) sm_split_d(s, k)
+
+/* #API: |Split set: move elements >= k into a new set (SMS_S)|set; key|New set with the moved elements; NULL if not enough memory|O(n)|1;2|
+srt_set *sms_split_s(srt_set *s, const srt_string *k);
+*/
+#define sms_split_s(s, k) sm_split_s(s, k)
+
+/* #API: |Join sets: move all elements from s2 into s (all s2 elements must be greater than s elements)|set; set of the same type (emptied on success)|S_TRUE: OK; S_FALSE: type or order mismatch, or not enough memory|O(n)|1;2|
+srt_bool sms_join(srt_set **s, srt_set *s2);
+*/
+#define sms_join(s, s2) sm_join(s, s2)
+
+/*
+ * Memory layout
+ */
+
+/* #API: |Optimize set memory layout for lookups (see sm_optimize())|set|S_TRUE: OK; S_FALSE: not enough memory, or snapshot|O(n); Aux space: n * node size|1;2|
+srt_bool sms_optimize(srt_set *s);
+*/
+#define sms_optimize(s) sm_optimize(s)
+
+/*
+ * Merge-style operations (both sets are walked in order at the same time)
+ */
+
+/*
+#API: |Set difference: elements from s1 not in s2|output set; set; set of the same type|output set (NULL if invalid parameters or not enough memory)|O(n + m)|1;2|
+srt_set *sms_diff(srt_set **s, const srt_set *s1, const srt_set *s2);
+
+#API: |Set intersection: elements from s1 also in s2|output set; set; set of the same type|output set (NULL if invalid parameters or not enough memory)|O(n + m)|1;2|
+srt_set *sms_intersect(srt_set **s, const srt_set *s1, const srt_set *s2);
+
+#API: |Set union|output set; set; set of the same type|output set (NULL if invalid parameters or not enough memory)|O(n + m)|1;2|
+srt_set *sms_union(srt_set **s, const srt_set *s1, const srt_set *s2);
+
+#API: |Enumerate changes between two sets in order: added (only in s_new) and removed (only in s_old) elements|old set; new set of the same type; callback function (optional, return S_FALSE for stopping); callback function context|Changes processed|O(n + m)|1;2|
+size_t sms_diff_itr(const srt_set *s_old, const srt_set *s_new, srt_map_diff f, void *context);
+*/
+#define sms_diff(s, s1, s2) sm_diff(s, s1, s2)
+#define sms_intersect(s, s1, s2) sm_intersect(s, s1, s2)
+#define sms_union(s, s1, s2) sm_union(s, s1, s2)
+#define sms_diff_itr(s_old, s_new, f, context)                                 \
+	sm_diff_itr(s_old, s_new, f, context)
+
 /*
  * Enumeration
  */
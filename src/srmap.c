@@ -0,0 +1,1006 @@
+/*
+ * srmap.c
+ *
+ * Radix tree map handling.
+ *
+ * Observations:
+ * - Adaptive radix tree: inner nodes with room for 4, 16, 48 or 256
+ *   children, growing/shrinking as children are added/removed.
+ * - Path compression: inner nodes keep the length of the key segment
+ *   shared by all the keys below, storing just its first SRM_PFX_MAX bytes
+ *   (the rest is checked against the leaf key at the end of the lookup).
+ * - Keys ending at an inner node (prefix of other keys) are referenced from
+ *   the node itself, so no key terminator is required.
+ * - Nodes are stored in vectors (one per node kind), being referenced by
+ *   index plus node kind (no pointers), and keys into a shared key buffer.
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "srmap.h"
+#include "saux/scommon.h"
+
+/*
+ * Internal constants
+ */
+
+#define SRM_PFX_MAX 10
+#define SRM_NIL 0xffffffff
+#define SRM_KIND_BITS 3
+#define SRM_NDX_MAX ((SRM_NIL >> SRM_KIND_BITS) - 1)
+#define SRM_KEY_FREE ((size_t)-1) /* leaf slot not in use */
+
+#define SRM_REF(kind, i) (((uint32_t)(i) << SRM_KIND_BITS) | (uint32_t)(kind))
+#define SRM_KIND(r) ((enum eSRM_Kind)((r) & ((1 << SRM_KIND_BITS) - 1)))
+#define SRM_NDX(r) ((r) >> SRM_KIND_BITS)
+
+enum eSRM_Kind { SRM_Leaf, SRM_N4, SRM_N16, SRM_N48, SRM_N256, SRM_NKinds };
+
+/*
+ * Internal data structures
+ */
+
+struct SRMapLeaf {
+	size_t k_off, k_size; /* key location in the key buffer */
+	union {
+		int64_t i;
+		srt_string *s;
+		const void *p;
+	} v;
+};
+
+struct SRMapInner {
+	uint32_t leaf;		  /* key ending at this node (SRM_NIL: none) */
+	uint32_t plen;		  /* compressed path length */
+	uint16_t nc;		  /* number of children */
+	uint8_t pfx[SRM_PFX_MAX]; /* compressed path (first bytes) */
+};
+
+struct SRMapN4 {
+	struct SRMapInner h;
+	uint8_t k[4];
+	uint32_t c[4];
+};
+
+struct SRMapN16 {
+	struct SRMapInner h;
+	uint8_t k[16];
+	uint32_t c[16];
+};
+
+struct SRMapN48 {
+	struct SRMapInner h;
+	uint8_t ci[256]; /* child index + 1 (0: no child) */
+	uint32_t c[48];
+};
+
+struct SRMapN256 {
+	struct SRMapInner h;
+	uint32_t c[256];
+};
+
+struct SRMap {
+	enum eSRM_Type t;
+	uint32_t root;
+	size_t size;
+	size_t k_garbage;	       /* deleted key bytes in the key buffer */
+	srt_string *keys;	       /* key buffer */
+	srt_vector *pool[SRM_NKinds];  /* nodes, by kind */
+	srt_vector *avail[SRM_NKinds]; /* free node slots, by kind */
+};
+
+struct SRMapWalk {
+	uint32_t r, pos;
+};
+
+union SRMapItrF {
+	srt_map_it_si si;
+	srt_map_it_ss ss;
+	srt_map_it_sp sp;
+};
+
+static const size_t srm_node_size[SRM_NKinds] = {
+	sizeof(struct SRMapLeaf), sizeof(struct SRMapN4),
+	sizeof(struct SRMapN16), sizeof(struct SRMapN48),
+	sizeof(struct SRMapN256)};
+
+static const uint16_t srm_node_cap[SRM_NKinds] = {0, 4, 16, 48, 256};
+
+/* Inner node shrink thresholds */
+static const uint16_t srm_node_min[SRM_NKinds] = {0, 0, 3, 12, 37};
+
+/*
+ * Internal functions
+ */
+
+S_INLINE srt_bool srm_chk_t(const srt_rmap *m, enum eSRM_Type t)
+{
+	return m && m->t == t ? S_TRUE : S_FALSE;
+}
+
+S_INLINE void *srm_node(const srt_rmap *m, uint32_t r)
+{
+	return sv_elem_addr(m->pool[SRM_KIND(r)], SRM_NDX(r));
+}
+
+S_INLINE struct SRMapLeaf *srm_leaf(const srt_rmap *m, uint32_t r)
+{
+	return (struct SRMapLeaf *)srm_node(m, r);
+}
+
+S_INLINE struct SRMapInner *srm_inner(const srt_rmap *m, uint32_t r)
+{
+	return (struct SRMapInner *)srm_node(m, r);
+}
+
+S_INLINE const uint8_t *srm_leaf_key(const srt_rmap *m,
+				     const struct SRMapLeaf *l)
+{
+	return (const uint8_t *)ss_get_buffer_r(m->keys) + l->k_off;
+}
+
+S_INLINE srt_bool srm_leaf_eq(const srt_rmap *m, uint32_t r, const uint8_t *k,
+			      size_t ks)
+{
+	const struct SRMapLeaf *l = srm_leaf(m, r);
+	return l->k_size == ks && !memcmp(srm_leaf_key(m, l), k, ks) ? S_TRUE
+								    : S_FALSE;
+}
+
+/*
+ * Ensure that one node of every kind can be allocated without reallocating
+ * the node vectors, so node references taken before the allocation are
+ * kept valid
+ */
+static srt_bool srm_reserve(srt_rmap *m)
+{
+	size_t i, ps, as;
+	for (i = 0; i < SRM_NKinds; i++) {
+		ps = sv_size(m->pool[i]);
+		as = sv_size(m->avail[i]);
+		RETURN_IF(!as && (ps >= SRM_NDX_MAX
+				  || sv_reserve(&m->pool[i], ps + 1) < ps + 1),
+			  S_FALSE);
+		RETURN_IF(sv_reserve(&m->avail[i], as + 3) < as + 3, S_FALSE);
+	}
+	return S_TRUE;
+}
+
+static uint32_t srm_new(srt_rmap *m, enum eSRM_Kind k)
+{
+	size_t i;
+	void *n;
+	struct SRMapInner *h;
+	if (sv_size(m->avail[k])) {
+		i = sv_pop_u32(m->avail[k]);
+	} else {
+		i = sv_size(m->pool[k]);
+		sv_set_size(m->pool[k], i + 1); /* srm_reserve() */
+	}
+	n = sv_elem_addr(m->pool[k], i);
+	memset(n, 0, m->pool[k]->d.elem_size);
+	if (k == SRM_N48)
+		memset(((struct SRMapN48 *)n)->c, 0xff,
+		       sizeof(((struct SRMapN48 *)n)->c));
+	else if (k == SRM_N256)
+		memset(((struct SRMapN256 *)n)->c, 0xff,
+		       sizeof(((struct SRMapN256 *)n)->c));
+	if (k != SRM_Leaf) {
+		h = (struct SRMapInner *)n;
+		h->leaf = SRM_NIL;
+	}
+	return SRM_REF(k, i);
+}
+
+static void srm_release(srt_rmap *m, uint32_t r)
+{
+	if (SRM_KIND(r) == SRM_Leaf)
+		srm_leaf(m, r)->k_off = SRM_KEY_FREE;
+	sv_push_u32(&m->avail[SRM_KIND(r)], SRM_NDX(r)); /* srm_reserve() */
+}
+
+static uint32_t srm_new_leaf(srt_rmap *m, const uint8_t *k, size_t ks)
+{
+	uint32_t r;
+	struct SRMapLeaf *l;
+	size_t off = ss_size(m->keys);
+	ss_cat_cn(&m->keys, (const char *)k, ks);
+	RETURN_IF(ss_size(m->keys) != off + ks, SRM_NIL); /* BEHAVIOR */
+	r = srm_new(m, SRM_Leaf);
+	l = srm_leaf(m, r);
+	l->k_off = off;
+	l->k_size = ks;
+	m->size++;
+	return r;
+}
+
+/* Rewrite the key buffer without the keys of the deleted elements */
+static void srm_compact_keys(srt_rmap *m)
+{
+	size_t i, nl = sv_size(m->pool[SRM_Leaf]);
+	struct SRMapLeaf *l;
+	srt_string *keys = ss_alloc(ss_size(m->keys) - m->k_garbage);
+	if (!keys || keys == ss_void)
+		return; /* BEHAVIOR: not enough memory (keys kept as is) */
+	for (i = 0; i < nl; i++) {
+		l = (struct SRMapLeaf *)sv_elem_addr(m->pool[SRM_Leaf], i);
+		if (l->k_off == SRM_KEY_FREE)
+			continue;
+		ss_cat_cn(&keys, ss_get_buffer_r(m->keys) + l->k_off,
+			  l->k_size);
+		l->k_off = ss_size(keys) - l->k_size;
+	}
+	ss_free(&m->keys);
+	m->keys = keys;
+	m->k_garbage = 0;
+}
+
+static void srm_delete_leaf(srt_rmap *m, uint32_t r)
+{
+	struct SRMapLeaf *l = srm_leaf(m, r);
+	if (m->t == SRM_SS)
+		ss_free(&l->v.s);
+	m->k_garbage += l->k_size;
+	m->size--;
+	srm_release(m, r);
+}
+
+static uint32_t *srm_child(const srt_rmap *m, uint32_t r, uint8_t b)
+{
+	size_t i;
+	void *n = srm_node(m, r);
+	switch (SRM_KIND(r)) {
+	case SRM_N4:
+	case SRM_N16: {
+		/* N4 and N16 share the layout: header + keys + children */
+		struct SRMapInner *h = (struct SRMapInner *)n;
+		uint8_t *k = (uint8_t *)(h + 1);
+		uint32_t *c = SRM_KIND(r) == SRM_N4 ? ((struct SRMapN4 *)n)->c
+						    : ((struct SRMapN16 *)n)->c;
+		for (i = 0; i < h->nc && k[i] <= b; i++)
+			if (k[i] == b)
+				return &c[i];
+		return NULL;
+	}
+	case SRM_N48: {
+		struct SRMapN48 *n48 = (struct SRMapN48 *)n;
+		return n48->ci[b] ? &n48->c[n48->ci[b] - 1] : NULL;
+	}
+	case SRM_N256: {
+		struct SRMapN256 *n256 = (struct SRMapN256 *)n;
+		return n256->c[b] != SRM_NIL ? &n256->c[b] : NULL;
+	}
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Child enumeration in key byte order: *pos is the enumeration state (0
+ * for the first call). The key ending at the node goes first.
+ */
+static uint32_t srm_next_child(const srt_rmap *m, uint32_t r, uint32_t *pos)
+{
+	uint32_t i;
+	void *n = srm_node(m, r);
+	struct SRMapInner *h = (struct SRMapInner *)n;
+	if (*pos == 0) {
+		*pos = 1;
+		if (h->leaf != SRM_NIL)
+			return h->leaf;
+	}
+	i = *pos - 1;
+	switch (SRM_KIND(r)) {
+	case SRM_N4:
+		if (i < h->nc) {
+			(*pos)++;
+			return ((struct SRMapN4 *)n)->c[i];
+		}
+		break;
+	case SRM_N16:
+		if (i < h->nc) {
+			(*pos)++;
+			return ((struct SRMapN16 *)n)->c[i];
+		}
+		break;
+	case SRM_N48:
+		for (; i < 256; i++)
+			if (((struct SRMapN48 *)n)->ci[i]) {
+				*pos = i + 2;
+				return ((struct SRMapN48 *)n)
+					->c[((struct SRMapN48 *)n)->ci[i] - 1];
+			}
+		*pos = 257;
+		break;
+	case SRM_N256:
+		for (; i < 256; i++)
+			if (((struct SRMapN256 *)n)->c[i] != SRM_NIL) {
+				*pos = i + 2;
+				return ((struct SRMapN256 *)n)->c[i];
+			}
+		*pos = 257;
+		break;
+	default:
+		break;
+	}
+	return SRM_NIL;
+}
+
+/* Leaf with the smallest key below a given node */
+static const struct SRMapLeaf *srm_min_leaf(const srt_rmap *m, uint32_t r)
+{
+	uint32_t pos;
+	while (SRM_KIND(r) != SRM_Leaf) {
+		pos = 0;
+		r = srm_next_child(m, r, &pos);
+	}
+	return srm_leaf(m, r);
+}
+
+/* Add child to a non-full inner node */
+static void srm_add_child0(srt_rmap *m, uint32_t r, uint8_t b, uint32_t child)
+{
+	size_t i, j;
+	void *n = srm_node(m, r);
+	struct SRMapInner *h = (struct SRMapInner *)n;
+	switch (SRM_KIND(r)) {
+	case SRM_N4:
+	case SRM_N16: {
+		uint8_t *k = (uint8_t *)(h + 1);
+		uint32_t *c = SRM_KIND(r) == SRM_N4 ? ((struct SRMapN4 *)n)->c
+						    : ((struct SRMapN16 *)n)->c;
+		for (i = 0; i < h->nc && k[i] < b; i++)
+			;
+		for (j = h->nc; j > i; j--) {
+			k[j] = k[j - 1];
+			c[j] = c[j - 1];
+		}
+		k[i] = b;
+		c[i] = child;
+		break;
+	}
+	case SRM_N48: {
+		struct SRMapN48 *n48 = (struct SRMapN48 *)n;
+		for (i = 0; n48->c[i] != SRM_NIL; i++)
+			;
+		n48->c[i] = child;
+		n48->ci[b] = (uint8_t)(i + 1);
+		break;
+	}
+	case SRM_N256:
+		((struct SRMapN256 *)n)->c[b] = child;
+		break;
+	default:
+		return;
+	}
+	h->nc++;
+}
+
+static void srm_del_child0(srt_rmap *m, uint32_t r, uint8_t b)
+{
+	size_t i;
+	void *n = srm_node(m, r);
+	struct SRMapInner *h = (struct SRMapInner *)n;
+	switch (SRM_KIND(r)) {
+	case SRM_N4:
+	case SRM_N16: {
+		uint8_t *k = (uint8_t *)(h + 1);
+		uint32_t *c = SRM_KIND(r) == SRM_N4 ? ((struct SRMapN4 *)n)->c
+						    : ((struct SRMapN16 *)n)->c;
+		for (i = 0; i < h->nc && k[i] != b; i++)
+			;
+		for (; i + 1 < h->nc; i++) {
+			k[i] = k[i + 1];
+			c[i] = c[i + 1];
+		}
+		break;
+	}
+	case SRM_N48: {
+		struct SRMapN48 *n48 = (struct SRMapN48 *)n;
+		n48->c[n48->ci[b] - 1] = SRM_NIL;
+		n48->ci[b] = 0;
+		break;
+	}
+	case SRM_N256:
+		((struct SRMapN256 *)n)->c[b] = SRM_NIL;
+		break;
+	default:
+		return;
+	}
+	h->nc--;
+}
+
+/* Move node to a node of a different kind (grow or shrink) */
+static uint32_t srm_resize(srt_rmap *m, uint32_t r, enum eSRM_Kind k)
+{
+	size_t b;
+	const uint32_t *c;
+	uint32_t nr = srm_new(m, k);
+	struct SRMapInner *h = srm_inner(m, r), *nh = srm_inner(m, nr);
+	nh->leaf = h->leaf;
+	nh->plen = h->plen;
+	memcpy(nh->pfx, h->pfx, SRM_PFX_MAX);
+	for (b = 0; b < 256; b++)
+		if ((c = srm_child(m, r, (uint8_t)b)) != NULL)
+			srm_add_child0(m, nr, (uint8_t)b, *c);
+	srm_release(m, r);
+	return nr;
+}
+
+/* Add child, growing the node if full (*slot is updated) */
+static void srm_add_child(srt_rmap *m, uint32_t *slot, uint8_t b,
+			  uint32_t child)
+{
+	enum eSRM_Kind k = SRM_KIND(*slot);
+	if (srm_inner(m, *slot)->nc == srm_node_cap[k])
+		*slot = srm_resize(m, *slot, (enum eSRM_Kind)(k + 1));
+	srm_add_child0(m, *slot, b, child);
+}
+
+/*
+ * Inner node with a single element left (child or key) is replaced by that
+ * element, merging the compressed paths (*slot is updated)
+ */
+static void srm_collapse(srt_rmap *m, uint32_t *slot)
+{
+	uint32_t r = *slot, c, pos = 1;
+	struct SRMapInner *h = srm_inner(m, r), *ch;
+	uint8_t b, pfx[SRM_PFX_MAX];
+	size_t i, n;
+	enum eSRM_Kind k = SRM_KIND(r);
+	if (h->nc + (h->leaf != SRM_NIL ? 1 : 0) > 1) {
+		if (h->nc < srm_node_min[k])
+			*slot = srm_resize(m, r, (enum eSRM_Kind)(k - 1));
+		return;
+	}
+	if (h->leaf != SRM_NIL) {
+		*slot = h->leaf;
+	} else {
+		c = srm_next_child(m, r, &pos);
+		if (SRM_KIND(c) != SRM_Leaf) {
+			/* path: node path + child key byte + child path */
+			ch = srm_inner(m, c);
+			n = S_MIN(h->plen, SRM_PFX_MAX);
+			memcpy(pfx, h->pfx, n);
+			if (n < SRM_PFX_MAX) {
+				if (k == SRM_N4 || k == SRM_N16)
+					b = *(uint8_t *)(h + 1);
+				else
+					b = (uint8_t)(pos - 2);
+				pfx[n++] = b;
+				for (i = 0; n < SRM_PFX_MAX && i < ch->plen;)
+					pfx[n++] = ch->pfx[i++];
+			}
+			memcpy(ch->pfx, pfx, n);
+			ch->plen += h->plen + 1;
+		}
+		*slot = c;
+	}
+	srm_release(m, r);
+}
+
+/* Number of matching bytes between the node compressed path and the key */
+static size_t srm_pfx_match(const srt_rmap *m, uint32_t r, const uint8_t *k,
+			    size_t ks, size_t depth)
+{
+	size_t i, n;
+	const uint8_t *lk = NULL;
+	const struct SRMapInner *h = srm_inner(m, r);
+	n = S_MIN(h->plen, ks - depth);
+	for (i = 0; i < n; i++) {
+		if (i == SRM_PFX_MAX) /* path bytes not stored in the node */
+			lk = srm_leaf_key(m, srm_min_leaf(m, r)) + depth;
+		if ((i < SRM_PFX_MAX ? h->pfx[i] : lk[i]) != k[depth + i])
+			break;
+	}
+	return i;
+}
+
+static uint32_t srm_find(const srt_rmap *m, const srt_string *key)
+{
+	size_t depth = 0, i, ks;
+	const uint8_t *k;
+	const uint32_t *c;
+	const struct SRMapInner *h;
+	uint32_t r;
+	RETURN_IF(!m || !m->size, SRM_NIL);
+	ks = ss_size(key);
+	k = (const uint8_t *)ss_get_buffer_r(key);
+	for (r = m->root; r != SRM_NIL && SRM_KIND(r) != SRM_Leaf;) {
+		h = srm_inner(m, r);
+		if (h->plen) {
+			RETURN_IF(ks - depth < h->plen, SRM_NIL);
+			for (i = 0; i < h->plen && i < SRM_PFX_MAX; i++)
+				if (h->pfx[i] != k[depth + i])
+					return SRM_NIL;
+			depth += h->plen;
+		}
+		if (depth == ks) {
+			r = h->leaf;
+			break;
+		}
+		c = srm_child(m, r, k[depth++]);
+		r = c ? *c : SRM_NIL;
+	}
+	return r != SRM_NIL && srm_leaf_eq(m, r, k, ks) ? r : SRM_NIL;
+}
+
+/*
+ * Leaf split: new inner node for the common path of the leaf and the new key
+ */
+static uint32_t srm_split_leaf(srt_rmap *m, uint32_t *slot, const uint8_t *k,
+			       size_t ks, size_t depth)
+{
+	size_t lp, n;
+	uint8_t b;
+	uint32_t r = *slot, nl, nn;
+	const uint8_t *lk;
+	struct SRMapInner *hn;
+	struct SRMapLeaf *l = srm_leaf(m, r);
+	lk = srm_leaf_key(m, l);
+	for (lp = depth; lp < ks && lp < l->k_size && k[lp] == lk[lp]; lp++)
+		;
+	b = lp < l->k_size ? lk[lp] : 0;
+	n = l->k_size; /* lk gets invalid after the key insert */
+	nl = srm_new_leaf(m, k, ks);
+	RETURN_IF(nl == SRM_NIL, SRM_NIL); /* BEHAVIOR: not enough memory */
+	nn = srm_new(m, SRM_N4);
+	hn = srm_inner(m, nn);
+	hn->plen = (uint32_t)(lp - depth);
+	memcpy(hn->pfx, k + depth, S_MIN(lp - depth, SRM_PFX_MAX));
+	if (n == lp)
+		hn->leaf = r;
+	else
+		srm_add_child0(m, nn, b, r);
+	if (ks == lp)
+		hn->leaf = nl;
+	else
+		srm_add_child0(m, nn, k[lp], nl);
+	*slot = nn;
+	return nl;
+}
+
+/*
+ * Path split: new node with the first lp bytes of the path, having below
+ * both the current node (with the rest of the path) and the new key
+ */
+static uint32_t srm_split_path(srt_rmap *m, uint32_t *slot, const uint8_t *k,
+			       size_t ks, size_t depth, size_t lp)
+{
+	size_t n;
+	uint8_t b, pfx[SRM_PFX_MAX];
+	uint32_t r = *slot, nl, nn;
+	const uint8_t *lk;
+	struct SRMapInner *h = srm_inner(m, r), *hn;
+	if (h->plen > SRM_PFX_MAX)
+		lk = srm_leaf_key(m, srm_min_leaf(m, r)) + depth;
+	else
+		lk = h->pfx;
+	b = lk[lp];
+	n = S_MIN(h->plen - lp - 1, SRM_PFX_MAX);
+	memcpy(pfx, lk + lp + 1, n);
+	nl = srm_new_leaf(m, k, ks);
+	RETURN_IF(nl == SRM_NIL, SRM_NIL); /* BEHAVIOR: not enough memory */
+	h = srm_inner(m, r);
+	h->plen -= (uint32_t)(lp + 1);
+	memcpy(h->pfx, pfx, n);
+	nn = srm_new(m, SRM_N4);
+	hn = srm_inner(m, nn);
+	hn->plen = (uint32_t)lp;
+	memcpy(hn->pfx, k + depth, S_MIN(lp, SRM_PFX_MAX));
+	srm_add_child0(m, nn, b, r);
+	if (depth + lp == ks)
+		hn->leaf = nl;
+	else
+		srm_add_child0(m, nn, k[depth + lp], nl);
+	*slot = nn;
+	return nl;
+}
+
+/*
+ * Locate element for writing, inserting it if not found
+ */
+static struct SRMapLeaf *srm_locate_w(srt_rmap *m, const srt_string *key)
+{
+	size_t depth = 0, ks, lp;
+	const uint8_t *k;
+	uint32_t *slot, *c, r, nl;
+	struct SRMapInner *h;
+	RETURN_IF(!srm_reserve(m), NULL); /* BEHAVIOR: not enough memory */
+	ks = ss_size(key);
+	k = (const uint8_t *)ss_get_buffer_r(key);
+	for (slot = &m->root;;) {
+		r = *slot;
+		if (r == SRM_NIL) { /* empty map */
+			nl = srm_new_leaf(m, k, ks);
+			*slot = nl;
+			break;
+		}
+		if (SRM_KIND(r) == SRM_Leaf) {
+			if (srm_leaf_eq(m, r, k, ks))
+				return srm_leaf(m, r);
+			nl = srm_split_leaf(m, slot, k, ks, depth);
+			break;
+		}
+		h = srm_inner(m, r);
+		if (h->plen) {
+			lp = srm_pfx_match(m, r, k, ks, depth);
+			if (lp < h->plen) {
+				nl = srm_split_path(m, slot, k, ks, depth, lp);
+				break;
+			}
+			depth += h->plen;
+		}
+		if (depth == ks) {
+			if (h->leaf == SRM_NIL) {
+				nl = srm_new_leaf(m, k, ks);
+				RETURN_IF(nl == SRM_NIL, NULL); /* BEHAVIOR */
+				srm_inner(m, r)->leaf = nl;
+			}
+			return srm_leaf(m, srm_inner(m, r)->leaf);
+		}
+		c = srm_child(m, r, k[depth]);
+		if (!c) {
+			nl = srm_new_leaf(m, k, ks);
+			if (nl != SRM_NIL)
+				srm_add_child(m, slot, k[depth], nl);
+			break;
+		}
+		slot = c;
+		depth++;
+	}
+	return nl != SRM_NIL ? srm_leaf(m, nl) : NULL;
+}
+
+static void srm_free_parts(srt_rmap *m)
+{
+	size_t i;
+	for (i = 0; i < SRM_NKinds; i++) {
+		sv_free(&m->pool[i]);
+		sv_free(&m->avail[i]);
+	}
+	ss_free(&m->keys);
+	s_free(m);
+}
+
+/*
+ * Allocation
+ */
+
+srt_rmap *srm_alloc(enum eSRM_Type t, size_t init_size)
+{
+	size_t i, n;
+	srt_bool ok;
+	srt_rmap *m = (srt_rmap *)s_malloc(sizeof(srt_rmap));
+	RETURN_IF(!m, NULL); /* BEHAVIOR: not enough memory */
+	m->t = t;
+	m->root = SRM_NIL;
+	m->size = m->k_garbage = 0;
+	m->keys = ss_alloc(init_size * 16);
+	ok = m->keys && m->keys != ss_void;
+	for (i = 0; i < SRM_NKinds; i++) {
+		n = i == SRM_Leaf ? init_size : i == SRM_N4 ? init_size / 2 : 0;
+		m->pool[i] = sv_alloc(srm_node_size[i], n, NULL);
+		m->avail[i] = sv_alloc_t(SV_U32, 0);
+		if (!m->pool[i] || !m->avail[i])
+			ok = S_FALSE;
+	}
+	if (!ok) {
+		srm_free_parts(m);
+		return NULL; /* BEHAVIOR: not enough memory */
+	}
+	return m;
+}
+
+void srm_clear(srt_rmap *m)
+{
+	size_t i, nl;
+	struct SRMapLeaf *l;
+	if (!m)
+		return;
+	if (m->t == SRM_SS) {
+		nl = sv_size(m->pool[SRM_Leaf]);
+		for (i = 0; i < nl; i++) {
+			l = (struct SRMapLeaf *)sv_elem_addr(m->pool[SRM_Leaf],
+							     i);
+			if (l->k_off != SRM_KEY_FREE)
+				ss_free(&l->v.s);
+		}
+	}
+	for (i = 0; i < SRM_NKinds; i++) {
+		sv_set_size(m->pool[i], 0);
+		sv_set_size(m->avail[i], 0);
+	}
+	ss_clear(m->keys);
+	m->root = SRM_NIL;
+	m->size = m->k_garbage = 0;
+}
+
+void srm_free_aux(srt_rmap **m, ...)
+{
+	va_list ap;
+	srt_rmap **next;
+	va_start(ap, m);
+	next = m;
+	while (!s_varg_tail_ptr_tag(next)) { /* last element tag */
+		if (next && *next) {
+			srm_clear(*next); /* release associated dyn. memory */
+			srm_free_parts(*next);
+			*next = NULL;
+		}
+		next = (srt_rmap **)va_arg(ap, srt_rmap **);
+	}
+	va_end(ap);
+}
+
+size_t srm_size(const srt_rmap *m)
+{
+	return m ? m->size : 0;
+}
+
+enum eSRM_Type srm_type(const srt_rmap *m)
+{
+	return m ? m->t : SRM_SI;
+}
+
+/*
+ * Accessors
+ */
+
+int64_t srm_at_si(const srt_rmap *m, const srt_string *k)
+{
+	uint32_t r;
+	RETURN_IF(!srm_chk_t(m, SRM_SI), 0);
+	r = srm_find(m, k);
+	return r != SRM_NIL ? srm_leaf(m, r)->v.i : 0;
+}
+
+const srt_string *srm_at_ss(const srt_rmap *m, const srt_string *k)
+{
+	uint32_t r;
+	RETURN_IF(!srm_chk_t(m, SRM_SS), ss_void);
+	r = srm_find(m, k);
+	return r != SRM_NIL && srm_leaf(m, r)->v.s ? srm_leaf(m, r)->v.s
+						   : ss_void;
+}
+
+const void *srm_at_sp(const srt_rmap *m, const srt_string *k)
+{
+	uint32_t r;
+	RETURN_IF(!srm_chk_t(m, SRM_SP), NULL);
+	r = srm_find(m, k);
+	return r != SRM_NIL ? srm_leaf(m, r)->v.p : NULL;
+}
+
+/*
+ * Existence check
+ */
+
+size_t srm_count_s(const srt_rmap *m, const srt_string *k)
+{
+	return srm_find(m, k) != SRM_NIL ? 1 : 0;
+}
+
+/*
+ * Insert
+ */
+
+srt_bool srm_insert_si(srt_rmap **m, const srt_string *k, int64_t v)
+{
+	struct SRMapLeaf *l;
+	RETURN_IF(!m || !srm_chk_t(*m, SRM_SI), S_FALSE);
+	l = srm_locate_w(*m, k);
+	RETURN_IF(!l, S_FALSE);
+	l->v.i = v;
+	return S_TRUE;
+}
+
+srt_bool srm_inc_si(srt_rmap **m, const srt_string *k, int64_t v)
+{
+	struct SRMapLeaf *l;
+	RETURN_IF(!m || !srm_chk_t(*m, SRM_SI), S_FALSE);
+	l = srm_locate_w(*m, k);
+	RETURN_IF(!l, S_FALSE);
+	l->v.i += v;
+	return S_TRUE;
+}
+
+srt_bool srm_insert_ss(srt_rmap **m, const srt_string *k, const srt_string *v)
+{
+	size_t size0;
+	struct SRMapLeaf *l;
+	RETURN_IF(!m || !srm_chk_t(*m, SRM_SS), S_FALSE);
+	size0 = (*m)->size;
+	l = srm_locate_w(*m, k);
+	RETURN_IF(!l, S_FALSE);
+	ss_cpy(&l->v.s, v);
+	if (l->v.s == ss_void)
+		l->v.s = NULL;
+	if (ss_size(l->v.s) == ss_size(v))
+		return S_TRUE;
+	/*
+	 * BEHAVIOR: not enough memory for the value copy: a new key is
+	 * removed, so the map is left as before the call
+	 */
+	if ((*m)->size != size0)
+		srm_delete_s(*m, k);
+	return S_FALSE;
+}
+
+srt_bool srm_insert_sp(srt_rmap **m, const srt_string *k, const void *v)
+{
+	struct SRMapLeaf *l;
+	RETURN_IF(!m || !srm_chk_t(*m, SRM_SP), S_FALSE);
+	l = srm_locate_w(*m, k);
+	RETURN_IF(!l, S_FALSE);
+	l->v.p = v;
+	return S_TRUE;
+}
+
+/*
+ * Delete
+ */
+
+srt_bool srm_delete_s(srt_rmap *m, const srt_string *key)
+{
+	size_t depth = 0, i, ks;
+	const uint8_t *k;
+	uint32_t *slot, *pslot = NULL, *c, r;
+	uint8_t pb = 0;
+	struct SRMapInner *h;
+	RETURN_IF(!m || !m->size, S_FALSE);
+	RETURN_IF(!srm_reserve(m), S_FALSE); /* BEHAVIOR: not enough memory */
+	ks = ss_size(key);
+	k = (const uint8_t *)ss_get_buffer_r(key);
+	for (slot = &m->root;;) {
+		r = *slot;
+		if (SRM_KIND(r) == SRM_Leaf) {
+			RETURN_IF(!srm_leaf_eq(m, r, k, ks), S_FALSE);
+			srm_delete_leaf(m, r);
+			if (pslot) {
+				srm_del_child0(m, *pslot, pb);
+				srm_collapse(m, pslot);
+			} else {
+				m->root = SRM_NIL;
+			}
+			break;
+		}
+		h = srm_inner(m, r);
+		if (h->plen) {
+			RETURN_IF(ks - depth < h->plen, S_FALSE);
+			for (i = 0; i < h->plen && i < SRM_PFX_MAX; i++)
+				RETURN_IF(h->pfx[i] != k[depth + i], S_FALSE);
+			depth += h->plen;
+		}
+		if (depth == ks) {
+			RETURN_IF(h->leaf == SRM_NIL
+					  || !srm_leaf_eq(m, h->leaf, k, ks),
+				  S_FALSE);
+			srm_delete_leaf(m, h->leaf);
+			h->leaf = SRM_NIL;
+			srm_collapse(m, slot);
+			break;
+		}
+		c = srm_child(m, r, k[depth]);
+		RETURN_IF(!c, S_FALSE);
+		pslot = slot;
+		pb = k[depth++];
+		slot = c;
+	}
+	if (!m->size)
+		srm_clear(m);
+	else if (m->k_garbage > 4096 && m->k_garbage > ss_size(m->keys) / 2)
+		srm_compact_keys(m);
+	return S_TRUE;
+}
+
+/*
+ * Enumeration
+ */
+
+/* Subtree having all the keys with the given prefix */
+static uint32_t srm_prefix_root(const srt_rmap *m, const srt_string *prefix)
+{
+	size_t depth = 0, ps = ss_size(prefix);
+	const uint8_t *p = (const uint8_t *)ss_get_buffer_r(prefix);
+	const struct SRMapLeaf *l;
+	const uint32_t *c;
+	uint32_t r = m->root;
+	while (r != SRM_NIL && depth < ps && SRM_KIND(r) != SRM_Leaf) {
+		/* path bytes are checked at the end, against a leaf key */
+		depth += srm_inner(m, r)->plen;
+		if (depth >= ps)
+			break;
+		c = srm_child(m, r, p[depth++]);
+		r = c ? *c : SRM_NIL;
+	}
+	if (r != SRM_NIL) {
+		l = srm_min_leaf(m, r);
+		if (l->k_size < ps
+		    || (ps && memcmp(srm_leaf_key(m, l), p, ps)))
+			r = SRM_NIL;
+	}
+	return r;
+}
+
+static size_t srm_itr_aux(const srt_rmap *m, const srt_string *prefix,
+			  enum eSRM_Type t, srt_bool has_f, union SRMapItrF f,
+			  void *context)
+{
+	size_t cnt = 0, ns;
+	srt_bool go_on;
+	srt_string_ref kr;
+	const srt_string *k;
+	const struct SRMapLeaf *l;
+	struct SRMapWalk w, *top;
+	srt_vector *s;
+	RETURN_IF(!srm_chk_t(m, t) || !m->size, 0);
+	w.r = srm_prefix_root(m, prefix);
+	w.pos = 0;
+	RETURN_IF(w.r == SRM_NIL, 0);
+	s = sv_alloc(sizeof(struct SRMapWalk), 32, NULL);
+	RETURN_IF(!s || !sv_push(&s, &w), 0); /* BEHAVIOR: not enough mem. */
+	while ((ns = sv_size(s)) > 0) {
+		top = (struct SRMapWalk *)sv_elem_addr(s, ns - 1);
+		if (SRM_KIND(top->r) != SRM_Leaf) {
+			w.r = srm_next_child(m, top->r, &top->pos);
+			w.pos = 0;
+			if (w.r == SRM_NIL)
+				sv_set_size(s, ns - 1);
+			else if (!sv_push(&s, &w))
+				break; /* BEHAVIOR: not enough memory */
+			continue;
+		}
+		l = srm_leaf(m, top->r);
+		sv_set_size(s, ns - 1);
+		if (has_f) {
+			k = ss_ref_buf(&kr, (const char *)srm_leaf_key(m, l),
+				       l->k_size);
+			switch (t) {
+			case SRM_SI:
+				go_on = f.si(k, l->v.i, context);
+				break;
+			case SRM_SS:
+				go_on = f.ss(k, l->v.s ? l->v.s : ss_void,
+					     context);
+				break;
+			default:
+				go_on = f.sp(k, l->v.p, context);
+				break;
+			}
+			if (!go_on)
+				break;
+		}
+		cnt++;
+	}
+	sv_free(&s);
+	return cnt;
+}
+
+size_t srm_itr_si(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_si f, void *context)
+{
+	union SRMapItrF uf;
+	uf.si = f;
+	return srm_itr_aux(m, prefix, SRM_SI, f ? S_TRUE : S_FALSE, uf,
+			   context);
+}
+
+size_t srm_itr_ss(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_ss f, void *context)
+{
+	union SRMapItrF uf;
+	uf.ss = f;
+	return srm_itr_aux(m, prefix, SRM_SS, f ? S_TRUE : S_FALSE, uf,
+			   context);
+}
+
+size_t srm_itr_sp(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_sp f, void *context)
+{
+	union SRMapItrF uf;
+	uf.sp = f;
+	return srm_itr_aux(m, prefix, SRM_SP, f ? S_TRUE : S_FALSE, uf,
+			   context);
+}
@@ -0,0 +1,152 @@
+#ifndef SRMAP_H
+#define SRMAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * srmap.h
+ *
+ * #SHORTDOC radix tree map handling (string key-value storage)
+ *
+ * #DOC Radix map functions handle string-keyed key-value storage, which is
+ * #DOC implemented as an adaptive radix tree (prefix-compressed trie, using
+ * #DOC inner nodes with room for 4, 16, 48 or 256 children, depending on
+ * #DOC the number of children). Lookup/insert/delete are O(k), being k the
+ * #DOC key length, instead of O(log n) string comparisons (srt_map string
+ * #DOC key modes). Keys are stored once, into a shared key buffer, so there
+ * #DOC is no heap allocation per key. Keys with long common prefixes (e.g.
+ * #DOC URLs or file paths) are compared just once per node, and not for
+ * #DOC every tree level.
+ * #DOC
+ * #DOC Elements are enumerated in key order (same order as srt_map string
+ * #DOC keys), being possible to enumerate only the keys having a given
+ * #DOC prefix (srm_itr_*() functions).
+ * #DOC
+ * #DOC
+ * #DOC Supported map modes (enum eSRM_Type):
+ * #DOC
+ * #DOC
+ * #DOC 	SRM_SI: string key, int64_t value
+ * #DOC
+ * #DOC 	SRM_SS: string key, string value
+ * #DOC
+ * #DOC 	SRM_SP: string key, pointer value
+ * #DOC
+ * #DOC
+ * #DOC Callback types for the srm_itr_*() functions (same as srt_map ones):
+ * #DOC
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_it_si)(const srt_string *, int64_t v, void *context);
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_it_ss)(const srt_string *, const srt_string *, void *context);
+ * #DOC
+ * #DOC	typedef srt_bool (*srt_map_it_sp)(const srt_string *, const void *, void *context);
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "smap.h"
+
+/*
+ * Structures
+ */
+
+enum eSRM_Type { SRM_SI, SRM_SS, SRM_SP };
+
+struct SRMap;
+
+typedef struct SRMap srt_rmap;
+
+/*
+ * Allocation
+ */
+
+/* #API: |Allocate radix map (heap)|map type; initial reserve|map|O(1)|1;2| */
+srt_rmap *srm_alloc(enum eSRM_Type t, size_t initial_num_elems_reserve);
+
+/* #API: |Reset/clean map (keeping map type)|map|-|O(1) for SRM_SI and SRM_SP maps, O(n) for SRM_SS|1;2| */
+void srm_clear(srt_rmap *m);
+
+/*
+#API: |Free one or more radix maps (heap)|map; more maps (optional)|-|O(1) for SRM_SI and SRM_SP maps, O(n) for SRM_SS|1;2|
+void srm_free(srt_rmap **m, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define srm_free(...) srm_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define srm_free(m) srm_free_aux(m, S_INVALID_PTR_VARG_TAIL)
+#endif
+void srm_free_aux(srt_rmap **m, ...);
+
+/* #API: |Get map size|map|Map number of elements|O(1)|1;2| */
+size_t srm_size(const srt_rmap *m);
+
+/* #API: |Get map type|map|Map type|O(1)|1;2| */
+enum eSRM_Type srm_type(const srt_rmap *m);
+
+/*
+ * Accessors
+ */
+
+/* #API: |Access to string-int map element|map; key|value (0 if not found)|O(k)|1;2| */
+int64_t srm_at_si(const srt_rmap *m, const srt_string *k);
+
+/* #API: |Access to string-string map element|map; key|value (empty string if not found)|O(k)|1;2| */
+const srt_string *srm_at_ss(const srt_rmap *m, const srt_string *k);
+
+/* #API: |Access to string-pointer map element|map; key|value (NULL if not found)|O(k)|1;2| */
+const void *srm_at_sp(const srt_rmap *m, const srt_string *k);
+
+/*
+ * Existence check
+ */
+
+/* #API: |Map element count/check|map; key|S_TRUE: element found; S_FALSE: not in the map|O(k)|1;2| */
+size_t srm_count_s(const srt_rmap *m, const srt_string *k);
+
+/*
+ * Insert
+ */
+
+/* #API: |Insert into string-int map|map; key; value|S_TRUE: OK, S_FALSE: insertion error|O(k)|1;2| */
+srt_bool srm_insert_si(srt_rmap **m, const srt_string *k, int64_t v);
+
+/* #API: |Increment value into string-int map|map; key; value|S_TRUE: OK, S_FALSE: insertion error|O(k)|1;2| */
+srt_bool srm_inc_si(srt_rmap **m, const srt_string *k, int64_t v);
+
+/* #API: |Insert into string-string map|map; key; value|S_TRUE: OK, S_FALSE: insertion error|O(k)|1;2| */
+srt_bool srm_insert_ss(srt_rmap **m, const srt_string *k, const srt_string *v);
+
+/* #API: |Insert into string-pointer map|map; key; value|S_TRUE: OK, S_FALSE: insertion error|O(k)|1;2| */
+srt_bool srm_insert_sp(srt_rmap **m, const srt_string *k, const void *v);
+
+/*
+ * Delete
+ */
+
+/* #API: |Delete map element|map; key|S_TRUE: found and deleted; S_FALSE: not found|O(k)|1;2| */
+srt_bool srm_delete_s(srt_rmap *m, const srt_string *k);
+
+/*
+ * Enumeration / export data
+ */
+
+/* #API: |Enumerate string-int map elements having the given key prefix, in key order|map; key prefix (NULL or empty string: all elements); callback function (NULL: count only); callback function context|Number of elements processed|O(k + n)|1;2| */
+size_t srm_itr_si(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_si f, void *context);
+
+/* #API: |Enumerate string-string map elements having the given key prefix, in key order|map; key prefix (NULL or empty string: all elements); callback function (NULL: count only); callback function context|Number of elements processed|O(k + n)|1;2| */
+size_t srm_itr_ss(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_ss f, void *context);
+
+/* #API: |Enumerate string-pointer map elements having the given key prefix, in key order|map; key prefix (NULL or empty string: all elements); callback function (NULL: count only); callback function context|Number of elements processed|O(k + n)|1;2| */
+size_t srm_itr_sp(const srt_rmap *m, const srt_string *prefix,
+		  srt_map_it_sp f, void *context);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* #ifndef SRMAP_H */
@@ -12,7 +12,9 @@
 #include "saux/scommon.h"
 #include "saux/senc.h"
 #include "saux/shash.h"
+#include "saux/smsearch.h"
 #include "saux/ssearch.h"
+#include "saux/ssort.h"
 
 /*
  * Togglable optimizations
@@ -696,7 +698,7 @@ static srt_string *aux_replace(srt_string **s, srt_bool cat,
 	}
 	o += off;
 	i_next = s1 == s2 ? S_NPOS : /* no replace */
-			 ss_find(src, i + off, s1);
+			 ss_find(src, off, s1);
 	for (i = off;;) {
 		/* before match copy: */
 		if (i_next == S_NPOS) {
@@ -1930,6 +1932,18 @@ const wchar_t *ss_to_w(const srt_string *s, wchar_t *o, size_t nmax, size_t *n)
  * Search
  */
 
+/*
+ * Short targets: first/last byte filter (falling back to the checksum
+ * search in adversarial cases); other: checksum search
+ */
+S_INLINE size_t ss_find_aux(const char *s0, size_t off, size_t ss,
+			    const char *t, size_t ts)
+{
+	return ts >= SS_FIND_FL_MIN && ts <= SS_FIND_FL_MAX
+		       ? ss_find_fl(s0, off, ss, t, ts)
+		       : ss_find_csum_fast(s0, off, ss, t, ts);
+}
+
 size_t ss_find(const srt_string *s, size_t off, const srt_string *tgt)
 {
 	return ss_findr(s, off, S_NPOS, tgt);
@@ -1976,7 +1990,7 @@ size_t ss_findr(const srt_string *s, size_t off, size_t max_off,
 	RETURN_IF(!ss || !ts || (off + ts) > ss, S_NPOS);
 	s0 = ss_get_buffer_r(s);
 	t0 = ss_get_buffer_r(tgt);
-	return ss_find_csum_fast(s0, off, ss, t0, ts);
+	return ss_find_aux(s0, off, ss, t0, ts);
 }
 
 #define SS_FINDRX_AUX_VARS const char *p0, *pm, *p
@@ -2038,7 +2052,273 @@ size_t ss_findr_cn(const srt_string *s, size_t off, size_t max_off,
 	RETURN_IF(!s || !t, S_NPOS);
 	ss = ss_real_off(s, max_off);
 	RETURN_IF(!ss || !ts || (off + ts) > ss, S_NPOS);
-	return ss_find_csum_fast(ss_get_buffer_r(s), off, ss, t, ts);
+	return ss_find_aux(ss_get_buffer_r(s), off, ss, t, ts);
+}
+
+/*
+ * Precomputed search (the target copy is stored after the structure)
+ */
+
+struct SStringPattern {
+	struct SSearchPat sp;
+};
+
+srt_string_pattern *ss_pattern_compile(const srt_string *tgt)
+{
+	char *t;
+	size_t ts;
+	srt_string_pattern *p;
+	ts = ss_size(tgt);
+	RETURN_IF(!ts, NULL); /* BEHAVIOR: empty target */
+	RETURN_IF(ts > S_SIZET_MAX - sizeof(srt_string_pattern), NULL);
+	p = (srt_string_pattern *)s_malloc(sizeof(srt_string_pattern) + ts);
+	RETURN_IF(!p, NULL);
+	t = (char *)(p + 1);
+	memcpy(t, ss_get_buffer_r(tgt), ts);
+	ss_find_pat_init(&p->sp, t, ts);
+	return p;
+}
+
+void ss_pattern_free_aux(srt_string_pattern **p, ...)
+{
+	va_list ap;
+	srt_string_pattern **next;
+	va_start(ap, p);
+	next = p;
+	while (!s_varg_tail_ptr_tag(next)) { /* last element tag */
+		if (next && *next) {
+			s_free(*next);
+			*next = NULL;
+		}
+		next = (srt_string_pattern **)va_arg(ap, srt_string_pattern **);
+	}
+	va_end(ap);
+}
+
+size_t ss_find_p(const srt_string *s, size_t off, const srt_string_pattern *p)
+{
+	return ss_findr_p(s, off, S_NPOS, p);
+}
+
+size_t ss_findr_p(const srt_string *s, size_t off, size_t max_off,
+		  const srt_string_pattern *p)
+{
+	size_t ss;
+	RETURN_IF(!s || !p, S_NPOS);
+	ss = ss_real_off(s, max_off);
+	RETURN_IF(off >= ss || ss - off < p->sp.ts, S_NPOS);
+	return ss_find_pat(ss_get_buffer_r(s), off, ss, &p->sp);
+}
+
+size_t ss_count_p(const srt_string *s, size_t off, const srt_string_pattern *p)
+{
+	const char *s0;
+	size_t ss, n = 0;
+	RETURN_IF(!s || !p, 0);
+	ss = ss_size(s);
+	s0 = ss_get_buffer_r(s);
+	for (; (off = ss_find_pat(s0, off, ss, &p->sp)) != S_NPOS;
+	     off += p->sp.ts)
+		n++;
+	return n;
+}
+
+/*
+ * Multi-pattern search
+ */
+
+struct SSMpMatch {
+	size_t off, id;
+};
+
+struct SSMpAll {
+	struct SSMpMatch *m;
+	size_t n, max;
+	srt_bool sorted, oom;
+};
+
+struct SSMpMask {
+	uint64_t *m;
+	size_t n, ntgts;
+};
+
+srt_string_mpattern *ss_mpattern_compile(const srt_vector *tgts)
+{
+	size_t i, n, *ts;
+	const char **t;
+	const srt_string *s;
+	srt_string_mpattern *p;
+	RETURN_IF(!tgts || tgts->d.sub_type != SV_GEN
+			  || tgts->d.elem_size != sizeof(srt_string *),
+		  NULL); /* BEHAVIOR: not a string pointer vector */
+	n = sv_size(tgts);
+	RETURN_IF(!n || n > S_SIZET_MAX / (sizeof(size_t) + sizeof(char *)),
+		  NULL);
+	ts = (size_t *)s_malloc(n * (sizeof(size_t) + sizeof(char *)));
+	RETURN_IF(!ts, NULL); /* BEHAVIOR: out of memory */
+	t = (const char **)(ts + n);
+	for (i = 0; i < n; i++) {
+		s = *(const srt_string *const *)sv_at(tgts, i);
+		t[i] = ss_get_buffer_r(s);
+		ts[i] = ss_size(s);
+	}
+	p = smsearch_alloc(t, ts, n);
+	s_free(ts);
+	return p;
+}
+
+void ss_mpattern_free_aux(srt_string_mpattern **p, ...)
+{
+	va_list ap;
+	srt_string_mpattern **next;
+	va_start(ap, p);
+	next = p;
+	while (!s_varg_tail_ptr_tag(next)) { /* last element tag */
+		if (next && *next) {
+			smsearch_free(*next);
+			*next = NULL;
+		}
+		next = (srt_string_mpattern **)va_arg(
+			ap, srt_string_mpattern **);
+	}
+	va_end(ap);
+}
+
+size_t ss_find_mp(const srt_string *s, size_t off,
+		  const srt_string_mpattern *p, size_t *id)
+{
+	size_t id0;
+	RETURN_IF(!s || !p, S_NPOS);
+	return smsearch_first(p, ss_get_buffer_r(s), off, ss_size(s),
+			      id ? id : &id0);
+}
+
+static srt_bool ss_mp_all_f(void *ctx, size_t off, size_t id)
+{
+	size_t max;
+	struct SSMpMatch *m;
+	struct SSMpAll *a = (struct SSMpAll *)ctx;
+	if (a->n == a->max) {
+		max = a->max ? a->max * 2 : 64;
+		m = max > S_SIZET_MAX / sizeof(struct SSMpMatch)
+			    ? NULL
+			    : (struct SSMpMatch *)s_realloc(
+				    a->m, max * sizeof(struct SSMpMatch));
+		if (!m) {
+			a->oom = S_TRUE;
+			return S_FALSE;
+		}
+		a->m = m;
+		a->max = max;
+	}
+	if (a->n > 0
+	    && (off < a->m[a->n - 1].off
+		|| (off == a->m[a->n - 1].off && id < a->m[a->n - 1].id)))
+		a->sorted = S_FALSE;
+	a->m[a->n].off = off;
+	a->m[a->n].id = id;
+	a->n++;
+	return S_TRUE;
+}
+
+static int ss_mp_cmp(const void *a, const void *b)
+{
+	const struct SSMpMatch *x = (const struct SSMpMatch *)a,
+			       *y = (const struct SSMpMatch *)b;
+	if (x->off != y->off)
+		return x->off < y->off ? -1 : 1;
+	return x->id < y->id ? -1 : x->id > y->id ? 1 : 0;
+}
+
+/*
+ * Output vector of n elements (reusing the existing one if possible)
+ */
+static void *ss_mp_out(srt_vector **out, enum eSV_Type t, size_t n)
+{
+	srt_vector *o = *out;
+	if (o == (srt_vector *)sd_void)
+		o = NULL;
+	if (o && o->d.sub_type != t) {
+		sv_free(out);
+		o = NULL;
+	}
+	if (o) {
+		sv_reserve(out, n);
+		o = *out;
+	} else {
+		o = sv_alloc_t(t, n);
+		*out = o;
+	}
+	RETURN_IF(!o || o == (srt_vector *)sd_void || sv_max_size(o) < n,
+		  NULL); /* BEHAVIOR: alloc error */
+	sv_set_size(o, n);
+	return sv_get_buffer(o);
+}
+
+size_t ss_find_all_mp(const srt_string *s, size_t off,
+		      const srt_string_mpattern *p, srt_vector **offs,
+		      srt_vector **ids)
+{
+	size_t i;
+	uint64_t *o;
+	uint32_t *d = NULL;
+	struct SSMpAll a;
+	RETURN_IF(!s || !p || !offs, 0);
+	a.m = NULL;
+	a.n = a.max = 0;
+	a.sorted = S_TRUE;
+	a.oom = S_FALSE;
+	smsearch_scan(p, ss_get_buffer_r(s), off, ss_size(s), ss_mp_all_f,
+		      &a);
+	o = (uint64_t *)ss_mp_out(offs, SV_U64, a.n);
+	if (ids)
+		d = (uint32_t *)ss_mp_out(ids, SV_U32, a.n);
+	if (a.oom || !o || (ids && !d)) {
+		if (o)
+			sv_set_size(*offs, 0);
+		if (d)
+			sv_set_size(*ids, 0);
+		s_free(a.m);
+		return 0; /* BEHAVIOR: out of memory */
+	}
+	if (!a.sorted)
+		ssort_gen(a.m, a.n, sizeof(struct SSMpMatch), ss_mp_cmp);
+	for (i = 0; i < a.n; i++) {
+		o[i] = a.m[i].off;
+		if (d)
+			d[i] = (uint32_t)a.m[i].id;
+	}
+	s_free(a.m);
+	return a.n;
+}
+
+static srt_bool ss_mp_mask_f(void *ctx, size_t off, size_t id)
+{
+	struct SSMpMask *k = (struct SSMpMask *)ctx;
+	uint64_t bit = S_NBIT64(id % 64);
+	(void)off;
+	if (!(k->m[id / 64] & bit)) {
+		k->m[id / 64] |= bit;
+		k->n++;
+	}
+	return k->n < k->ntgts ? S_TRUE : S_FALSE; /* all found: stop */
+}
+
+size_t ss_match_mp(const srt_string *s, size_t off,
+		   const srt_string_mpattern *p, srt_vector **mask)
+{
+	size_t words;
+	struct SSMpMask k;
+	RETURN_IF(!s || !p || !mask, 0);
+	k.ntgts = smsearch_n(p);
+	words = (k.ntgts + 63) / 64;
+	k.m = (uint64_t *)ss_mp_out(mask, SV_U64, words);
+	RETURN_IF(!k.m, 0); /* BEHAVIOR: out of memory */
+	memset(k.m, 0, words * sizeof(uint64_t));
+	k.n = 0;
+	smsearch_scan(p, ss_get_buffer_r(s), off, ss_size(s), ss_mp_mask_f,
+		      &k);
+	return k.n;
 }
 
 size_t ss_split(const srt_string *src, const srt_string *separator,
@@ -73,6 +73,8 @@ struct SStringRefRW {
 /* Opaque structures (accessors are provided) */
 typedef struct SString srt_string;
 typedef struct SStringRef srt_string_ref;
+typedef struct SStringPattern srt_string_pattern;
+typedef struct SMSearch srt_string_mpattern;
 
 /*
  * Aux
@@ -765,6 +767,54 @@ size_t ss_findrnb(const srt_string *s, size_t off, size_t max_off);
 /* #API: |Find n bytes|input string; search offset start; max offset (S_NPOS for end of string); target buffer; target buffer size (bytes)|Offset location if found, S_NPOS if not found|O(n)|1;2| */
 size_t ss_findr_cn(const srt_string *s, size_t off, size_t max_off, const char *t, size_t ts);
 
+/* #API: |Precompute a search target, for repeated searches (ss_find_p(), ss_findr_p(), ss_count_p()): the target is copied, so it can be modified or freed afterwards|target string|search pattern (heap); NULL if empty target or out of memory|O(m)|1;2| */
+srt_string_pattern *ss_pattern_compile(const srt_string *tgt);
+
+/*
+#API: |Free one or more search patterns|search pattern; more search patterns (optional)|-|O(1)|1;2|
+void ss_pattern_free(srt_string_pattern **p, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define ss_pattern_free(...)                                                   \
+	ss_pattern_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define ss_pattern_free(p) ss_pattern_free_aux(p, S_INVALID_PTR_VARG_TAIL)
+#endif
+void ss_pattern_free_aux(srt_string_pattern **p, ...);
+
+/* #API: |Find precomputed search target into string (same result as ss_find(), without per-call target processing)|input string; search offset start; search pattern|Offset location if found, S_NPOS if not found|O(n)|1;2| */
+size_t ss_find_p(const srt_string *s, size_t off, const srt_string_pattern *p);
+
+/* #API: |Find precomputed search target into string (in range)|input string; search offset start; max offset (S_NPOS for end of string); search pattern|Offset location if found, S_NPOS if not found|O(n)|1;2| */
+size_t ss_findr_p(const srt_string *s, size_t off, size_t max_off, const srt_string_pattern *p);
+
+/* #API: |Count non-overlapping occurrences of a precomputed search target|input string; search offset start; search pattern|Number of occurrences|O(n)|1;2| */
+size_t ss_count_p(const srt_string *s, size_t off, const srt_string_pattern *p);
+
+/* #API: |Precompute a set of search targets, for multi-pattern search in one pass (ss_find_mp(), ss_find_all_mp(), ss_match_mp()): Teddy SIMD filter for small sets (up to 32 targets, if built with SSSE3, AVX2 or AArch64 NEON), Aho-Corasick DFA otherwise; the targets are copied|target vector (SV_GEN, element: srt_string pointer; target id: vector index)|multi-pattern (heap); NULL if no targets, empty target, non srt_string pointer vector, or out of memory|O(m * k) (m: total target size; k: distinct target bytes)|1;2| */
+srt_string_mpattern *ss_mpattern_compile(const srt_vector *tgts);
+
+/*
+#API: |Free one or more multi-patterns|multi-pattern; more multi-patterns (optional)|-|O(1)|1;2|
+void ss_mpattern_free(srt_string_mpattern **p, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define ss_mpattern_free(...)                                                  \
+	ss_mpattern_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define ss_mpattern_free(p) ss_mpattern_free_aux(p, S_INVALID_PTR_VARG_TAIL)
+#endif
+void ss_mpattern_free_aux(srt_string_mpattern **p, ...);
+
+/* #API: |Find the leftmost occurrence of any of the targets|input string; search offset start; multi-pattern; output target id (lowest id if more than one target matches at that offset; NULL: ignored)|Offset location if found, S_NPOS if not found|O(n)|1;2| */
+size_t ss_find_mp(const srt_string *s, size_t off, const srt_string_mpattern *p, size_t *id);
+
+/* #API: |Locate all occurrences of all the targets (overlapping occurrences included), sorted by offset and target id|input string; search offset start; multi-pattern; output offsets (SV_U64, allocated/reused); output target ids (SV_U32, allocated/reused; NULL: ignored)|Number of occurrences (0 if out of memory)|O(n + k log k) (k: occurrences)|1;2| */
+size_t ss_find_all_mp(const srt_string *s, size_t off, const srt_string_mpattern *p, srt_vector **offs, srt_vector **ids);
+
+/* #API: |Check which targets occur, as a bit mask (e.g. keyword classification)|input string; search offset start; multi-pattern; output bit mask vector (SV_U64, bit i set: target i found, allocated/reused)|Number of different targets found (0 if out of memory)|O(n)|1;2| */
+size_t ss_match_mp(const srt_string *s, size_t off, const srt_string_mpattern *p, srt_vector **mask);
+
 /* #API: |Split/tokenize: break string by separators|input string; separator; output substring references; number of output substrings|Number of elements|O(n)|1;2| */
 size_t ss_split(const srt_string *src, const srt_string *separator, srt_string_ref out_substrings[], size_t max_refs);
 
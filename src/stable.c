@@ -0,0 +1,502 @@
+/*
+ * stable.c
+ *
+ * Columnar table handling.
+ *
+ * Observations:
+ * - Table header and column vector pointers are stored in one allocation.
+ *   The row count is the size of every column (kept equal by all the
+ *   row operations).
+ * - Row operations are all-or-nothing: memory is reserved in all columns
+ *   before writing (append), or a new set of columns is built and then
+ *   swapped (reordering/selection).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "stable.h"
+#include "saux/scommon.h"
+
+/*
+ * Internal data structures
+ */
+
+struct STable {
+	size_t ncols;
+	srt_vector **c;
+};
+
+#define stb_void_col(v) (!(v) || (v) == (srt_vector *)sd_void)
+
+/*
+ * Internal functions
+ */
+
+static srt_table *stb_alloc_cols(size_t ncols)
+{
+	size_t i;
+	srt_table *t;
+	RETURN_IF(!ncols
+			  || ncols > (S_SIZET_MAX - sizeof(srt_table))
+					     / sizeof(srt_vector *),
+		  NULL);
+	t = (srt_table *)s_malloc(sizeof(srt_table)
+				  + ncols * sizeof(srt_vector *));
+	RETURN_IF(!t, NULL);
+	t->ncols = ncols;
+	t->c = (srt_vector **)(t + 1);
+	for (i = 0; i < ncols; i++)
+		t->c[i] = NULL;
+	return t;
+}
+
+static void stb_free_cols(srt_table *t)
+{
+	size_t i;
+	for (i = 0; i < t->ncols; i++)
+		if (!stb_void_col(t->c[i]))
+			sv_free(&t->c[i]);
+	s_free(t);
+}
+
+S_INLINE size_t stb_es(const srt_table *t, size_t col)
+{
+	return t->c[col]->d.elem_size;
+}
+
+S_INLINE char *stb_field(srt_table *t, size_t col, size_t row)
+{
+	return (char *)sv_get_buffer(t->c[col]) + row * stb_es(t, col);
+}
+
+S_INLINE const char *stb_field_r(const srt_table *t, size_t col, size_t row)
+{
+	return (const char *)sv_get_buffer_r(t->c[col])
+	       + row * stb_es(t, col);
+}
+
+S_INLINE void stb_copy_field(void *o, const void *s, size_t es)
+{
+	switch (es) {
+	case 1:
+		*(char *)o = *(const char *)s;
+		break;
+	case 2:
+		memcpy(o, s, 2);
+		break;
+	case 4:
+		memcpy(o, s, 4);
+		break;
+	default:
+		memcpy(o, s, 8);
+		break;
+	}
+}
+
+/*
+ * Ensure room for 'rows' rows in all columns
+ */
+static srt_bool stb_room(srt_table *t, size_t rows)
+{
+	size_t i;
+	for (i = 0; i < t->ncols; i++)
+		if (sv_capacity(t->c[i]) < rows
+		    && sv_reserve(&t->c[i], rows) < rows)
+			return S_FALSE;
+	return S_TRUE;
+}
+
+/*
+ * Copy 'n' fields of 'es' bytes, 'stride' bytes apart (constant size copies,
+ * so the compiler emits a load/store per field instead of a memcpy() call)
+ */
+static void stb_copy_strided(char *o, const char *s, size_t n, size_t stride,
+			     size_t es)
+{
+	size_t i;
+	switch (es) {
+	case 1:
+		for (i = 0; i < n; i++, s += stride)
+			o[i] = *s;
+		break;
+	case 2:
+		for (i = 0; i < n; i++, s += stride)
+			memcpy(o + i * 2, s, 2);
+		break;
+	case 4:
+		for (i = 0; i < n; i++, s += stride)
+			memcpy(o + i * 4, s, 4);
+		break;
+	case 8:
+		for (i = 0; i < n; i++, s += stride)
+			memcpy(o + i * 8, s, 8);
+		break;
+	default:
+		break;
+	}
+}
+
+#define STB_GATHER_PF 8 /* prefetch distance */
+
+#define STB_GATHER_LOOP(ES)                                                    \
+	for (i = 0; i < m; i++) {                                              \
+		if (i + STB_GATHER_PF < m)                                     \
+			S_PREFETCH(s + (ES)*ix[i + STB_GATHER_PF]);            \
+		memcpy(o + i * (ES), s + (ES)*ix[i], ES);                      \
+	}
+
+#define STB_GATHER(TI)                                                         \
+	{                                                                      \
+		const TI *ix = (const TI *)sv_get_buffer_r(rows);              \
+		switch (es) {                                                  \
+		case 1:                                                        \
+			STB_GATHER_LOOP(1);                                    \
+			break;                                                 \
+		case 2:                                                        \
+			STB_GATHER_LOOP(2);                                    \
+			break;                                                 \
+		case 4:                                                        \
+			STB_GATHER_LOOP(4);                                    \
+			break;                                                 \
+		case 8:                                                        \
+			STB_GATHER_LOOP(8);                                    \
+			break;                                                 \
+		default:                                                       \
+			break;                                                 \
+		}                                                              \
+	}
+
+/*
+ * Gather 'm' fields by row index (constant size copies)
+ */
+static void stb_gather_col(char *o, const char *s, size_t es,
+			   const srt_vector *rows, size_t m)
+{
+	size_t i;
+	if (rows->d.sub_type == SV_U32)
+		STB_GATHER(uint32_t)
+	else
+		STB_GATHER(uint64_t)
+}
+
+static srt_bool stb_rows_ok(const srt_vector *rows, size_t n)
+{
+	size_t i, m = sv_size(rows);
+	const uint32_t *i32;
+	const uint64_t *i64;
+	if (rows->d.sub_type == SV_U32) {
+		i32 = (const uint32_t *)sv_get_buffer_r(rows);
+		for (i = 0; i < m && i32[i] < n; i++)
+			;
+	} else {
+		i64 = (const uint64_t *)sv_get_buffer_r(rows);
+		for (i = 0; i < m && i64[i] < n; i++)
+			;
+	}
+	return i == m;
+}
+
+/*
+ * Replace the table columns with the ones from 'o' (freeing 'o')
+ */
+static void stb_swap_cols(srt_table *t, srt_table *o)
+{
+	size_t i;
+	srt_vector *c;
+	for (i = 0; i < t->ncols; i++) {
+		c = t->c[i];
+		t->c[i] = o->c[i];
+		o->c[i] = c;
+	}
+	stb_free_cols(o);
+}
+
+/*
+ * Allocation
+ */
+
+srt_table *stb_alloc(const enum eSV_Type *types, size_t ncols,
+		     size_t init_rows)
+{
+	size_t i;
+	srt_table *t;
+	RETURN_IF(!types, NULL);
+	for (i = 0; i < ncols; i++)
+		RETURN_IF(types[i] > SV_LAST_NUM,
+			  NULL); /* BEHAVIOR: non-supported column type */
+	t = stb_alloc_cols(ncols);
+	RETURN_IF(!t, NULL);
+	for (i = 0; i < ncols; i++) {
+		t->c[i] = sv_alloc_t(types[i], init_rows);
+		if (stb_void_col(t->c[i])) {
+			stb_free_cols(t);
+			return NULL;
+		}
+	}
+	return t;
+}
+
+void stb_free_aux(srt_table **t, ...)
+{
+	va_list ap;
+	srt_table **next;
+	va_start(ap, t);
+	next = t;
+	while (!s_varg_tail_ptr_tag(next)) { /* last element tag */
+		if (next && *next) {
+			stb_free_cols(*next);
+			*next = NULL;
+		}
+		next = (srt_table **)va_arg(ap, srt_table **);
+	}
+	va_end(ap);
+}
+
+srt_table *stb_dup(const srt_table *t)
+{
+	size_t i;
+	srt_table *o;
+	RETURN_IF(!t, NULL);
+	o = stb_alloc_cols(t->ncols);
+	RETURN_IF(!o, NULL);
+	for (i = 0; i < t->ncols; i++) {
+		o->c[i] = sv_dup(t->c[i]);
+		if (stb_void_col(o->c[i])
+		    || sv_size(o->c[i]) != sv_size(t->c[i])) {
+			stb_free_cols(o);
+			return NULL;
+		}
+	}
+	return o;
+}
+
+size_t stb_reserve(srt_table *t, size_t max_rows)
+{
+	size_t i, r, min_r = S_SIZET_MAX;
+	RETURN_IF(!t, 0);
+	for (i = 0; i < t->ncols; i++) {
+		r = sv_reserve(&t->c[i], max_rows);
+		min_r = S_MIN(min_r, r);
+	}
+	return min_r;
+}
+
+void stb_clear(srt_table *t)
+{
+	size_t i;
+	if (t)
+		for (i = 0; i < t->ncols; i++)
+			sv_clear(t->c[i]);
+}
+
+size_t stb_size(const srt_table *t)
+{
+	return t ? sv_size(t->c[0]) : 0;
+}
+
+size_t stb_ncols(const srt_table *t)
+{
+	return t ? t->ncols : 0;
+}
+
+enum eSV_Type stb_col_type(const srt_table *t, size_t col)
+{
+	RETURN_IF(!t || col >= t->ncols, SV_GEN);
+	return (enum eSV_Type)t->c[col]->d.sub_type;
+}
+
+const srt_vector *stb_col(const srt_table *t, size_t col)
+{
+	return t && col < t->ncols ? t->c[col] : NULL;
+}
+
+/*
+ * Rows
+ */
+
+srt_bool stb_push_row(srt_table *t, const void *const *fields)
+{
+	size_t i, n;
+	RETURN_IF(!t || !fields, S_FALSE);
+	n = stb_size(t);
+	RETURN_IF(!stb_room(t, n + 1), S_FALSE); /* BEHAVIOR: out of memory */
+	for (i = 0; i < t->ncols; i++) {
+		stb_copy_field(stb_field(t, i, n), fields[i], stb_es(t, i));
+		sv_set_size(t->c[i], n + 1);
+	}
+	return S_TRUE;
+}
+
+srt_bool stb_push_rec(srt_table *t, const void *rec, const size_t *offs)
+{
+	size_t i, n;
+	RETURN_IF(!t || !rec || !offs, S_FALSE);
+	n = stb_size(t);
+	RETURN_IF(!stb_room(t, n + 1), S_FALSE); /* BEHAVIOR: out of memory */
+	for (i = 0; i < t->ncols; i++) {
+		stb_copy_field(stb_field(t, i, n), (const char *)rec + offs[i],
+			       stb_es(t, i));
+		sv_set_size(t->c[i], n + 1);
+	}
+	return S_TRUE;
+}
+
+srt_bool stb_push_recs(srt_table *t, const srt_vector *recs,
+		       const size_t *offs)
+{
+	const char *r;
+	size_t i, n, m, rs;
+	RETURN_IF(!t || !recs || !offs || recs->d.sub_type != SV_GEN,
+		  S_FALSE);
+	rs = recs->d.elem_size;
+	for (i = 0; i < t->ncols; i++)
+		RETURN_IF(offs[i] > rs || rs - offs[i] < stb_es(t, i),
+			  S_FALSE); /* BEHAVIOR: field out of the record */
+	n = stb_size(t);
+	m = sv_size(recs);
+	RETURN_IF(n + m < n || !stb_room(t, n + m),
+		  S_FALSE); /* BEHAVIOR: out of memory */
+	r = (const char *)sv_get_buffer_r(recs);
+	for (i = 0; i < t->ncols; i++) {
+		stb_copy_strided(stb_field(t, i, n), r + offs[i], m, rs,
+				 stb_es(t, i));
+		sv_set_size(t->c[i], n + m);
+	}
+	return S_TRUE;
+}
+
+srt_bool stb_get_row(const srt_table *t, size_t row, void *const *fields)
+{
+	size_t i;
+	RETURN_IF(!t || !fields || row >= stb_size(t), S_FALSE);
+	for (i = 0; i < t->ncols; i++)
+		if (fields[i])
+			stb_copy_field(fields[i], stb_field_r(t, i, row),
+				       stb_es(t, i));
+	return S_TRUE;
+}
+
+srt_bool stb_get_rec(const srt_table *t, size_t row, void *rec,
+		     const size_t *offs)
+{
+	size_t i;
+	RETURN_IF(!t || !rec || !offs || row >= stb_size(t), S_FALSE);
+	for (i = 0; i < t->ncols; i++)
+		stb_copy_field((char *)rec + offs[i], stb_field_r(t, i, row),
+			       stb_es(t, i));
+	return S_TRUE;
+}
+
+const void *stb_at(const srt_table *t, size_t col, size_t row)
+{
+	RETURN_IF(!t || col >= t->ncols || row >= stb_size(t), NULL);
+	return stb_field_r(t, col, row);
+}
+
+srt_bool stb_set(srt_table *t, size_t col, size_t row, const void *field)
+{
+	RETURN_IF(!t || !field || col >= t->ncols || row >= stb_size(t),
+		  S_FALSE);
+	stb_copy_field(stb_field(t, col, row), field, stb_es(t, col));
+	return S_TRUE;
+}
+
+/*
+ * Row reordering and selection
+ */
+
+srt_table *stb_gather(const srt_table *t, const srt_vector *rows)
+{
+	size_t i, m;
+	srt_table *o;
+	RETURN_IF(!t || !rows, NULL);
+	RETURN_IF(rows->d.sub_type != SV_U32 && rows->d.sub_type != SV_U64,
+		  NULL); /* BEHAVIOR: non-supported index type */
+	RETURN_IF(!stb_rows_ok(rows, stb_size(t)),
+		  NULL); /* BEHAVIOR: out of range index */
+	o = stb_alloc_cols(t->ncols);
+	RETURN_IF(!o, NULL);
+	m = sv_size(rows);
+	for (i = 0; i < o->ncols; i++) {
+		o->c[i] = sv_alloc_t((enum eSV_Type)t->c[i]->d.sub_type, m);
+		if (stb_void_col(o->c[i]) || sv_capacity(o->c[i]) < m) {
+			stb_free_cols(o);
+			return NULL;
+		}
+		stb_gather_col(stb_field(o, i, 0), stb_field_r(t, i, 0),
+			       stb_es(t, i), rows, m);
+		sv_set_size(o->c[i], m);
+	}
+	return o;
+}
+
+srt_bool stb_permute(srt_table *t, const srt_vector *rows)
+{
+	srt_table *o = stb_gather(t, rows);
+	RETURN_IF(!o, S_FALSE);
+	stb_swap_cols(t, o);
+	return S_TRUE;
+}
+
+/*
+ * Multi-key sort as a chain of stable sorts, from the last key to the
+ * first: the key column is gathered in the current row order, and its
+ * stable argsort is composed with the current row index
+ */
+srt_bool stb_sort(srt_table *t, const size_t *cols, size_t nkeys)
+{
+	size_t j;
+	srt_bool ok = S_TRUE;
+	srt_vector *idx = NULL, *k, *a;
+	RETURN_IF(!t || !cols || !nkeys, S_FALSE);
+	for (j = 0; j < nkeys; j++)
+		RETURN_IF(cols[j] >= t->ncols, S_FALSE);
+	for (j = nkeys; j-- > 0 && ok;) {
+		k = idx ? sv_dup(t->c[cols[j]]) : t->c[cols[j]];
+		ok = !stb_void_col(k) && (!idx || sv_permute(&k, idx));
+		a = ok ? sv_argsort(k) : NULL;
+		if (idx && !stb_void_col(k))
+			sv_free(&k);
+		ok = a != NULL;
+		if (ok && idx) {
+			ok = sv_permute(&idx, a);
+			sv_free(&a);
+		} else if (ok) {
+			idx = a;
+		}
+	}
+	ok = ok && stb_permute(t, idx);
+	sv_free(&idx);
+	return ok;
+}
+
+size_t stb_filter(srt_table *t, const srt_vector *mask)
+{
+	uint64_t w;
+	const uint64_t *m;
+	size_t i, j, n, nw, k;
+	srt_vector *idx;
+	RETURN_IF(!t || !mask || mask->d.sub_type != SV_U64, S_NPOS);
+	n = stb_size(t);
+	nw = S_MIN(sv_size(mask), (n + 63) / 64);
+	m = (const uint64_t *)sv_get_buffer_r(mask);
+	idx = sv_alloc_t(n <= UINT32_MAX ? SV_U32 : SV_U64, 0);
+	for (i = k = 0; i < nw; i++)
+		for (w = m[i]; w && k < n; w &= w - 1) {
+			j = i * 64 + slog2_64(w & (~w + 1));
+			if (j >= n)
+				break;
+			if (!stb_void_col(idx) && sv_size(idx) == k) {
+				if (n <= UINT32_MAX)
+					sv_push_u32(&idx, (uint32_t)j);
+				else
+					sv_push_u64(&idx, (uint64_t)j);
+			}
+			k++;
+		}
+	if (stb_void_col(idx) || sv_size(idx) != k || !stb_permute(t, idx))
+		k = S_NPOS; /* BEHAVIOR: out of memory */
+	sv_free(&idx);
+	return k;
+}
@@ -0,0 +1,132 @@
+#ifndef STABLE_H
+#define STABLE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * stable.h
+ *
+ * #SHORTDOC columnar table handling (structure of arrays)
+ *
+ * #DOC Table functions handle multi-field records stored by column: one
+ * #DOC typed srt_vector per field, all having the same number of rows. Scanning
+ * #DOC a field reads only that field's column (instead of whole records, as
+ * #DOC with a SV_GEN vector of structs), so column scans use the
+ * #DOC srt_vector functions directly on the column (stb_col()), e.g.
+ * #DOC sv_sum(), sv_minmax(), sv_count_*() or sv_find_all_*().
+ * #DOC
+ * #DOC Row operations (sort, filter, gather) compute a row index vector
+ * #DOC once, using the column kernels (sv_argsort(), sv_find_all_*() bit
+ * #DOC masks), and then gather every column by that index (same index
+ * #DOC format as sv_permute()).
+ * #DOC
+ * #DOC Records can be appended and extracted either as an array of field
+ * #DOC pointers (one per column), or as a C struct plus the field offsets
+ * #DOC (offsetof()), so existing SV_GEN record vectors can be converted with
+ * #DOC stb_push_recs().
+ * #DOC
+ * #DOC Column types: integer and floating point (SV_I8 to SV_D).
+ *
+ * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
+ * Released under the BSD 3-Clause License (see the doc/LICENSE)
+ */
+
+#include "svector.h"
+
+/*
+ * Structures
+ */
+
+struct STable;
+
+typedef struct STable srt_table;
+
+/*
+ * Allocation
+ */
+
+/* #API: |Allocate table (heap)|column types (SV_I8 to SV_D); number of columns; initial reserve (rows)|table; NULL if out of memory, no columns, or non-supported column type|O(ncols)|1;2| */
+srt_table *stb_alloc(const enum eSV_Type *types, size_t ncols,
+		     size_t init_rows);
+
+/*
+#API: |Free one or more tables (heap)|table; more tables (optional)|-|O(ncols)|1;2|
+void stb_free(srt_table **t, ...)
+*/
+#ifdef S_USE_VA_ARGS
+#define stb_free(...) stb_free_aux(__VA_ARGS__, S_INVALID_PTR_VARG_TAIL)
+#else
+#define stb_free(t) stb_free_aux(t, S_INVALID_PTR_VARG_TAIL)
+#endif
+void stb_free_aux(srt_table **t, ...);
+
+/* #API: |Duplicate table|table|output table; NULL if out of memory|O(n)|1;2| */
+srt_table *stb_dup(const srt_table *t);
+
+/* #API: |Ensure space for extra rows|table; absolute row reserve|reserved rows (in all columns)|O(n) (if resized)|1;2| */
+size_t stb_reserve(srt_table *t, size_t max_rows);
+
+/* #API: |Remove all rows (keeping the reserved space)|table||O(ncols)|1;2| */
+void stb_clear(srt_table *t);
+
+/* #API: |Number of rows|table|rows|O(1)|1;2| */
+size_t stb_size(const srt_table *t);
+
+/* #API: |Number of columns|table|columns|O(1)|1;2| */
+size_t stb_ncols(const srt_table *t);
+
+/* #API: |Column type|table; column|column type (SV_GEN if out of range)|O(1)|1;2| */
+enum eSV_Type stb_col_type(const srt_table *t, size_t col);
+
+/* #API: |Column vector, for read-only scans with srt_vector functions (e.g. sv_sum(), sv_minmax(), sv_find_all_*()); it must not be resized, as the row count is shared by all the columns|table; column|column vector (NULL if out of range)|O(1)|1;2| */
+const srt_vector *stb_col(const srt_table *t, size_t col);
+
+/*
+ * Rows
+ */
+
+/* #API: |Append row, given one field pointer per column (field type: column type)|table; field pointers|S_TRUE: OK; S_FALSE: out of memory (table not modified)|O(ncols)|1;2| */
+srt_bool stb_push_row(srt_table *t, const void *const *fields);
+
+/* #API: |Append row from a record (C struct)|table; record; field offset per column (e.g. offsetof())|S_TRUE: OK; S_FALSE: out of memory (table not modified)|O(ncols)|1;2| */
+srt_bool stb_push_rec(srt_table *t, const void *rec, const size_t *offs);
+
+/* #API: |Append all records from a SV_GEN vector of records (C structs), converting them to columns|table; record vector; field offset per column|S_TRUE: OK; S_FALSE: out of memory, non SV_GEN vector, or field out of the record (table not modified)|O(n)|1;2| */
+srt_bool stb_push_recs(srt_table *t, const srt_vector *recs,
+		       const size_t *offs);
+
+/* #API: |Get row, writing one field per column|table; row; field output pointers (NULL: field skipped)|S_TRUE: OK; S_FALSE: row out of range|O(ncols)|1;2| */
+srt_bool stb_get_row(const srt_table *t, size_t row, void *const *fields);
+
+/* #API: |Get row as a record (C struct)|table; row; output record; field offset per column|S_TRUE: OK; S_FALSE: row out of range|O(ncols)|1;2| */
+srt_bool stb_get_rec(const srt_table *t, size_t row, void *rec,
+		     const size_t *offs);
+
+/* #API: |Field access|table; column; row|field pointer (type: column type); NULL if out of range|O(1)|1;2| */
+const void *stb_at(const srt_table *t, size_t col, size_t row);
+
+/* #API: |Set field|table; column; row; field value pointer (type: column type)|S_TRUE: OK; S_FALSE: out of range|O(1)|1;2| */
+srt_bool stb_set(srt_table *t, size_t col, size_t row, const void *field);
+
+/*
+ * Row reordering and selection
+ */
+
+/* #API: |Gather rows by row index into a new table: output row i = input row rows[i]|table; row index vector (SV_U32/SV_U64, e.g. from sv_argsort())|output table; NULL if out of memory or out of range index|O(n)|1;2| */
+srt_table *stb_gather(const srt_table *t, const srt_vector *rows);
+
+/* #API: |Reorder rows by row index (in-place gather, rows not referenced are removed)|table; row index vector (SV_U32/SV_U64)|S_TRUE: OK; S_FALSE: out of memory or out of range index (table not modified)|O(n)|1;2| */
+srt_bool stb_permute(srt_table *t, const srt_vector *rows);
+
+/* #API: |Sort rows by one or more key columns (stable; same order as sv_sort() for every key)|table; key columns (first: primary key); number of key columns|S_TRUE: OK; S_FALSE: out of memory or column out of range (table not modified)|O(n * nkeys) (radix sort)|1;2| */
+srt_bool stb_sort(srt_table *t, const size_t *cols, size_t nkeys);
+
+/* #API: |Keep only the rows selected in a bit mask (e.g. from sv_find_all_*() on a column), in the same order|table; bit mask (SV_U64, bit i: row i)|number of rows kept; S_NPOS: out of memory (table not modified)|O(n)|1;2| */
+size_t stb_filter(srt_table *t, const srt_vector *mask);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* STABLE_H */
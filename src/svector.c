@@ -9,7 +9,10 @@
 
 #include "svector.h"
 #include "saux/scommon.h"
+#include "saux/sfind.h"
 #include "saux/ssort.h"
+#include "saux/svops.h"
+#include "saux/svpack.h"
 
 #ifndef SV_DEFAULT_SIGNED_VAL
 #define SV_DEFAULT_SIGNED_VAL 0
@@ -31,20 +34,33 @@
 #ifndef S_MINIMAL
 struct SVecCtx {
 	ssort_f sortf;
+	ssort_par_f psortf;
+	ssort_sel_f self;
+	ssort_top_k_f topkf;
 };
 
 struct SVecCtx vec_ctx[SV_NumTypes] = {
-	{(ssort_f)ssort_i8},  /*SV_I8*/
-	{(ssort_f)ssort_u8},  /*SV_U8*/
-	{(ssort_f)ssort_i16}, /*SV_I16*/
-	{(ssort_f)ssort_u16}, /*SV_U16*/
-	{(ssort_f)ssort_i32}, /*SV_I32*/
-	{(ssort_f)ssort_u32}, /*SV_U32*/
-	{(ssort_f)ssort_i64}, /*SV_I64*/
-	{(ssort_f)ssort_u64}, /*SV_U64*/
-	{NULL},		      /*SV_F*/
-	{NULL},		      /*SV_D*/
-	{NULL}		      /*SV_GEN*/
+	{(ssort_f)ssort_i8, NULL, /*SV_I8*/
+	 (ssort_sel_f)ssort_select_i8, (ssort_top_k_f)ssort_top_k_i8},
+	{(ssort_f)ssort_u8, NULL, /*SV_U8*/
+	 (ssort_sel_f)ssort_select_u8, (ssort_top_k_f)ssort_top_k_u8},
+	{(ssort_f)ssort_i16, (ssort_par_f)ssort_par_i16, /*SV_I16*/
+	 (ssort_sel_f)ssort_select_i16, (ssort_top_k_f)ssort_top_k_i16},
+	{(ssort_f)ssort_u16, (ssort_par_f)ssort_par_u16, /*SV_U16*/
+	 (ssort_sel_f)ssort_select_u16, (ssort_top_k_f)ssort_top_k_u16},
+	{(ssort_f)ssort_i32, (ssort_par_f)ssort_par_i32, /*SV_I32*/
+	 (ssort_sel_f)ssort_select_i32, (ssort_top_k_f)ssort_top_k_i32},
+	{(ssort_f)ssort_u32, (ssort_par_f)ssort_par_u32, /*SV_U32*/
+	 (ssort_sel_f)ssort_select_u32, (ssort_top_k_f)ssort_top_k_u32},
+	{(ssort_f)ssort_i64, (ssort_par_f)ssort_par_i64, /*SV_I64*/
+	 (ssort_sel_f)ssort_select_i64, (ssort_top_k_f)ssort_top_k_i64},
+	{(ssort_f)ssort_u64, (ssort_par_f)ssort_par_u64, /*SV_U64*/
+	 (ssort_sel_f)ssort_select_u64, (ssort_top_k_f)ssort_top_k_u64},
+	{(ssort_f)ssort_f32, (ssort_par_f)ssort_par_f32, /*SV_F*/
+	 (ssort_sel_f)ssort_select_f32, (ssort_top_k_f)ssort_top_k_f32},
+	{(ssort_f)ssort_f64, (ssort_par_f)ssort_par_f64, /*SV_D*/
+	 (ssort_sel_f)ssort_select_f64, (ssort_top_k_f)ssort_top_k_f64},
+	{NULL, NULL, NULL, NULL} /*SV_GEN*/
 };
 #endif
 
@@ -85,6 +101,51 @@ BUILD_CMP(__sv_cmp_u64, uint64_t)
 BUILD_CMP(__sv_cmp_f, float)
 BUILD_CMP(__sv_cmp_d, double)
 
+/*
+ * Ordered floating point keys (IEEE-754 key flip, same total order as
+ * sv_sort(): -NaN, -Inf, ..., -0, 0, ..., Inf, NaN)
+ */
+S_INLINE uint64_t sv_arg_key_f(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return (uint32_t)(u & 0x80000000 ? ~u : u | 0x80000000);
+}
+
+S_INLINE uint64_t sv_arg_key_d(double d)
+{
+	uint64_t u, s = (uint64_t)1 << 63;
+	memcpy(&u, &d, sizeof(u));
+	return u & s ? ~u : u | s;
+}
+
+/*
+ * Compare function for the comparison sorts: floating point values use the
+ * ordered keys, so the result is the same as the radix sort one (minimal
+ * build)
+ */
+#define BUILD_CMP_KEY(FN, T, KEYF)                                             \
+	static int FN(const void *a, const void *b)                            \
+	{                                                                      \
+		T a2, b2;                                                      \
+		uint64_t ka, kb;                                               \
+		memcpy(&a2, a, sizeof(T));                                     \
+		memcpy(&b2, b, sizeof(T));                                     \
+		ka = KEYF(a2);                                                 \
+		kb = KEYF(b2);                                                 \
+		return ka < kb ? -1 : ka > kb ? 1 : 0;                         \
+	}
+
+BUILD_CMP_KEY(__sv_cmp_key_f, float, sv_arg_key_f)
+BUILD_CMP_KEY(__sv_cmp_key_d, double, sv_arg_key_d)
+
+static srt_vector_cmp sv_sort_cmpf(const srt_vector *v)
+{
+	return v->d.sub_type == SV_F   ? __sv_cmp_key_f
+	       : v->d.sub_type == SV_D ? __sv_cmp_key_d
+				       : v->vx.cmpf;
+}
+
 static uint8_t svt_sizes[SV_LAST_NUM + 1] = {
 	sizeof(int8_t),  sizeof(uint8_t),  sizeof(int16_t), sizeof(uint16_t),
 	sizeof(int32_t), sizeof(uint32_t), sizeof(int64_t), sizeof(uint64_t),
@@ -431,37 +492,354 @@ srt_vector *sv_sort(srt_vector *v)
 	buf_size = sv_size(v);
 	elem_size = v->d.elem_size;
 #ifndef S_MINIMAL
-	if (v->d.sub_type <= SV_U64)
+	if (vec_ctx[v->d.sub_type].sortf)
 		vec_ctx[v->d.sub_type].sortf(buf, buf_size);
 	else
-		qsort(buf, buf_size, elem_size, v->vx.cmpf);
+		ssort_gen(buf, buf_size, elem_size, v->vx.cmpf);
+#else
+	ssort_gen(buf, buf_size, elem_size, sv_sort_cmpf(v));
+#endif
+	return v;
+}
+
+srt_vector *sv_sort_key(srt_vector *v, srt_vector_key keyf)
+{
+	RETURN_IF(!v || !keyf, sv_check(v ? &v : NULL));
+	ssort_gen_key((void *)sv_get_buffer(v), sv_size(v), v->d.elem_size,
+		      keyf);
+	return v;
+}
+
+srt_vector *sv_sort_stable(srt_vector *v)
+{
+	RETURN_IF(!v || !v->vx.cmpf, sv_check(v ? &v : NULL));
+#ifndef S_MINIMAL
+	/*
+	 * Numeric types: equal elements are bit-identical (total order for
+	 * floating point), so the radix sort result is the stable one
+	 */
+	if (vec_ctx[v->d.sub_type].sortf)
+		return sv_sort(v);
+#endif
+	ssort_gen_stable((void *)sv_get_buffer(v), sv_size(v), v->d.elem_size,
+			 sv_sort_cmpf(v));
+	return v;
+}
+
+#ifndef S_MINIMAL
+#define SV_ARG_KEYS(T, KEXPR)                                                  \
+	{                                                                      \
+		const T *b = (const T *)sv_get_buffer_r(v);                    \
+		for (i = 0; i < n; i++)                                        \
+			k[i] = (KEXPR);                                        \
+	}
+
+/*
+ * Ordered 64-bit keys (signed: sign bit flipped, floating point: see
+ * sv_arg_key_f/d())
+ */
+
+static void sv_arg_keys(const srt_vector *v, uint64_t *k)
+{
+	size_t i, n = sv_size(v);
+	uint64_t s64 = (uint64_t)1 << 63;
+	switch (v->d.sub_type) {
+	case SV_I8:
+		SV_ARG_KEYS(int8_t, (uint64_t)(int64_t)b[i] ^ s64);
+		break;
+	case SV_U8:
+		SV_ARG_KEYS(uint8_t, b[i]);
+		break;
+	case SV_I16:
+		SV_ARG_KEYS(int16_t, (uint64_t)(int64_t)b[i] ^ s64);
+		break;
+	case SV_U16:
+		SV_ARG_KEYS(uint16_t, b[i]);
+		break;
+	case SV_I32:
+		SV_ARG_KEYS(int32_t, (uint64_t)(int64_t)b[i] ^ s64);
+		break;
+	case SV_U32:
+		SV_ARG_KEYS(uint32_t, b[i]);
+		break;
+	case SV_I64:
+		SV_ARG_KEYS(int64_t, (uint64_t)b[i] ^ s64);
+		break;
+	case SV_U64:
+		SV_ARG_KEYS(uint64_t, b[i]);
+		break;
+	case SV_F:
+		SV_ARG_KEYS(float, sv_arg_key_f(b[i]));
+		break;
+	case SV_D:
+		SV_ARG_KEYS(double, sv_arg_key_d(b[i]));
+		break;
+	default:
+		break;
+	}
+}
+#endif
+
+srt_vector *sv_argsort(const srt_vector *v)
+{
+	void *idx_buf;
+	srt_bool r, i32;
+	srt_vector *idx;
+	size_t n;
+#ifndef S_MINIMAL
+	uint64_t *k = NULL;
+#endif
+	RETURN_IF(!v || !v->vx.cmpf, NULL);
+	n = sv_size(v);
+	i32 = n <= 0xffffffff ? S_TRUE : S_FALSE;
+	idx = sv_alloc_t(i32 ? SV_U32 : SV_U64, n);
+	RETURN_IF(!idx || idx == sv_void, NULL); /* BEHAVIOR: alloc error */
+	if (sv_max_size(idx) < n) {
+		sv_free(&idx);
+		return NULL;
+	}
+	sv_set_size(idx, n);
+	idx_buf = (void *)sv_get_buffer(idx);
+#ifndef S_MINIMAL
+	if (v->d.sub_type <= SV_LAST_NUM) {
+		k = (uint64_t *)s_malloc(sizeof(uint64_t) * (n ? n : 1));
+		if (k) {
+			sv_arg_keys(v, k);
+			r = i32 ? ssort_arg_radix32(k, n, (uint32_t *)idx_buf)
+				: ssort_arg_radix64(k, n, (uint64_t *)idx_buf);
+			s_free(k);
+		} else {
+			r = S_FALSE;
+		}
+	} else
+#endif
+		r = i32 ? ssort_arg_gen32(sv_get_buffer_r(v), n,
+					  v->d.elem_size, v->vx.cmpf,
+					  (uint32_t *)idx_buf)
+			: ssort_arg_gen64(sv_get_buffer_r(v), n,
+					  v->d.elem_size, v->vx.cmpf,
+					  (uint64_t *)idx_buf);
+	if (!r)
+		sv_free(&idx);
+	return idx;
+}
+
+#define SV_PERMUTE_PF 8 /* prefetch distance */
+
+#define SV_PERMUTE_GATHER(TI)                                                  \
+	{                                                                      \
+		const TI *ix = (const TI *)sv_get_buffer_r(idx);               \
+		for (i = 0; i < m && ix[i] < n; i++) {                         \
+			if (i + SV_PERMUTE_PF < m)                             \
+				S_PREFETCH(src + es * ix[i + SV_PERMUTE_PF]);  \
+			memcpy(tmp + i * es, src + es * ix[i], es);            \
+		}                                                              \
+	}
+
+srt_bool sv_permute(srt_vector **v, const srt_vector *idx)
+{
+	char *tmp;
+	const char *src;
+	size_t i, n, m, es;
+	RETURN_IF(!v || !*v || !idx, S_FALSE);
+	RETURN_IF(idx->d.sub_type != SV_U32 && idx->d.sub_type != SV_U64,
+		  S_FALSE); /* BEHAVIOR: non-supported index type */
+	n = sv_size(*v);
+	m = sv_size(idx);
+	es = (*v)->d.elem_size;
+	RETURN_IF(m > S_SIZET_MAX / es, S_FALSE);
+	tmp = (char *)s_malloc(m * es + 1);
+	RETURN_IF(!tmp, S_FALSE);
+	src = (const char *)sv_get_buffer_r(*v);
+	if (idx->d.sub_type == SV_U32)
+		SV_PERMUTE_GATHER(uint32_t)
+	else
+		SV_PERMUTE_GATHER(uint64_t)
+	if (i < m /* BEHAVIOR: out of range index */
+	    || sv_reserve(v, m) < m) {
+		s_free(tmp);
+		return S_FALSE;
+	}
+	memcpy(sv_get_buffer(*v), tmp, m * es);
+	sv_set_size(*v, m);
+	s_free(tmp);
+	return S_TRUE;
+}
+
+srt_vector *sv_sort_parallel(srt_vector *v, size_t nthreads)
+{
+#if !defined(S_MINIMAL) && defined(S_PTHREADS)
+	void *buf;
+	size_t buf_size;
+	const struct SVecCtx *c;
+	RETURN_IF(!v || !v->vx.cmpf, sv_check(v ? &v : NULL));
+	buf = (void *)sv_get_buffer(v);
+	buf_size = sv_size(v);
+	c = &vec_ctx[v->d.sub_type];
+	if (c->psortf)
+		c->psortf(buf, buf_size, nthreads);
+	else if (c->sortf) /* 8-bit: counting sort */
+		c->sortf(buf, buf_size);
+	else
+		ssort_par_gen(buf, buf_size, v->d.elem_size, v->vx.cmpf,
+			      nthreads);
+	return v;
 #else
-	qsort(buf, buf_size, elem_size, v->vx.cmpf);
+	(void)nthreads; /* BEHAVIOR: no threads, same as sv_sort() */
+	return sv_sort(v);
+#endif
+}
+
+/*
+ * Selection
+ */
+
+srt_vector *sv_nth_element(srt_vector *v, size_t k)
+{
+	void *buf;
+	RETURN_IF(!v || !v->vx.cmpf, sv_check(v ? &v : NULL));
+	buf = (void *)sv_get_buffer(v);
+#ifndef S_MINIMAL
+	if (vec_ctx[v->d.sub_type].self) {
+		vec_ctx[v->d.sub_type].self(buf, sv_size(v), k);
+		return v;
+	}
+#endif
+	ssort_select_gen(buf, sv_size(v), v->d.elem_size, sv_sort_cmpf(v), k);
+	return v;
+}
+
+srt_vector *sv_partial_sort(srt_vector *v, size_t k)
+{
+	void *buf;
+	RETURN_IF(!v || !v->vx.cmpf, sv_check(v ? &v : NULL));
+	if (k >= sv_size(v))
+		return sv_sort(v);
+	sv_nth_element(v, k);
+	buf = (void *)sv_get_buffer(v);
+#ifndef S_MINIMAL
+	if (vec_ctx[v->d.sub_type].sortf) {
+		vec_ctx[v->d.sub_type].sortf(buf, k);
+		return v;
+	}
 #endif
+	ssort_gen(buf, k, v->d.elem_size, sv_sort_cmpf(v));
 	return v;
 }
 
+srt_vector *sv_top_k(srt_vector **out, const srt_vector *v, size_t k)
+{
+	srt_vector *tmp = NULL, **o = out;
+	size_t n, m, r;
+	RETURN_IF(!out || !v || !v->vx.cmpf, sv_check(out));
+	n = sv_size(v);
+	m = k <= n / 2 ? 2 * k : n; /* streaming buffer size */
+	if (*out == v)
+		o = &tmp; /* aliasing: output to a temporary vector */
+	else if (*out && *out != sv_void
+		 && ((*out)->d.sub_type != v->d.sub_type
+		     || (*out)->d.elem_size != v->d.elem_size))
+		sv_free(out);
+	RETURN_IF(aux_reserve(o, v, m) < m || *o == sv_void,
+		  sv_check(out)); /* BEHAVIOR: alloc error */
+#ifndef S_MINIMAL
+	if (vec_ctx[v->d.sub_type].topkf)
+		r = vec_ctx[v->d.sub_type].topkf(sv_get_buffer_r(v), n, k,
+						 sv_get_buffer(*o));
+	else
+#endif
+		r = ssort_top_k_gen(sv_get_buffer_r(v), n, v->d.elem_size,
+				    sv_sort_cmpf(v), k, sv_get_buffer(*o));
+	sv_set_size(*o, r);
+	if (o == &tmp) {
+		sv_cpy(out, tmp);
+		sv_free(&tmp);
+	}
+	return sv_check(out);
+}
+
 /*
  * Search
  */
 
+S_INLINE srt_bool sv_find_chk(const srt_vector *v, size_t tgt_size)
+{
+	RETURN_IF(!v || v->d.sub_type > SV_GEN || !v->d.elem_size, S_FALSE);
+	return !tgt_size || v->d.elem_size == tgt_size ? S_TRUE : S_FALSE;
+}
+
 static size_t sv_find_aux(const srt_vector *v, size_t off, const void *tgt,
 			  size_t tgt_size)
 {
-	size_t pos, size, elem_size, off_max, i;
-	const void *p;
-	RETURN_IF(!v || v->d.sub_type > SV_GEN, S_NPOS);
-	pos = S_NPOS;
+	size_t size, pos;
+	RETURN_IF(!sv_find_chk(v, tgt_size), S_NPOS);
 	size = sv_size(v);
-	p = sv_get_buffer_r(v);
-	elem_size = v->d.elem_size;
-	RETURN_IF(!elem_size || (tgt_size && elem_size != tgt_size), S_NPOS);
-	off_max = size * v->d.elem_size;
-	i = off * elem_size;
-	for (; i < off_max; i += elem_size)
-		if (!memcmp((const char *)p + i, tgt, elem_size))
-			return i / elem_size; /* found */
-	return pos;
+	RETURN_IF(off >= size, S_NPOS);
+	pos = sfind_first((const char *)sv_get_buffer_r(v)
+				  + off * v->d.elem_size,
+			  size - off, tgt, v->d.elem_size);
+	return pos != S_NPOS ? pos + off : S_NPOS;
+}
+
+static size_t sv_count_aux(const srt_vector *v, size_t off, const void *tgt,
+			   size_t tgt_size)
+{
+	size_t size;
+	RETURN_IF(!sv_find_chk(v, tgt_size), 0);
+	size = sv_size(v);
+	RETURN_IF(off >= size, 0);
+	return sfind_count((const char *)sv_get_buffer_r(v)
+				   + off * v->d.elem_size,
+			   size - off, tgt, v->d.elem_size);
+}
+
+/*
+ * Output vector of n elements (reusing the existing one if possible)
+ */
+static void *sv_out_t(srt_vector **out, enum eSV_Type t, size_t n)
+{
+	srt_vector *o = *out;
+	if (o == sv_void)
+		o = NULL;
+	if (o && o->d.sub_type != t) {
+		sv_free(out);
+		o = NULL;
+	}
+	if (o) {
+		sv_reserve(out, n);
+		o = *out;
+	} else {
+		o = sv_alloc_t(t, n);
+		*out = o;
+	}
+	RETURN_IF(!o || o == sv_void || sv_max_size(o) < n,
+		  NULL); /* BEHAVIOR: alloc error */
+	sv_set_size(o, n);
+	return sv_get_buffer(o);
+}
+
+static uint64_t *sv_out_u64(srt_vector **out, size_t n)
+{
+	return (uint64_t *)sv_out_t(out, SV_U64, n);
+}
+
+static size_t sv_find_all_aux(const srt_vector *v, size_t off,
+			      const void *tgt, size_t tgt_size,
+			      srt_vector **mask)
+{
+	uint64_t *m;
+	size_t size, words;
+	RETURN_IF(!sv_find_chk(v, tgt_size) || !mask, 0);
+	size = sv_size(v);
+	words = (size + 63) / 64;
+	m = sv_out_u64(mask, words);
+	RETURN_IF(!m, 0);
+	if (words)
+		memset(m, 0, words * sizeof(uint64_t));
+	RETURN_IF(off >= size, 0);
+	return sfind_mask((const char *)sv_get_buffer_r(v)
+				  + off * v->d.elem_size,
+			  size - off, tgt, v->d.elem_size, m, off);
 }
 
 size_t sv_find(const srt_vector *v, size_t off, const void *target)
@@ -469,23 +847,1075 @@ size_t sv_find(const srt_vector *v, size_t off, const void *target)
 	return sv_find_aux(v, off, target, 0);
 }
 
-#define SV_BUILD_FIND(FN, T)                                                   \
+size_t sv_count(const srt_vector *v, size_t off, const void *target)
+{
+	return sv_count_aux(v, off, target, 0);
+}
+
+size_t sv_find_all(const srt_vector *v, size_t off, const void *target,
+		   srt_vector **mask)
+{
+	return sv_find_all_aux(v, off, target, 0, mask);
+}
+
+#define SV_BUILD_FIND(FN, FC, FA, T)                                           \
 	size_t FN(const srt_vector *v, size_t off, T target)                   \
 	{                                                                      \
 		return sv_find_aux(v, off, (const void *)&target,              \
 				   sizeof(target));                            \
+	}                                                                      \
+	size_t FC(const srt_vector *v, size_t off, T target)                   \
+	{                                                                      \
+		return sv_count_aux(v, off, (const void *)&target,             \
+				    sizeof(target));                           \
+	}                                                                      \
+	size_t FA(const srt_vector *v, size_t off, T target,                   \
+		  srt_vector **mask)                                           \
+	{                                                                      \
+		return sv_find_all_aux(v, off, (const void *)&target,          \
+				       sizeof(target), mask);                  \
+	}
+
+SV_BUILD_FIND(sv_find_i8, sv_count_i8, sv_find_all_i8, int8_t)
+SV_BUILD_FIND(sv_find_u8, sv_count_u8, sv_find_all_u8, uint8_t)
+SV_BUILD_FIND(sv_find_i16, sv_count_i16, sv_find_all_i16, int16_t)
+SV_BUILD_FIND(sv_find_u16, sv_count_u16, sv_find_all_u16, uint16_t)
+SV_BUILD_FIND(sv_find_i32, sv_count_i32, sv_find_all_i32, int32_t)
+SV_BUILD_FIND(sv_find_u32, sv_count_u32, sv_find_all_u32, uint32_t)
+SV_BUILD_FIND(sv_find_i64, sv_count_i64, sv_find_all_i64, int64_t)
+SV_BUILD_FIND(sv_find_u64, sv_count_u64, sv_find_all_u64, uint64_t)
+SV_BUILD_FIND(sv_find_f, sv_count_f, sv_find_all_f, float)
+SV_BUILD_FIND(sv_find_d, sv_count_d, sv_find_all_d, double)
+
+/*
+ * Sorted vector search
+ */
+
+#define SV_BUILD_SORTED_K(LB, UB, GAL, LU, T, TK, KEY)                         \
+	static size_t LB(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		const T *base = b;                                             \
+		size_t half;                                                   \
+		TK tk = KEY(t);                                                \
+		RETURN_IF(!n, 0);                                              \
+		for (; n > 1; n -= half) {                                     \
+			half = n / 2;                                          \
+			S_PREFETCH(base + half / 2);                           \
+			S_PREFETCH(base + half + half / 2);                    \
+			base = KEY(base[half]) < tk ? base + half : base;      \
+		}                                                              \
+		return (size_t)(base - b) + (KEY(*base) < tk ? 1 : 0);         \
+	}                                                                      \
+	static size_t UB(const T *b, size_t n, T t)                            \
+	{                                                                      \
+		const T *base = b;                                             \
+		size_t half;                                                   \
+		TK tk = KEY(t);                                                \
+		RETURN_IF(!n, 0);                                              \
+		for (; n > 1; n -= half) {                                     \
+			half = n / 2;                                          \
+			S_PREFETCH(base + half / 2);                           \
+			S_PREFETCH(base + half + half / 2);                    \
+			base = KEY(base[half]) <= tk ? base + half : base;     \
+		}                                                              \
+		return (size_t)(base - b) + (KEY(*base) <= tk ? 1 : 0);        \
+	}                                                                      \
+	static size_t GAL(const T *b, size_t n, size_t off, T t)               \
+	{                                                                      \
+		size_t lo = off, step = 1;                                     \
+		TK tk = KEY(t);                                                \
+		RETURN_IF(off >= n || !(KEY(b[off]) < tk), off);               \
+		for (; step < n - lo && KEY(b[lo + step]) < tk; step *= 2)     \
+			lo += step;                                            \
+		step = S_MIN(step, n - lo);                                    \
+		return lo + 1 + LB(b + lo + 1, step - 1, t);                   \
+	}                                                                      \
+	static size_t LU(const void *vb, size_t n, const void *vq, size_t nq,  \
+			 uint64_t *o)                                          \
+	{                                                                      \
+		const T *b = (const T *)vb, *q = (const T *)vq;                \
+		size_t i, p = 0, c = 0;                                        \
+		for (i = 0; i < nq; i++) {                                     \
+			if (i > 0 && KEY(q[i]) < KEY(q[i - 1]))                \
+				p = 0; /* non-sorted queries: restart */       \
+			p = GAL(b, n, p, q[i]);                                \
+			if (p < n && KEY(b[p]) == KEY(q[i])) {                 \
+				o[i] = p;                                      \
+				c++;                                           \
+			} else {                                               \
+				o[i] = (uint64_t)S_NPOS;                       \
+			}                                                      \
+		}                                                              \
+		return c;                                                      \
+	}
+
+/*
+ * Integers are compared directly, floating point values through the
+ * ordered keys, so the search follows the sv_sort() total order (e.g.
+ * NaN values are located, at the vector end)
+ */
+
+SV_BUILD_SORTED_K(sv_lb_i8, sv_ub_i8, sv_gal_i8, sv_lu_i8, int8_t, int8_t,
+		  SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_u8, sv_ub_u8, sv_gal_u8, sv_lu_u8, uint8_t, uint8_t,
+		  SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_i16, sv_ub_i16, sv_gal_i16, sv_lu_i16, int16_t,
+		  int16_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_u16, sv_ub_u16, sv_gal_u16, sv_lu_u16, uint16_t,
+		  uint16_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_i32, sv_ub_i32, sv_gal_i32, sv_lu_i32, int32_t,
+		  int32_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_u32, sv_ub_u32, sv_gal_u32, sv_lu_u32, uint32_t,
+		  uint32_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_i64, sv_ub_i64, sv_gal_i64, sv_lu_i64, int64_t,
+		  int64_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_u64, sv_ub_u64, sv_gal_u64, sv_lu_u64, uint64_t,
+		  uint64_t, SFIND_KEY_ID)
+SV_BUILD_SORTED_K(sv_lb_f, sv_ub_f, sv_gal_f, sv_lu_f, float, uint64_t,
+		  sv_arg_key_f)
+SV_BUILD_SORTED_K(sv_lb_d, sv_ub_d, sv_gal_d, sv_lu_d, double, uint64_t,
+		  sv_arg_key_d)
+
+#define SV_BUILD_SORTED(FLB, FUB, FBS, FGAL, LB, UB, GAL, T, SVT, KEY)         \
+	size_t FLB(const srt_vector *v, T target)                              \
+	{                                                                      \
+		size_t n = sv_size(v), r;                                      \
+		RETURN_IF(!v || v->d.sub_type != SVT, S_NPOS);                 \
+		r = LB((const T *)sv_get_buffer_r(v), n, target);              \
+		return r < n ? r : S_NPOS;                                     \
+	}                                                                      \
+	size_t FUB(const srt_vector *v, T target)                              \
+	{                                                                      \
+		size_t n = sv_size(v), r;                                      \
+		RETURN_IF(!v || v->d.sub_type != SVT, S_NPOS);                 \
+		r = UB((const T *)sv_get_buffer_r(v), n, target);              \
+		return r < n ? r : S_NPOS;                                     \
+	}                                                                      \
+	size_t FBS(const srt_vector *v, T target)                              \
+	{                                                                      \
+		const T *b;                                                    \
+		size_t n = sv_size(v), r;                                      \
+		RETURN_IF(!v || v->d.sub_type != SVT, S_NPOS);                 \
+		b = (const T *)sv_get_buffer_r(v);                             \
+		r = LB(b, n, target);                                          \
+		return r < n && KEY(b[r]) == KEY(target) ? r : S_NPOS;         \
+	}                                                                      \
+	size_t FGAL(const srt_vector *v, size_t off, T target)                 \
+	{                                                                      \
+		size_t n = sv_size(v), r;                                      \
+		RETURN_IF(!v || v->d.sub_type != SVT, S_NPOS);                 \
+		r = GAL((const T *)sv_get_buffer_r(v), n, off, target);        \
+		return r < n ? r : S_NPOS;                                     \
+	}
+
+SV_BUILD_SORTED(sv_lower_bound_i8, sv_upper_bound_i8, sv_bsearch_i8,
+		sv_gallop_i8, sv_lb_i8, sv_ub_i8, sv_gal_i8, int8_t, SV_I8,
+		SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_u8, sv_upper_bound_u8, sv_bsearch_u8,
+		sv_gallop_u8, sv_lb_u8, sv_ub_u8, sv_gal_u8, uint8_t, SV_U8,
+		SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_i16, sv_upper_bound_i16, sv_bsearch_i16,
+		sv_gallop_i16, sv_lb_i16, sv_ub_i16, sv_gal_i16, int16_t,
+		SV_I16, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_u16, sv_upper_bound_u16, sv_bsearch_u16,
+		sv_gallop_u16, sv_lb_u16, sv_ub_u16, sv_gal_u16, uint16_t,
+		SV_U16, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_i32, sv_upper_bound_i32, sv_bsearch_i32,
+		sv_gallop_i32, sv_lb_i32, sv_ub_i32, sv_gal_i32, int32_t,
+		SV_I32, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_u32, sv_upper_bound_u32, sv_bsearch_u32,
+		sv_gallop_u32, sv_lb_u32, sv_ub_u32, sv_gal_u32, uint32_t,
+		SV_U32, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_i64, sv_upper_bound_i64, sv_bsearch_i64,
+		sv_gallop_i64, sv_lb_i64, sv_ub_i64, sv_gal_i64, int64_t,
+		SV_I64, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_u64, sv_upper_bound_u64, sv_bsearch_u64,
+		sv_gallop_u64, sv_lb_u64, sv_ub_u64, sv_gal_u64, uint64_t,
+		SV_U64, SFIND_KEY_ID)
+SV_BUILD_SORTED(sv_lower_bound_f, sv_upper_bound_f, sv_bsearch_f, sv_gallop_f,
+		sv_lb_f, sv_ub_f, sv_gal_f, float, SV_F, sv_arg_key_f)
+SV_BUILD_SORTED(sv_lower_bound_d, sv_upper_bound_d, sv_bsearch_d, sv_gallop_d,
+		sv_lb_d, sv_ub_d, sv_gal_d, double, SV_D, sv_arg_key_d)
+
+/*
+ * Generic element search, using the vector compare function
+ */
+
+S_INLINE srt_bool sv_gen_lt(srt_vector_cmp f, const char *e, const void *t,
+			    srt_bool ub)
+{
+	int r = f(e, t);
+	return ub ? (r <= 0 ? S_TRUE : S_FALSE) : (r < 0 ? S_TRUE : S_FALSE);
+}
+
+static size_t sv_lb_gen(const char *b, size_t lo, size_t hi, size_t es,
+			const void *t, srt_vector_cmp f, srt_bool ub)
+{
+	size_t m;
+	while (lo < hi) {
+		m = lo + (hi - lo) / 2;
+		if (sv_gen_lt(f, b + m * es, t, ub))
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+static size_t sv_gal_gen(const char *b, size_t n, size_t off, size_t es,
+			 const void *t, srt_vector_cmp f)
+{
+	size_t lo = off, step = 1;
+	RETURN_IF(off >= n || !sv_gen_lt(f, b + off * es, t, S_FALSE), off);
+	for (; step < n - lo && sv_gen_lt(f, b + (lo + step) * es, t, S_FALSE);
+	     step *= 2)
+		lo += step;
+	return sv_lb_gen(b, lo + 1, lo + S_MIN(step, n - lo), es, t, f,
+			 S_FALSE);
+}
+
+static size_t sv_bound_gen(const srt_vector *v, const void *target,
+			   srt_bool ub)
+{
+	size_t n = sv_size(v), r;
+	RETURN_IF(!v || !v->vx.cmpf || !target, S_NPOS);
+	r = sv_lb_gen((const char *)sv_get_buffer_r(v), 0, n, v->d.elem_size,
+		      target, v->vx.cmpf, ub);
+	return r < n ? r : S_NPOS;
+}
+
+size_t sv_lower_bound(const srt_vector *v, const void *target)
+{
+	return sv_bound_gen(v, target, S_FALSE);
+}
+
+size_t sv_upper_bound(const srt_vector *v, const void *target)
+{
+	return sv_bound_gen(v, target, S_TRUE);
+}
+
+size_t sv_bsearch(const srt_vector *v, const void *target)
+{
+	size_t r = sv_bound_gen(v, target, S_FALSE);
+	return r != S_NPOS && !v->vx.cmpf(sv_at(v, r), target) ? r : S_NPOS;
+}
+
+size_t sv_gallop(const srt_vector *v, size_t off, const void *target)
+{
+	size_t n = sv_size(v), r;
+	RETURN_IF(!v || !v->vx.cmpf || !target, S_NPOS);
+	r = sv_gal_gen((const char *)sv_get_buffer_r(v), n, off,
+		       v->d.elem_size, target, v->vx.cmpf);
+	return r < n ? r : S_NPOS;
+}
+
+static size_t sv_lu_gen(const srt_vector *v, const srt_vector *q,
+			uint64_t *o)
+{
+	const char *b = (const char *)sv_get_buffer_r(v),
+		   *qb = (const char *)sv_get_buffer_r(q);
+	size_t i, p = 0, c = 0, n = sv_size(v), nq = sv_size(q),
+		  es = v->d.elem_size;
+	srt_vector_cmp f = v->vx.cmpf;
+	for (i = 0; i < nq; i++) {
+		if (i > 0 && f(qb + i * es, qb + (i - 1) * es) < 0)
+			p = 0; /* non-sorted queries: restart */
+		p = sv_gal_gen(b, n, p, es, qb + i * es, f);
+		if (p < n && !f(b + p * es, qb + i * es)) {
+			o[i] = p;
+			c++;
+		} else {
+			o[i] = (uint64_t)S_NPOS;
+		}
 	}
+	return c;
+}
 
-SV_BUILD_FIND(sv_find_i8, int8_t)
-SV_BUILD_FIND(sv_find_u8, uint8_t)
-SV_BUILD_FIND(sv_find_i16, int16_t)
-SV_BUILD_FIND(sv_find_u16, uint16_t)
-SV_BUILD_FIND(sv_find_i32, int32_t)
-SV_BUILD_FIND(sv_find_u32, uint32_t)
-SV_BUILD_FIND(sv_find_i64, int64_t)
-SV_BUILD_FIND(sv_find_u64, uint64_t)
-SV_BUILD_FIND(sv_find_f, float)
-SV_BUILD_FIND(sv_find_d, double)
+size_t sv_lookup_sorted(const srt_vector *v, const srt_vector *queries,
+			srt_vector **out)
+{
+	uint64_t *o;
+	const void *b, *qb;
+	size_t n, nq;
+	RETURN_IF(!v || !queries || !out || !v->vx.cmpf, 0);
+	RETURN_IF(v->d.sub_type != queries->d.sub_type
+			  || v->d.elem_size != queries->d.elem_size,
+		  0); /* BEHAVIOR: different vector types */
+	n = sv_size(v);
+	nq = sv_size(queries);
+	o = sv_out_u64(out, nq);
+	RETURN_IF(!o, 0);
+	b = sv_get_buffer_r(v);
+	qb = sv_get_buffer_r(queries);
+	switch (v->d.sub_type) {
+	case SV_I8:
+		return sv_lu_i8(b, n, qb, nq, o);
+	case SV_U8:
+		return sv_lu_u8(b, n, qb, nq, o);
+	case SV_I16:
+		return sv_lu_i16(b, n, qb, nq, o);
+	case SV_U16:
+		return sv_lu_u16(b, n, qb, nq, o);
+	case SV_I32:
+		return sv_lu_i32(b, n, qb, nq, o);
+	case SV_U32:
+		return sv_lu_u32(b, n, qb, nq, o);
+	case SV_I64:
+		return sv_lu_i64(b, n, qb, nq, o);
+	case SV_U64:
+		return sv_lu_u64(b, n, qb, nq, o);
+	case SV_F:
+		return sv_lu_f(b, n, qb, nq, o);
+	case SV_D:
+		return sv_lu_d(b, n, qb, nq, o);
+	default:
+		break;
+	}
+	return sv_lu_gen(v, queries, o);
+}
+
+/*
+ * Set operations on sorted vectors
+ */
+
+#define SV_SETOP_GALLOP 32 /* size ratio for galloping instead of merging */
+
+typedef size_t (*sv_uniq_fn)(void *b, size_t n);
+typedef size_t (*sv_setop_fn)(const void *a, size_t na, const void *b,
+			       size_t nb, void *o);
+
+enum SVSetOp { SV_SO_ISECT, SV_SO_UNION, SV_SO_DIFF };
+
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_i8, int8_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_u8, uint8_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_i16, int16_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_u16, uint16_t, SFIND_KEY_ID)
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_f, float, sv_arg_key_f)
+SFIND_BUILD_ISECT_MERGE(sv_isect_merge_d, double, sv_arg_key_d)
+
+#define SV_BUILD_SETOPS_K(UNIQ, ISECT, UNION, DIFF, BLK, GAL, T, KEY)          \
+	static size_t UNIQ(void *vb, size_t n)                                 \
+	{                                                                      \
+		T *b = (T *)vb;                                                \
+		size_t i, k = 1;                                               \
+		RETURN_IF(n < 2, n);                                           \
+		for (i = 1; i < n; i++)                                        \
+			if (KEY(b[i]) != KEY(b[k - 1]))                        \
+				b[k++] = b[i];                                 \
+		return k;                                                      \
+	}                                                                      \
+	static size_t ISECT(const void *va, size_t na, const void *vb,         \
+			    size_t nb, void *vo)                               \
+	{                                                                      \
+		const T *a = (const T *)va, *b = (const T *)vb;                \
+		T *o = (T *)vo;                                                \
+		size_t i, j = 0, k = 0;                                        \
+		if (na * SV_SETOP_GALLOP < nb) {                               \
+			for (i = 0; i < na && j < nb; i++) {                   \
+				j = GAL(b, nb, j, a[i]);                       \
+				if (j < nb && KEY(b[j]) == KEY(a[i]))          \
+					o[k++] = a[i];                         \
+			}                                                      \
+			return k;                                              \
+		}                                                              \
+		if (nb * SV_SETOP_GALLOP < na) {                               \
+			for (i = 0; j < nb && i < na; j++) {                   \
+				i = GAL(a, na, i, b[j]);                       \
+				if (i < na && KEY(a[i]) == KEY(b[j]))          \
+					o[k++] = a[i];                         \
+			}                                                      \
+			return k;                                              \
+		}                                                              \
+		return BLK(a, na, b, nb, o);                                   \
+	}                                                                      \
+	static size_t UNION(const void *va, size_t na, const void *vb,         \
+			    size_t nb, void *vo)                               \
+	{                                                                      \
+		const T *a = (const T *)va, *b = (const T *)vb, *l, *t;        \
+		T *o = (T *)vo;                                                \
+		size_t i = 0, j = 0, k = 0, p, nl, nt;                         \
+		if (na * SV_SETOP_GALLOP < nb || nb * SV_SETOP_GALLOP < na) {  \
+			l = na > nb ? a : b; /* large */                       \
+			t = na > nb ? b : a; /* tiny */                        \
+			nl = na > nb ? na : nb;                                \
+			nt = na > nb ? nb : na;                                \
+			for (; i < nt; i++, j = p) {                           \
+				p = GAL(l, nl, j, t[i]);                       \
+				memcpy(o + k, l + j, (p - j) * sizeof(T));     \
+				k += p - j;                                    \
+				o[k++] = t[i];                                 \
+				if (p < nl && KEY(l[p]) == KEY(t[i]))          \
+					p++;                                   \
+			}                                                      \
+			memcpy(o + k, l + j, (nl - j) * sizeof(T));            \
+			return k + nl - j;                                     \
+		}                                                              \
+		while (i < na && j < nb) {                                     \
+			if (KEY(a[i]) < KEY(b[j])) {                           \
+				o[k++] = a[i++];                               \
+			} else if (KEY(b[j]) < KEY(a[i])) {                    \
+				o[k++] = b[j++];                               \
+			} else {                                               \
+				o[k++] = a[i++];                               \
+				j++;                                           \
+			}                                                      \
+		}                                                              \
+		memcpy(o + k, a + i, (na - i) * sizeof(T));                    \
+		k += na - i;                                                   \
+		memcpy(o + k, b + j, (nb - j) * sizeof(T));                    \
+		return k + nb - j;                                             \
+	}                                                                      \
+	static size_t DIFF(const void *va, size_t na, const void *vb,          \
+			   size_t nb, void *vo)                                \
+	{                                                                      \
+		const T *a = (const T *)va, *b = (const T *)vb;                \
+		T *o = (T *)vo;                                                \
+		size_t i = 0, j = 0, k = 0, p;                                 \
+		if (na * SV_SETOP_GALLOP < nb) {                               \
+			for (; i < na; i++) {                                  \
+				j = GAL(b, nb, j, a[i]);                       \
+				if (j >= nb || KEY(b[j]) != KEY(a[i]))         \
+					o[k++] = a[i];                         \
+			}                                                      \
+			return k;                                              \
+		}                                                              \
+		if (nb * SV_SETOP_GALLOP < na) {                               \
+			for (; j < nb && i < na; j++, i = p) {                 \
+				p = GAL(a, na, i, b[j]);                       \
+				memmove(o + k, a + i, (p - i) * sizeof(T));    \
+				k += p - i;                                    \
+				if (p < na && KEY(a[p]) == KEY(b[j]))          \
+					p++;                                   \
+			}                                                      \
+			memmove(o + k, a + i, (na - i) * sizeof(T));           \
+			return k + na - i;                                     \
+		}                                                              \
+		while (i < na && j < nb) {                                     \
+			if (KEY(a[i]) < KEY(b[j])) {                           \
+				o[k++] = a[i++];                               \
+			} else if (KEY(b[j]) < KEY(a[i])) {                    \
+				j++;                                           \
+			} else {                                               \
+				i++;                                           \
+				j++;                                           \
+			}                                                      \
+		}                                                              \
+		memmove(o + k, a + i, (na - i) * sizeof(T));                   \
+		return k + na - i;                                             \
+	}
+
+SV_BUILD_SETOPS_K(sv_uniq_i8, sv_isect_i8, sv_union_i8, sv_diff_i8,
+		  sv_isect_merge_i8, sv_gal_i8, int8_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_u8, sv_isect_u8, sv_union_u8, sv_diff_u8,
+		  sv_isect_merge_u8, sv_gal_u8, uint8_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_i16, sv_isect_i16, sv_union_i16, sv_diff_i16,
+		  sv_isect_merge_i16, sv_gal_i16, int16_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_u16, sv_isect_u16, sv_union_u16, sv_diff_u16,
+		  sv_isect_merge_u16, sv_gal_u16, uint16_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_i32, sv_isect_i32, sv_union_i32, sv_diff_i32,
+		  sfind_isect_i32, sv_gal_i32, int32_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_u32, sv_isect_u32, sv_union_u32, sv_diff_u32,
+		  sfind_isect_u32, sv_gal_u32, uint32_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_i64, sv_isect_i64, sv_union_i64, sv_diff_i64,
+		  sfind_isect_i64, sv_gal_i64, int64_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_u64, sv_isect_u64, sv_union_u64, sv_diff_u64,
+		  sfind_isect_u64, sv_gal_u64, uint64_t, SFIND_KEY_ID)
+SV_BUILD_SETOPS_K(sv_uniq_f, sv_isect_f, sv_union_f, sv_diff_f,
+		  sv_isect_merge_f, sv_gal_f, float, sv_arg_key_f)
+SV_BUILD_SETOPS_K(sv_uniq_d, sv_isect_d, sv_union_d, sv_diff_d,
+		  sv_isect_merge_d, sv_gal_d, double, sv_arg_key_d)
+
+struct SVSetOpK {
+	sv_uniq_fn uniq;
+	sv_setop_fn f[3]; /* enum SVSetOp order */
+};
+
+static const struct SVSetOpK sv_setop_k[SV_GEN] = {
+	{sv_uniq_i8, {sv_isect_i8, sv_union_i8, sv_diff_i8}},
+	{sv_uniq_u8, {sv_isect_u8, sv_union_u8, sv_diff_u8}},
+	{sv_uniq_i16, {sv_isect_i16, sv_union_i16, sv_diff_i16}},
+	{sv_uniq_u16, {sv_isect_u16, sv_union_u16, sv_diff_u16}},
+	{sv_uniq_i32, {sv_isect_i32, sv_union_i32, sv_diff_i32}},
+	{sv_uniq_u32, {sv_isect_u32, sv_union_u32, sv_diff_u32}},
+	{sv_uniq_i64, {sv_isect_i64, sv_union_i64, sv_diff_i64}},
+	{sv_uniq_u64, {sv_isect_u64, sv_union_u64, sv_diff_u64}},
+	{sv_uniq_f, {sv_isect_f, sv_union_f, sv_diff_f}},
+	{sv_uniq_d, {sv_isect_d, sv_union_d, sv_diff_d}}
+};
+
+/*
+ * Generic (compare function) set operations
+ */
+
+static size_t sv_uniq_gen(char *b, size_t n, size_t es, srt_vector_cmp f)
+{
+	size_t i, k = 1;
+	RETURN_IF(n < 2, n);
+	for (i = 1; i < n; i++)
+		if (f(b + i * es, b + (k - 1) * es)) {
+			if (k != i)
+				memcpy(b + k * es, b + i * es, es);
+			k++;
+		}
+	return k;
+}
+
+static size_t sv_setop_gen(const char *a, size_t na, const char *b, size_t nb,
+			   char *o, size_t es, srt_vector_cmp f,
+			   enum SVSetOp op)
+{
+	int r;
+	size_t i = 0, j = 0, k = 0;
+	while (i < na && j < nb) {
+		r = f(a + i * es, b + j * es);
+		if (r < 0) {
+			if (op != SV_SO_ISECT)
+				memmove(o + k++ * es, a + i * es, es);
+			i++;
+		} else if (r > 0) {
+			if (op == SV_SO_UNION)
+				memcpy(o + k++ * es, b + j * es, es);
+			j++;
+		} else {
+			if (op != SV_SO_DIFF)
+				memmove(o + k++ * es, a + i * es, es);
+			i++;
+			j++;
+		}
+	}
+	if (op != SV_SO_ISECT) {
+		memmove(o + k * es, a + i * es, (na - i) * es);
+		k += na - i;
+	}
+	if (op == SV_SO_UNION) {
+		memcpy(o + k * es, b + j * es, (nb - j) * es);
+		k += nb - j;
+	}
+	return k;
+}
+
+static srt_vector *sv_setop(srt_vector **out, const srt_vector *a,
+			    const srt_vector *b, enum SVSetOp op)
+{
+	srt_vector *tmp = NULL, **o = out;
+	size_t na, nb, n, k;
+	RETURN_IF(!out || !a || !b || !a->vx.cmpf, sv_check(out));
+	RETURN_IF(a->d.sub_type != b->d.sub_type
+			  || a->d.elem_size != b->d.elem_size,
+		  sv_check(out)); /* BEHAVIOR: different vector types */
+	na = sv_size(a);
+	nb = sv_size(b);
+	n = op == SV_SO_UNION ? na + nb : op == SV_SO_ISECT ? S_MIN(na, nb) : na;
+	if (*out == b || (*out == a && op == SV_SO_UNION))
+		o = &tmp; /* aliasing: output to a temporary vector */
+	else if (*out && *out != sv_void
+		 && ((*out)->d.sub_type != a->d.sub_type
+		     || (*out)->d.elem_size != a->d.elem_size))
+		sv_free(out);
+	RETURN_IF(aux_reserve(o, a, n) < n || *o == sv_void,
+		  sv_check(out)); /* BEHAVIOR: alloc error */
+	if (a->d.sub_type < SV_GEN)
+		k = sv_setop_k[a->d.sub_type].f[op](
+			sv_get_buffer_r(a), na, sv_get_buffer_r(b), nb,
+			sv_get_buffer(*o));
+	else
+		k = sv_setop_gen((const char *)sv_get_buffer_r(a), na,
+				 (const char *)sv_get_buffer_r(b), nb,
+				 (char *)sv_get_buffer(*o), a->d.elem_size,
+				 a->vx.cmpf, op);
+	sv_set_size(*o, k);
+	if (o == &tmp) {
+		sv_cpy(out, tmp);
+		sv_free(&tmp);
+	}
+	return sv_check(out);
+}
+
+srt_vector *sv_unique(srt_vector *v)
+{
+	size_t n;
+	RETURN_IF(!v || !v->vx.cmpf, sv_check(v ? &v : NULL));
+	if (v->d.sub_type < SV_GEN)
+		n = sv_setop_k[v->d.sub_type].uniq(sv_get_buffer(v), sv_size(v));
+	else
+		n = sv_uniq_gen((char *)sv_get_buffer(v), sv_size(v),
+				v->d.elem_size, v->vx.cmpf);
+	sv_set_size(v, n);
+	return v;
+}
+
+srt_vector *sv_intersect(srt_vector **out, const srt_vector *a,
+			 const srt_vector *b)
+{
+	return sv_setop(out, a, b, SV_SO_ISECT);
+}
+
+srt_vector *sv_union(srt_vector **out, const srt_vector *a,
+		     const srt_vector *b)
+{
+	return sv_setop(out, a, b, SV_SO_UNION);
+}
+
+srt_vector *sv_difference(srt_vector **out, const srt_vector *a,
+			  const srt_vector *b)
+{
+	return sv_setop(out, a, b, SV_SO_DIFF);
+}
+
+/*
+ * Reductions and element-wise operations
+ */
+
+struct SVOpsK {
+	svops_sum_fn sum; /* integers */
+	svops_sum_d_fn sumd;
+	svops_minmax_fn minmax;
+	svops_add_fn add;
+	svops_scale_fn scale;
+	svops_clamp_fn clamp;
+};
+
+#define SV_OPS_K(t, SUM)                                                       \
+	{SUM, (svops_sum_d_fn)svops_sumd_##t,                                  \
+	 (svops_minmax_fn)svops_minmax_##t, (svops_add_fn)svops_add_##t,       \
+	 (svops_scale_fn)svops_scale_##t, (svops_clamp_fn)svops_clamp_##t}
+
+static const struct SVOpsK sv_ops_k[SV_GEN] = {
+	SV_OPS_K(i8, (svops_sum_fn)svops_sum_i8),
+	SV_OPS_K(u8, (svops_sum_fn)svops_sum_u8),
+	SV_OPS_K(i16, (svops_sum_fn)svops_sum_i16),
+	SV_OPS_K(u16, (svops_sum_fn)svops_sum_u16),
+	SV_OPS_K(i32, (svops_sum_fn)svops_sum_i32),
+	SV_OPS_K(u32, (svops_sum_fn)svops_sum_u32),
+	SV_OPS_K(i64, (svops_sum_fn)svops_sum_i64),
+	SV_OPS_K(u64, (svops_sum_fn)svops_sum_u64),
+	SV_OPS_K(f, NULL),
+	SV_OPS_K(d, NULL)};
+
+enum SVOp {
+	SV_OP_SUM,
+	SV_OP_SUM_D,
+	SV_OP_MINMAX,
+	SV_OP_ADD,
+	SV_OP_SCALE,
+	SV_OP_CLAMP
+};
+
+/*
+ * Per-operation context, with per-thread (chunk) results
+ */
+struct SVOpsCtx {
+	enum SVOp op;
+	const struct SVOpsK *k; /* NULL: SV_GEN */
+	char *a;
+	const char *b;
+	const void *lo, *hi;
+	double f;
+	size_t es;
+	int (*cmpf)(const void *, const void *);
+	struct SVOpsAcc acc[SVOPS_MAX_THREADS];
+	double d[SVOPS_MAX_THREADS];
+	/* min/max: element values (contiguous), SV_GEN: element offsets */
+	uint64_t mn[SVOPS_MAX_THREADS], mx[SVOPS_MAX_THREADS];
+};
+
+static void sv_minmax_gen(struct SVOpsCtx *c, size_t i0, size_t i1,
+			  size_t id)
+{
+	size_t i, lo = i0, hi = i0;
+	for (i = i0 + 1; i < i1; i++) {
+		if (c->cmpf(c->a + i * c->es, c->a + lo * c->es) < 0)
+			lo = i;
+		if (c->cmpf(c->a + i * c->es, c->a + hi * c->es) > 0)
+			hi = i;
+	}
+	c->mn[id] = lo;
+	c->mx[id] = hi;
+}
+
+static void sv_clamp_gen(struct SVOpsCtx *c, char *a, size_t n)
+{
+	for (; n > 0; n--, a += c->es)
+		if (c->cmpf(a, c->lo) < 0)
+			memcpy(a, c->lo, c->es);
+		else if (c->cmpf(a, c->hi) > 0)
+			memcpy(a, c->hi, c->es);
+}
+
+static void sv_ops_w(void *ctx, size_t i0, size_t i1, size_t id)
+{
+	struct SVOpsCtx *c = (struct SVOpsCtx *)ctx;
+	char *a = c->a + i0 * c->es;
+	size_t n = i1 - i0;
+	switch (c->op) {
+	case SV_OP_SUM:
+		c->k->sum(a, n, &c->acc[id]);
+		break;
+	case SV_OP_SUM_D:
+		c->d[id] = c->k->sumd(a, n);
+		break;
+	case SV_OP_MINMAX:
+		if (c->k)
+			c->k->minmax(a, n, (char *)c->mn + id * c->es,
+				     (char *)c->mx + id * c->es);
+		else
+			sv_minmax_gen(c, i0, i1, id);
+		break;
+	case SV_OP_ADD:
+		c->k->add(a, c->b + i0 * c->es, n);
+		break;
+	case SV_OP_SCALE:
+		c->k->scale(a, n, c->f);
+		break;
+	case SV_OP_CLAMP:
+		if (c->k)
+			c->k->clamp(a, n, c->lo, c->hi);
+		else
+			sv_clamp_gen(c, a, n);
+		break;
+	}
+}
+
+static size_t sv_ops_run(struct SVOpsCtx *c, const srt_vector *v, char *a,
+			 enum SVOp op, size_t nthreads)
+{
+	c->op = op;
+	c->k = v->d.sub_type < SV_GEN ? &sv_ops_k[v->d.sub_type] : NULL;
+	c->a = a;
+	c->es = v->d.elem_size;
+	c->cmpf = v->vx.cmpf;
+	return svops_par(sv_size(v), nthreads, sv_ops_w, c);
+}
+
+/*
+ * Exact integer sum: per-thread 128-bit partial sums, added in 128 bits
+ */
+static srt_bool sv_sum_acc(const srt_vector *v, struct SVOpsAcc *acc,
+			   size_t nthreads)
+{
+	size_t i, nt;
+	struct SVOpsCtx c;
+	acc->lo = acc->hi = 0;
+	RETURN_IF(!v || v->d.sub_type >= SV_F, S_FALSE);
+	nt = sv_ops_run(&c, v, (char *)sv_get_buffer_r(v), SV_OP_SUM,
+			nthreads);
+	for (i = 0; i < nt; i++)
+		svops_acc_add(acc, &c.acc[i]);
+	return S_TRUE;
+}
+
+static srt_bool sv_sum_i_aux(const srt_vector *v, int64_t *sum,
+			     size_t nthreads)
+{
+	struct SVOpsAcc acc;
+	RETURN_IF(!sum, S_FALSE);
+	*sum = 0;
+	RETURN_IF(!sv_sum_acc(v, &acc, nthreads), S_FALSE);
+	return svops_acc_i64(&acc, sum);
+}
+
+static srt_bool sv_sum_u_aux(const srt_vector *v, uint64_t *sum,
+			     size_t nthreads)
+{
+	struct SVOpsAcc acc;
+	RETURN_IF(!sum, S_FALSE);
+	*sum = 0;
+	RETURN_IF(!sv_sum_acc(v, &acc, nthreads), S_FALSE);
+	return svops_acc_u64(&acc, sum);
+}
+
+static double sv_sum_aux(const srt_vector *v, size_t nthreads)
+{
+	size_t i, nt;
+	double s = 0;
+	struct SVOpsCtx c;
+	RETURN_IF(!v || v->d.sub_type >= SV_GEN, 0);
+	nt = sv_ops_run(&c, v, (char *)sv_get_buffer_r(v), SV_OP_SUM_D,
+			nthreads);
+	for (i = 0; i < nt; i++)
+		s += c.d[i];
+	return s;
+}
+
+static srt_bool sv_minmax_aux(const srt_vector *v, void *min, void *max,
+			      size_t nthreads)
+{
+	size_t i, nt, lo, hi, es;
+	uint64_t l, h, t;
+	struct SVOpsCtx c;
+	RETURN_IF(!v || !sv_size(v) || !v->vx.cmpf, S_FALSE);
+	nt = sv_ops_run(&c, v, (char *)sv_get_buffer_r(v), SV_OP_MINMAX,
+			nthreads);
+	es = v->d.elem_size;
+	if (c.k) { /* minimum of the minimums, maximum of the maximums */
+		c.k->minmax(c.mn, nt, &l, &t);
+		c.k->minmax(c.mx, nt, &t, &h);
+		if (min)
+			memcpy(min, &l, es);
+		if (max)
+			memcpy(max, &h, es);
+		return S_TRUE;
+	}
+	for (i = 1, lo = c.mn[0], hi = c.mx[0]; i < nt; i++) {
+		if (c.cmpf(c.a + c.mn[i] * es, c.a + lo * es) < 0)
+			lo = (size_t)c.mn[i];
+		if (c.cmpf(c.a + c.mx[i] * es, c.a + hi * es) > 0)
+			hi = (size_t)c.mx[i];
+	}
+	if (min)
+		memcpy(min, c.a + lo * es, es);
+	if (max)
+		memcpy(max, c.a + hi * es, es);
+	return S_TRUE;
+}
+
+static srt_bool sv_add_aux(srt_vector *v, const srt_vector *w,
+			   size_t nthreads)
+{
+	struct SVOpsCtx c;
+	RETURN_IF(!v || !w || v->d.sub_type >= SV_GEN, S_FALSE);
+	RETURN_IF(v->d.sub_type != w->d.sub_type || sv_size(v) != sv_size(w),
+		  S_FALSE); /* BEHAVIOR: different vector types or sizes */
+	c.b = (const char *)sv_get_buffer_r(w);
+	sv_ops_run(&c, v, (char *)sv_get_buffer(v), SV_OP_ADD, nthreads);
+	return S_TRUE;
+}
+
+static srt_vector *sv_scale_aux(srt_vector *v, double f, size_t nthreads)
+{
+	struct SVOpsCtx c;
+	RETURN_IF(!v || v->d.sub_type >= SV_GEN, sv_check(v ? &v : NULL));
+	c.f = f;
+	sv_ops_run(&c, v, (char *)sv_get_buffer(v), SV_OP_SCALE, nthreads);
+	return v;
+}
+
+static srt_vector *sv_clamp_aux(srt_vector *v, const void *lo, const void *hi,
+				size_t nthreads)
+{
+	struct SVOpsCtx c;
+	RETURN_IF(!v || !lo || !hi || !v->vx.cmpf, sv_check(v ? &v : NULL));
+	c.lo = lo;
+	c.hi = hi;
+	sv_ops_run(&c, v, (char *)sv_get_buffer(v), SV_OP_CLAMP, nthreads);
+	return v;
+}
+
+double sv_sum(const srt_vector *v)
+{
+	return sv_sum_aux(v, 1);
+}
+
+srt_bool sv_sum_i(const srt_vector *v, int64_t *sum)
+{
+	return sv_sum_i_aux(v, sum, 1);
+}
+
+srt_bool sv_sum_u(const srt_vector *v, uint64_t *sum)
+{
+	return sv_sum_u_aux(v, sum, 1);
+}
+
+srt_bool sv_min(const srt_vector *v, void *min)
+{
+	return min ? sv_minmax_aux(v, min, NULL, 1) : S_FALSE;
+}
+
+srt_bool sv_max(const srt_vector *v, void *max)
+{
+	return max ? sv_minmax_aux(v, NULL, max, 1) : S_FALSE;
+}
+
+srt_bool sv_minmax(const srt_vector *v, void *min, void *max)
+{
+	return sv_minmax_aux(v, min, max, 1);
+}
+
+srt_bool sv_add(srt_vector *v, const srt_vector *w)
+{
+	return sv_add_aux(v, w, 1);
+}
+
+srt_vector *sv_scale(srt_vector *v, double f)
+{
+	return sv_scale_aux(v, f, 1);
+}
+
+srt_vector *sv_clamp(srt_vector *v, const void *lo, const void *hi)
+{
+	return sv_clamp_aux(v, lo, hi, 1);
+}
+
+double sv_sum_parallel(const srt_vector *v, size_t nthreads)
+{
+	return sv_sum_aux(v, nthreads);
+}
+
+srt_bool sv_sum_i_parallel(const srt_vector *v, int64_t *sum,
+			   size_t nthreads)
+{
+	return sv_sum_i_aux(v, sum, nthreads);
+}
+
+srt_bool sv_sum_u_parallel(const srt_vector *v, uint64_t *sum,
+			   size_t nthreads)
+{
+	return sv_sum_u_aux(v, sum, nthreads);
+}
+
+srt_bool sv_minmax_parallel(const srt_vector *v, void *min, void *max,
+			    size_t nthreads)
+{
+	return sv_minmax_aux(v, min, max, nthreads);
+}
+
+srt_bool sv_add_parallel(srt_vector *v, const srt_vector *w, size_t nthreads)
+{
+	return sv_add_aux(v, w, nthreads);
+}
+
+srt_vector *sv_scale_parallel(srt_vector *v, double f, size_t nthreads)
+{
+	return sv_scale_aux(v, f, nthreads);
+}
+
+srt_vector *sv_clamp_parallel(srt_vector *v, const void *lo, const void *hi,
+			      size_t nthreads)
+{
+	return sv_clamp_aux(v, lo, hi, nthreads);
+}
+
+/*
+ * Compression
+ */
+
+#define SV_PACK_HDR 9 /* element type (1 byte), element count (8 bytes) */
+
+S_INLINE srt_bool sv_pack_sign(enum eSV_Type t)
+{
+	return t == SV_I8 || t == SV_I16 || t == SV_I32 || t == SV_I64
+		       ? S_TRUE
+		       : S_FALSE;
+}
+
+/*
+ * Compressed stream header: element type and count (S_FALSE if invalid)
+ */
+static srt_bool sv_pack_hdr(const srt_vector *c, enum eSV_Type *t, size_t *n)
+{
+	const uint8_t *b;
+	uint64_t n64;
+	RETURN_IF(!c || c->d.sub_type != SV_U8 || sv_size(c) < SV_PACK_HDR,
+		  S_FALSE);
+	b = (const uint8_t *)sv_get_buffer_r(c);
+	n64 = S_LD_LE_U64(b + 1);
+	/*
+	 * BEHAVIOR: invalid header (the smallest block takes SVPACK_HDR
+	 * bytes for up to SVPACK_BLK elements, so larger counts can not be
+	 * stored in the stream)
+	 */
+	RETURN_IF(b[0] >= SV_F || n64 > S_SIZET_MAX
+			  || n64 / SVPACK_BLK + (n64 % SVPACK_BLK ? 1 : 0)
+				     > (sv_size(c) - SV_PACK_HDR) / SVPACK_HDR,
+		  S_FALSE);
+	*t = (enum eSV_Type)b[0];
+	*n = (size_t)n64;
+	return S_TRUE;
+}
+
+srt_vector *sv_compress(srt_vector **out, const srt_vector *v)
+{
+	uint64_t k[SVPACK_BLK];
+	uint8_t *o, *o0;
+	const char *b;
+	size_t i, m, n, es, max;
+	srt_bool sign;
+	srt_vector *tmp = NULL, **po = out;
+	RETURN_IF(!out || !v || v->d.sub_type >= SV_F,
+		  sv_check(out)); /* BEHAVIOR: non-integer vector */
+	n = sv_size(v);
+	es = v->d.elem_size;
+	sign = sv_pack_sign((enum eSV_Type)v->d.sub_type);
+	max = SV_PACK_HDR
+	      + (n + SVPACK_BLK - 1) / SVPACK_BLK * SVPACK_BLK_MAX(es);
+	if (*out == v)
+		po = &tmp; /* aliasing: output to a temporary vector */
+	o0 = o = (uint8_t *)sv_out_t(po, SV_U8, max);
+	RETURN_IF(!o, sv_check(out)); /* BEHAVIOR: alloc error */
+	o[0] = (uint8_t)v->d.sub_type;
+	S_ST_LE_U64(o + 1, (uint64_t)n);
+	o += SV_PACK_HDR;
+	b = (const char *)sv_get_buffer_r(v);
+	for (i = 0; i < n; i += m) {
+		m = S_MIN(SVPACK_BLK, n - i);
+		svpack_keys(k, b + i * es, m, es, sign);
+		o += svpack_enc(o, k, m);
+	}
+	sv_set_size(*po, (size_t)(o - o0));
+	if (po == &tmp) {
+		sv_cpy(out, tmp);
+		sv_free(&tmp);
+	}
+	return sv_check(out);
+}
+
+srt_vector *sv_decompress(srt_vector **out, const srt_vector *c)
+{
+	uint64_t k[SVPACK_BLK];
+	enum eSV_Type t;
+	char *o;
+	const uint8_t *b;
+	size_t i, m, n, es, cs, off, r;
+	srt_vector *tmp = NULL, **po = out;
+	RETURN_IF(!out || !sv_pack_hdr(c, &t, &n),
+		  sv_check(out)); /* BEHAVIOR: invalid input */
+	if (*out == c)
+		po = &tmp;
+	o = (char *)sv_out_t(po, t, n);
+	RETURN_IF(!o, sv_check(out)); /* BEHAVIOR: alloc error */
+	es = (*po)->d.elem_size;
+	b = (const uint8_t *)sv_get_buffer_r(c);
+	cs = sv_size(c);
+	for (i = 0, off = SV_PACK_HDR; i < n; i += m, off += r) {
+		r = svpack_dec(k, &m, b + off, cs - off);
+		if (!r || m > n - i)
+			break;
+		svpack_unkeys(o + i * es, k, m, es, sv_pack_sign(t));
+	}
+	sv_set_size(*po, i < n ? 0 : n); /* BEHAVIOR: corrupted input */
+	if (po == &tmp) {
+		sv_cpy(out, tmp);
+		sv_free(&tmp);
+	}
+	return sv_check(out);
+}
+
+size_t sv_decompress_block(srt_vector **out, const srt_vector *c, size_t off)
+{
+	uint64_t k[SVPACK_BLK];
+	enum eSV_Type t;
+	void *o;
+	size_t m, n, r;
+	RETURN_IF(!out || *out == c || !sv_pack_hdr(c, &t, &n), 0);
+	if (!off)
+		off = SV_PACK_HDR;
+	r = off < sv_size(c)
+		    ? svpack_dec(k, &m,
+				 (const uint8_t *)sv_get_buffer_r(c) + off,
+				 sv_size(c) - off)
+		    : 0;
+	o = sv_out_t(out, t, r ? m : 0);
+	RETURN_IF(!o || !r, 0); /* BEHAVIOR: end of data, or invalid input */
+	svpack_unkeys(o, k, m, (*out)->d.elem_size, sv_pack_sign(t));
+	return off + r;
+}
+
+size_t sv_compressed_elems(const srt_vector *c)
+{
+	enum eSV_Type t;
+	size_t n;
+	return sv_pack_hdr(c, &t, &n) ? n : 0;
+}
 
 /*
  * Compare
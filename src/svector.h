@@ -36,6 +36,13 @@ extern "C" {
  * #DOC SV_D: double
  * #DOC
  * #DOC SV_GEN: generic-data (user defined)
+ * #DOC
+ * #DOC
+ * #DOC Search functions (sv_find*(), sv_count*()) compare elements bitwise
+ * #DOC (as memcmp()), so for SV_F/SV_D 0.0 and -0.0 are different, and a
+ * #DOC NaN matches the same NaN bit pattern. For 1, 2, 4 and 8 byte
+ * #DOC elements the search is vectorized when built for SSE2, AVX2 or
+ * #DOC NEON (AArch64) targets.
  *
  * Copyright (c) 2015-2020 F. Aragon. All rights reserved.
  * Released under the BSD 3-Clause License (see the doc/LICENSE)
@@ -64,6 +71,7 @@ enum eSV_Type {
 };
 
 typedef int (*srt_vector_cmp)(const void *a, const void *b);
+typedef int64_t (*srt_vector_key)(const void *e);
 
 struct SVector {
 	struct SDataFull d;
@@ -230,9 +238,33 @@ srt_vector *sv_erase(srt_vector **v, size_t off, size_t n);
 /* #API: |Resize vector|input/output vector; new size|output vector reference (optional usage)|O(n)|1;2| */
 srt_vector *sv_resize(srt_vector **v, size_t n);
 
-/* #API: |Sort vector|input/output vector|output vector reference (optional usage)|relies on libc "qsort" implementation, e.g. glibc implements introsort (O(n log n)), musl does smoothsort (O(n log n)), etc.|1;2| */
+/* #API: |Sort vector (SV_F/SV_D: total order, i.e. -NaN < -inf < ... < -0.0 < 0.0 < ... < inf < NaN)|input/output vector|output vector reference (optional usage)|O(n) for integer and floating point vectors (radix sort); SV_GEN: O(n log n) (pattern-defeating quicksort, not stable)|1;2| */
 srt_vector *sv_sort(srt_vector *v);
 
+/* #API: |Sort vector using multiple threads (same order as sv_sort(); SV_GEN: parallel merge sort, with the merges split across the threads, stable across chunks only; threads used if built with PTHREADS=1 and having more than 64K elements, otherwise same as sv_sort())|input/output vector; number of threads (1: single thread)|output vector reference (optional usage)|O(n / nthreads) for integer and floating point vectors; SV_GEN: O((n log n + n log nthreads) / nthreads)|1;2| */
+srt_vector *sv_sort_parallel(srt_vector *v, size_t nthreads);
+
+/* #API: |Sort vector by integer key (key extracted once per element, so no comparison callbacks are involved)|input/output vector; key extraction function|output vector reference (optional usage)|O(n log n); Aux space: O(n)|1;2| */
+srt_vector *sv_sort_key(srt_vector *v, srt_vector_key keyf);
+
+/* #API: |Sort vector, keeping the relative order of equal elements (stable sort)|input/output vector|output vector reference (optional usage)|O(n) for integer and floating point vectors (radix sort); SV_GEN: O(n log n) (merge sort, O(n log^2 n) if no memory for the O(n) scratch buffer is available)|1;2| */
+srt_vector *sv_sort_stable(srt_vector *v);
+
+/* #API: |Stable argsort: index vector that would sort the vector (equal elements keep their relative order), for reordering parallel vectors with sv_permute()|input vector|index vector (SV_U32 if the input size fits in 32 bits, SV_U64 otherwise); NULL if out of memory or no compare function is set (SV_GEN)|O(n) for integer and floating point vectors (radix sort); SV_GEN: O(n log n) (merge sort)|1;2| */
+srt_vector *sv_argsort(const srt_vector *v);
+
+/* #API: |Reorder (gather) vector elements by index vector: output element i = input element idx[i] (output size: idx size)|input/output vector; index vector (SV_U32/SV_U64, e.g. sv_argsort() output)|S_TRUE: OK; S_FALSE: out of range index, non-supported index vector type or out of memory (vector not modified)|O(n)|1;2| */
+srt_bool sv_permute(srt_vector **v, const srt_vector *idx);
+
+/* #API: |Partial reorder so the element at offset k is the one sorted order would place there, with no greater elements before it and no smaller after it (nth element)|input/output vector; element offset (nothing done if out of range)|output vector reference (optional usage)|O(n) for integer and floating point vectors (radix select); SV_GEN: O(n) expected (introselect)|1;2| */
+srt_vector *sv_nth_element(srt_vector *v, size_t k);
+
+/* #API: |Partial sort: first k elements sorted (the k smallest, same order as sv_sort()), the rest in unspecified order|input/output vector; number of elements to be sorted (k >= size: full sort)|output vector reference (optional usage)|O(n + k log k)|1;2| */
+srt_vector *sv_partial_sort(srt_vector *v, size_t k);
+
+/* #API: |Top-k: k largest elements, in descending order (input not modified; it is read once, using up to 2k elements of output buffer)|output vector (allocated/reused; it can be the input vector); input vector; number of elements|output vector reference|O(n + k log k)|1;2| */
+srt_vector *sv_top_k(srt_vector **out, const srt_vector *v, size_t k);
+
 /*
  * Search
  */
@@ -270,6 +302,318 @@ size_t sv_find_f(const srt_vector *v, size_t off, float target);
 /* #API: |Find value in vector (SV_D)|vector; search offset start; target to be located|offset: >=0 found; S_NPOS: not found|O(n)|1;2| */
 size_t sv_find_d(const srt_vector *v, size_t off, double target);
 
+/* #API: |Count elements equal to the target (SV_GEN)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count(const srt_vector *v, size_t off, const void *target);
+
+/* #API: |Count elements equal to the target (SV_I8)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_i8(const srt_vector *v, size_t off, int8_t target);
+
+/* #API: |Count elements equal to the target (SV_U8)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_u8(const srt_vector *v, size_t off, uint8_t target);
+
+/* #API: |Count elements equal to the target (SV_I16)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_i16(const srt_vector *v, size_t off, int16_t target);
+
+/* #API: |Count elements equal to the target (SV_U16)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_u16(const srt_vector *v, size_t off, uint16_t target);
+
+/* #API: |Count elements equal to the target (SV_I32)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_i32(const srt_vector *v, size_t off, int32_t target);
+
+/* #API: |Count elements equal to the target (SV_U32)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_u32(const srt_vector *v, size_t off, uint32_t target);
+
+/* #API: |Count elements equal to the target (SV_I64)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_i64(const srt_vector *v, size_t off, int64_t target);
+
+/* #API: |Count elements equal to the target (SV_U64)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_u64(const srt_vector *v, size_t off, uint64_t target);
+
+/* #API: |Count elements equal to the target (SV_F)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_f(const srt_vector *v, size_t off, float target);
+
+/* #API: |Count elements equal to the target (SV_D)|vector; search offset start; target to be counted|Number of matching elements|O(n)|1;2| */
+size_t sv_count_d(const srt_vector *v, size_t off, double target);
+
+/* #API: |Locate all elements equal to the target (SV_GEN), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all(const srt_vector *v, size_t off, const void *target,
+		   srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_I8), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_i8(const srt_vector *v, size_t off, int8_t target,
+		      srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_U8), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_u8(const srt_vector *v, size_t off, uint8_t target,
+		      srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_I16), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_i16(const srt_vector *v, size_t off, int16_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_U16), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_u16(const srt_vector *v, size_t off, uint16_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_I32), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_i32(const srt_vector *v, size_t off, int32_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_U32), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_u32(const srt_vector *v, size_t off, uint32_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_I64), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_i64(const srt_vector *v, size_t off, int64_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_U64), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_u64(const srt_vector *v, size_t off, uint64_t target,
+		       srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_F), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_f(const srt_vector *v, size_t off, float target,
+		     srt_vector **mask);
+
+/* #API: |Locate all elements equal to the target (SV_D), as a bit mask (bit i set: element i matches)|vector; search offset start; target to be located; output bit mask vector (SV_U64, one bit per element, allocated/reused)|Number of matching elements (0 if out of memory)|O(n)|1;2| */
+size_t sv_find_all_d(const srt_vector *v, size_t off, double target,
+		     srt_vector **mask);
+
+/*
+ * Sorted vector search (the vector must be sorted in ascending order, e.g.
+ * with sv_sort()). The SV_F/SV_D functions follow the sv_sort() total
+ * order (-NaN, -Inf, ..., -0, 0, ..., Inf, NaN), so NaN values can be
+ * located, and -0 and 0 are different keys. The generic functions use the
+ * vector compare function (numeric comparison: NaN is not supported).
+ */
+
+/* #API: |Binary search (any vector type, using the vector compare function)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch(const srt_vector *v, const void *target);
+
+/* #API: |Locate first element >= target (lower bound) (any vector type, using the vector compare function)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound(const srt_vector *v, const void *target);
+
+/* #API: |Locate first element > target (upper bound) (any vector type, using the vector compare function)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound(const srt_vector *v, const void *target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search, so the cost depends on the distance to the result (any vector type, using the vector compare function)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop(const srt_vector *v, size_t off, const void *target);
+
+/* #API: |Binary search (SV_I8)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_i8(const srt_vector *v, int8_t target);
+
+/* #API: |Binary search (SV_U8)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_u8(const srt_vector *v, uint8_t target);
+
+/* #API: |Binary search (SV_I16)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_i16(const srt_vector *v, int16_t target);
+
+/* #API: |Binary search (SV_U16)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_u16(const srt_vector *v, uint16_t target);
+
+/* #API: |Binary search (SV_I32)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_i32(const srt_vector *v, int32_t target);
+
+/* #API: |Binary search (SV_U32)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_u32(const srt_vector *v, uint32_t target);
+
+/* #API: |Binary search (SV_I64)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_i64(const srt_vector *v, int64_t target);
+
+/* #API: |Binary search (SV_U64)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_u64(const srt_vector *v, uint64_t target);
+
+/* #API: |Binary search (SV_F)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_f(const srt_vector *v, float target);
+
+/* #API: |Binary search (SV_D)|sorted vector; target to be located|offset of the first element equal to the target; S_NPOS: not found|O(log n)|1;2| */
+size_t sv_bsearch_d(const srt_vector *v, double target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_I8)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_i8(const srt_vector *v, int8_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_U8)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_u8(const srt_vector *v, uint8_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_I16)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_i16(const srt_vector *v, int16_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_U16)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_u16(const srt_vector *v, uint16_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_I32)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_i32(const srt_vector *v, int32_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_U32)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_u32(const srt_vector *v, uint32_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_I64)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_i64(const srt_vector *v, int64_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_U64)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_u64(const srt_vector *v, uint64_t target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_F)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_f(const srt_vector *v, float target);
+
+/* #API: |Locate first element >= target (lower bound) (SV_D)|sorted vector; target|offset; S_NPOS if all elements are < target|O(log n)|1;2| */
+size_t sv_lower_bound_d(const srt_vector *v, double target);
+
+/* #API: |Locate first element > target (upper bound) (SV_I8)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_i8(const srt_vector *v, int8_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_U8)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_u8(const srt_vector *v, uint8_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_I16)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_i16(const srt_vector *v, int16_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_U16)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_u16(const srt_vector *v, uint16_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_I32)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_i32(const srt_vector *v, int32_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_U32)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_u32(const srt_vector *v, uint32_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_I64)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_i64(const srt_vector *v, int64_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_U64)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_u64(const srt_vector *v, uint64_t target);
+
+/* #API: |Locate first element > target (upper bound) (SV_F)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_f(const srt_vector *v, float target);
+
+/* #API: |Locate first element > target (upper bound) (SV_D)|sorted vector; target|offset; S_NPOS if all elements are <= target|O(log n)|1;2| */
+size_t sv_upper_bound_d(const srt_vector *v, double target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_I8)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_i8(const srt_vector *v, size_t off, int8_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_U8)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_u8(const srt_vector *v, size_t off, uint8_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_I16)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_i16(const srt_vector *v, size_t off, int16_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_U16)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_u16(const srt_vector *v, size_t off, uint16_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_I32)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_i32(const srt_vector *v, size_t off, int32_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_U32)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_u32(const srt_vector *v, size_t off, uint32_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_I64)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_i64(const srt_vector *v, size_t off, int64_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_U64)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_u64(const srt_vector *v, size_t off, uint64_t target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_F)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_f(const srt_vector *v, size_t off, float target);
+
+/* #API: |Locate first element >= target starting from a given offset, using exponential (galloping) search (SV_D)|sorted vector; search offset start; target|offset; S_NPOS if all elements from the start offset are < target|O(log d), being d the distance from the start offset to the result|1;2| */
+size_t sv_gallop_d(const srt_vector *v, size_t off, double target);
+
+/* #API: |Batched lookup of many targets in a sorted vector: sorted queries are processed with a single merge-like sweep (galloping from the previous result), non-sorted queries are also supported (slower)|sorted vector; query vector (same type as the sorted vector); output vector (SV_U64, one element per query: offset of the first element equal to the query, or S_NPOS if not found; allocated/reused)|Number of queries found (0 if out of memory or different vector types)|O(m log(n / m)) for m sorted queries|1;2| */
+size_t sv_lookup_sorted(const srt_vector *v, const srt_vector *queries,
+			srt_vector **out);
+
+/*
+ * Set operations on sorted vectors
+ */
+
+/* #API: |Remove consecutive repeated elements (e.g. after sv_sort(), so the vector elements become unique)|vector|output vector reference (same as input)|O(n)|1;2| */
+srt_vector *sv_unique(srt_vector *v);
+
+/* #API: |Intersection of two sorted vectors with unique elements (elements present in both vectors). Vectorized for 32/64-bit integer vectors, galloping search when one vector is much smaller|output vector (allocated/reused; it can be one of the input vectors); sorted vector #1; sorted vector #2 (same type as vector #1)|output vector reference|O(n + m); O(n log(m / n)) for n much smaller than m|1;2| */
+srt_vector *sv_intersect(srt_vector **out, const srt_vector *a,
+			 const srt_vector *b);
+
+/* #API: |Union of two sorted vectors with unique elements (sorted, without repeated elements). Galloping search when one vector is much smaller|output vector (allocated/reused; it can be one of the input vectors); sorted vector #1; sorted vector #2 (same type as vector #1)|output vector reference|O(n + m)|1;2| */
+srt_vector *sv_union(srt_vector **out, const srt_vector *a,
+		     const srt_vector *b);
+
+/* #API: |Difference of two sorted vectors with unique elements (elements of vector #1 not present in vector #2). Galloping search when one vector is much smaller|output vector (allocated/reused; it can be one of the input vectors); sorted vector #1; sorted vector #2 (same type as vector #1)|output vector reference|O(n + m); O(n log(m / n)) for n much smaller than m|1;2| */
+srt_vector *sv_difference(srt_vector **out, const srt_vector *a,
+			  const srt_vector *b);
+
+/*
+ * Reductions and element-wise operations
+ */
+
+/* #API: |Sum of all elements, accumulated as double (integer and floating point vectors)|vector|Sum (0 for empty, SV_GEN or NULL vectors)|O(n)|1;2| */
+double sv_sum(const srt_vector *v);
+
+/* #API: |Exact sum of all elements of an integer vector (128-bit accumulation, with the range checked on the result)|vector; output sum (saturated on overflow)|S_TRUE: OK; S_FALSE: overflow (sum out of the int64_t range) or non-integer vector|O(n)|1;2| */
+srt_bool sv_sum_i(const srt_vector *v, int64_t *sum);
+
+/* #API: |Exact sum of all elements of an integer vector (128-bit accumulation, with the range checked on the result)|vector; output sum (saturated on overflow)|S_TRUE: OK; S_FALSE: overflow (sum out of the uint64_t range) or non-integer vector|O(n)|1;2| */
+srt_bool sv_sum_u(const srt_vector *v, uint64_t *sum);
+
+/* #API: |Minimum element (same order as sv_sort(), except for SV_F/SV_D NaNs, which are ignored)|vector; output element (element size bytes, e.g. int32_t for SV_I32)|S_TRUE: OK; S_FALSE: empty vector|O(n)|1;2| */
+srt_bool sv_min(const srt_vector *v, void *min);
+
+/* #API: |Maximum element (same order as sv_sort(), except for SV_F/SV_D NaNs, which are ignored)|vector; output element (element size bytes)|S_TRUE: OK; S_FALSE: empty vector|O(n)|1;2| */
+srt_bool sv_max(const srt_vector *v, void *max);
+
+/* #API: |Minimum and maximum elements, in a single pass|vector; output minimum element (optional, NULL: not set); output maximum element (optional)|S_TRUE: OK; S_FALSE: empty vector|O(n)|1;2| */
+srt_bool sv_minmax(const srt_vector *v, void *min, void *max);
+
+/* #API: |Element-wise addition: v[i] += w[i] (integers: modular arithmetic)|input/output vector; input vector (same type and size)|S_TRUE: OK; S_FALSE: different vector types or sizes, or SV_GEN vector|O(n)|1;2| */
+srt_bool sv_add(srt_vector *v, const srt_vector *w);
+
+/* #API: |Element-wise scaling: v[i] *= f (integers: computed as double, truncated and saturated to the element range)|input/output vector; factor|output vector reference (optional usage)|O(n)|1;2| */
+srt_vector *sv_scale(srt_vector *v, double f);
+
+/* #API: |Element-wise clamp to [lo, hi] range|input/output vector; lower bound element; upper bound element|output vector reference (optional usage)|O(n)|1;2| */
+srt_vector *sv_clamp(srt_vector *v, const void *lo, const void *hi);
+
+/* #API: |Sum of all elements, using multiple threads (threads used if built with PTHREADS=1 and having more than 64K elements per thread)|vector; number of threads|Sum|O(n / nthreads)|1;2| */
+double sv_sum_parallel(const srt_vector *v, size_t nthreads);
+
+/* #API: |Exact sum of all elements of an integer vector, using multiple threads|vector; output sum; number of threads|S_TRUE: OK; S_FALSE: overflow or non-integer vector|O(n / nthreads)|1;2| */
+srt_bool sv_sum_i_parallel(const srt_vector *v, int64_t *sum,
+			   size_t nthreads);
+
+/* #API: |Exact sum of all elements of an integer vector, using multiple threads|vector; output sum; number of threads|S_TRUE: OK; S_FALSE: overflow or non-integer vector|O(n / nthreads)|1;2| */
+srt_bool sv_sum_u_parallel(const srt_vector *v, uint64_t *sum,
+			   size_t nthreads);
+
+/* #API: |Minimum and maximum elements, using multiple threads|vector; output minimum element (optional); output maximum element (optional); number of threads|S_TRUE: OK; S_FALSE: empty vector|O(n / nthreads)|1;2| */
+srt_bool sv_minmax_parallel(const srt_vector *v, void *min, void *max,
+			    size_t nthreads);
+
+/* #API: |Element-wise addition, using multiple threads|input/output vector; input vector (same type and size); number of threads|S_TRUE: OK; S_FALSE: different vector types or sizes, or SV_GEN vector|O(n / nthreads)|1;2| */
+srt_bool sv_add_parallel(srt_vector *v, const srt_vector *w, size_t nthreads);
+
+/* #API: |Element-wise scaling, using multiple threads|input/output vector; factor; number of threads|output vector reference (optional usage)|O(n / nthreads)|1;2| */
+srt_vector *sv_scale_parallel(srt_vector *v, double f, size_t nthreads);
+
+/* #API: |Element-wise clamp, using multiple threads|input/output vector; lower bound element; upper bound element; number of threads|output vector reference (optional usage)|O(n / nthreads)|1;2| */
+srt_vector *sv_clamp_parallel(srt_vector *v, const void *lo, const void *hi,
+			      size_t nthreads);
+
+/*
+ * Compression
+ */
+
+/* #API: |Compress integer vector (blocks of 128 elements, frame of reference or delta encoding -the one requiring fewer bits, delta being used for sorted blocks-, plus bit-packing), e.g. sorted 32-bit ids with small gaps take 1-2 bytes per element|output compressed stream (SV_U8 vector, reused if already allocated); input integer vector|output compressed stream reference (optional usage)|O(n)|1;2| */
+srt_vector *sv_compress(srt_vector **out, const srt_vector *v);
+
+/* #API: |Decompress vector compressed with sv_compress()|output vector (same type as the compressed one, reused if already allocated); compressed stream|output vector reference (optional usage)|O(n)|1;2| */
+srt_vector *sv_decompress(srt_vector **out, const srt_vector *c);
+
+/* #API: |Decompress one block (up to 128 elements), for scanning without decompressing the whole vector. E.g. size_t off = 0; while ((off = sv_decompress_block(&blk, c, off))) { ... }|output vector (block elements, reused if already allocated); compressed stream; block offset (0 for the first block, then the value returned by the previous call)|offset of the next block; 0: no more blocks|O(1)|1;2| */
+size_t sv_decompress_block(srt_vector **out, const srt_vector *c, size_t off);
+
+/* #API: |Number of elements in a compressed vector|compressed stream|number of elements (0 if not a compressed stream)|O(1)|1;2| */
+size_t sv_compressed_elems(const srt_vector *c);
+
 /*
  * Compare
  */
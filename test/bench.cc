@@ -8,10 +8,15 @@
  */
 
 #include "../src/libsrt.h"
+#include "../src/saux/ssearch.h"
+#include "../src/saux/ssort.h"
 #include "../test/utf8_examples.h"
 #include <algorithm>
 #include <bitset>
+#include <functional>
+#include <iterator>
 #include <map>
+#include <numeric>
 #include <set>
 #include <string>
 #include <vector>
@@ -72,12 +77,12 @@
 #define TId2Count(id) ((id & TId_Read10Times) != 0 ? 10 : 0)
 #define TIdTest(id, key) ((id & key) == key)
 
-#define LIBSRTM_BENCH(FN, TID, TK, TV, INSF, ATF, DELF)	\
+#define LIBSRTM_BENCH(FN, ALLOCF, TID, TK, TV, INSF, ATF, DELF)	\
 	bool FN(size_t count, int tid) { \
 		RETURN_IF(!TIdTest(tid, TId_Base) && \
 			  !TIdTest(tid, TId_Read10Times) && \
 			  !TIdTest(tid, TId_DeleteOneByOne), false); \
-		srt_map *m = sm_alloc(TID, 0); \
+		srt_map *m = ALLOCF(TID, 0); \
 		for (size_t i = 0; i < count; i++) \
 			INSF(&m, (TK)i, (TV)i); \
 		for (size_t j = 0; j < TId2Count(tid); j++) \
@@ -91,15 +96,19 @@
 		return true; \
 	}
 
-LIBSRTM_BENCH(libsrt_map_ii32, SM_II32, int32_t, int32_t, sm_insert_ii32,
-	      sm_at_ii32, sm_delete_i)
-LIBSRTM_BENCH(libsrt_map_uu32, SM_UU32, uint32_t, uint32_t, sm_insert_uu32,
-	      sm_at_uu32, sm_delete_i)
-LIBSRTM_BENCH(libsrt_map_ii64, SM_II, int64_t, int64_t, sm_insert_ii,
-	      sm_at_ii, sm_delete_i)
-LIBSRTM_BENCH(libsrt_map_ff, SM_FF, float, float, sm_insert_ff,
+LIBSRTM_BENCH(libsrt_map_ii32, sm_alloc, SM_II32, int32_t, int32_t,
+	      sm_insert_ii32, sm_at_ii32, sm_delete_i)
+LIBSRTM_BENCH(libsrt_map_ii32_w, sm_alloc_wide, SM_II32, int32_t, int32_t,
+	      sm_insert_ii32, sm_at_ii32, sm_delete_i)
+LIBSRTM_BENCH(libsrt_map_uu32, sm_alloc, SM_UU32, uint32_t, uint32_t,
+	      sm_insert_uu32, sm_at_uu32, sm_delete_i)
+LIBSRTM_BENCH(libsrt_map_ii64, sm_alloc, SM_II, int64_t, int64_t,
+	      sm_insert_ii, sm_at_ii, sm_delete_i)
+LIBSRTM_BENCH(libsrt_map_ii64_w, sm_alloc_wide, SM_II, int64_t, int64_t,
+	      sm_insert_ii, sm_at_ii, sm_delete_i)
+LIBSRTM_BENCH(libsrt_map_ff, sm_alloc, SM_FF, float, float, sm_insert_ff,
 	      sm_at_ff, sm_delete_f)
-LIBSRTM_BENCH(libsrt_map_dd, SM_DD, double, double, sm_insert_dd,
+LIBSRTM_BENCH(libsrt_map_dd, sm_alloc, SM_DD, double, double, sm_insert_dd,
 	      sm_at_dd, sm_delete_d)
 
 template <class TK, class TV>
@@ -155,6 +164,35 @@ bool cxx_map_ii(size_t count, int tid)
 LIBSRTMS_BENCH(libsrt_map_s16, "%016i")
 LIBSRTMS_BENCH(libsrt_map_s64, "%064i")
 
+#define LIBSRTRMS_BENCH(FN, FMT)	\
+	bool FN(size_t count, int tid) { \
+		RETURN_IF(!TIdTest(tid, TId_Base) && \
+			  !TIdTest(tid, TId_Read10Times) && \
+			  !TIdTest(tid, TId_DeleteOneByOne), false); \
+		srt_string *btmp = ss_alloca(512); \
+		srt_rmap *m = srm_alloc(SRM_SS, 0); \
+		for (size_t i = 0; i < count; i++) { \
+			ss_printf(&btmp, 512, FMT, (int)i); \
+			srm_insert_ss(&m, btmp, btmp); \
+		} \
+		for (size_t j = 0; j < TId2Count(tid); j++) \
+			for (size_t i = 0; i < count; i++) { \
+				ss_printf(&btmp, 512, FMT, (int)i); \
+				(void)srm_at_ss(m, btmp); \
+			} \
+		if (TIdTest(tid, TId_DeleteOneByOne)) \
+			for (size_t i = 0; i < count; i++) { \
+				ss_printf(&btmp, 512, FMT, (int)i); \
+				srm_delete_s(m, btmp); \
+			} \
+		HOLD_EXEC(tid); \
+		srm_free(&m); \
+		return true; \
+	}
+
+LIBSRTRMS_BENCH(libsrt_rmap_s16, "%016i")
+LIBSRTRMS_BENCH(libsrt_rmap_s64, "%064i")
+
 #define CXXMS_BENCH(FN, FMT)	\
 	bool FN(size_t count, int tid) { \
 		RETURN_IF(!TIdTest(tid, TId_Base) && \
@@ -674,6 +712,387 @@ bool cxx_vector_gen(size_t count, int tid)
 	return true;
 }
 
+#ifndef S_MINIMAL
+#define S_SORT_CROSSOVER_ELEMS (S_TEST_ELEMS * 20)
+
+#define LIBSRT_SORT_BENCH(FN, T, SORTF)				\
+	bool FN(size_t count, int tid) {			\
+		RETURN_IF(!TIdTest(tid, TId_Base) || !count, false);	\
+		size_t reps = S_SORT_CROSSOVER_ELEMS / count;		\
+		T *r = (T *)s_malloc(count * sizeof(T)),		\
+		  *b = (T *)s_malloc(count * sizeof(T));		\
+		uint64_t x = 1;						\
+		for (size_t i = 0; r && i < count; i++) {		\
+			x = x * 6364136223846793005ULL + 1;		\
+			r[i] = (T)(x >> 11);				\
+		}							\
+		for (size_t j = 0; r && b && j < reps; j++) {		\
+			memcpy(b, r, count * sizeof(T));		\
+			SORTF(b, count);				\
+		}							\
+		HOLD_EXEC(tid);						\
+		s_free(r);						\
+		s_free(b);						\
+		return true;						\
+	}
+
+LIBSRT_SORT_BENCH(libsrt_sort_msd_u16, uint16_t, ssort_msd_u16)
+LIBSRT_SORT_BENCH(libsrt_sort_lsd_u16, uint16_t, ssort_lsd_u16)
+LIBSRT_SORT_BENCH(libsrt_sort_msd_u32, uint32_t, ssort_msd_u32)
+LIBSRT_SORT_BENCH(libsrt_sort_lsd_u32, uint32_t, ssort_lsd_u32)
+LIBSRT_SORT_BENCH(libsrt_sort_msd_u64, uint64_t, ssort_msd_u64)
+LIBSRT_SORT_BENCH(libsrt_sort_lsd_u64, uint64_t, ssort_lsd_u64)
+
+#define S_SORT_PAR_THREADS 4
+#define ssort_par_n_u32(b, n) ssort_par_u32(b, n, S_SORT_PAR_THREADS)
+#define ssort_par_n_u64(b, n) ssort_par_u64(b, n, S_SORT_PAR_THREADS)
+
+LIBSRT_SORT_BENCH(libsrt_sort_u32, uint32_t, ssort_u32)
+LIBSRT_SORT_BENCH(libsrt_sort_par_u32, uint32_t, ssort_par_n_u32)
+LIBSRT_SORT_BENCH(libsrt_sort_u64, uint64_t, ssort_u64)
+LIBSRT_SORT_BENCH(libsrt_sort_par_u64, uint64_t, ssort_par_n_u64)
+
+#define S_TOP_K 100
+#define ssort_nth_u32(b, n) ssort_select_u32(b, n, n / 2)
+
+static void ssort_top_u32(uint32_t *b, size_t n)
+{
+	uint32_t o[2 * S_TOP_K];
+	(void)ssort_top_k_u32(b, n, S_TOP_K, o);
+}
+
+static void cxx_nth_u32(uint32_t *b, size_t n)
+{
+	std::nth_element(b, b + n / 2, b + n);
+}
+
+static void cxx_top_u32(uint32_t *b, size_t n)
+{
+	std::partial_sort(b, b + S_MIN(n, S_TOP_K), b + n,
+			  std::greater<uint32_t>());
+}
+
+LIBSRT_SORT_BENCH(libsrt_select_u32, uint32_t, ssort_nth_u32)
+LIBSRT_SORT_BENCH(cxx_select_u32, uint32_t, cxx_nth_u32)
+LIBSRT_SORT_BENCH(libsrt_top_k_u32, uint32_t, ssort_top_u32)
+LIBSRT_SORT_BENCH(cxx_top_k_u32, uint32_t, cxx_top_u32)
+#endif
+
+#define S_VSEARCH_REPS 100
+
+/*
+ * Vector search: full scans (not found / count / all matches)
+ */
+#define LIBSRT_VSEARCH_BENCH(FN, T, SVT, PUSHF, SEARCH)		\
+	bool FN(size_t count, int tid) {			\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);	\
+		srt_vector *v = sv_alloc_t(SVT, count), *m = NULL;	\
+		size_t r = 0;					\
+		for (size_t i = 0; i < count; i++)		\
+			PUSHF(&v, (T)(i % 100));		\
+		for (size_t j = 0; j < S_VSEARCH_REPS; j++)	\
+			r += SEARCH;				\
+		HOLD_EXEC(tid);					\
+		sv_free(&v);					\
+		sv_free(&m);					\
+		return r != 1;					\
+	}
+
+LIBSRT_VSEARCH_BENCH(libsrt_vector_find_u8, uint8_t, SV_U8, sv_push_u8,
+		     sv_find_u8(v, 0, 100))
+LIBSRT_VSEARCH_BENCH(libsrt_vector_find_u32, uint32_t, SV_U32, sv_push_u32,
+		     sv_find_u32(v, 0, 100))
+LIBSRT_VSEARCH_BENCH(libsrt_vector_find_u64, uint64_t, SV_U64, sv_push_u64,
+		     sv_find_u64(v, 0, 100))
+LIBSRT_VSEARCH_BENCH(libsrt_vector_find_d, double, SV_D, sv_push_d,
+		     sv_find_d(v, 0, 100))
+LIBSRT_VSEARCH_BENCH(libsrt_vector_count_u32, uint32_t, SV_U32, sv_push_u32,
+		     sv_count_u32(v, 0, 7))
+LIBSRT_VSEARCH_BENCH(libsrt_vector_find_all_u32, uint32_t, SV_U32,
+		     sv_push_u32, sv_find_all_u32(v, 0, 7, &m))
+
+template <typename T>
+bool cxx_vector_find(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	std::vector <T> v;
+	size_t r = 0;
+	for (size_t i = 0; i < count; i++)
+		v.push_back((T)(i % 100));
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		r += (size_t)(std::find(v.begin(), v.end(), (T)100) - v.begin());
+	HOLD_EXEC(tid);
+	return r != 1;
+}
+
+bool cxx_vector_count_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	std::vector <uint32_t> v;
+	size_t r = 0;
+	for (size_t i = 0; i < count; i++)
+		v.push_back((uint32_t)(i % 100));
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		r += (size_t)std::count(v.begin(), v.end(), (uint32_t)7);
+	HOLD_EXEC(tid);
+	return r != 1;
+}
+
+/*
+ * Sorted set intersection (posting lists): 1/2 and 1/3 density
+ */
+bool libsrt_vector_intersect_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_vector *a = sv_alloc_t(SV_U32, count),
+		   *b = sv_alloc_t(SV_U32, count), *o = NULL;
+	size_t r = 0;
+	for (size_t i = 0; i < count; i++) {
+		sv_push_u32(&a, (uint32_t)(i * 2));
+		sv_push_u32(&b, (uint32_t)(i * 3));
+	}
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++) {
+		sv_intersect(&o, a, b);
+		r += sv_size(o);
+	}
+	HOLD_EXEC(tid);
+	sv_free(&a);
+	sv_free(&b);
+	sv_free(&o);
+	return r != 1;
+}
+
+bool cxx_vector_intersect_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	std::vector <uint32_t> a, b, o;
+	size_t r = 0;
+	for (size_t i = 0; i < count; i++) {
+		a.push_back((uint32_t)(i * 2));
+		b.push_back((uint32_t)(i * 3));
+	}
+	o.reserve(count);
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++) {
+		o.clear();
+		std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+				      std::back_inserter(o));
+		r += o.size();
+	}
+	HOLD_EXEC(tid);
+	return r != 1;
+}
+
+/*
+ * Vector reductions: sum and min/max (full scans)
+ */
+#define LIBSRT_VOPS_BENCH(FN, T, SVT, PUSHF, OP)			\
+	bool FN(size_t count, int tid) {			\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);	\
+		srt_vector *v = sv_alloc_t(SVT, count);		\
+		T mn = 0, mx = 0;				\
+		double r = 0;					\
+		for (size_t i = 0; i < count; i++)		\
+			PUSHF(&v, (T)(i % 1000));		\
+		for (size_t j = 0; j < S_VSEARCH_REPS; j++)	\
+			OP;					\
+		HOLD_EXEC(tid);					\
+		sv_free(&v);					\
+		return r + mn + mx != 1;			\
+	}
+
+LIBSRT_VOPS_BENCH(libsrt_vector_sum_i32, int32_t, SV_I32, sv_push_i32,
+		  r += sv_sum(v))
+LIBSRT_VOPS_BENCH(libsrt_vector_sum_d, double, SV_D, sv_push_d,
+		  r += sv_sum(v))
+LIBSRT_VOPS_BENCH(libsrt_vector_minmax_i32, int32_t, SV_I32, sv_push_i32,
+		  sv_minmax(v, &mn, &mx))
+
+#define CXX_VOPS_BENCH(FN, T, OP)					\
+	bool FN(size_t count, int tid) {			\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);	\
+		std::vector <T> v;				\
+		T mn = 0, mx = 0;				\
+		double r = 0;					\
+		for (size_t i = 0; i < count; i++)		\
+			v.push_back((T)(i % 1000));		\
+		for (size_t j = 0; j < S_VSEARCH_REPS; j++)	\
+			OP;					\
+		HOLD_EXEC(tid);					\
+		return r + mn + mx != 1;			\
+	}
+
+CXX_VOPS_BENCH(cxx_vector_sum_i32, int32_t,
+	       r += std::accumulate(v.begin(), v.end(), (int64_t)0))
+CXX_VOPS_BENCH(cxx_vector_sum_d, double,
+	       r += std::accumulate(v.begin(), v.end(), 0.0))
+CXX_VOPS_BENCH(cxx_vector_minmax_i32, int32_t,
+	       mn = *std::min_element(v.begin(), v.end());
+	       mx = *std::max_element(v.begin(), v.end()))
+
+/*
+ * Compressed vector: sorted ids (average gap 50), decompression and
+ * block-by-block scan (vs scanning the uncompressed vector)
+ */
+static srt_vector *vpack_ids(size_t count)
+{
+	srt_vector *v = sv_alloc_t(SV_U32, count);
+	for (size_t i = 0; i < count; i++)
+		sv_push_u32(&v, (uint32_t)(i * 50 + i % 7));
+	return v;
+}
+
+bool libsrt_vector_compress_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_vector *v = vpack_ids(count), *c = NULL;
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		sv_compress(&c, v);
+	HOLD_EXEC(tid);
+	sv_free(&v);
+	sv_free(&c);
+	return true;
+}
+
+bool libsrt_vector_decompress_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_vector *v = vpack_ids(count), *c = NULL;
+	sv_compress(&c, v);
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		sv_decompress(&v, c);
+	HOLD_EXEC(tid);
+	sv_free(&v);
+	sv_free(&c);
+	return true;
+}
+
+bool libsrt_vector_scan_packed_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_vector *v = vpack_ids(count), *c = NULL, *b = NULL;
+	double r = 0;
+	sv_compress(&c, v);
+	sv_free(&v);
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		for (size_t off = 0; (off = sv_decompress_block(&b, c, off));)
+			r += sv_sum(b);
+	HOLD_EXEC(tid);
+	sv_free(&b);
+	sv_free(&c);
+	return r != 1;
+}
+
+bool libsrt_vector_scan_u32(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_vector *v = vpack_ids(count);
+	double r = 0;
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		r += sv_sum(v);
+	HOLD_EXEC(tid);
+	sv_free(&v);
+	return r != 1;
+}
+
+/*
+ * Columnar table vs array of records: one field scan, and sort by key
+ */
+struct BenchRec {
+	uint32_t id;
+	int32_t key;
+	double price;
+	double qty;
+	uint64_t flags;
+};
+
+static srt_table *tb_recs(size_t count)
+{
+	enum eSV_Type ty[5] = {SV_U32, SV_I32, SV_D, SV_D, SV_U64};
+	size_t offs[5] = {offsetof(BenchRec, id), offsetof(BenchRec, key),
+			  offsetof(BenchRec, price), offsetof(BenchRec, qty),
+			  offsetof(BenchRec, flags)};
+	srt_table *t = stb_alloc(ty, 5, count);
+	BenchRec r;
+	for (size_t i = 0; i < count; i++) {
+		r.id = (uint32_t)i;
+		r.key = (int32_t)((i * 2654435761U) % 1000);
+		r.price = (double)(i % 1000);
+		r.qty = 1;
+		r.flags = i;
+		stb_push_rec(t, &r, offs);
+	}
+	return t;
+}
+
+static void cxx_recs(std::vector<BenchRec> &v, size_t count)
+{
+	BenchRec r;
+	for (size_t i = 0; i < count; i++) {
+		r.id = (uint32_t)i;
+		r.key = (int32_t)((i * 2654435761U) % 1000);
+		r.price = (double)(i % 1000);
+		r.qty = 1;
+		r.flags = i;
+		v.push_back(r);
+	}
+}
+
+bool libsrt_table_scan(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_table *t = tb_recs(count);
+	double r = 0;
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		r += sv_sum(stb_col(t, 2));
+	HOLD_EXEC(tid);
+	stb_free(&t);
+	return r != 1;
+}
+
+bool cxx_records_scan(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	std::vector<BenchRec> v;
+	double r = 0;
+	cxx_recs(v, count);
+	for (size_t j = 0; j < S_VSEARCH_REPS; j++)
+		for (size_t i = 0; i < count; i++)
+			r += v[i].price;
+	HOLD_EXEC(tid);
+	return r != 1;
+}
+
+bool libsrt_table_sort(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	srt_table *t = tb_recs(count);
+	size_t key = 1;
+	stb_sort(t, &key, 1);
+	HOLD_EXEC(tid);
+	stb_free(&t);
+	return true;
+}
+
+static bool cmp_bench_rec(const BenchRec &a, const BenchRec &b)
+{
+	return a.key < b.key;
+}
+
+bool cxx_records_sort(size_t count, int tid)
+{
+	RETURN_IF(!TIdTest(tid, TId_Base), false);
+	std::vector<BenchRec> v;
+	cxx_recs(v, count);
+	std::stable_sort(v.begin(), v.end(), cmp_bench_rec);
+	HOLD_EXEC(tid);
+	return true;
+}
+
+#define cxx_vector_find_u8 cxx_vector_find<uint8_t>
+#define cxx_vector_find_u32 cxx_vector_find<uint32_t>
+#define cxx_vector_find_u64 cxx_vector_find<uint64_t>
+#define cxx_vector_find_d cxx_vector_find<double>
+
 const char
 	*haystack_easymatch1_long =
 	"Alice was beginning to get very tired of sitting by her sister on the"
@@ -916,6 +1335,224 @@ bool cxx_string_search_hardmatch_long_3(size_t count, int tid)
 				 count, tid);
 }
 
+/*
+ * Substring search over large corpora: English text, DNA (4 letter
+ * alphabet, so filter matches are frequent), and adversarial input for
+ * the first/last byte filter (every position passing the filter)
+ */
+enum eSearchCorpus { SC_TEXT, SC_DNA, SC_ADVERSARIAL };
+
+static void search_corpus(std::string &h, std::string &n, size_t count,
+			  enum eSearchCorpus c)
+{
+	uint32_t r = 1;
+	h.clear();
+	switch (c) {
+	case SC_TEXT:
+		n = "rabbit-hole";
+		while (h.size() < count)
+			h += haystack_easymatch1_long;
+		break;
+	case SC_DNA:
+		n = "ACGTTGCAAGCTTCGAACGTAGCTAGCTAGCA";
+		for (size_t i = 0; i < count; i++) {
+			r = r * 1103515245 + 12345;
+			h += "ACGT"[(r >> 16) & 3];
+		}
+		break;
+	case SC_ADVERSARIAL:
+		n = std::string("aab") + std::string(29, 'a');
+		h.assign(count, 'a');
+		break;
+	}
+	h.resize(count);
+	h += n; /* match at the end */
+}
+
+#define BUILD_STRING_SEARCH_CORPUS(FN, C, OP)				\
+	bool FN(size_t count, int tid) {				\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);		\
+		std::string hs, ns;					\
+		search_corpus(hs, ns, count, C);			\
+		const srt_string *h = ss_crefa(hs.c_str()),		\
+				 *n = ss_crefa(ns.c_str());		\
+		const char *volatile hv = hs.c_str(); /* no hoisting */	\
+		size_t r = 0;						\
+		for (size_t j = 0; j < S_VSEARCH_REPS; j++)		\
+			r += OP;					\
+		HOLD_EXEC(tid);						\
+		return r != 1 || !h || !n;				\
+	}
+
+#define LIBSRT_SEARCH_OP ss_find(h, 0, n)
+#define LIBSRT_SEARCH_CSUM_OP						\
+	ss_find_csum_fast(hs.c_str(), 0, hs.size(), ns.c_str(), ns.size())
+#define C_SEARCH_OP (size_t)(strstr(hv, ns.c_str()) - hs.c_str())
+#define CXX_SEARCH_OP hs.find(ns)
+
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_text, SC_TEXT,
+			   LIBSRT_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_csum_text, SC_TEXT,
+			   LIBSRT_SEARCH_CSUM_OP)
+BUILD_STRING_SEARCH_CORPUS(c_string_search_text, SC_TEXT, C_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(cxx_string_search_text, SC_TEXT, CXX_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_dna, SC_DNA,
+			   LIBSRT_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_csum_dna, SC_DNA,
+			   LIBSRT_SEARCH_CSUM_OP)
+BUILD_STRING_SEARCH_CORPUS(c_string_search_dna, SC_DNA, C_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(cxx_string_search_dna, SC_DNA, CXX_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_adversarial, SC_ADVERSARIAL,
+			   LIBSRT_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(libsrt_string_search_csum_adversarial,
+			   SC_ADVERSARIAL, LIBSRT_SEARCH_CSUM_OP)
+BUILD_STRING_SEARCH_CORPUS(c_string_search_adversarial, SC_ADVERSARIAL,
+			   C_SEARCH_OP)
+BUILD_STRING_SEARCH_CORPUS(cxx_string_search_adversarial, SC_ADVERSARIAL,
+			   CXX_SEARCH_OP)
+
+/*
+ * Repeated search of the same target over short haystacks (log lines,
+ * searched one by one): per-call target processing vs precomputed target
+ */
+static void search_log(std::string &h, std::vector<size_t> &eol,
+		       size_t count)
+{
+	char line[256];
+	for (size_t i = 0; i < count; i++) {
+		snprintf(line, sizeof(line), "2020-05-01 12:%02u:%02u host%u "
+			 "app[%u]: %s request id=%u path=/api/v1/items/%u "
+			 "status=%u\n", (unsigned)(i / 60 % 60),
+			 (unsigned)(i % 60), (unsigned)(i % 7),
+			 (unsigned)(1000 + i % 97),
+			 i % 50 ? "INFO" : "ERROR", (unsigned)i,
+			 (unsigned)(i * 31 % 10000), i % 50 ? 200 : 500);
+		h += line;
+		eol.push_back(h.size());
+	}
+}
+
+#define S_LOG_SEARCH_PASSES 10
+
+#define BUILD_STRING_SEARCH_LOG(FN, NEEDLE, FIND)			\
+	bool FN(size_t count, int tid) {				\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);		\
+		std::string hs;						\
+		std::vector<size_t> eol;				\
+		search_log(hs, eol, count);				\
+		const srt_string *h = ss_crefa(hs.c_str()),		\
+				 *n = ss_crefa(NEEDLE);			\
+		srt_string_pattern *p = ss_pattern_compile(n);		\
+		size_t r = 0;						\
+		for (size_t j = 0; j < S_LOG_SEARCH_PASSES; j++)	\
+			for (size_t i = 0, off = 0; i < count;		\
+			     off = eol[i++])				\
+				r += FIND(h, off, eol[i], n, p)		\
+				     != S_NPOS;				\
+		HOLD_EXEC(tid);						\
+		ss_pattern_free(&p);					\
+		return r != 1;						\
+	}
+
+#define LOG_NEEDLE_SHORT "ERROR"
+#define LOG_NEEDLE_LONG							\
+	"ERROR request id=12345678 path=/api/v1/items/1234 status=500 "	\
+	"(timeout waiting for upstream)"
+#define FIND_R(h, off, max_off, n, p) ss_findr(h, off, max_off, n)
+#define FIND_R_P(h, off, max_off, n, p) ss_findr_p(h, off, max_off, p)
+
+BUILD_STRING_SEARCH_LOG(libsrt_string_search_log_short, LOG_NEEDLE_SHORT,
+			FIND_R)
+BUILD_STRING_SEARCH_LOG(libsrt_string_search_log_short_p, LOG_NEEDLE_SHORT,
+			FIND_R_P)
+BUILD_STRING_SEARCH_LOG(libsrt_string_search_log_long, LOG_NEEDLE_LONG,
+			FIND_R)
+BUILD_STRING_SEARCH_LOG(libsrt_string_search_log_long_p, LOG_NEEDLE_LONG,
+			FIND_R_P)
+
+/*
+ * Keyword classification of log lines: one search per keyword and line
+ * vs one multi-pattern pass per line
+ */
+static const char *mpsearch_words[] = {"ERROR",	 "WARN",   "timeout",
+				       "refused", "denied", "panic",
+				       "fatal",	 "overflow"};
+
+static void mpsearch_kw(char *w, size_t ws, size_t i, size_t nkw)
+{
+	static const char *syl[] = {"ka", "to", "mi", "re", "su",
+				    "no", "pa", "le", "vi", "do"};
+	if (nkw <= 8)
+		snprintf(w, ws, "%s", mpsearch_words[i % 8]);
+	else
+		snprintf(w, ws, "%s%s%s%s", syl[i % 10], syl[i / 10 % 10],
+			 syl[i / 100 % 10], syl[i / 1000 % 10]);
+}
+
+static void mpsearch_log(std::string &h, std::vector<size_t> &eol,
+			 size_t count, size_t nkw)
+{
+	char line[256], w[32];
+	for (size_t i = 0; i < count; i++) {
+		mpsearch_kw(w, sizeof(w), i * 7 % nkw, nkw);
+		snprintf(line, sizeof(line), "2020-05-01 12:%02u:%02u host%u "
+			 "app[%u]: request id=%u path=/api/v1/items/%u "
+			 "status=200%s%s\n", (unsigned)(i / 60 % 60),
+			 (unsigned)(i % 60), (unsigned)(i % 7),
+			 (unsigned)(1000 + i % 97), (unsigned)i,
+			 (unsigned)(i * 31 % 10000), i % 20 ? "" : " tag=",
+			 i % 20 ? "" : w);
+		h += line;
+		eol.push_back(h.size());
+	}
+}
+
+#define BUILD_STRING_MPSEARCH(FN, NKW, CLASSIFY)			\
+	bool FN(size_t count, int tid) {				\
+		RETURN_IF(!TIdTest(tid, TId_Base), false);		\
+		std::string hs;						\
+		std::vector<size_t> eol;				\
+		mpsearch_log(hs, eol, count, NKW);			\
+		char w[32];						\
+		srt_string *kw[NKW];					\
+		srt_vector *v = sv_alloc(sizeof(srt_string *), NKW,	\
+					 NULL), *m = NULL;		\
+		for (size_t k = 0; k < NKW; k++) {			\
+			mpsearch_kw(w, sizeof(w), k, NKW);		\
+			kw[k] = ss_dup_c(w);				\
+			sv_push(&v, &kw[k]);				\
+		}							\
+		srt_string_mpattern *p = ss_mpattern_compile(v);	\
+		const srt_string *h = ss_crefa(hs.c_str());		\
+		srt_string_ref lr;					\
+		size_t r = 0;						\
+		for (size_t j = 0; j < S_LOG_SEARCH_PASSES; j++)	\
+			for (size_t i = 0, off = 0; i < count;		\
+			     off = eol[i++])				\
+				CLASSIFY(h, off, eol[i], kw, NKW, p, lr,	\
+					 m, r);				\
+		HOLD_EXEC(tid);						\
+		for (size_t k = 0; k < NKW; k++)			\
+			ss_free(&kw[k]);				\
+		sv_free(&v);						\
+		sv_free(&m);						\
+		ss_mpattern_free(&p);					\
+		return r != 1;						\
+	}
+
+#define MPSEARCH_EACH(h, off, max_off, kw, nkw, p, lr, m, r)		\
+	for (size_t k = 0; k < nkw; k++)				\
+		r += ss_findr(h, off, max_off, kw[k]) != S_NPOS
+#define MPSEARCH_MP(h, off, max_off, kw, nkw, p, lr, m, r)		\
+	r += ss_match_mp(ss_ref_buf(&lr, ss_get_buffer_r(h) + off,	\
+				    max_off - off),			\
+			 0, p, &m)
+
+BUILD_STRING_MPSEARCH(libsrt_string_mpsearch_8, 8, MPSEARCH_EACH)
+BUILD_STRING_MPSEARCH(libsrt_string_mpsearch_8_mp, 8, MPSEARCH_MP)
+BUILD_STRING_MPSEARCH(libsrt_string_mpsearch_2000, 2000, MPSEARCH_EACH)
+BUILD_STRING_MPSEARCH(libsrt_string_mpsearch_2000_mp, 2000, MPSEARCH_MP)
+
 const char
 	case_test_ascii_str[95 + 1] =
 	" !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
@@ -1202,6 +1839,7 @@ int main(int argc, char *argv[])
 		printf("\n%s\n| Test | Insert count | Memory (MiB) | Execution "
 		       "time (s) |\n|:---:|:---:|:---:|:---:|\n", label[i]);
 		BENCH_FN(libsrt_map_ii32, count[i], tid[i]);
+		BENCH_FN(libsrt_map_ii32_w, count[i], tid[i]);
 		BENCH_FN(cxx_map_ii32, count[i], tid[i]);
 		BENCH_FN(libsrt_hmap_ii32, count[i], tid[i]);
 #ifdef S_BENCH_CPP_HM
@@ -1214,6 +1852,7 @@ int main(int argc, char *argv[])
 		BENCH_FN(cxx_umap_uu32, count[i], tid[i]);
 #endif
 		BENCH_FN(libsrt_map_ii64, count[i], tid[i]);
+		BENCH_FN(libsrt_map_ii64_w, count[i], tid[i]);
 		BENCH_FN(cxx_map_ii64, count[i], tid[i]);
 		BENCH_FN(libsrt_hmap_ii64, count[i], tid[i]);
 #ifdef S_BENCH_CPP_HM
@@ -1232,12 +1871,14 @@ int main(int argc, char *argv[])
 		BENCH_FN(cxx_umap_dd, count[i], tid[i]);
 #endif
 		BENCH_FN(libsrt_map_s16, count[i], tid[i]);
+		BENCH_FN(libsrt_rmap_s16, count[i], tid[i]);
 		BENCH_FN(cxx_map_s16, count[i], tid[i]);
 		BENCH_FN(libsrt_hmap_s16, count[i], tid[i]);
 #ifdef S_BENCH_CPP_HM
 		BENCH_FN(cxx_umap_s16, count[i], tid[i]);
 #endif
 		BENCH_FN(libsrt_map_s64, count[i], tid[i]);
+		BENCH_FN(libsrt_rmap_s64, count[i], tid[i]);
 		BENCH_FN(cxx_map_s64, count[i], tid[i]);
 		BENCH_FN(libsrt_hmap_s64, count[i], tid[i]);
 #ifdef S_BENCH_CPP_HM
@@ -1366,6 +2007,129 @@ int main(int argc, char *argv[])
 		BENCH_FN(cxx_string_cat, count[i] / 10, tid[i]);
 		BENCH_FN(cxx_stringstream_cat, count[i] / 10, tid[i]);
 	}
+	printf("\nVector search (" FMT_ZU " full scans per test)\n| Test | "
+	       "Elements | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_VSEARCH_REPS);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_vector_find_u8, n, TId_Base);
+		BENCH_FN(cxx_vector_find_u8, n, TId_Base);
+		BENCH_FN(libsrt_vector_find_u32, n, TId_Base);
+		BENCH_FN(cxx_vector_find_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_find_u64, n, TId_Base);
+		BENCH_FN(cxx_vector_find_u64, n, TId_Base);
+		BENCH_FN(libsrt_vector_find_d, n, TId_Base);
+		BENCH_FN(cxx_vector_find_d, n, TId_Base);
+		BENCH_FN(libsrt_vector_count_u32, n, TId_Base);
+		BENCH_FN(cxx_vector_count_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_find_all_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_intersect_u32, n, TId_Base);
+		BENCH_FN(cxx_vector_intersect_u32, n, TId_Base);
+	}
+	printf("\nVector reductions (" FMT_ZU " full scans per test)\n| Test "
+	       "| Elements | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_VSEARCH_REPS);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_vector_sum_i32, n, TId_Base);
+		BENCH_FN(cxx_vector_sum_i32, n, TId_Base);
+		BENCH_FN(libsrt_vector_sum_d, n, TId_Base);
+		BENCH_FN(cxx_vector_sum_d, n, TId_Base);
+		BENCH_FN(libsrt_vector_minmax_i32, n, TId_Base);
+		BENCH_FN(cxx_vector_minmax_i32, n, TId_Base);
+	}
+	printf("\nCompressed vector, sorted ids (" FMT_ZU " full passes per "
+	       "test)\n| Test | Elements | Memory (MiB) | Execution time (s) "
+	       "|\n|:---:|:---:|:---:|:---:|\n", (size_t)S_VSEARCH_REPS);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_vector_compress_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_decompress_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_scan_packed_u32, n, TId_Base);
+		BENCH_FN(libsrt_vector_scan_u32, n, TId_Base);
+	}
+	printf("\nColumnar table vs array of records (5 fields, 32 bytes per "
+	       "record; scan: " FMT_ZU " passes over one field)\n| Test | "
+	       "Elements | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_VSEARCH_REPS);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_table_scan, n, TId_Base);
+		BENCH_FN(cxx_records_scan, n, TId_Base);
+		BENCH_FN(libsrt_table_sort, n, TId_Base);
+		BENCH_FN(cxx_records_sort, n, TId_Base);
+	}
+	printf("\nString search, large corpora (" FMT_ZU " searches per test, "
+	       "match at the end)\n| Test | Haystack size | Memory (MiB) | "
+	       "Execution time (s) |\n|:---:|:---:|:---:|:---:|\n",
+	       (size_t)S_VSEARCH_REPS);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_string_search_text, n, TId_Base);
+		BENCH_FN(libsrt_string_search_csum_text, n, TId_Base);
+		BENCH_FN(c_string_search_text, n, TId_Base);
+		BENCH_FN(cxx_string_search_text, n, TId_Base);
+		BENCH_FN(libsrt_string_search_dna, n, TId_Base);
+		BENCH_FN(libsrt_string_search_csum_dna, n, TId_Base);
+		BENCH_FN(c_string_search_dna, n, TId_Base);
+		BENCH_FN(cxx_string_search_dna, n, TId_Base);
+		BENCH_FN(libsrt_string_search_adversarial, n, TId_Base);
+		BENCH_FN(libsrt_string_search_csum_adversarial, n, TId_Base);
+		BENCH_FN(c_string_search_adversarial, n, TId_Base);
+		BENCH_FN(cxx_string_search_adversarial, n, TId_Base);
+	}
+	printf("\nString search, repeated target over log lines (" FMT_ZU
+	       " passes, one search per line)\n| Test | Lines | Memory (MiB) "
+	       "| Execution time (s) |\n|:---:|:---:|:---:|:---:|\n",
+	       (size_t)S_LOG_SEARCH_PASSES);
+	for (size_t n = 100000; n <= 10000000; n *= 100) {
+		BENCH_FN(libsrt_string_search_log_short, n, TId_Base);
+		BENCH_FN(libsrt_string_search_log_short_p, n, TId_Base);
+		BENCH_FN(libsrt_string_search_log_long, n, TId_Base);
+		BENCH_FN(libsrt_string_search_log_long_p, n, TId_Base);
+	}
+	printf("\nMulti-pattern search, keyword classification of log lines "
+	       "(8 and 2000 keywords, " FMT_ZU " passes, one search per "
+	       "keyword vs one pass per line)\n| Test | Lines | Memory (MiB) "
+	       "| Execution time (s) |\n|:---:|:---:|:---:|:---:|\n",
+	       (size_t)S_LOG_SEARCH_PASSES);
+	for (size_t n = 1000; n <= 10000; n *= 10) {
+		BENCH_FN(libsrt_string_mpsearch_8, n, TId_Base);
+		BENCH_FN(libsrt_string_mpsearch_8_mp, n, TId_Base);
+		BENCH_FN(libsrt_string_mpsearch_2000, n, TId_Base);
+		BENCH_FN(libsrt_string_mpsearch_2000_mp, n, TId_Base);
+	}
+#ifndef S_MINIMAL
+	printf("\nSort crossover, MSD vs LSD radix sort (random data, "
+	       FMT_ZU " elements sorted in total per test)\n| Test | Elements "
+	       "per sort | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_SORT_CROSSOVER_ELEMS);
+	for (size_t n = 64; n <= 4194304; n *= 4) {
+		BENCH_FN(libsrt_sort_msd_u16, n, TId_Base);
+		BENCH_FN(libsrt_sort_lsd_u16, n, TId_Base);
+		BENCH_FN(libsrt_sort_msd_u32, n, TId_Base);
+		BENCH_FN(libsrt_sort_lsd_u32, n, TId_Base);
+		BENCH_FN(libsrt_sort_msd_u64, n, TId_Base);
+		BENCH_FN(libsrt_sort_lsd_u64, n, TId_Base);
+	}
+	printf("\nParallel sort, " FMT_ZU " threads (random data, " FMT_ZU
+	       " elements sorted in total per test)\n| Test | Elements "
+	       "per sort | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_SORT_PAR_THREADS,
+	       (size_t)S_SORT_CROSSOVER_ELEMS);
+	for (size_t n = 262144; n <= 4194304; n *= 4) {
+		BENCH_FN(libsrt_sort_u32, n, TId_Base);
+		BENCH_FN(libsrt_sort_par_u32, n, TId_Base);
+		BENCH_FN(libsrt_sort_u64, n, TId_Base);
+		BENCH_FN(libsrt_sort_par_u64, n, TId_Base);
+	}
+	printf("\nSelection: median and top " FMT_ZU " (random data, " FMT_ZU
+	       " elements processed in total per test)\n| Test | Elements "
+	       "per call | Memory (MiB) | Execution time (s) |\n|:---:|:---:|"
+	       ":---:|:---:|\n", (size_t)S_TOP_K,
+	       (size_t)S_SORT_CROSSOVER_ELEMS);
+	for (size_t n = 262144; n <= 4194304; n *= 4) {
+		BENCH_FN(libsrt_select_u32, n, TId_Base);
+		BENCH_FN(cxx_select_u32, n, TId_Base);
+		BENCH_FN(libsrt_top_k_u32, n, TId_Base);
+		BENCH_FN(cxx_top_k_u32, n, TId_Base);
+	}
+#endif
 	return 0;
 }
 
@@ -10,8 +10,12 @@
 #include "../src/libsrt.h"
 #include "../src/saux/schar.h"
 #include "../src/saux/sdbg.h"
+#include "../src/saux/ssort.h"
 #include "utf8_examples.h"
 #include <locale.h>
+#ifdef S_PTHREADS
+#include <pthread.h>
+#endif
 
 #if !defined(_MSC_VER) && !defined(__CYGWIN__) && !defined(S_MINIMAL)
 #define GOOD_LOCALE_SUPPORT
@@ -1730,6 +1734,278 @@ static int test_ss_find_misc()
 	return res;
 }
 
+static size_t ss_find_ref(const char *s, size_t off, size_t ss, const char *t,
+			  size_t ts)
+{
+	for (; off + ts <= ss; off++)
+		if (!memcmp(s + off, t, ts))
+			return off;
+	return S_NPOS;
+}
+
+static int test_ss_find_fl()
+{
+	int res = 0;
+	uint32_t r = 1;
+	char h[1024], t[80];
+	size_t i, j, k, ts, off, hs = sizeof(h);
+	srt_string *a = NULL, *b = NULL;
+	/*
+	 * Random haystacks over small alphabets (many first/last byte
+	 * matches), target lengths around the block sizes and the limits
+	 */
+	for (i = 0; i < 300 && !res; i++) {
+		for (j = 0; j < hs; j++) {
+			r = r * 1103515245 + 12345;
+			h[j] = (char)('a' + (r >> 16) % (1 + i % 4));
+		}
+		ts = 1 + i % 70;
+		r = r * 1103515245 + 12345;
+		k = (r >> 16) % (hs - ts);
+		memcpy(t, h + k, ts);
+		if (i % 3 == 0) /* not found */
+			t[ts / 2] = 'z';
+		off = i % 5 == 0 ? k : (i % 40);
+		ss_cpy_cn(&a, h, hs);
+		ss_cpy_cn(&b, t, ts);
+		if (ss_find(a, off, b) != ss_find_ref(h, off, hs, t, ts)
+		    || ss_findr(a, off, hs / 2, b)
+			       != ss_find_ref(h, off, hs / 2, t, ts))
+			res |= 1;
+	}
+	/*
+	 * Adversarial: every position passing the filter (false candidates
+	 * over the limit, switch to the O(n) search)
+	 */
+	memset(h, 'a', hs);
+	memset(t, 'a', 40);
+	t[2] = 'b';
+	ss_cpy_cn(&a, h, hs);
+	ss_cpy_cn(&b, t, 40);
+	res |= ss_find(a, 0, b) == S_NPOS ? 0 : 2;
+	ss_cpy_cn(&a, t, 40);
+	ss_cat_cn(&a, h, hs);
+	ss_cat_cn(&a, t, 40);
+	res |= ss_find(a, 1, b) == hs + 40 ? 0 : 4;
+	res |= ss_find_cn(a, hs, "aab", 3) == hs + 40 ? 0 : 8;
+#ifdef S_USE_VA_ARGS
+	ss_free(&a, &b);
+#else
+	ss_free(&a);
+	ss_free(&b);
+#endif
+	return res;
+}
+
+static int test_ss_find_p()
+{
+	int res = 0;
+	uint32_t r = 7;
+	char h[2048], t[200];
+	size_t i, j, k, ts, off, hs = sizeof(h), cnt;
+	srt_string *a = NULL, *b = NULL;
+	srt_string_pattern *p = NULL, *p2 = NULL;
+	res |= !ss_pattern_compile(NULL) && !ss_pattern_compile(ss_crefa(""))
+			       && ss_find_p(ss_crefa("abc"), 0, NULL) == S_NPOS
+		       ? 0
+		       : 1;
+	/*
+	 * Same result as ss_find(), for short (first/last byte filter)
+	 * and long (Boyer-Moore-Horspool) targets
+	 */
+	for (i = 0; i < 200 && !res; i++) {
+		for (j = 0; j < hs; j++) {
+			r = r * 1103515245 + 12345;
+			h[j] = (char)('a' + (r >> 16) % (1 + i % 3));
+		}
+		ts = 1 + (i * 7) % 150;
+		r = r * 1103515245 + 12345;
+		k = (r >> 16) % (hs - ts);
+		memcpy(t, h + k, ts);
+		if (i % 3 == 0)
+			t[ts / 2] = 'z';
+		off = i % 4 == 0 ? k : (i % 50);
+		ss_cpy_cn(&a, h, hs);
+		ss_cpy_cn(&b, t, ts);
+		p = ss_pattern_compile(b);
+		ss_cpy_c(&b, "x"); /* pattern keeps its own copy */
+		ss_cpy_cn(&b, t, ts);
+		if (!p || ss_find_p(a, off, p) != ss_find_ref(h, off, hs, t, ts)
+		    || ss_findr_p(a, off, hs / 2, p)
+			       != ss_find_ref(h, off, hs / 2, t, ts))
+			res |= 2;
+		for (cnt = 0, j = off;
+		     (j = ss_find_ref(h, j, hs, t, ts)) != S_NPOS; j += ts)
+			cnt++;
+		if (ss_count_p(a, off, p) != cnt)
+			res |= 4;
+		ss_pattern_free(&p);
+	}
+	/*
+	 * Adversarial (long target): every window matching the last byte
+	 */
+	memset(h, 'a', hs);
+	memset(t, 'a', 100);
+	t[0] = 'b';
+	ss_cpy_cn(&a, h, hs);
+	ss_cat_cn(&a, t, 100);
+	ss_cpy_cn(&b, t, 100);
+	p = ss_pattern_compile(b);
+	p2 = ss_pattern_compile(ss_crefa("aa"));
+	res |= ss_find_p(a, 0, p) == hs && ss_count_p(a, 0, p) == 1 ? 0 : 8;
+	res |= ss_count_p(a, 0, p2) == (hs + 99) / 2 ? 0 : 16;
+#ifdef S_USE_VA_ARGS
+	ss_free(&a, &b);
+	ss_pattern_free(&p, &p2);
+#else
+	ss_free(&a);
+	ss_free(&b);
+	ss_pattern_free(&p);
+	ss_pattern_free(&p2);
+#endif
+	return res;
+}
+
+#define TSS_MP_MAX 200
+
+static int test_ss_find_mp()
+{
+	int res = 0;
+	uint32_t r = 11;
+	char h[3000];
+	const size_t set_sizes[] = {1, 5, 8, 20, 32, 33, 200};
+	size_t i, j, k, n, ts, off, hs = sizeof(h), id, fo, fid, cnt, nids;
+	srt_string *a = NULL, *tg[TSS_MP_MAX];
+	srt_vector *v = NULL, *o = NULL, *d = NULL, *m = NULL;
+	srt_string_mpattern *p = NULL, *p2 = NULL;
+	const uint64_t *mb;
+	for (i = 0; i < TSS_MP_MAX; i++)
+		tg[i] = NULL;
+	v = sv_alloc(sizeof(srt_string *), TSS_MP_MAX, NULL);
+	res |= !ss_mpattern_compile(NULL) && !ss_mpattern_compile(v)
+			       && ss_find_mp(ss_crefa("abc"), 0, NULL, NULL)
+					  == S_NPOS
+		       ? 0
+		       : 1;
+	/*
+	 * Same result as one ss_find() per target, for small (Teddy, if
+	 * available) and large (Aho-Corasick DFA) sets, including targets
+	 * being duplicates, prefixes or suffixes of other targets
+	 */
+	for (i = 0; i < 70 && !res; i++) {
+		n = set_sizes[i % 7];
+		sv_clear(v);
+		for (j = 0; j < n; j++) {
+			r = r * 1103515245 + 12345;
+			ts = 1 + (r >> 16) % (i % 2 ? 12 : 4);
+			r = r * 1103515245 + 12345;
+			k = (r >> 16) % (hs - ts);
+			if (j > 0 && j % 7 == 0) /* prefix/suffix/duplicate */
+				ss_cpy_substr(&tg[j], tg[j - 1], j % 2,
+					      ss_size(tg[j - 1]) - j % 2);
+			else
+				ss_cpy_cn(&tg[j], h + k, ts);
+			if (!ss_size(tg[j]))
+				ss_cpy_c(&tg[j], "a");
+			sv_push(&v, &tg[j]);
+		}
+		for (j = 0; j < hs; j++) {
+			r = r * 1103515245 + 12345;
+			h[j] = (char)('a' + (r >> 16) % (2 + i % 4));
+		}
+		ss_cpy_cn(&a, h, hs);
+		p = ss_mpattern_compile(v);
+		if (!p) {
+			res |= 2;
+			break;
+		}
+		off = i % 5;
+		fo = S_NPOS;
+		for (fid = j = 0; j < n; j++) {
+			k = ss_find_ref(h, off, hs, ss_get_buffer_r(tg[j]),
+					ss_size(tg[j]));
+			if (k < fo) {
+				fo = k;
+				fid = j;
+			}
+		}
+		id = S_NPOS;
+		if (ss_find_mp(a, off, p, &id) != fo
+		    || (fo != S_NPOS && id != fid))
+			res |= 4;
+		cnt = ss_find_all_mp(a, off, p, &o, &d);
+		ss_match_mp(a, off, p, &m);
+		mb = (const uint64_t *)sv_get_buffer_r(m);
+		for (k = 0, j = off; j < hs; j++)
+			for (id = 0; id < n; id++) {
+				ts = ss_size(tg[id]);
+				if (ts > hs - j
+				    || memcmp(h + j, ss_get_buffer_r(tg[id]),
+					      ts))
+					continue;
+				if (k >= cnt || sv_at_u64(o, k) != j
+				    || sv_at_u32(d, k) != id
+				    || !(mb[id / 64] & S_NBIT64(id % 64)))
+					res |= 8;
+				k++;
+			}
+		if (k != cnt || sv_size(o) != cnt || sv_size(d) != cnt)
+			res |= 16;
+		for (nids = id = 0; id < n; id++)
+			nids += (mb[id / 64] & S_NBIT64(id % 64)) ? 1 : 0;
+		if (ss_match_mp(a, off, p, &m) != nids)
+			res |= 32;
+		ss_mpattern_free(&p);
+	}
+	/*
+	 * Adversarial (Teddy: every position being a candidate), and
+	 * targets longer than the input
+	 */
+	memset(h, 'a', hs);
+	ss_cpy_cn(&a, h, hs);
+	ss_cat_c(&a, "ab");
+	sv_clear(v);
+	ss_cpy_c(&tg[0], "aaab");
+	ss_cpy_c(&tg[1], "aaaa");
+	ss_cpy_c(&tg[2], "ba");
+	sv_push(&v, &tg[0]);
+	sv_push(&v, &tg[1]);
+	sv_push(&v, &tg[2]);
+	p = ss_mpattern_compile(v);
+	res |= ss_find_mp(a, 0, p, &id) == 0 && id == 1 ? 0 : 64;
+	res |= ss_find_mp(a, hs - 2, p, &id) == hs - 2 && id == 0 ? 0 : 128;
+	res |= ss_find_all_mp(a, 0, p, &o, NULL) == hs - 1 ? 0 : 256;
+	res |= ss_match_mp(a, 0, p, &m) == 2 ? 0 : 512;
+	ss_cpy_c(&tg[3], "aaaaaaaaaaaa");
+	sv_push(&v, &tg[3]);
+	p2 = ss_mpattern_compile(v);
+	res |= ss_find_mp(ss_crefa("aaa"), 0, p2, &id) == S_NPOS
+			       && ss_find_all_mp(ss_crefa("aaaab"), 0, p2, &o,
+						 &d)
+					  == 2
+			       && sv_at_u32(d, 0) == 1 && sv_at_u32(d, 1) == 0
+		       ? 0
+		       : 1024;
+	ss_cpy_c(&tg[3], "");
+	res |= !ss_mpattern_compile(v) ? 0 : 2048; /* empty target */
+	for (i = 0; i < TSS_MP_MAX; i++)
+		ss_free(&tg[i]);
+#ifdef S_USE_VA_ARGS
+	ss_free(&a);
+	sv_free(&v, &o, &d, &m);
+	ss_mpattern_free(&p, &p2);
+#else
+	ss_free(&a);
+	sv_free(&v);
+	sv_free(&o);
+	sv_free(&d);
+	sv_free(&m);
+	ss_mpattern_free(&p);
+	ss_mpattern_free(&p2);
+#endif
+	return res;
+}
+
 static int test_ss_split()
 {
 	const char *howareyou = "how are you";
@@ -3260,6 +3536,366 @@ static int test_sv_sort()
 	return res;
 }
 
+static int cmp_gen_i32(const void *a, const void *b)
+{
+	int32_t a2, b2;
+	memcpy(&a2, a, sizeof(a2));
+	memcpy(&b2, b, sizeof(b2));
+	return a2 < b2 ? -1 : a2 > b2 ? 1 : 0;
+}
+
+static int64_t key_gen_i32(const void *e)
+{
+	int32_t k;
+	memcpy(&k, e, sizeof(k));
+	return k;
+}
+
+static int test_sv_sort_gen()
+{
+	int res = 0;
+	char e[40];
+	int32_t k, kp;
+	uint64_t x = 1, sum, sum2;
+	size_t i, j, t, n = 3000, es[6] = {4, 8, 12, 16, 32, 40};
+	srt_vector *v;
+	/*
+	 * Element sizes with specialized and generic swaps, and input patterns
+	 * (random, sorted, reversed, organ pipe, few unique values, constant),
+	 * using both the comparison callback and the key extraction sort
+	 */
+	for (i = 0; i < 6 * 6 * 2; i++) {
+		v = sv_alloc(es[i % 6], n, cmp_gen_i32);
+		for (j = sum = 0, t = (i / 6) % 6; j < n; j++) {
+			x = x * 6364136223846793005ULL + 1;
+			k = t == 0   ? (int32_t)(x >> 32)
+			    : t == 1 ? (int32_t)j
+			    : t == 2 ? (int32_t)(n - j)
+			    : t == 3 ? (int32_t)(j < n / 2 ? j : n - j)
+			    : t == 4 ? (int32_t)(x >> 61)
+				     : 7;
+			memset(e, (int)j, sizeof(e));
+			memcpy(e, &k, sizeof(k));
+			sv_push(&v, e);
+			sum += (uint64_t)k;
+		}
+		if (i < 6 * 6)
+			sv_sort(v);
+		else
+			sv_sort_key(v, key_gen_i32);
+		for (j = sum2 = 0, kp = 0; j < sv_size(v); j++) {
+			k = (int32_t)key_gen_i32(sv_at(v, j));
+			if (j > 0 && k < kp)
+				break;
+			kp = k;
+			sum2 += (uint64_t)k;
+		}
+		res |= j == n && sum == sum2 ? 0 : 1 << (i % 30);
+		sv_free(&v);
+	}
+	return res;
+}
+
+static int test_sv_sort_stable()
+{
+	int res = 0;
+	struct AA a;
+	const struct AA *p, *q;
+	uint64_t x = 1;
+	size_t i, j, n[3] = {10, 100, 5000};
+	srt_vector *v;
+	for (j = 0; j < 3; j++) {
+		v = sv_alloc(sizeof(struct AA), n[j], AA_cmp);
+		for (i = 0; i < n[j]; i++) {
+			x = x * 6364136223846793005ULL + 1;
+			a.a = (int)(x >> 61);
+			a.b = (int)i;
+			sv_push(&v, &a);
+		}
+		sv_sort_stable(v);
+		for (i = 1; i < sv_size(v); i++) {
+			p = (const struct AA *)sv_at(v, i - 1);
+			q = (const struct AA *)sv_at(v, i);
+			if (p->a > q->a || (p->a == q->a && p->b > q->b))
+				break;
+		}
+		res |= sv_size(v) == n[j] && i == n[j] ? 0 : 1 << j;
+		sv_free(&v);
+	}
+	return res;
+}
+
+#define TEST_SV_ARGSORT(v, AT, ntest)                                          \
+	idx = sv_argsort(v);                                                   \
+	for (i = 1; idx && i < sv_size(idx); i++) {                            \
+		j = sv_at_u32(idx, i - 1);                                     \
+		k = sv_at_u32(idx, i);                                         \
+		if (AT(v, j) > AT(v, k) || (AT(v, j) == AT(v, k) && j > k))    \
+			break;                                                 \
+	}                                                                      \
+	res |= idx && sv_size(idx) == sv_size(v) && i >= sv_size(v)            \
+		       ? 0                                                     \
+		       : 1 << ntest;                                           \
+	sv_free(&idx);
+
+static int test_sv_argsort_permute()
+{
+	int res = 0;
+	struct AA a;
+	uint64_t x = 1;
+	size_t i, j, k, n = 3000;
+	srt_vector *idx, *idx2, *vi = sv_alloc_t(SV_I32, n),
+				 *vd = sv_alloc_t(SV_D, n),
+				 *vg = sv_alloc(sizeof(struct AA), n, AA_cmp),
+				 *w = sv_alloc_t(SV_U64, n), *ws;
+	for (i = 0; i < n; i++) {
+		x = x * 6364136223846793005ULL + 1;
+		sv_push_i32(&vi, (int32_t)(x >> 32) % 100);
+		sv_push_d(&vd, (double)(int64_t)x / 1e9);
+		a.a = (int)(x >> 60);
+		a.b = 0;
+		sv_push(&vg, &a);
+		sv_push_u64(&w, i);
+	}
+	TEST_SV_ARGSORT(vi, sv_at_i32, 0);
+	TEST_SV_ARGSORT(vd, sv_at_d, 1);
+#define AT_AA(v, i) ((const struct AA *)sv_at(v, i))->a
+	TEST_SV_ARGSORT(vg, AT_AA, 2);
+#undef AT_AA
+	/* Reorder parallel vectors */
+	idx = sv_argsort(vi);
+	ws = sv_dup(vi);
+	sv_sort(ws);
+	res |= sv_permute(&vi, idx) && sv_permute(&w, idx) ? 0 : 1 << 3;
+	res |= !sv_ncmp(vi, 0, ws, 0, n) ? 0 : 1 << 4;
+	for (i = 0; i < n && sv_at_u64(w, i) == sv_at_u32(idx, i); i++)
+		;
+	res |= i == n ? 0 : 1 << 5;
+	/* Gather, invalid indexes, non-supported index type */
+	idx2 = sv_alloc_t(SV_U32, 3);
+	sv_push_u32(&idx2, 5);
+	sv_push_u32(&idx2, 5);
+	res |= sv_permute(&w, idx2) && sv_size(w) == 2 ? 0 : 1 << 6;
+	sv_push_u32(&idx2, 2);
+	res |= !sv_permute(&w, idx2) && sv_size(w) == 2 ? 0 : 1 << 7;
+	res |= !sv_permute(&w, vi) ? 0 : 1 << 8;
+#ifdef S_USE_VA_ARGS
+	sv_free(&vi, &vd, &vg, &w, &ws, &idx, &idx2);
+#else
+	sv_free(&vi);
+	sv_free(&vd);
+	sv_free(&vg);
+	sv_free(&w);
+	sv_free(&ws);
+	sv_free(&idx);
+	sv_free(&idx2);
+#endif
+	return res;
+}
+
+#ifndef S_MINIMAL
+static srt_bool sv_sort_fp_chk(const srt_vector *v, size_t n)
+{
+	size_t i;
+	double a, b;
+	uint64_t ua, ub;
+	srt_bool f = v->d.sub_type == SV_F;
+	if (sv_size(v) != n)
+		return S_FALSE;
+	for (i = 1; i < n; i++) {
+		a = f ? (double)sv_at_f(v, i - 1) : sv_at_d(v, i - 1);
+		b = f ? (double)sv_at_f(v, i) : sv_at_d(v, i);
+		memcpy(&ua, &a, sizeof(ua));
+		memcpy(&ub, &b, sizeof(ub));
+		if (i == 1 && (a == a || !(ua >> 63))) /* -NaN first */
+			return S_FALSE;
+		if (i == n - 1 && (b == b || (ub >> 63))) /* NaN last */
+			return S_FALSE;
+		if (i > 1 && i < n - 1
+		    && (a > b || (a == b && (ua >> 63) < (ub >> 63))))
+			return S_FALSE;
+	}
+	return S_TRUE;
+}
+
+static int test_sv_sort_fp()
+{
+	int res = 0;
+	size_t i, j, n[2] = {20, 3000};
+	uint64_t x = 1;
+	srt_vector *vf = NULL, *vd = NULL;
+	const uint32_t sf[6] = {0x7fc00000, 0xffc00000, 0x7f800000,
+				0xff800000, 0x80000000, 0};
+	const uint64_t sd[6] = {0x7ff8000000000000ULL, 0xfff8000000000000ULL,
+				0x7ff0000000000000ULL, 0xfff0000000000000ULL,
+				0x8000000000000000ULL, 0};
+	float f;
+	double d;
+	/* Specials (NaN, -NaN, inf, -inf, -0.0, 0.0) and random values */
+	for (j = 0; j < 2; j++) {
+		vf = sv_alloc_t(SV_F, n[j]);
+		vd = sv_alloc_t(SV_D, n[j]);
+		for (i = 0; i < 6; i++) {
+			memcpy(&f, &sf[i], sizeof(f));
+			memcpy(&d, &sd[i], sizeof(d));
+			sv_push_f(&vf, f);
+			sv_push_d(&vd, d);
+		}
+		for (i = 6; i < n[j]; i++) {
+			x = x * 6364136223846793005ULL + 1;
+			d = (double)(int64_t)x / 1e9 / (double)((x >> 60) + 1);
+			sv_push_f(&vf, (float)d);
+			sv_push_d(&vd, i % 7 ? d : (double)(int)d);
+		}
+		sv_sort(vf);
+		sv_sort(vd);
+		res |= sv_sort_fp_chk(vf, n[j]) ? 0 : 1 << (j * 2);
+		res |= sv_sort_fp_chk(vd, n[j]) ? 0 : 2 << (j * 2);
+#ifdef S_USE_VA_ARGS
+		sv_free(&vf, &vd);
+#else
+		sv_free(&vf);
+		sv_free(&vd);
+#endif
+	}
+	return res;
+}
+
+#define TEST_SV_SORT_LSD(T, SVT, MSDF, AT, n, mask, seed)                      \
+	{                                                                      \
+		T *r = (T *)s_malloc(n * sizeof(T));                           \
+		srt_vector *v = sv_alloc_t(SVT, n);                            \
+		for (i = 0, x = seed; r && i < n; i++) {                       \
+			x = x * 6364136223846793005ULL + 1;                    \
+			r[i] = (T)((x >> 16) & (mask));                        \
+			sv_push_raw(&v, &r[i], 1);                             \
+		}                                                              \
+		sv_sort(v);                                                    \
+		MSDF(r, n);                                                    \
+		for (i = 0; r && i < n && AT(v, i) == r[i]                     \
+			    && (!i || AT(v, i - 1) <= AT(v, i));               \
+		     i++)                                                      \
+			;                                                      \
+		res |= r && i == n ? 0 : 1 << ntest;                           \
+		ntest++;                                                       \
+		s_free(r);                                                     \
+		sv_free(&v);                                                   \
+	}
+
+static int test_sv_sort_lsd()
+{
+	int res = 0, ntest = 0;
+	size_t i;
+	uint64_t x;
+	/*
+	 * Large inputs (LSD), all digits and constant digits, vs MSD sort,
+	 * and small inputs (MSD, small partitions)
+	 */
+	TEST_SV_SORT_LSD(int16_t, SV_I16, ssort_msd_i16, sv_at_i16, 3000,
+			 0xffff, 1);
+	TEST_SV_SORT_LSD(uint16_t, SV_U16, ssort_msd_u16, sv_at_u16, 3000,
+			 0x0ff0, 2);
+	TEST_SV_SORT_LSD(int32_t, SV_I32, ssort_msd_i32, sv_at_i32, 5000,
+			 0xffffffff, 3);
+	TEST_SV_SORT_LSD(uint32_t, SV_U32, ssort_msd_u32, sv_at_u32, 5000,
+			 0xff00ff, 4);
+	TEST_SV_SORT_LSD(int64_t, SV_I64, ssort_msd_i64, sv_at_i64, 5000,
+			 (uint64_t)-1, 5);
+	TEST_SV_SORT_LSD(int64_t, SV_I64, ssort_msd_i64, sv_at_i64, 5000,
+			 0xff, 6);
+	TEST_SV_SORT_LSD(uint64_t, SV_U64, ssort_msd_u64, sv_at_u64, 5000,
+			 0xffff000000000000ULL, 7);
+	TEST_SV_SORT_LSD(uint64_t, SV_U64, ssort_msd_u64, sv_at_u64, 5000, 0,
+			 8);
+	TEST_SV_SORT_LSD(int32_t, SV_I32, ssort_msd_i32, sv_at_i32, 500,
+			 0xffffffff, 9);
+	TEST_SV_SORT_LSD(int64_t, SV_I64, ssort_msd_i64, sv_at_i64, 100,
+			 0xffffffff, 10);
+	return res;
+}
+
+static int test_sv_sort_parallel()
+{
+	int res = 0;
+	size_t i, j, n = 100000, nt[3] = {1, 3, 4};
+	uint64_t x = 1, sb;
+	struct AA a;
+	const struct AA *pa, *pb;
+	srt_vector *v[5], *w[5];
+	enum eSV_Type t[4] = {SV_I16, SV_I32, SV_U64, SV_D};
+	/*
+	 * Parallel vs single-thread sort (integer, floating point, and generic
+	 * elements), including a non power of two number of threads
+	 */
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 4; i++)
+			v[i] = sv_alloc_t(t[i], n);
+		v[4] = sv_alloc(sizeof(struct AA), n, AA_cmp);
+		for (i = 0; i < n; i++) {
+			x = x * 6364136223846793005ULL + 1;
+			sv_push_i16(&v[0], (int16_t)(x >> 48));
+			sv_push_i32(&v[1], (int32_t)(x >> 32));
+			sv_push_u64(&v[2], x >> (x % 40));
+			sv_push_d(&v[3], (double)(int64_t)x / 1e9);
+			a.a = (int)(x >> 40);
+			a.b = (int)i;
+			sv_push(&v[4], &a);
+		}
+		for (i = 0; i < 5; i++) {
+			w[i] = sv_dup(v[i]);
+			sv_sort_parallel(v[i], nt[j]);
+			sv_sort(w[i]);
+			res |= sv_size(v[i]) == n ? 0 : 1 << (j * 5 + i);
+		}
+		for (i = 0; i < 4; i++)
+			if (memcmp(sv_get_buffer_r(v[i]), sv_get_buffer_r(w[i]),
+				   n * v[i]->d.elem_size))
+				res |= 1 << (j * 5 + i);
+		for (i = 0; i < n; i++) {
+			pa = (const struct AA *)sv_at(v[4], i);
+			pb = (const struct AA *)sv_at(w[4], i);
+			if (!pa || !pb || pa->a != pb->a) {
+				res |= 1 << (j * 5 + 4);
+				break;
+			}
+		}
+		for (i = 0; i < 5; i++) {
+#ifdef S_USE_VA_ARGS
+			sv_free(&v[i], &w[i]);
+#else
+			sv_free(&v[i]);
+			sv_free(&w[i]);
+#endif
+		}
+	}
+	/*
+	 * Generic parallel merge sort kernel (split merges, many equal keys),
+	 * also covering builds without threads (phases run in sequence)
+	 */
+	for (j = 5; j <= 7; j += 2) {
+		v[0] = sv_alloc(sizeof(struct AA), n, AA_cmp);
+		for (i = 0; i < n; i++) {
+			x = x * 6364136223846793005ULL + 1;
+			a.a = (int)(x >> 60);
+			a.b = (int)i;
+			sv_push(&v[0], &a);
+		}
+		ssort_par_gen(sv_get_buffer(v[0]), n, sizeof(struct AA), AA_cmp,
+			      j);
+		for (i = 0, sb = 0; i < n; i++) {
+			pa = (const struct AA *)sv_at(v[0], i);
+			pb = (const struct AA *)sv_at(v[0], i ? i - 1 : 0);
+			sb += (uint64_t)pa->b;
+			if (pb->a > pa->a)
+				res |= 1 << 15;
+		}
+		res |= sb == (uint64_t)n * (n - 1) / 2 ? 0 : 1 << 16;
+		sv_free(&v[0]);
+	}
+	return res;
+}
+#endif
+
 #define TEST_SV_FIND_VARS(v) srt_vector *v
 
 #define TEST_SV_FIND(v, ntest, alloc, push, check, type, CMPF, a, b)           \
@@ -3321,84 +3957,794 @@ static int test_sv_find()
 	return res;
 }
 
-static int test_sv_push_pop_set()
+#define TEST_SV_FIND_ALL(ntest, type, T, push, find, count, find_all)          \
+	v = sv_alloc_t(type, 300);                                             \
+	for (i = 0; i < 300; i++)                                              \
+		push(&v, (T)(i % 7));                                          \
+	for (off = 0; off < 310; off += 37) {                                  \
+		for (j = off, c = 0, p = S_NPOS; j < 300; j++)                 \
+			if (j % 7 == 3) {                                      \
+				p = p == S_NPOS ? j : p;                       \
+				c++;                                           \
+			}                                                      \
+		if (find(v, off, (T)3) != p || count(v, off, (T)3) != c        \
+		    || find_all(v, off, (T)3, &m) != c                         \
+		    || sv_size(m) != (300 + 63) / 64)                          \
+			res |= 1 << (ntest * 2);                               \
+		for (j = 0; j < 300 && m; j++)                                 \
+			if (((sv_at_u64(m, j / 64) >> (j % 64)) & 1)           \
+			    != (j >= off && j % 7 == 3 ? 1U : 0U))             \
+				res |= 1 << (ntest * 2);                       \
+	}                                                                      \
+	if (find(v, 0, (T)9) != S_NPOS || count(v, 0, (T)9) != 0)              \
+		res |= 2 << (ntest * 2);                                       \
+	sv_free(&v);
+
+static int test_sv_find_count_all()
 {
-	size_t as = 10;
-	srt_vector *a = sv_alloc(sizeof(struct AA), as, NULL),
-		   *b = sv_alloca(sizeof(struct AA), as, NULL);
-	const struct AA *t = NULL;
-	int res = (!a || !b) ? 1 : 0;
-	if (!res) {
+	int res = 0;
+	uint64_t u = 3;
+	double z = 0, nz = -0.0;
+	size_t i, j, c, p, off;
+	srt_vector *v, *m = NULL;
+	TEST_SV_FIND_ALL(0, SV_I8, int8_t, sv_push_i8, sv_find_i8, sv_count_i8,
+			 sv_find_all_i8);
+	TEST_SV_FIND_ALL(1, SV_U8, uint8_t, sv_push_u8, sv_find_u8, sv_count_u8,
+			 sv_find_all_u8);
+	TEST_SV_FIND_ALL(2, SV_I16, int16_t, sv_push_i16, sv_find_i16,
+			 sv_count_i16, sv_find_all_i16);
+	TEST_SV_FIND_ALL(3, SV_U16, uint16_t, sv_push_u16, sv_find_u16,
+			 sv_count_u16, sv_find_all_u16);
+	TEST_SV_FIND_ALL(4, SV_I32, int32_t, sv_push_i32, sv_find_i32,
+			 sv_count_i32, sv_find_all_i32);
+	TEST_SV_FIND_ALL(5, SV_U32, uint32_t, sv_push_u32, sv_find_u32,
+			 sv_count_u32, sv_find_all_u32);
+	TEST_SV_FIND_ALL(6, SV_I64, int64_t, sv_push_i64, sv_find_i64,
+			 sv_count_i64, sv_find_all_i64);
+	TEST_SV_FIND_ALL(7, SV_U64, uint64_t, sv_push_u64, sv_find_u64,
+			 sv_count_u64, sv_find_all_u64);
+	TEST_SV_FIND_ALL(8, SV_F, float, sv_push_f, sv_find_f, sv_count_f,
+			 sv_find_all_f);
+	TEST_SV_FIND_ALL(9, SV_D, double, sv_push_d, sv_find_d, sv_count_d,
+			 sv_find_all_d);
+	/* Generic vector (8-byte elements) and bitwise compare */
+	v = sv_alloc(sizeof(uint64_t), 0, NULL);
+	for (i = 0; i < 100; i++)
+		sv_push(&v, &u);
+	if (sv_count(v, 10, &u) != 90 || sv_find(v, 99, &u) != 99
+	    || sv_find_all(v, 0, &u, &m) != 100
+	    || sv_find(v, 100, &u) != S_NPOS)
+		res |= 1 << 20;
+	sv_free(&v);
+	v = sv_alloc_t(SV_D, 0);
+	sv_push_d(&v, nz);
+	if (sv_find_d(v, 0, z) != S_NPOS || sv_count_d(v, 0, nz) != 1)
+		res |= 1 << 21;
 #ifdef S_USE_VA_ARGS
-		res |= (sv_push(&a, &a2, &a2, &a1) ? 0 : 4);
+	sv_free(&v, &m);
 #else
-		res |= (sv_push(&a, &a2) && sv_push(&a, &a2) && sv_push(&a, &a1)
-				? 0
-				: 4);
+	sv_free(&v);
+	sv_free(&m);
 #endif
-		res |= (sv_len(a) == 3 ? 0 : 8);
-		res |= (((t = (const struct AA *)sv_pop(a)) && t->a == a1.a
-			 && t->b == a1.b)
-				? 0
-				: 16);
-		res |= (sv_len(a) == 2 ? 0 : 32);
-		res |= (sv_push(&b, &a2) ? 0 : 64);
-		res |= (sv_len(b) == 1 ? 0 : 128);
-		res |= (((t = (struct AA *)sv_pop(b)) && t->a == a2.a
-			 && t->b == a2.b)
-				? 0
-				: 256);
-		res |= (sv_len(b) == 0 ? 0 : 512);
-		sv_set(&a, 0, &a2);
-		sv_set(&a, 1000, &a1);
-		sv_set(&b, 0, &a2);
-		sv_set(&b, as - 1, &a1);
-		t = (const struct AA *)sv_at(a, 0);
-		res |= t->a == a2.a ? 0 : 1024;
-		t = (const struct AA *)sv_at(a, 1000);
-		res |= t->a == a1.a ? 0 : 2048;
-		t = (const struct AA *)sv_at(b, 0);
-		res |= t->a == a2.a ? 0 : 4096;
-		t = (const struct AA *)sv_at(b, as - 1);
-		res |= t->a == a1.a ? 0 : 8192;
+	return res;
+}
+
+#define TEST_SV_SORTED(ntest, type, T, push, bs, lb, ub, gal)                  \
+	v = sv_alloc_t(type, 180);                                             \
+	q = sv_alloc_t(type, 122);                                             \
+	for (i = 0; i < 180; i++)                                              \
+		push(&v, (T)((i / 3) * 2));                                    \
+	for (t = 0; t < 122; t++) {                                            \
+		push(&q, (T)(121 - t));                                        \
+		for (l = 0; l < 180 && (size_t)((l / 3) * 2) < t; l++)         \
+			;                                                      \
+		for (u = l; u < 180 && (size_t)((u / 3) * 2) <= t; u++)        \
+			;                                                      \
+		if (lb(v, (T)t) != (l < 180 ? l : S_NPOS)                      \
+		    || ub(v, (T)t) != (u < 180 ? u : S_NPOS)                   \
+		    || bs(v, (T)t) != (u > l ? l : S_NPOS))                    \
+			res |= 1 << (ntest * 2);                               \
+		for (o = 0; o <= 180; o += 45)                                 \
+			if (gal(v, o, (T)t) != (S_MAX(o, l) < 180 ? S_MAX(o, l) \
+								     : S_NPOS)) \
+				res |= 1 << (ntest * 2);                       \
+	}                                                                      \
+	if (sv_lookup_sorted(v, q, &out) != 60 || sv_size(out) != 122)         \
+		res |= 2 << (ntest * 2);                                       \
+	for (t = 0; t < 122 && out; t++)                                       \
+		if ((size_t)sv_at_u64(out, t) != bs(v, (T)(121 - t)))          \
+			res |= 2 << (ntest * 2);                               \
+	sv_sort(q);                                                            \
+	if (sv_lookup_sorted(v, q, &out) != 60                                 \
+	    || (size_t)sv_at_u64(out, 118) != 177                              \
+	    || (size_t)sv_at_u64(out, 121) != S_NPOS)                          \
+		res |= 2 << (ntest * 2);                                       \
+	sv_free(&v);                                                           \
+	sv_free(&q);
+
+static int test_sv_sorted_search()
+{
+	int res = 0;
+	int32_t k;
+	char e[12];
+	size_t i, t, l, u, o;
+	double nan, mnan, mz, dv[7];
+	uint64_t nanb = (uint64_t)0x7ff8 << 48, sb = (uint64_t)1 << 63;
+	srt_vector *v, *q, *out = NULL;
+	TEST_SV_SORTED(0, SV_I8, int8_t, sv_push_i8, sv_bsearch_i8,
+		       sv_lower_bound_i8, sv_upper_bound_i8, sv_gallop_i8);
+	TEST_SV_SORTED(1, SV_U8, uint8_t, sv_push_u8, sv_bsearch_u8,
+		       sv_lower_bound_u8, sv_upper_bound_u8, sv_gallop_u8);
+	TEST_SV_SORTED(2, SV_I16, int16_t, sv_push_i16, sv_bsearch_i16,
+		       sv_lower_bound_i16, sv_upper_bound_i16, sv_gallop_i16);
+	TEST_SV_SORTED(3, SV_U16, uint16_t, sv_push_u16, sv_bsearch_u16,
+		       sv_lower_bound_u16, sv_upper_bound_u16, sv_gallop_u16);
+	TEST_SV_SORTED(4, SV_I32, int32_t, sv_push_i32, sv_bsearch_i32,
+		       sv_lower_bound_i32, sv_upper_bound_i32, sv_gallop_i32);
+	TEST_SV_SORTED(5, SV_U32, uint32_t, sv_push_u32, sv_bsearch_u32,
+		       sv_lower_bound_u32, sv_upper_bound_u32, sv_gallop_u32);
+	TEST_SV_SORTED(6, SV_I64, int64_t, sv_push_i64, sv_bsearch_i64,
+		       sv_lower_bound_i64, sv_upper_bound_i64, sv_gallop_i64);
+	TEST_SV_SORTED(7, SV_U64, uint64_t, sv_push_u64, sv_bsearch_u64,
+		       sv_lower_bound_u64, sv_upper_bound_u64, sv_gallop_u64);
+	TEST_SV_SORTED(8, SV_F, float, sv_push_f, sv_bsearch_f,
+		       sv_lower_bound_f, sv_upper_bound_f, sv_gallop_f);
+	TEST_SV_SORTED(9, SV_D, double, sv_push_d, sv_bsearch_d,
+		       sv_lower_bound_d, sv_upper_bound_d, sv_gallop_d);
+	/*
+	 * Generic vector (compare function), and type mismatch
+	 */
+	v = sv_alloc(sizeof(e), 100, cmp_gen_i32);
+	q = sv_alloc(sizeof(e), 10, cmp_gen_i32);
+	memset(e, 0, sizeof(e));
+	for (i = 0; i < 100; i++) {
+		k = (int32_t)(i / 2) * 3;
+		memcpy(e, &k, sizeof(k));
+		sv_push(&v, e);
+		if (i < 10)
+			sv_push(&q, e);
 	}
-	sv_free(&a);
+	k = 30;
+	memcpy(e, &k, sizeof(k));
+	if (sv_bsearch(v, e) != 20 || sv_lower_bound(v, e) != 20
+	    || sv_upper_bound(v, e) != 22 || sv_gallop(v, 21, e) != 21
+	    || sv_gallop(v, 90, e) != 90)
+		res |= 1 << 20;
+	k = 31;
+	memcpy(e, &k, sizeof(k));
+	if (sv_bsearch(v, e) != S_NPOS || sv_lower_bound(v, e) != 22
+	    || sv_gallop(v, 0, e) != 22)
+		res |= 1 << 21;
+	if (sv_lookup_sorted(v, q, &out) != 10 || sv_at_u64(out, 9) != 8)
+		res |= 1 << 22;
+	if (sv_lower_bound_i32(v, 30) != S_NPOS
+	    || sv_lookup_sorted(v, out, &out) != 0)
+		res |= 1 << 23;
+	/*
+	 * Floating point: same total order as sv_sort(), i.e.
+	 * -NaN, -1, -0, 0, 1, NaN, NaN
+	 */
+	sv_free(&v);
+	sv_free(&q);
+	memcpy(&nan, &nanb, sizeof(nan));
+	nanb |= sb;
+	memcpy(&mnan, &nanb, sizeof(mnan));
+	memcpy(&mz, &sb, sizeof(mz));
+	dv[0] = 1;
+	dv[1] = nan;
+	dv[2] = mz;
+	dv[3] = mnan;
+	dv[4] = 0;
+	dv[5] = -1;
+	dv[6] = nan;
+	v = sv_alloc_t(SV_D, 7);
+	q = sv_alloc_t(SV_D, 1);
+	for (i = 0; i < 7; i++)
+		sv_push_d(&v, dv[i]);
+	sv_push_d(&q, nan);
+	sv_sort(v);
+	if (sv_bsearch_d(v, nan) != 5 || sv_lower_bound_d(v, nan) != 5
+	    || sv_upper_bound_d(v, nan) != S_NPOS
+	    || sv_upper_bound_d(v, 1) != 5 || sv_bsearch_d(v, mnan) != 0
+	    || sv_upper_bound_d(v, mnan) != 1 || sv_bsearch_d(v, mz) != 2
+	    || sv_lower_bound_d(v, 0) != 3 || sv_gallop_d(v, 1, nan) != 5
+	    || sv_lookup_sorted(v, q, &out) != 1 || sv_at_u64(out, 0) != 5)
+		res |= 1 << 24;
+#ifdef S_USE_VA_ARGS
+	sv_free(&v, &q, &out);
+#else
+	sv_free(&v);
+	sv_free(&q);
+	sv_free(&out);
+#endif
 	return res;
 }
 
-#define BUILD_TEST_SV_PUSH_POP_SET_X(FN, T, TID, PUSH, POP, SET, AT)           \
-	static int FN()                                                        \
-	{                                                                      \
-		size_t as = 10;                                                \
-		int i = 0, res = 0;                                            \
-		srt_vector *a = sv_alloc_t(TID, as);                           \
-		srt_vector *b = sv_alloca_t(TID, as);                          \
-		do {                                                           \
-			if (!a || !b) {                                        \
-				res |= 1 << (i * 4);                           \
-				break;                                         \
-			}                                                      \
-			if (!PUSH(&a, (T)i) || !PUSH(&b, (T)i)) {              \
-				res |= 2 << (i * 4);                           \
-				break;                                         \
-			}                                                      \
-			if (POP(a) != (T)i || POP(b) != (T)i) {                \
-				res |= 3 << (i * 4);                           \
-				break;                                         \
-			}                                                      \
-			if (sv_len(a) != 0 || sv_len(b) != 0) {                \
-				res |= 4 << (i * 4);                           \
-				break;                                         \
+#define TEST_SV_SETOPS(ntest, type, T, push, at, bs)                           \
+	for (t = 0; t < 5; t++) {                                              \
+		a = sv_alloc_t(type, 0);                                       \
+		b = sv_alloc_t(type, 0);                                       \
+		for (i = 0; i < na[t]; i++)                                    \
+			push(&a, (T)(i * 3));                                  \
+		for (i = 0; i < nb[t]; i++)                                    \
+			push(&b, (T)(i * 2 + (t & 1)));                        \
+		for (i = c = 0; i < na[t]; i++)                                \
+			c += bs(b, at(a, i)) != S_NPOS ? 1 : 0;                \
+		for (op = 0; op < 4; op++) {                                   \
+			if (op == 0)                                           \
+				sv_intersect(&o, a, b);                        \
+			else if (op == 1)                                      \
+				sv_union(&o, a, b);                            \
+			else if (op == 2)                                      \
+				sv_difference(&o, a, b);                       \
+			else                                                   \
+				sv_intersect(&a, a, b);                        \
+			r = op == 3 ? a : o;                                   \
+			if (sv_size(r) != (op == 1	? na[t] + nb[t] - c    \
+					   : op == 2 ? na[t] - c               \
+						     : c))                     \
+				res |= 1 << (ntest * 3 + op % 3);              \
+			for (i = 0; i < sv_size(r); i++) {                     \
+				x = at(r, i);                                  \
+				ia = bs(op == 3 ? b : a, x) != S_NPOS;         \
+				ib = bs(b, x) != S_NPOS;                       \
+				if ((i > 0 && !(at(r, i - 1) < x))             \
+				    || (op == 1 ? !(ia || ib)                  \
+					: op == 2 ? !ia || ib                  \
+						  : !ia || !ib))               \
+					res |= 1 << (ntest * 3 + op % 3);      \
 			}                                                      \
-			SET(&a, 0, (T)-2);                                     \
-			SET(&a, 1000, (T)-1);                                  \
-			SET(&b, 0, (T)-2);                                     \
-			SET(&b, as - 1, (T)-1);                                \
-			res |= AT(a, 0) == (T)-2 ? 0 : -1;                     \
-			res |= AT(a, 1000) == (T)-1 ? 0 : -1;                  \
-			res |= AT(b, 0) == (T)-2 ? 0 : -1;                     \
-			res |= AT(b, as - 1) == (T)-1 ? 0 : -1;                \
-		} while (0);                                                   \
+		}                                                              \
+		sv_free(&a);                                                   \
+		sv_free(&b);                                                   \
+	}
+
+static int test_sv_setops()
+{
+	int res = 0, op;
+	srt_bool ia, ib;
+	int32_t k;
+	char e[12];
+	size_t i, t, c, na[5] = {200, 2, 300, 0, 150},
+			 nb[5] = {300, 300, 3, 10, 150};
+	float nan;
+	srt_vector *a, *b, *o = NULL, *r;
+	{
+		int32_t x;
+		TEST_SV_SETOPS(0, SV_I32, int32_t, sv_push_i32, sv_at_i32,
+			       sv_bsearch_i32);
+	}
+	{
+		uint32_t x;
+		TEST_SV_SETOPS(1, SV_U32, uint32_t, sv_push_u32, sv_at_u32,
+			       sv_bsearch_u32);
+	}
+	{
+		int64_t x;
+		TEST_SV_SETOPS(2, SV_I64, int64_t, sv_push_i64, sv_at_i64,
+			       sv_bsearch_i64);
+	}
+	{
+		uint64_t x;
+		TEST_SV_SETOPS(3, SV_U64, uint64_t, sv_push_u64, sv_at_u64,
+			       sv_bsearch_u64);
+	}
+	{
+		int16_t x;
+		TEST_SV_SETOPS(4, SV_I16, int16_t, sv_push_i16, sv_at_i16,
+			       sv_bsearch_i16);
+	}
+	{
+		double x;
+		TEST_SV_SETOPS(5, SV_D, double, sv_push_d, sv_at_d,
+			       sv_bsearch_d);
+	}
+	/*
+	 * Deduplication, aliasing and generic vectors
+	 */
+	a = sv_alloc_t(SV_U8, 0);
+	for (i = 0; i < 20; i++)
+		sv_push_u8(&a, (uint8_t)(i / 3));
+	sv_unique(a);
+	for (i = 0; i < sv_size(a); i++)
+		if (sv_at_u8(a, i) != i)
+			res |= 1 << 20;
+	res |= sv_size(a) == 7 ? 0 : 1 << 20;
+	b = sv_dup(a);
+	sv_push_u8(&b, 100);
+	sv_union(&a, a, b);
+	res |= sv_size(a) == 8 && sv_at_u8(a, 7) == 100 ? 0 : 1 << 21;
+	sv_difference(&b, a, b);
+	res |= sv_size(b) == 0 ? 0 : 1 << 21;
+	sv_free(&a);
+	sv_free(&b);
+	a = sv_alloc(sizeof(e), 0, cmp_gen_i32);
+	b = sv_alloc(sizeof(e), 0, cmp_gen_i32);
+	memset(e, 0, sizeof(e));
+	for (i = 0; i < 30; i++) {
+		k = (int32_t)(i / 2);
+		memcpy(e, &k, sizeof(k));
+		sv_push(&a, e);
+		k = (int32_t)i + 10;
+		memcpy(e, &k, sizeof(k));
+		sv_push(&b, e);
+	}
+	sv_unique(a);
+	res |= sv_size(a) == 15 ? 0 : 1 << 22;
+	sv_intersect(&o, a, b);
+	res |= sv_size(o) == 5 && key_gen_i32(sv_at(o, 0)) == 10 ? 0 : 1 << 23;
+	sv_union(&o, a, b);
+	res |= sv_size(o) == 40 && key_gen_i32(sv_at(o, 39)) == 39 ? 0 : 1 << 23;
+	sv_difference(&o, a, b);
+	res |= sv_size(o) == 10 && key_gen_i32(sv_at(o, 9)) == 9 ? 0 : 1 << 23;
+	sv_intersect(&o, a, o);
+	res |= sv_size(o) == 10 ? 0 : 1 << 23;
+	/* Floating point: NaN runs collapse, NaN elements are matched */
+	sv_free(&a);
+	sv_free(&b);
+	nan = 0;
+	nan = nan / nan;
+	a = sv_alloc_t(SV_F, 0);
+	b = sv_alloc_t(SV_F, 0);
+	for (i = 0; i < 4; i++)
+		sv_push_f(&a, i ? nan : 1);
+	sv_push_f(&b, nan);
+	sv_unique(sv_sort(a));
+	sv_intersect(&o, a, b);
+	res |= sv_size(a) == 2 && sv_size(o) == 1 ? 0 : 1 << 24;
+	sv_difference(&o, a, b);
+	res |= sv_size(o) == 1 && sv_at_f(o, 0) == 1 ? 0 : 1 << 24;
+	sv_union(&o, a, b);
+	res |= sv_size(o) == 2 ? 0 : 1 << 24;
+#ifdef S_USE_VA_ARGS
+	sv_free(&a, &b, &o);
+#else
+	sv_free(&a);
+	sv_free(&b);
+	sv_free(&o);
+#endif
+	return res;
+}
+
+#define TEST_SV_SELECT(ntest, type, T, push, at)                               \
+	v = sv_alloc_t(type, n);                                               \
+	for (i = 0, r = 1; i < n; i++, r = r * 1103515245 + 12345)             \
+		push(&v, (T)((int)((r >> 8) % 251) - 50));                     \
+	s = sv_dup(v);                                                         \
+	sv_sort(s);                                                            \
+	for (t = 0; t < 5; t++) {                                              \
+		w = sv_dup(v);                                                 \
+		sv_nth_element(w, ks[t]);                                      \
+		for (i = 0; i < n && ks[t] < n; i++)                           \
+			if (at(w, ks[t]) != at(s, ks[t])                       \
+			    || (i < ks[t] && at(s, ks[t]) < at(w, i))          \
+			    || (i > ks[t] && at(w, i) < at(s, ks[t])))         \
+				res |= 1 << (ntest * 3);                       \
+		sv_free(&w);                                                   \
+		w = sv_dup(v);                                                 \
+		sv_partial_sort(w, ks[t]);                                     \
+		for (i = 0; i < n && i < ks[t]; i++)                           \
+			if (at(w, i) != at(s, i))                              \
+				res |= 1 << (ntest * 3 + 1);                   \
+		sv_top_k(&w, w, ks[t]);                                        \
+		if (sv_size(w) != S_MIN(ks[t], n))                             \
+			res |= 1 << (ntest * 3 + 2);                           \
+		for (i = 0; i < sv_size(w); i++)                               \
+			if (at(w, i) != at(s, n - 1 - i))                      \
+				res |= 1 << (ntest * 3 + 2);                   \
+		sv_free(&w);                                                   \
+	}                                                                      \
+	sv_free(&v);                                                           \
+	sv_free(&s);
+
+static int test_sv_select()
+{
+	int res = 0;
+	char e[12];
+	int32_t k;
+	uint32_t r;
+	size_t i, t, n = 1000, ks[5] = {0, 1, 100, 999, 1000};
+	srt_vector *v, *s, *w;
+	TEST_SV_SELECT(0, SV_I8, int8_t, sv_push_i8, sv_at_i8);
+	TEST_SV_SELECT(1, SV_U8, uint8_t, sv_push_u8, sv_at_u8);
+	TEST_SV_SELECT(2, SV_I16, int16_t, sv_push_i16, sv_at_i16);
+	TEST_SV_SELECT(3, SV_I32, int32_t, sv_push_i32, sv_at_i32);
+	TEST_SV_SELECT(4, SV_U32, uint32_t, sv_push_u32, sv_at_u32);
+	TEST_SV_SELECT(5, SV_I64, int64_t, sv_push_i64, sv_at_i64);
+	TEST_SV_SELECT(6, SV_F, float, sv_push_f, sv_at_f);
+	TEST_SV_SELECT(7, SV_D, double, sv_push_d, sv_at_d);
+	/*
+	 * Generic elements (introselect)
+	 */
+	v = sv_alloc(sizeof(e), n, cmp_gen_i32);
+	memset(e, 0, sizeof(e));
+	for (i = 0, r = 1; i < n; i++, r = r * 1103515245 + 12345) {
+		k = (int32_t)((r >> 8) % 251) - 50;
+		memcpy(e, &k, sizeof(k));
+		sv_push(&v, e);
+	}
+	s = sv_dup(v);
+	sv_sort(s);
+	for (t = 0; t < 5; t++) {
+		w = sv_dup(v);
+		sv_nth_element(w, ks[t]);
+		if (ks[t] < n
+		    && key_gen_i32(sv_at(w, ks[t]))
+			       != key_gen_i32(sv_at(s, ks[t])))
+			res |= 1 << 24;
+		sv_partial_sort(w, ks[t]);
+		for (i = 0; i < n && i < ks[t]; i++)
+			if (key_gen_i32(sv_at(w, i)) != key_gen_i32(sv_at(s, i)))
+				res |= 1 << 25;
+		sv_top_k(&w, v, ks[t]);
+		res |= sv_size(w) == S_MIN(ks[t], n) ? 0 : 1 << 26;
+		for (i = 0; i < sv_size(w); i++)
+			if (key_gen_i32(sv_at(w, i))
+			    != key_gen_i32(sv_at(s, n - 1 - i)))
+				res |= 1 << 26;
+		sv_free(&w);
+	}
+#ifdef S_USE_VA_ARGS
+	sv_free(&v, &s);
+#else
+	sv_free(&v);
+	sv_free(&s);
+#endif
+	return res;
+}
+
+static int test_sv_ops()
+{
+	int res = 0;
+	size_t i, n = 300001;
+	int8_t i8a, i8b;
+	uint8_t u8a;
+	int32_t ia, ib, lo = -10, hi = 10;
+	int64_t s, s2;
+	uint64_t u;
+	float fa, fb, nan;
+	double d;
+	char e[12], emin[12], emax[12];
+	srt_vector *v = sv_alloc_t(SV_I32, n), *w = NULL;
+	for (i = 0; i < n; i++)
+		sv_push_i32(&v, (int32_t)(i * 7 % 1000) - 500);
+	/*
+	 * Sum and min/max, single and multiple threads
+	 */
+	for (i = 0, s2 = 0; i < n; i++)
+		s2 += sv_at_i32(v, i);
+	res |= sv_sum_i(v, &s) && s == s2 ? 0 : 1 << 0;
+	res |= sv_sum_i_parallel(v, &s, 4) && s == s2 ? 0 : 1 << 0;
+	res |= sv_sum(v) == (double)s2 && sv_sum_parallel(v, 3) == (double)s2
+		       ? 0
+		       : 1 << 0;
+	res |= !sv_sum_u(v, &u) && u == 0 ? 0 : 1 << 1; /* negative */
+	res |= sv_minmax(v, &ia, &ib) && ia == -500 && ib == 499 ? 0 : 1 << 2;
+	ia = ib = 0;
+	res |= sv_minmax_parallel(v, &ia, &ib, 4) && ia == -500 && ib == 499
+		       ? 0
+		       : 1 << 2;
+	/*
+	 * Element-wise operations
+	 */
+	w = sv_dup(v);
+	res |= sv_add_parallel(w, v, 4)
+			       && sv_at_i32(w, n - 1) == 2 * sv_at_i32(v, n - 1)
+		       ? 0
+		       : 1 << 3;
+	sv_clamp(w, &lo, &hi);
+	res |= sv_min(w, &ia) && sv_max(w, &ib) && ia == lo && ib == hi
+		       ? 0
+		       : 1 << 4;
+	sv_scale(w, -0.5);
+	res |= sv_minmax(w, &ia, &ib) && ia == -5 && ib == 5 ? 0 : 1 << 4;
+	sv_free(&w);
+	w = sv_alloc_t(SV_I16, 0);
+	res |= !sv_add(v, w) ? 0 : 1 << 5; /* different type */
+	sv_free(&w);
+	w = sv_alloc_t(SV_I8, 0);
+	res |= !sv_minmax(w, &i8a, &i8b) ? 0 : 1 << 5; /* empty */
+	sv_push_i8(&w, 100);
+	sv_push_i8(&w, -100);
+	sv_push_i8(&w, 3);
+	sv_scale(w, 2);
+	res |= sv_at_i8(w, 0) == 127 && sv_at_i8(w, 1) == -128
+			       && sv_at_i8(w, 2) == 6
+		       ? 0
+		       : 1 << 6;
+	res |= sv_sum_i(w, &s) && s == 5 ? 0 : 1 << 6;
+	sv_free(&w);
+	/*
+	 * Overflow detection
+	 */
+	w = sv_alloc_t(SV_U8, 0);
+	for (i = 0; i < 1000; i++)
+		sv_push_u8(&w, 200);
+	sv_add(w, w);
+	res |= sv_at_u8(w, 999) == 144 && sv_sum_u(w, &u) && u == 144000
+		       ? 0
+		       : 1 << 7;
+	res |= sv_max(w, &u8a) && u8a == 144 ? 0 : 1 << 7;
+	sv_free(&w);
+	w = sv_alloc_t(SV_I64, 0);
+	sv_push_i64(&w, INT64_MAX);
+	sv_push_i64(&w, -1);
+	res |= sv_sum_i(w, &s) && s == INT64_MAX - 1 ? 0 : 1 << 8;
+	sv_push_i64(&w, 2);
+	res |= !sv_sum_i(w, &s) && s == INT64_MAX ? 0 : 1 << 8;
+	sv_free(&w);
+	w = sv_alloc_t(SV_U64, 0);
+	sv_push_u64(&w, (uint64_t)-1);
+	res |= !sv_sum_i(w, &s) && sv_sum_u(w, &u) && u == (uint64_t)-1
+		       ? 0
+		       : 1 << 8;
+	sv_push_u64(&w, 1);
+	res |= !sv_sum_u(w, &u) ? 0 : 1 << 8;
+	sv_free(&w);
+	/*
+	 * Mixed-sign 64-bit elements: only the final sum is range checked
+	 */
+	w = sv_alloc_t(SV_I64, 0);
+	sv_push_i64(&w, INT64_MAX);
+	sv_push_i64(&w, 1);
+	sv_push_i64(&w, -1);
+	res |= sv_sum_i(w, &s) && s == INT64_MAX ? 0 : 1 << 12;
+	sv_set_size(w, 0);
+	sv_push_i64(&w, INT64_MIN);
+	sv_push_i64(&w, -1);
+	sv_push_i64(&w, INT64_MAX);
+	sv_push_i64(&w, 1);
+	res |= sv_sum_i(w, &s) && s == -1 && !sv_sum_u(w, &u) && u == 0
+		       ? 0
+		       : 1 << 12;
+	sv_set_size(w, 0);
+	sv_push_i64(&w, INT64_MAX);
+	sv_push_i64(&w, INT64_MAX);
+	res |= sv_sum_u(w, &u) && u == (uint64_t)-2 && !sv_sum_i(w, &s)
+			       && s == INT64_MAX
+		       ? 0
+		       : 1 << 12;
+	sv_set_size(w, 0);
+	for (i = 0; i < n; i++)
+		sv_push_i64(&w, i % 2 ? INT64_MIN + 1 : INT64_MAX);
+	res |= sv_sum_i(w, &s) && s == INT64_MAX
+			       && sv_sum_i_parallel(w, &s2, 4) && s2 == s
+		       ? 0
+		       : 1 << 12;
+	sv_push_i64(&w, INT64_MAX);
+	res |= sv_sum_u(w, &u) && u == (uint64_t)INT64_MAX * 2
+			       && sv_sum_u_parallel(w, &u, 4)
+			       && u == (uint64_t)INT64_MAX * 2
+			       && !sv_sum_i_parallel(w, &s, 4) && s == INT64_MAX
+		       ? 0
+		       : 1 << 12;
+	sv_free(&w);
+	w = sv_alloc_t(SV_U64, 0);
+	for (i = 0; i < n; i++)
+		sv_push_u64(&w, i % 2 ? (uint64_t)-1 : 0);
+	res |= !sv_sum_u(w, &u) && u == (uint64_t)-1
+			       && !sv_sum_u_parallel(w, &u, 4)
+			       && u == (uint64_t)-1
+		       ? 0
+		       : 1 << 12;
+	sv_free(&w);
+	/*
+	 * Floating point (NaN elements ignored by min/max)
+	 */
+	w = sv_alloc_t(SV_F, 0);
+	nan = 0;
+	nan = nan / nan;
+	sv_push_f(&w, nan);
+	for (i = 0; i < 20; i++)
+		sv_push_f(&w, (float)i - 5);
+	res |= sv_minmax(w, &fa, &fb) && fa == -5 && fb == 14 ? 0 : 1 << 9;
+	sv_free(&w);
+	w = sv_alloc_t(SV_D, 0);
+	for (i = 0; i < 101; i++)
+		sv_push_d(&w, 0.5);
+	sv_scale(w, 3);
+	d = sv_sum(w);
+	res |= d == 151.5 && !sv_sum_i(w, &s) ? 0 : 1 << 10;
+	sv_free(&w);
+	/*
+	 * Generic elements: min/max and clamp using the compare function
+	 */
+	w = sv_alloc(sizeof(e), 0, cmp_gen_i32);
+	memset(e, 0, sizeof(e));
+	for (i = 0; i < 100; i++) {
+		ia = (int32_t)(i * 13 % 100) - 50;
+		memcpy(e, &ia, sizeof(ia));
+		sv_push(&w, e);
+	}
+	res |= sv_minmax(w, emin, emax) && key_gen_i32(emin) == -50
+			       && key_gen_i32(emax) == 49
+		       ? 0
+		       : 1 << 11;
+	ia = 0;
+	memcpy(emin, &ia, sizeof(ia));
+	sv_clamp(w, emin, emax);
+	res |= sv_min(w, e) && key_gen_i32(e) == 0 ? 0 : 1 << 11;
+	res |= sv_sum(w) == 0 && !sv_add(w, w) ? 0 : 1 << 11;
+#ifdef S_USE_VA_ARGS
+	sv_free(&v, &w);
+#else
+	sv_free(&v);
+	sv_free(&w);
+#endif
+	return res;
+}
+
+#define TEST_SV_PACK(ntest, type, T, push, at, x0, step, noise)                \
+	for (t = 0; t < 7; t++) {                                              \
+		v = sv_alloc_t(type, 0);                                       \
+		for (i = 0; i < ns[t]; i++)                                    \
+			push(&v, (T)((T)x0 + (T)(i * step)                     \
+				     + (T)(t & 1 ? (i * 7919) % noise : 0)));  \
+		sv_compress(&c, v);                                            \
+		sv_decompress(&w, c);                                          \
+		if (sv_compressed_elems(c) != ns[t] || sv_size(w) != ns[t]     \
+		    || w->d.sub_type != type                                   \
+		    || (ns[t] && memcmp(sv_get_buffer_r(v), sv_get_buffer_r(w), \
+					ns[t] * sizeof(T))))                   \
+			res |= 1 << (ntest * 2);                               \
+		for (i = off = 0; (off = sv_decompress_block(&w, c, off));)    \
+			for (j = 0; j < sv_size(w); j++, i++)                  \
+				if (at(w, j) != at(v, i))                      \
+					res |= 1 << (ntest * 2 + 1);           \
+		if (i != ns[t] || sv_size(w))                                  \
+			res |= 1 << (ntest * 2 + 1);                           \
+		sv_free(&v);                                                   \
+	}
+
+static int test_sv_compress()
+{
+	int res = 0;
+	size_t i, j, t, off, ns[7] = {0, 1, 5, 127, 128, 129, 10000};
+	srt_vector *v = NULL, *w = NULL, *c = NULL;
+	TEST_SV_PACK(0, SV_U8, uint8_t, sv_push_u8, sv_at_u8, 0, 1, 3);
+	TEST_SV_PACK(1, SV_I8, int8_t, sv_push_i8, sv_at_i8, -128, 1, 5);
+	TEST_SV_PACK(2, SV_U16, uint16_t, sv_push_u16, sv_at_u16, 0, 7, 100);
+	TEST_SV_PACK(3, SV_I16, int16_t, sv_push_i16, sv_at_i16, -30000, 3,
+		     1000);
+	TEST_SV_PACK(4, SV_U32, uint32_t, sv_push_u32, sv_at_u32, 100, 37,
+		     1000000);
+	TEST_SV_PACK(5, SV_I32, int32_t, sv_push_i32, sv_at_i32, -5000, 13,
+		     100);
+	TEST_SV_PACK(6, SV_U64, uint64_t, sv_push_u64, sv_at_u64,
+		     (uint64_t)-1 / 2, 12345678901ULL, 1000);
+	TEST_SV_PACK(7, SV_I64, int64_t, sv_push_i64, sv_at_i64, INT64_MIN,
+		     999, 100000);
+	/*
+	 * Sorted ids with small gaps: 1 byte per element (vs 4)
+	 */
+	v = sv_alloc_t(SV_U32, 0);
+	for (i = 0; i < 100000; i++)
+		sv_push_u32(&v, (uint32_t)(i * 50 + i % 7));
+	sv_compress(&c, v);
+	res |= sv_size(c) < 100000 * 11 / 10 ? 0 : 1 << 16;
+	/*
+	 * Aliasing, full 64-bit range, and invalid input
+	 */
+	sv_compress(&v, v);
+	sv_decompress(&v, v);
+	res |= sv_size(v) == 100000 && sv_at_u32(v, 99999) == 99999 * 50 + 4
+		       ? 0
+		       : 1 << 17;
+	sv_free(&v);
+	v = sv_alloc_t(SV_I64, 0);
+	sv_push_i64(&v, INT64_MAX);
+	sv_push_i64(&v, INT64_MIN);
+	sv_push_i64(&v, 0);
+	sv_compress(&c, v);
+	sv_decompress(&w, c);
+	res |= sv_size(w) == 3 && sv_at_i64(w, 0) == INT64_MAX
+			       && sv_at_i64(w, 1) == INT64_MIN
+			       && sv_at_i64(w, 2) == 0
+		       ? 0
+		       : 1 << 18;
+	sv_set_size(c, sv_size(c) - 1);
+	sv_decompress(&w, c);
+	res |= sv_size(w) == 0 && !sv_decompress_block(&w, c, 0) ? 0 : 1 << 18;
+	sv_compress(&c, v);
+	((uint8_t *)sv_get_buffer(c))[8] = 0xdc; /* element count: 0xdc...03 */
+	sv_free(&w);
+	sv_decompress(&w, c);
+	res |= sv_size(w) == 0 && sv_max_size(w) < 1000
+			       && sv_compressed_elems(c) == 0
+		       ? 0
+		       : 1 << 20;
+	sv_free(&v);
+	v = sv_alloc_t(SV_F, 0);
+	sv_push_f(&v, 1);
+	res |= sv_compressed_elems(v) == 0 ? 0 : 1 << 19;
+#ifdef S_USE_VA_ARGS
+	sv_free(&v, &w, &c);
+#else
+	sv_free(&v);
+	sv_free(&w);
+	sv_free(&c);
+#endif
+	return res;
+}
+
+static int test_sv_push_pop_set()
+{
+	size_t as = 10;
+	srt_vector *a = sv_alloc(sizeof(struct AA), as, NULL),
+		   *b = sv_alloca(sizeof(struct AA), as, NULL);
+	const struct AA *t = NULL;
+	int res = (!a || !b) ? 1 : 0;
+	if (!res) {
+#ifdef S_USE_VA_ARGS
+		res |= (sv_push(&a, &a2, &a2, &a1) ? 0 : 4);
+#else
+		res |= (sv_push(&a, &a2) && sv_push(&a, &a2) && sv_push(&a, &a1)
+				? 0
+				: 4);
+#endif
+		res |= (sv_len(a) == 3 ? 0 : 8);
+		res |= (((t = (const struct AA *)sv_pop(a)) && t->a == a1.a
+			 && t->b == a1.b)
+				? 0
+				: 16);
+		res |= (sv_len(a) == 2 ? 0 : 32);
+		res |= (sv_push(&b, &a2) ? 0 : 64);
+		res |= (sv_len(b) == 1 ? 0 : 128);
+		res |= (((t = (struct AA *)sv_pop(b)) && t->a == a2.a
+			 && t->b == a2.b)
+				? 0
+				: 256);
+		res |= (sv_len(b) == 0 ? 0 : 512);
+		sv_set(&a, 0, &a2);
+		sv_set(&a, 1000, &a1);
+		sv_set(&b, 0, &a2);
+		sv_set(&b, as - 1, &a1);
+		t = (const struct AA *)sv_at(a, 0);
+		res |= t->a == a2.a ? 0 : 1024;
+		t = (const struct AA *)sv_at(a, 1000);
+		res |= t->a == a1.a ? 0 : 2048;
+		t = (const struct AA *)sv_at(b, 0);
+		res |= t->a == a2.a ? 0 : 4096;
+		t = (const struct AA *)sv_at(b, as - 1);
+		res |= t->a == a1.a ? 0 : 8192;
+	}
+	sv_free(&a);
+	return res;
+}
+
+#define BUILD_TEST_SV_PUSH_POP_SET_X(FN, T, TID, PUSH, POP, SET, AT)           \
+	static int FN()                                                        \
+	{                                                                      \
+		size_t as = 10;                                                \
+		int i = 0, res = 0;                                            \
+		srt_vector *a = sv_alloc_t(TID, as);                           \
+		srt_vector *b = sv_alloca_t(TID, as);                          \
+		do {                                                           \
+			if (!a || !b) {                                        \
+				res |= 1 << (i * 4);                           \
+				break;                                         \
+			}                                                      \
+			if (!PUSH(&a, (T)i) || !PUSH(&b, (T)i)) {              \
+				res |= 2 << (i * 4);                           \
+				break;                                         \
+			}                                                      \
+			if (POP(a) != (T)i || POP(b) != (T)i) {                \
+				res |= 3 << (i * 4);                           \
+				break;                                         \
+			}                                                      \
+			if (sv_len(a) != 0 || sv_len(b) != 0) {                \
+				res |= 4 << (i * 4);                           \
+				break;                                         \
+			}                                                      \
+			SET(&a, 0, (T)-2);                                     \
+			SET(&a, 1000, (T)-1);                                  \
+			SET(&b, 0, (T)-2);                                     \
+			SET(&b, as - 1, (T)-1);                                \
+			res |= AT(a, 0) == (T)-2 ? 0 : -1;                     \
+			res |= AT(a, 1000) == (T)-1 ? 0 : -1;                  \
+			res |= AT(b, 0) == (T)-2 ? 0 : -1;                     \
+			res |= AT(b, as - 1) == (T)-1 ? 0 : -1;                \
+		} while (0);                                                   \
 		sv_free(&a);                                                   \
 		return res;                                                    \
 	}
@@ -3478,6 +4824,146 @@ static int test_sv_push_raw()
 	return res;
 }
 
+struct TRec {
+	int32_t k;
+	double x;
+	uint8_t g;
+};
+
+static int test_stb()
+{
+	int res = 0;
+	size_t i, n = 1000, offs[3], keys[2] = {2, 0};
+	int32_t k, kprev;
+	uint8_t g, gprev;
+	double x, dmin, dmax;
+	const void *f[3];
+	void *o[3];
+	struct TRec r;
+	enum eSV_Type ty[3] = {SV_I32, SV_D, SV_U8},
+		      bad[2] = {SV_I32, SV_GEN};
+	srt_vector *recs = sv_alloc(sizeof(struct TRec), n, NULL),
+		   *m = NULL, *idx = NULL;
+	srt_table *t = stb_alloc(ty, 3, 0), *t2 = NULL;
+	offs[0] = offsetof(struct TRec, k);
+	offs[1] = offsetof(struct TRec, x);
+	offs[2] = offsetof(struct TRec, g);
+	res |= !stb_alloc(bad, 2, 0) && !stb_alloc(ty, 0, 0) && t
+		       && stb_ncols(t) == 3 && stb_col_type(t, 2) == SV_U8
+		       && stb_col_type(t, 3) == SV_GEN && !stb_col(t, 3)
+		       ? 0
+		       : 1;
+	/*
+	 * Append: field pointers, record, and record vector
+	 */
+	k = 7;
+	x = 0.5;
+	g = 3;
+	f[0] = &k;
+	f[1] = &x;
+	f[2] = &g;
+	res |= stb_push_row(t, f) && stb_size(t) == 1 ? 0 : 2;
+	for (i = 1; i < n; i++) {
+		r.k = (int32_t)(i % 10);
+		r.x = (double)i;
+		r.g = (uint8_t)(i % 3);
+		if (i < 10)
+			stb_push_rec(t, &r, offs);
+		else
+			sv_push(&recs, &r);
+	}
+	res |= stb_push_recs(t, recs, offs) && stb_size(t) == n
+		       && sv_size(stb_col(t, 1)) == n
+		       ? 0
+		       : 4;
+	res |= !stb_push_recs(t, stb_col(t, 0), offs) ? 0 : 8;
+	/*
+	 * Column scans with the vector functions
+	 */
+	res |= sv_minmax(stb_col(t, 1), &dmin, &dmax) && dmin == 0.5
+		       && dmax == (double)(n - 1)
+		       ? 0
+		       : 16;
+	res |= sv_find_all_i32(stb_col(t, 0), 0, 7, &m) == 101 ? 0 : 32;
+	/*
+	 * Row access
+	 */
+	res |= stb_get_rec(t, 123, &r, offs) && r.k == 3 && r.x == 123
+		       && r.g == 0
+		       ? 0
+		       : 64;
+	o[0] = &k;
+	o[1] = NULL;
+	o[2] = &g;
+	x = -1;
+	res |= stb_get_row(t, 0, o) && k == 7 && g == 3 && x == -1
+		       && !stb_get_row(t, n, o)
+		       ? 0
+		       : 128;
+	x = 1.5;
+	res |= stb_set(t, 1, 0, &x) && *(const double *)stb_at(t, 1, 0) == 1.5
+		       && !stb_set(t, 1, n, &x) && !stb_at(t, 0, n)
+		       ? 0
+		       : 256;
+	/*
+	 * Multi-key stable sort (g, then k; equal keys: input row order)
+	 */
+	res |= !stb_sort(t, keys, 0) ? 0 : 512;
+	t2 = stb_dup(t);
+	res |= stb_sort(t, keys, 2) && stb_size(t) == n ? 0 : 1024;
+	for (i = 1; i < n; i++) {
+		stb_get_rec(t, i - 1, &r, offs);
+		gprev = r.g;
+		kprev = r.k;
+		x = r.x;
+		stb_get_rec(t, i, &r, offs);
+		if (gprev > r.g || (gprev == r.g && kprev > r.k)
+		    || (gprev == r.g && kprev == r.k && x >= r.x)) {
+			res |= 2048;
+			break;
+		}
+	}
+	/*
+	 * Filter by mask (k == 7: 101 rows, in the original order)
+	 */
+	res |= stb_filter(t2, m) == 101 && stb_size(t2) == 101 ? 0 : 4096;
+	for (i = 0; i < stb_size(t2); i++)
+		if (*(const int32_t *)stb_at(t2, 0, i) != 7
+		    || (i && *(const double *)stb_at(t2, 1, i)
+				     != (double)(i * 10 - 3))) {
+			res |= 8192;
+			break;
+		}
+	/*
+	 * Gather, permute (invalid index: no changes), and clear
+	 */
+	idx = sv_alloc_t(SV_U32, 0);
+	sv_push_u32(&idx, 2);
+	sv_push_u32(&idx, 0);
+	stb_free(&t);
+	t = stb_gather(t2, idx);
+	res |= t && stb_size(t) == 2 && *(const int32_t *)stb_at(t, 0, 0) == 7
+		       && *(const double *)stb_at(t, 1, 0) == 17
+		       && *(const double *)stb_at(t, 1, 1) == 1.5
+		       ? 0
+		       : 16384;
+	sv_push_u32(&idx, 101);
+	res |= !stb_permute(t2, idx) && stb_size(t2) == 101 ? 0 : 32768;
+	stb_clear(t2);
+	res |= stb_size(t2) == 0 && stb_filter(t2, m) == 0 ? 0 : 65536;
+#ifdef S_USE_VA_ARGS
+	stb_free(&t, &t2);
+	sv_free(&recs, &m, &idx);
+#else
+	stb_free(&t);
+	stb_free(&t2);
+	sv_free(&recs);
+	sv_free(&m);
+	sv_free(&idx);
+#endif
+	return res;
+}
+
 struct MyNode1 {
 	struct S_Node n;
 	int k;
@@ -3492,7 +4978,7 @@ static int cmp1(const struct MyNode1 *a, const struct MyNode1 *b)
 #ifdef S_EXTRA_TREE_TEST_DEBUG
 static void ndx2s(char *out, size_t out_max, const srt_tndx id)
 {
-	if (id == ST_NIL)
+	if (id == ST_NIL || id == ST_NIL_C) /* ST_NIL_C: raw compact link */
 		strcpy(out, "nil");
 	else
 		snprintf(out, out_max, "%u", (unsigned)id);
@@ -4616,6 +6102,1170 @@ static int test_sm_double_rotation()
 	return res;
 }
 
+static int test_sm_bounds()
+{
+	int res = 0;
+	int32_t i;
+	srt_tndx ndx;
+	srt_map *m_ii32 = sm_alloc(SM_II32, 0), *m_uu32 = sm_alloc(SM_UU32, 0),
+		*m_ii = sm_alloc(SM_II, 0), *m_ff = sm_alloc(SM_FF, 0),
+		*m_dd = sm_alloc(SM_DD, 0), *m_si = sm_alloc(SM_SI, 0),
+		*m_ss = sm_alloc(SM_SS, 0);
+	srt_set *s_i32 = sms_alloc(SMS_I32, 0);
+	const srt_string *k[] = {ss_crefa("k010"), ss_crefa("k020"),
+				 ss_crefa("k030"), ss_crefa("k040")};
+	/*
+	 * Empty map and wrong type
+	 */
+	res |= sm_lower_bound_i32(m_ii32, 0) == ST_NIL
+			       && sm_floor_i32(m_ii32, 0) == ST_NIL
+			       && sm_lower_bound_i(m_ii32, 0) == ST_NIL
+			       && sm_ceil_s(m_ii, k[0]) == ST_NIL
+		       ? 0
+		       : 1 << 0;
+	/*
+	 * Keys: 10, 20, 30, 40 (inserted in non-sorted order)
+	 */
+	for (i = 4; i > 0; i -= 2) {
+		sm_insert_ii32(&m_ii32, i * 10, -i);
+		sm_insert_uu32(&m_uu32, (uint32_t)i * 10, (uint32_t)i);
+		sm_insert_ii(&m_ii, i * 10, -i);
+		sm_insert_ff(&m_ff, (float)i * 10, (float)-i);
+		sm_insert_dd(&m_dd, (double)i * 10, (double)-i);
+		sm_insert_si(&m_si, k[i - 1], -i);
+		sm_insert_ss(&m_ss, k[i - 1], k[i - 1]);
+		sms_insert_i32(&s_i32, i * 10);
+	}
+	for (i = 1; i < 4; i += 2) {
+		sm_insert_ii32(&m_ii32, i * 10, -i);
+		sm_insert_uu32(&m_uu32, (uint32_t)i * 10, (uint32_t)i);
+		sm_insert_ii(&m_ii, i * 10, -i);
+		sm_insert_ff(&m_ff, (float)i * 10, (float)-i);
+		sm_insert_dd(&m_dd, (double)i * 10, (double)-i);
+		sm_insert_si(&m_si, k[i - 1], -i);
+		sm_insert_ss(&m_ss, k[i - 1], k[i - 1]);
+		sms_insert_i32(&s_i32, i * 10);
+	}
+	/*
+	 * Exact match, in between, and out of range
+	 */
+	ndx = sm_lower_bound_i32(m_ii32, 20);
+	res |= sm_it_i32_k(m_ii32, ndx) == 20 && sm_it_ii32_v(m_ii32, ndx) == -2
+		       ? 0
+		       : 1 << 1;
+	res |= sm_it_i32_k(m_ii32, sm_upper_bound_i32(m_ii32, 20)) == 30
+			       && sm_it_i32_k(m_ii32, sm_floor_i32(m_ii32, 20))
+					  == 20
+			       && sm_it_i32_k(m_ii32, sm_ceil_i32(m_ii32, 20))
+					  == 20
+		       ? 0
+		       : 1 << 2;
+	res |= sm_it_i32_k(m_ii32, sm_lower_bound_i32(m_ii32, 25)) == 30
+			       && sm_it_i32_k(m_ii32,
+					      sm_upper_bound_i32(m_ii32, 25))
+					  == 30
+			       && sm_it_i32_k(m_ii32, sm_floor_i32(m_ii32, 25))
+					  == 20
+			       && sm_it_i32_k(m_ii32, sm_ceil_i32(m_ii32, 25))
+					  == 30
+		       ? 0
+		       : 1 << 3;
+	res |= sm_floor_i32(m_ii32, 9) == ST_NIL
+			       && sm_it_i32_k(m_ii32, sm_ceil_i32(m_ii32, 9))
+					  == 10
+			       && sm_upper_bound_i32(m_ii32, 40) == ST_NIL
+			       && sm_lower_bound_i32(m_ii32, 41) == ST_NIL
+			       && sm_it_i32_k(m_ii32, sm_floor_i32(m_ii32, 41))
+					  == 40
+		       ? 0
+		       : 1 << 4;
+	/*
+	 * Other key types
+	 */
+	ndx = sm_floor_u32(m_uu32, 39);
+	res |= sm_it_u32_k(m_uu32, ndx) == 30 && sm_it_uu32_v(m_uu32, ndx) == 3
+			       && sm_upper_bound_u32(m_uu32, 40) == ST_NIL
+		       ? 0
+		       : 1 << 5;
+	ndx = sm_upper_bound_i(m_ii, 10);
+	res |= sm_it_i_k(m_ii, ndx) == 20 && sm_it_ii_v(m_ii, ndx) == -2
+			       && sm_floor_i(m_ii, 5) == ST_NIL
+		       ? 0
+		       : 1 << 6;
+	ndx = sm_ceil_f(m_ff, 10.5f);
+	res |= sm_it_f_k(m_ff, ndx) == 20 && sm_it_ff_v(m_ff, ndx) == -2
+			       && sm_it_f_k(m_ff, sm_floor_f(m_ff, 10.5f)) == 10
+		       ? 0
+		       : 1 << 7;
+	ndx = sm_lower_bound_d(m_dd, 39.9);
+	res |= sm_it_d_k(m_dd, ndx) == 40 && sm_it_dd_v(m_dd, ndx) == -4
+			       && sm_it_d_k(m_dd, sm_upper_bound_d(m_dd, 0))
+					  == 10
+		       ? 0
+		       : 1 << 8;
+	ndx = sm_lower_bound_s(m_si, ss_crefa("k015"));
+	res |= !ss_cmp(sm_it_s_k(m_si, ndx), k[1])
+			       && sm_it_si_v(m_si, ndx) == -2
+			       && !ss_cmp(sm_it_s_k(m_si,
+						    sm_floor_s(m_si,
+							       ss_crefa("k015"))),
+					  k[0])
+			       && sm_upper_bound_s(m_si, k[3]) == ST_NIL
+		       ? 0
+		       : 1 << 9;
+	ndx = sm_upper_bound_s(m_ss, k[2]);
+	res |= !ss_cmp(sm_it_s_k(m_ss, ndx), k[3])
+			       && !ss_cmp(sm_it_ss_v(m_ss, ndx), k[3])
+			       && sm_floor_s(m_ss, ss_crefa("k")) == ST_NIL
+		       ? 0
+		       : 1 << 10;
+	/*
+	 * Set wrappers
+	 */
+	res |= sms_it_i32(s_i32, sms_lower_bound_i32(s_i32, 11)) == 20
+			       && sms_it_i32(s_i32, sms_upper_bound_i32(s_i32, 30))
+					  == 40
+			       && sms_it_i32(s_i32, sms_floor_i32(s_i32, 11)) == 10
+			       && sms_ceil_i32(s_i32, 41) == ST_NIL
+		       ? 0
+		       : 1 << 11;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m_ii32, &m_uu32, &m_ii, &m_ff, &m_dd, &m_si, &m_ss);
+#else
+	sm_free(&m_ii32);
+	sm_free(&m_uu32);
+	sm_free(&m_ii);
+	sm_free(&m_ff);
+	sm_free(&m_dd);
+	sm_free(&m_si);
+	sm_free(&m_ss);
+#endif
+	sms_free(&s_i32);
+	return res;
+}
+
+static int test_sm_range_split_join()
+{
+	int res = 0;
+	int64_t i;
+	char buf[64];
+	srt_string *ks = NULL;
+	srt_map *m_ii = sm_alloc(SM_II, 0), *m_ss = sm_alloc(SM_SS, 0),
+		*m_hi = NULL, *m_ss_hi = NULL;
+	srt_set *s_i32 = sms_alloc(SMS_I32, 0), *s_i32_hi = NULL;
+	const int64_t nelems = 1000;
+	for (i = 0; i < nelems; i++) {
+		sm_insert_ii(&m_ii, i, -i);
+		sms_insert_i32(&s_i32, (int32_t)i);
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(&m_ss, ks, ks);
+	}
+	/*
+	 * Few elements (one by one deletion) and bulk (tree rebuild)
+	 */
+	res |= sm_delete_range_i(m_ii, 10, 12) == 3 && sm_size(m_ii) == 997
+			       && !sm_count_i(m_ii, 11) && sm_count_i(m_ii, 13)
+			       && st_assert((srt_tree *)m_ii)
+		       ? 0
+		       : 1 << 0;
+	res |= sm_delete_range_i(m_ii, 100, 899) == 800 && sm_size(m_ii) == 197
+			       && !sm_count_i(m_ii, 100) && !sm_count_i(m_ii, 899)
+			       && sm_count_i(m_ii, 99) && sm_at_ii(m_ii, 900) == -900
+			       && st_assert((srt_tree *)m_ii)
+		       ? 0
+		       : 1 << 1;
+	res |= sm_delete_range_i(m_ii, 2000, 3000) == 0
+			       && sm_delete_range_i(m_ii, 12, 10) == 0
+			       && sm_delete_range_i32(m_ii, 0, 10) == 0
+			       && sm_size(m_ii) == 197
+		       ? 0
+		       : 1 << 2;
+	ss_cpy_c(&ks, "key 0500");
+	res |= sm_delete_range_s(m_ss, ks, ss_crefa("key 0999 (zzz)")) == 500
+			       && sm_size(m_ss) == 500
+			       && st_assert((srt_tree *)m_ss)
+			       && !ss_cmp(sm_it_s_k(m_ss,
+						    sm_floor_s(m_ss, ks)),
+					  sm_it_ss_v(m_ss,
+						     sm_floor_s(m_ss, ks)))
+		       ? 0
+		       : 1 << 3;
+	/*
+	 * Split
+	 */
+	m_hi = sm_split_i(m_ii, 50);
+	res |= m_hi && sm_size(m_ii) == 47 && sm_size(m_hi) == 150
+			       && sm_at_ii(m_hi, 950) == -950
+			       && !sm_count_i(m_ii, 950) && sm_count_i(m_ii, 49)
+			       && st_assert((srt_tree *)m_ii)
+			       && st_assert((srt_tree *)m_hi)
+		       ? 0
+		       : 1 << 4;
+	m_ss_hi = sm_split_s(m_ss, ss_crefa("key 0250"));
+	res |= m_ss_hi && sm_size(m_ss) == 250 && sm_size(m_ss_hi) == 250
+			       && st_assert((srt_tree *)m_ss_hi)
+		       ? 0
+		       : 1 << 5;
+	s_i32_hi = sms_split_i32(s_i32, 2000);
+	res |= s_i32_hi && sms_size(s_i32) == 1000 && sms_size(s_i32_hi) == 0
+		       ? 0
+		       : 1 << 6;
+	/*
+	 * Join
+	 */
+	res |= !sm_join(&m_hi, m_ii) && sm_join(&m_ii, m_hi)
+			       && sm_size(m_ii) == 197 && sm_size(m_hi) == 0
+			       && sm_at_ii(m_ii, 999) == -999
+			       && st_assert((srt_tree *)m_ii)
+		       ? 0
+		       : 1 << 7;
+	res |= sm_join(&m_ss, m_ss_hi) && sm_size(m_ss) == 500
+			       && sm_size(m_ss_hi) == 0
+			       && sm_count_s(m_ss, ss_crefa("key 0250 (long "
+							    "enough for heap "
+							    "allocation)"))
+			       && st_assert((srt_tree *)m_ss)
+			       && !sm_join(&m_ss, m_ii)
+		       ? 0
+		       : 1 << 8;
+	res |= sms_delete_range_i32(s_i32, 0, 998) == 999
+			       && sms_count_i32(s_i32, 999)
+			       && sms_join(&s_i32_hi, s_i32)
+			       && sms_size(s_i32_hi) == 1
+		       ? 0
+		       : 1 << 9;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m_ii, &m_ss, &m_hi, &m_ss_hi);
+	sms_free(&s_i32, &s_i32_hi);
+#else
+	sm_free(&m_ii);
+	sm_free(&m_ss);
+	sm_free(&m_hi);
+	sm_free(&m_ss_hi);
+	sms_free(&s_i32);
+	sms_free(&s_i32_hi);
+#endif
+	ss_free(&ks);
+	return res;
+}
+
+#ifdef S_PTHREADS
+/*
+ * Concurrent snapshot reads: a writer thread modifies the source map, while
+ * a reader thread iterates its snapshot
+ */
+
+#define SNAP_THR_KEYS 1000
+
+struct SnapThr {
+	srt_map *m, *s;
+	srt_string *vs;
+	int64_t next;
+	srt_bool ok;
+};
+
+static void snap_thr_val(srt_string **s, int64_t k)
+{
+	char buf[64];
+	sprintf(buf, "value %i (long enough for heap allocation)", (int)k);
+	ss_cpy_c(s, buf);
+}
+
+static void *snap_thr_writer(void *context)
+{
+	int64_t i;
+	srt_string *vs = NULL;
+	struct SnapThr *c = (struct SnapThr *)context;
+	for (i = 0; i < 20 * SNAP_THR_KEYS; i++) {
+		snap_thr_val(&vs, -i);
+		sm_insert_is(&c->m, SNAP_THR_KEYS + i, vs);
+		sm_insert_is(&c->m, i % SNAP_THR_KEYS, vs);
+		if (i % 3 == 0)
+			sm_delete_i(c->m, (i * 7) % SNAP_THR_KEYS);
+	}
+	ss_free(&vs);
+	return NULL;
+}
+
+static srt_bool snap_thr_itr(int64_t k, const srt_string *v, void *context)
+{
+	struct SnapThr *c = (struct SnapThr *)context;
+	snap_thr_val(&c->vs, k);
+	if (k != c->next++ || ss_cmp(v, c->vs))
+		c->ok = S_FALSE;
+	return S_TRUE;
+}
+
+static void *snap_thr_reader(void *context)
+{
+	int i;
+	struct SnapThr *c = (struct SnapThr *)context;
+	for (i = 0; i < 50 && c->ok; i++) {
+		c->next = 0;
+		if (sm_itr_is(c->s, 0, SNAP_THR_KEYS, snap_thr_itr, c)
+			    != SNAP_THR_KEYS
+		    || c->next != SNAP_THR_KEYS
+		    || sm_size(c->s) != SNAP_THR_KEYS)
+			c->ok = S_FALSE;
+	}
+	return NULL;
+}
+
+static int test_sm_snapshot_threads()
+{
+	int64_t i;
+	pthread_t tw, tr;
+	struct SnapThr c;
+	c.m = sm_alloc(SM_IS, 0);
+	c.vs = NULL;
+	c.ok = S_TRUE;
+	for (i = 0; i < SNAP_THR_KEYS; i++) {
+		snap_thr_val(&c.vs, i);
+		sm_insert_is(&c.m, i, c.vs);
+	}
+	c.s = sm_snapshot(c.m);
+	if (!c.s || pthread_create(&tr, NULL, snap_thr_reader, &c))
+		c.ok = S_FALSE;
+	else if (pthread_create(&tw, NULL, snap_thr_writer, &c)) {
+		c.ok = S_FALSE;
+		pthread_join(tr, NULL);
+	} else {
+		pthread_join(tw, NULL);
+		pthread_join(tr, NULL);
+	}
+	if (c.ok)
+		c.ok = sm_size(c.m) > 20 * SNAP_THR_KEYS && st_assert(c.m)
+		       && st_assert(c.s);
+#ifdef S_USE_VA_ARGS
+	sm_free(&c.s, &c.m);
+#else
+	sm_free(&c.s);
+	sm_free(&c.m);
+#endif
+	ss_free(&c.vs);
+	return c.ok ? 0 : 1;
+}
+#endif
+
+static int test_sm_snapshot()
+{
+	int res = 0;
+	int64_t i, sum;
+	char buf[64];
+	srt_bool ok1, ok2;
+	srt_string *ks = NULL, *vs = NULL;
+	srt_map *m_ii = sm_alloc(SM_II, 0), *m_ss = sm_alloc(SM_SS, 0),
+		*s1 = NULL, *s2 = NULL, *s3 = NULL, *s_ss = NULL, *m_cp = NULL,
+		*mx;
+	srt_set *s_i32 = sms_alloc(SMS_I32, 0), *s_i32_sn = NULL;
+	for (i = 0; i < 1000; i++) {
+		sm_insert_ii(&m_ii, i, -i);
+		sms_insert_i32(&s_i32, (int32_t)i);
+	}
+	s1 = sm_snapshot(m_ii);
+	s_i32_sn = sms_snapshot(s_i32);
+	/*
+	 * Writes on the source map (insert with reallocation, delete,
+	 * overwrite, range delete)
+	 */
+	for (i = 1000; i < 2000; i++)
+		sm_insert_ii(&m_ii, i, -i);
+	for (i = 0; i < 100; i++)
+		sm_delete_i(m_ii, i);
+	sm_insert_ii(&m_ii, 500, 5);
+	sm_delete_range_i(m_ii, 600, 699);
+	s2 = sm_snapshot(m_ii);
+	sm_delete_range_i(m_ii, 0, 2000);
+	sm_insert_ii(&m_ii, 7, 7);
+	sms_delete_range_i32(s_i32, 0, 499);
+	res |= s1 && s2 && s_i32_sn && sm_size(s1) == 1000
+			       && sm_size(s2) == 1800 && sm_size(m_ii) == 1
+			       && sm_at_ii(m_ii, 7) == 7 && st_assert(s1)
+			       && st_assert(s2) && st_assert(m_ii)
+		       ? 0
+		       : 1 << 0;
+	for (i = 0, ok1 = ok2 = S_TRUE; i < 2000; i++) {
+		if (i < 1000 ? sm_at_ii(s1, i) != -i : sm_count_i(s1, i))
+			ok1 = S_FALSE;
+		if (i < 100 || (i >= 600 && i < 700)
+			    ? sm_count_i(s2, i)
+			    : sm_at_ii(s2, i) != (i == 500 ? 5 : -i))
+			ok2 = S_FALSE;
+	}
+	for (i = sum = 0; i < 1000; i++)
+		sum += sm_it_i_k(s1, (srt_tndx)i);
+	res |= ok1 && ok2 && sum == 999 * 1000 / 2 ? 0 : 1 << 1;
+	res |= sms_size(s_i32_sn) == 1000 && sms_count_i32(s_i32_sn, 0)
+			       && sms_size(s_i32) == 500
+			       && !sms_count_i32(s_i32, 0)
+		       ? 0
+		       : 1 << 2;
+	/*
+	 * Snapshots are read-only
+	 */
+	res |= !sm_insert_ii(&s2, 1, 1) && !sm_delete_i(s2, 200)
+			       && !sm_delete_range_i(s2, 0, 2000)
+			       && !sm_split_i(s2, 1000) && !sm_join(&s2, m_ii)
+			       && !sm_cpy(&s2, m_ii) && sm_size(s2) == 1800
+		       ? 0
+		       : 1 << 3;
+	/*
+	 * Copy from snapshot, out-of-order release
+	 */
+	m_cp = sm_dup(s2);
+	sm_free(&s1);
+	for (i = 100, ok2 = S_TRUE; i < 2000; i++)
+		if ((i < 600 || i >= 700)
+		    && sm_at_ii(s2, i) != (i == 500 ? 5 : -i))
+			ok2 = S_FALSE;
+	res |= ok2 && m_cp && sm_size(m_cp) == 1800 && st_assert(m_cp)
+			       && sm_at_ii(m_cp, 1999) == -1999
+		       ? 0
+		       : 1 << 4;
+	/*
+	 * Source map reallocated through other variable
+	 */
+	mx = m_ii;
+	sm_reserve(&mx, 100000);
+	sm_insert_ii(&mx, 8, 8);
+	res |= sm_at_ii(s2, 1999) == -1999 && sm_at_ii(s2, 500) == 5
+			       && !sm_count_i(s2, 8) && sm_at_ii(mx, 8) == 8
+			       && st_assert(s2)
+		       ? 0
+		       : 1 << 7;
+	m_ii = mx;
+	/*
+	 * String map: overwrite and delete on the source, then free it
+	 * before the snapshot
+	 */
+	for (i = 0; i < 100; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(&m_ss, ks, ks);
+	}
+	s_ss = sm_snapshot(m_ss);
+	for (i = 0; i < 100; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		if (i % 2)
+			sm_delete_s(m_ss, ks);
+		else
+			sm_insert_ss(&m_ss, ks,
+				     ss_crefa("overwritten value (long enough "
+					      "for heap allocation)"));
+	}
+	sm_free(&m_ss);
+	for (i = 0, ok1 = S_TRUE; i < 100; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		ss_cpy(&vs, sm_at_ss(s_ss, ks));
+		if (ss_cmp(ks, vs))
+			ok1 = S_FALSE;
+	}
+	res |= ok1 && sm_size(s_ss) == 100 && st_assert(s_ss) ? 0 : 1 << 5;
+	/*
+	 * String map with two live snapshots: deletes leave vacated node
+	 * slots (with freed strings) below the first snapshot size, reused
+	 * by the inserts after the second snapshot
+	 */
+	m_ss = sm_alloc(SM_SS, 0);
+	for (i = 0; i < 100; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(&m_ss, ks, ks);
+	}
+	s1 = sm_snapshot(m_ss);
+	for (i = 0; i < 90; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_delete_s(m_ss, ks);
+	}
+	s3 = sm_snapshot(m_ss);
+	for (i = 0; i < 90; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(&m_ss, ks, ss_crefa("new value (long enough for "
+						 "heap allocation)"));
+		sm_delete_s(m_ss, ks);
+		sm_insert_ss(&m_ss, ks, ks);
+	}
+	for (i = 0, ok1 = ok2 = S_TRUE; i < 100; i++) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		ss_cpy(&vs, sm_at_ss(s1, ks));
+		if (ss_cmp(ks, vs) || ss_cmp(ks, sm_at_ss(m_ss, ks)))
+			ok1 = S_FALSE;
+		if (i < 90 ? sm_count_s(s3, ks)
+			   : ss_cmp(ks, sm_at_ss(s3, ks)) != 0)
+			ok2 = S_FALSE;
+	}
+	res |= ok1 && ok2 && sm_size(s1) == 100 && sm_size(s3) == 10
+			       && sm_size(m_ss) == 100 && st_assert(s1)
+			       && st_assert(s3) && st_assert(m_ss)
+		       ? 0
+		       : 1 << 6;
+#ifdef S_PTHREADS
+	res |= test_sm_snapshot_threads() ? 1 << 8 : 0;
+#endif
+#ifdef S_USE_VA_ARGS
+	sm_free(&m_ii, &s2, &s_ss, &m_cp, &s1, &s3, &m_ss);
+	sms_free(&s_i32_sn, &s_i32);
+	ss_free(&ks, &vs);
+#else
+	sm_free(&m_ii);
+	sm_free(&s2);
+	sm_free(&s_ss);
+	sm_free(&m_cp);
+	sm_free(&s1);
+	sm_free(&s3);
+	sm_free(&m_ss);
+	sms_free(&s_i32_sn);
+	sms_free(&s_i32);
+	ss_free(&ks);
+	ss_free(&vs);
+#endif
+	return res;
+}
+
+static int test_sm_optimize()
+{
+	int res = 0;
+	int64_t i;
+	srt_tndx j;
+	srt_bool ok;
+	const srt_tnode *n;
+	srt_map *m = sm_alloc(SM_II, 0), *sn = NULL;
+	srt_set *s = sms_alloc(SMS_I32, 0);
+	for (i = 0; i < 1000; i++) {
+		sm_insert_ii(&m, (i * 7919) % 1000, i);
+		sms_insert_i32(&s, (int32_t)i);
+	}
+	sn = sm_snapshot(m);
+	for (i = 0; i < 1000; i += 3)
+		sm_delete_i(m, (i * 7919) % 1000);
+	res |= sm_optimize(m) && sms_optimize(s) && !sm_optimize(sn)
+			       && st_assert(m) && st_assert(sn) && st_assert(s)
+			       && m->root == 0 && sm_size(m) == 666
+		       ? 0
+		       : 1 << 0;
+	/*
+	 * Breadth-first layout: children are stored after their parent
+	 */
+	for (j = 0, ok = S_TRUE; j < (srt_tndx)sm_size(m); j++) {
+		n = st_enum_r(m, j);
+		if ((st_node_l(m, n) != ST_NIL && st_node_l(m, n) <= j)
+		    || (st_node_r(m, n) != ST_NIL && st_node_r(m, n) <= j))
+			ok = S_FALSE;
+	}
+	for (i = 0; i < 1000; i++)
+		if ((i % 3 ? sm_at_ii(m, (i * 7919) % 1000) != i
+			   : sm_count_i(m, (i * 7919) % 1000))
+		    || sm_at_ii(sn, (i * 7919) % 1000) != i)
+			ok = S_FALSE;
+	res |= ok && sms_size(s) == 1000 && sms_count_i32(s, 999) ? 0 : 1 << 1;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m, &sn);
+#else
+	sm_free(&m);
+	sm_free(&sn);
+#endif
+	sms_free(&s);
+	return res;
+}
+
+struct DiffCnt {
+	size_t cnt[3];
+	int64_t k_changed;
+	const srt_map *m_new;
+};
+
+static srt_bool diff_cnt(enum eSM_Diff d, srt_tndx i_old, srt_tndx i_new,
+			 void *context)
+{
+	struct DiffCnt *c = (struct DiffCnt *)context;
+	c->cnt[d]++;
+	if (d == SM_DiffChanged && i_old != ST_NIL)
+		c->k_changed = sm_it_i_k(c->m_new, i_new);
+	return S_TRUE;
+}
+
+static srt_bool diff_stop(enum eSM_Diff d, srt_tndx i_old, srt_tndx i_new,
+			  void *context)
+{
+	(void)d;
+	(void)i_old;
+	(void)i_new;
+	return --(*(int *)context) > 0 ? S_TRUE : S_FALSE;
+}
+
+static int test_sm_merge()
+{
+	int res = 0, stop = 10;
+	int64_t i;
+	char buf[64];
+	srt_string *ks = NULL;
+	struct DiffCnt dc;
+	srt_map *m1 = sm_alloc(SM_II, 0), *m2 = sm_alloc(SM_II, 0),
+		*m_d = NULL, *m_i = NULL, *m_u = sm_alloc(SM_SS, 0),
+		*s1 = sm_alloc(SM_SS, 0), *s2 = sm_alloc(SM_SS, 0), *s_u = NULL,
+		*d1 = NULL, *d2 = NULL, *mm = NULL;
+	srt_set *z1 = sms_alloc(SMS_I32, 0), *z2 = sms_alloc(SMS_I32, 0),
+		*z_i = NULL;
+	double nan;
+	for (i = 0; i < 100; i++) {
+		sm_insert_ii(&m1, i, i);
+		sm_insert_ii(&m2, i + 50, i == 10 ? -1 : i + 50);
+		sms_insert_i32(&z1, (int32_t)i * 2);
+		sms_insert_i32(&z2, (int32_t)i * 3);
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(i % 2 ? &s1 : &s2, ks, ks);
+	}
+	/* m_u (SM_SS) is reused as SM_II map */
+	res |= sm_diff(&m_d, m1, m2) && sm_intersect(&m_i, m1, m2)
+			       && sm_union(&m_u, m1, m2) && sm_size(m_d) == 50
+			       && sm_size(m_i) == 50 && sm_size(m_u) == 150
+			       && st_assert(m_d) && st_assert(m_i)
+			       && st_assert(m_u) && sm_at_ii(m_d, 49) == 49
+			       && !sm_count_i(m_d, 50) && sm_at_ii(m_i, 60) == 60
+			       && sm_at_ii(m_u, 60) == -1
+			       && sm_at_ii(m_u, 149) == 149
+		       ? 0
+		       : 1 << 0;
+	res |= !sm_diff(&m_d, m1, s1) && !sm_union(&m1, m1, m2) ? 0 : 1 << 1;
+	memset(&dc, 0, sizeof(dc));
+	dc.m_new = m2;
+	res |= sm_diff_itr(m1, m2, diff_cnt, &dc) == 101
+			       && dc.cnt[SM_DiffAdded] == 50
+			       && dc.cnt[SM_DiffRemoved] == 50
+			       && dc.cnt[SM_DiffChanged] == 1 && dc.k_changed == 60
+			       && sm_diff_itr(m1, m1, NULL, NULL) == 0
+			       && sm_diff_itr(m1, m2, diff_stop, &stop) == 9
+		       ? 0
+		       : 1 << 2;
+	res |= sms_intersect(&z_i, z1, z2) && sms_size(z_i) == 34
+			       && sms_count_i32(z_i, 198)
+			       && sms_diff_itr(z1, z2, NULL, NULL) == 132
+		       ? 0
+		       : 1 << 3;
+	res |= sm_union(&s_u, s1, s2) && sm_size(s_u) == 100 && st_assert(s_u)
+			       && !ss_cmp(sm_at_ss(s_u, ks), ks)
+			       && sm_diff(&s_u, s1, s2) && sm_size(s_u) == 50
+		       ? 0
+		       : 1 << 4;
+	/*
+	 * Diff: NaN values, compact vs wide, multimaps (not supported)
+	 */
+	nan = 0;
+	nan = nan / nan;
+	d1 = sm_alloc(SM_DD, 0);
+	d2 = sm_alloc_wide(SM_DD, 0);
+	mm = sm_alloc_multi(SM_II, 0);
+	for (i = 0; i < 10; i++) {
+		sm_insert_dd(&d1, (double)i, i % 2 ? nan : (double)i);
+		sm_insert_dd(&d2, (double)i, i % 2 ? nan : (double)i);
+		sm_insert_ii(&mm, i / 2, i);
+	}
+	sm_insert_dd(&d2, 2, nan);
+	res |= sm_diff_itr(d1, d2, NULL, NULL) == 1
+			       && sm_diff_itr(d2, d1, NULL, NULL) == 1
+			       && sm_diff_itr(d1, d1, NULL, NULL) == 0
+			       && sm_diff_itr(mm, m1, NULL, NULL) == 0
+			       && sm_diff_itr(m1, mm, NULL, NULL) == 0
+		       ? 0
+		       : 1 << 5;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m1, &m2, &m_d, &m_i, &m_u, &s1, &s2, &s_u, &d1, &d2, &mm);
+	sms_free(&z1, &z2, &z_i);
+#else
+	sm_free(&m1);
+	sm_free(&m2);
+	sm_free(&m_d);
+	sm_free(&m_i);
+	sm_free(&m_u);
+	sm_free(&s1);
+	sm_free(&s2);
+	sm_free(&s_u);
+	sm_free(&d1);
+	sm_free(&d2);
+	sm_free(&mm);
+	sms_free(&z1);
+	sms_free(&z2);
+	sms_free(&z_i);
+#endif
+	ss_free(&ks);
+	return res;
+}
+
+static int test_sm_wide()
+{
+	int res = 0;
+	int32_t i;
+	char buf[64];
+	srt_tndx j;
+	srt_bool ok = S_TRUE;
+	const srt_tnode *n;
+	srt_string *ks = NULL;
+	srt_map *m = sm_alloc_wide(SM_II32, 0), *mc = sm_alloc(SM_II32, 0),
+		*s = sm_alloc_wide(SM_SS, 0), *mk = sm_alloc(SM_II32, 0),
+		*m2 = NULL, *sn, *mu = NULL;
+	srt_set *z = sms_alloc_wide(SMS_I32, 0);
+	for (i = 0; i < 1000; i++) {
+		sm_insert_ii32(&m, (i * 7919) % 1000, i);
+		sm_insert_ii32(&mc, (i * 7919) % 1000, i);
+		sms_insert_i32(&z, i);
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i % 100);
+		ss_cpy_c(&ks, buf);
+		sm_insert_ss(&s, ks, ks);
+	}
+	for (i = 0; i < 1000; i += 3) {
+		sm_delete_i32(m, (i * 7919) % 1000);
+		sm_delete_i32(mc, (i * 7919) % 1000);
+	}
+	for (i = 0; i < 100; i += 2) {
+		sprintf(buf, "key %04i (long enough for heap allocation)",
+			(int)i);
+		ss_cpy_c(&ks, buf);
+		sm_delete_s(s, ks);
+	}
+	res |= st_is_wide(m) && !st_is_wide(mc) && st_is_wide(z)
+			       && st_ndx_max(m) > ST_NDX_MAX
+			       && m->d.elem_size == mc->d.elem_size + 8
+			       && st_assert(m) && st_assert(s) && st_assert(z)
+			       && sm_size(m) == 666 && sm_size(s) == 50
+			       && sms_size(z) == 1000
+		       ? 0
+		       : 1 << 0;
+	for (i = 0; i < 1000; i++)
+		if (sm_at_ii32(m, i) != sm_at_ii32(mc, i))
+			ok = S_FALSE;
+	res |= ok && sm_it_i32_k(m, sm_lower_bound_i32(m, 3)) == 3
+			       && sm_itr_ii32(m, 0, 999, NULL, NULL) == 666
+			       && sm_count_s(s, ks) == 0
+		       ? 0
+		       : 1 << 1;
+	/* Snapshot, copy to compact map (switching to wide), and union */
+	sn = sm_snapshot(m);
+	res |= sm_optimize(m) && sm_insert_ii32(&m, 3, -3)
+			       && sm_cpy(&mc, m) && st_is_wide(mc)
+			       && sm_at_ii32(mc, 3) == -3 && sm_at_ii32(sn, 3) == 37
+			       && !sm_count_i32(sn, 0) && st_assert(sn)
+			       && st_assert(mc) && sm_union(&mu, sn, m)
+			       && sm_size(mu) == 666 && sm_at_ii32(mu, 3) == -3
+			       && st_is_wide(mu) && st_assert(mu)
+			       && !sm_union(&m2, m, mk)
+		       ? 0
+		       : 1 << 2;
+	for (j = 0; j < (srt_tndx)sm_size(mc); j++) {
+		n = st_enum_r(mc, j);
+		if (st_node_l(mc, n) == ST_NIL_C || st_node_r(mc, n) == ST_NIL_C)
+			ok = S_FALSE;
+	}
+	res |= ok ? 0 : 1 << 3;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m, &mc, &s, &mk, &m2, &sn, &mu);
+#else
+	sm_free(&m);
+	sm_free(&mc);
+	sm_free(&s);
+	sm_free(&mk);
+	sm_free(&m2);
+	sm_free(&sn);
+	sm_free(&mu);
+#endif
+	sms_free(&z);
+	ss_free(&ks);
+	return res;
+}
+
+static srt_bool sm_multi_cb(int64_t k, int64_t v, void *context)
+{
+	int64_t *last = (int64_t *)context;
+	if (v <= *last) /* equal keys: insertion order */
+		*last = 1000000;
+	else
+		*last = v;
+	(void)k;
+	return S_TRUE;
+}
+
+static int test_sm_multi()
+{
+	int res = 0;
+	int64_t i, last = -1;
+	srt_string *ks = NULL;
+	srt_map *m = sm_alloc_multi(SM_II, 0), *s = sm_alloc_multi(SM_SS, 0),
+		*mu = sm_alloc(SM_II, 0), *m2 = NULL;
+	srt_set *z = sms_alloc_multi(SMS_I, 0);
+	for (i = 0; i < 1000; i++) {
+		sm_insert_ii(&m, (i * 7919) % 10, i);
+		sm_insert_ii(&mu, (i * 7919) % 10, i);
+		sms_insert_i(&z, i % 7);
+		ss_printf(&ks, 64, "key %i (long enough for heap allocation)",
+			  (int)(i % 3));
+		sm_insert_ss(&s, ks, ks);
+	}
+	res |= st_is_multi(m) && !st_is_multi(mu) && sm_size(m) == 1000
+			       && sm_size(mu) == 10 && sm_count_i(m, 3) == 100
+			       && sm_count_i(mu, 3) == 1 && !sm_count_i(m, 10)
+			       && sm_at_ii(m, 9) == 1 && sms_count_i(z, 6) == 142
+			       && sm_count_s(s, ks) == 334 && st_assert(m)
+			       && st_assert(z) && st_assert(s)
+		       ? 0
+		       : 1 << 0;
+	/* Equal key range enumeration, in insertion order */
+	res |= sm_itr_ii(m, 3, 3, sm_multi_cb, &last) == 100 && last < 1000
+			       && sm_itr_ii(m, 2, 4, NULL, NULL) == 300
+			       && sm_it_i_k(m, sm_upper_bound_i(m, 3)) == 4
+			       && sm_it_ii_v(m, sm_lower_bound_i(m, 3)) == 7
+		       ? 0
+		       : 1 << 1;
+	/* Delete one, delete all */
+	for (i = 0; i < 50; i++)
+		sm_delete_i(m, 3);
+	res |= sm_count_i(m, 3) == 50 && sm_delete_range_i(m, 3, 3) == 50
+			       && !sm_delete_i(m, 3) && sm_size(m) == 900
+			       && sm_delete_s(s, ks) && sm_count_s(s, ks) == 333
+			       && st_assert(m) && st_assert(s)
+		       ? 0
+		       : 1 << 2;
+	/* Copy keeps duplicate keys mode, merge requires the same mode */
+	res |= sm_cpy(&m2, m) && st_is_multi(m2) && sm_count_i(m2, 4) == 100
+			       && sm_cpy(&m2, mu) && !st_is_multi(m2)
+			       && !sm_union(&m2, m, mu)
+		       ? 0
+		       : 1 << 3;
+#ifdef S_USE_VA_ARGS
+	sm_free(&m, &s, &mu, &m2);
+#else
+	sm_free(&m);
+	sm_free(&s);
+	sm_free(&mu);
+	sm_free(&m2);
+#endif
+	sms_free(&z);
+	ss_free(&ks);
+	return res;
+}
+
+static srt_bool sim_order_cb(int64_t lo, int64_t hi, int64_t v, void *context)
+{
+	int64_t *last = (int64_t *)context;
+	if (lo < *last || hi - lo != (v < 0 ? 995000 : 25))
+		*last = 1 << 30; /* error */
+	else
+		*last = lo;
+	return lo < 9000 ? S_TRUE : S_FALSE;
+}
+
+static int test_sim()
+{
+	int res = 0;
+	int64_t i, last = 0;
+	char buf[2];
+	srt_imap *m = sim_alloc(SIM_II, 0), *mp = sim_alloc(SIM_IP, 0), *m2;
+	for (i = 0; i < 1000; i++) {
+		sim_insert_ii(&m, i * 10, i * 10 + 25, i);
+		sim_insert_ip(&mp, i * 10, i * 10 + 25, &buf[i % 2]);
+	}
+	res |= sim_insert_ii(&m, 5000, 1000000, -1)
+			       && !sim_insert_ii(&m, 10, 9, 0)
+			       && !sim_insert_ip(&m, 0, 1, buf)
+			       && sim_insert_ii(&m, 0, 25, 0)
+			       && sim_size(m) == 1001
+			       && sim_stab_ii(m, 105, NULL, NULL) == 3
+			       && sim_stab_ii(m, 5105, NULL, NULL) == 4
+			       && sim_stab_ii(m, 20000, NULL, NULL) == 1
+			       && sim_stab_ii(m, -1, NULL, NULL) == 0
+			       && sim_stab_ip(mp, 105, NULL, NULL) == 3
+			       && sim_stab_ip(m, 105, NULL, NULL) == 0
+			       && sim_overlap_ii(m, 0, 9, NULL, NULL) == 1
+			       && sim_overlap_ii(m, 100, 200, NULL, NULL) == 13
+			       && sim_overlap_ip(mp, 9990, 9999, NULL, NULL) == 3
+			       && st_assert(m) && st_assert(mp)
+		       ? 0
+		       : 1 << 0;
+	/* Query order and enumeration stop */
+	res |= sim_overlap_ii(m, 0, 1000000, sim_order_cb, &last) == 901
+			       && last == 9000
+		       ? 0
+		       : 1 << 1;
+	m2 = sim_dup(m);
+	for (i = 1; i < 1000; i += 2)
+		sim_delete(m, i * 10, i * 10 + 25);
+	res |= sim_size(m) == 501 && sim_stab_ii(m, 105, NULL, NULL) == 2
+			       && sim_delete(m, 5000, 1000000)
+			       && !sim_delete(m, 5000, 1000000)
+			       && sim_stab_ii(m, 20000, NULL, NULL) == 0
+			       && sim_stab_ii(m, 5105, NULL, NULL) == 2
+			       && sim_stab_ii(m2, 5105, NULL, NULL) == 4
+			       && st_assert(m)
+		       ? 0
+		       : 1 << 2;
+	sim_clear(m);
+	res |= sim_size(m) == 0 && sim_stab_ii(m, 105, NULL, NULL) == 0
+			       && sim_insert_ii(&m, 1, 2, 3)
+			       && sim_stab_ii(m, 2, NULL, NULL) == 1
+		       ? 0
+		       : 1 << 3;
+#ifdef S_USE_VA_ARGS
+	sim_free(&m, &mp, &m2);
+#else
+	sim_free(&m);
+	sim_free(&mp);
+	sim_free(&m2);
+#endif
+	return res;
+}
+
+static srt_bool sfm_order_cb(int64_t k, int64_t v, void *context)
+{
+	int64_t *last = (int64_t *)context;
+	if (k <= *last || v != -k)
+		*last = 1 << 30; /* error */
+	else
+		*last = k;
+	return k < 500 ? S_TRUE : S_FALSE;
+}
+
+static int test_sfm()
+{
+	int res = 0;
+	size_t n, s;
+	srt_bool found;
+	int64_t i, last = -1;
+	uint64_t u0 = (uint64_t)1 << 63;
+	srt_vector *kv = sv_alloc_t(SV_I32, 0), *vv = sv_alloc_t(SV_I64, 0),
+		   *dv = sv_alloc_t(SV_D, 0), *uv = sv_alloc_t(SV_U64, 0);
+	srt_map *m = sm_alloc(SM_DD, 0), *ms = sm_alloc(SM_SI, 0);
+	srt_fmap *fm = NULL, *fd, *fu;
+	/* Every tree shape up to 5 levels: bounds, lookup, slot order */
+	for (n = 0; n < 40; n++) {
+		sfm_free(&fm);
+		fm = sfm_alloc(kv, vv);
+		for (i = -1; i <= (int64_t)n * 2; i++) {
+			s = sfm_lower_bound_i(fm, i);
+			found = i >= 0 && i % 2 == 0 && i < (int64_t)n * 2;
+			if (i >= (int64_t)n * 2 - 1
+				    ? s != S_NPOS
+				    : sfm_it_i_k(fm, s) != (i + 1) / 2 * 2)
+				res |= 1 << 0;
+			if (sfm_count_i(fm, i) != (size_t)found
+			    || sfm_at_ii(fm, i) != (found ? -i : 0))
+				res |= 1 << 0;
+		}
+		for (s = sfm_first(fm), i = 0; s != S_NPOS;
+		     s = sfm_next(fm, s), i += 2)
+			if (sfm_it_i_k(fm, s) != i || sfm_it_ii_v(fm, s) != -i)
+				res |= 1 << 1;
+		res |= sfm_size(fm) == n && i == (int64_t)n * 2 ? 0 : 1 << 2;
+		sv_push_i32(&kv, (int32_t)n * 2);
+		sv_push_i64(&vv, -(int64_t)n * 2);
+	}
+	res |= sfm_type(fm) == SFM_II
+			       && sfm_upper_bound_i(fm, 10)
+					  == sfm_lower_bound_i(fm, 11)
+			       && sfm_itr_ii(fm, 11, 20, NULL, NULL) == 5
+			       && sfm_itr_ii(fm, 3, 2, NULL, NULL) == 0
+			       && sfm_count_d(fm, 2) == 0
+		       ? 0
+		       : 1 << 3;
+	res |= sfm_itr_ii(fm, 0, 1000, sfm_order_cb, &last) == 39 && last == 76
+		       ? 0
+		       : 1 << 4;
+	/* Invalid input: non-sorted keys, type mismatch, non-numeric map */
+	sv_push_i32(&kv, 0);
+	sv_push_i64(&vv, 0);
+	sv_push_d(&dv, 1);
+	res |= !sfm_alloc(kv, vv) && !sfm_alloc(dv, vv) && !sfm_alloc(NULL, dv)
+			       && !sfm_from_map(ms)
+		       ? 0
+		       : 1 << 5;
+	/* From map (SM_DD) */
+	for (i = 0; i < 1000; i++)
+		sm_insert_dd(&m, (double)i / 4, (double)i);
+	fd = sfm_from_map(m);
+	res |= sfm_size(fd) == 1000 && sfm_type(fd) == SFM_DD
+			       && sfm_at_dd(fd, 2.25) == 9
+			       && sfm_count_d(fd, 2.3) == 0
+			       && sfm_upper_bound_d(fd, 249.75) == S_NPOS
+			       && sfm_itr_dd(fd, 1, 2, NULL, NULL) == 5
+			       && sfm_count_i(fd, 0) == 0
+		       ? 0
+		       : 1 << 6;
+	s = sfm_lower_bound_d(fd, 2.3);
+	res |= sfm_it_d_k(fd, s) == 2.5 ? 0 : 1 << 7;
+	s = sfm_upper_bound_d(fd, 2.5);
+	res |= sfm_it_dd_v(fd, s) == 11 ? 0 : 1 << 8;
+	/* Unsigned keys above INT64_MAX (unsigned order) */
+	sv_clear(vv);
+	for (i = 0; i < 4; i++) {
+		sv_push_u64(&uv, i < 2 ? (uint64_t)i : u0 + (uint64_t)i);
+		sv_push_i64(&vv, i);
+	}
+	fu = sfm_alloc(uv, vv);
+	res |= sfm_size(fu) == 4 && sfm_at_ii(fu, (int64_t)(u0 + 3)) == 3
+			       && sfm_count_i(fu, 1) == 1
+			       && sfm_count_i(fu, (int64_t)u0) == 0
+			       && sfm_it_i_k(fu, sfm_first(fu)) == 0
+			       && sfm_it_i_k(fu, sfm_lower_bound_i(fu, 2))
+					  == (int64_t)(u0 + 2)
+			       && sfm_upper_bound_i(fu, (int64_t)(u0 + 3))
+					  == S_NPOS
+			       && sfm_itr_ii(fu, 1, (int64_t)(u0 + 2), NULL,
+					     NULL)
+					  == 2
+			       && sfm_itr_ii(fu, (int64_t)u0, 1, NULL, NULL) == 0
+		       ? 0
+		       : 1 << 9;
+#ifdef S_USE_VA_ARGS
+	sv_free(&kv, &vv, &dv, &uv);
+	sm_free(&m, &ms);
+	sfm_free(&fm, &fd, &fu);
+#else
+	sv_free(&kv);
+	sv_free(&vv);
+	sv_free(&dv);
+	sv_free(&uv);
+	sm_free(&m);
+	sm_free(&ms);
+	sfm_free(&fm);
+	sfm_free(&fd);
+	sfm_free(&fu);
+#endif
+	return res;
+}
+
+struct SRMapOrder {
+	srt_string *last;
+	size_t cnt, errors;
+};
+
+static srt_bool srm_order_cb(const srt_string *k, int64_t v, void *context)
+{
+	struct SRMapOrder *o = (struct SRMapOrder *)context;
+	if (o->cnt++ && ss_cmp(o->last, k) >= 0)
+		o->errors++;
+	ss_cpy(&o->last, k);
+	(void)v;
+	return o->cnt < 1000 ? S_TRUE : S_FALSE;
+}
+
+static int test_srm()
+{
+	int res = 0;
+	int i;
+	char buf[64];
+	srt_bool ok = S_TRUE;
+	struct SRMapOrder o = {NULL, 0, 0};
+	srt_string *k = NULL, *v = NULL;
+	const srt_string *url = ss_crefa("http://example.com/a"),
+			 *url1 = ss_crefa("http://example.com/a/1"),
+			 *e = ss_crefa("");
+	srt_rmap *m = srm_alloc(SRM_SI, 0), *ms = srm_alloc(SRM_SS, 0),
+		 *mp = srm_alloc(SRM_SP, 0);
+	for (i = 0; i < 1000; i++) {
+		sprintf(buf, "http://example.com/a/%i", i);
+		ss_cpy_c(&k, buf);
+		srm_insert_si(&m, k, i);
+		ss_cpy_c(&v, buf);
+		ss_cat_c(&v, " (long enough for heap allocation)");
+		srm_insert_ss(&ms, k, v);
+		srm_insert_sp(&mp, k, &buf[i % 64]);
+	}
+	/* keys being a prefix of other keys, empty key, overwrite */
+	res |= srm_insert_si(&m, url, -1) && srm_insert_si(&m, e, -2)
+			       && srm_inc_si(&m, url1, 10)
+			       && srm_insert_ss(&ms, url1, url)
+			       && !srm_insert_ss(&m, url1, url)
+			       && srm_size(m) == 1002 && srm_size(ms) == 1000
+			       && srm_at_si(m, url) == -1
+			       && srm_at_si(m, e) == -2
+			       && srm_at_si(m, url1) == 11
+			       && srm_count_s(m, ss_crefa("http://example.com/"))
+					  == 0
+			       && !ss_cmp(srm_at_ss(ms, url1), url)
+			       && srm_at_sp(mp, k) == &buf[999 % 64]
+			       && srm_at_sp(mp, url) == NULL
+		       ? 0
+		       : 1 << 0;
+	for (i = 0; i < 1000; i++) {
+		sprintf(buf, "http://example.com/a/%i", i);
+		if (srm_at_si(m, ss_crefa(buf)) != (i == 1 ? 11 : i))
+			ok = S_FALSE;
+	}
+	/* Key order, prefix enumeration, and enumeration stop */
+	res |= ok && srm_itr_si(m, NULL, NULL, NULL) == 1002
+			       && srm_itr_si(m, url1, NULL, NULL) == 111
+			       && srm_itr_si(m, url, NULL, NULL) == 1001
+			       && srm_itr_si(m, ss_crefa("http://example.com/b"),
+					     NULL, NULL)
+					  == 0
+			       && srm_itr_ss(ms, url1, NULL, NULL) == 111
+			       && srm_itr_sp(mp, e, NULL, NULL) == 1000
+			       && srm_itr_si(m, e, srm_order_cb, &o) == 999
+			       && o.errors == 0
+		       ? 0
+		       : 1 << 1;
+	/* Delete */
+	for (i = 0; i < 1000; i += 2) {
+		sprintf(buf, "http://example.com/a/%i", i);
+		if (!srm_delete_s(m, ss_crefa(buf))
+		    || !srm_delete_s(ms, ss_crefa(buf)))
+			ok = S_FALSE;
+	}
+	res |= ok && !srm_delete_s(m, ss_crefa("http://example.com/a/0"))
+			       && !srm_delete_s(m, ss_crefa("http"))
+			       && srm_delete_s(m, url) && srm_size(m) == 501
+			       && srm_size(ms) == 500 && srm_at_si(m, url1) == 11
+			       && !srm_count_s(m, ss_crefa("http://example.com"))
+			       && srm_count_s(m, url1)
+			       && srm_itr_si(m, url1, NULL, NULL) == 56
+		       ? 0
+		       : 1 << 2;
+	for (i = 1; i < 1000; i += 2) {
+		sprintf(buf, "http://example.com/a/%i", i);
+		srm_delete_s(m, ss_crefa(buf));
+	}
+	res |= srm_delete_s(m, e) && srm_size(m) == 0
+			       && srm_itr_si(m, NULL, NULL, NULL) == 0
+			       && srm_insert_si(&m, url, 1)
+			       && srm_at_si(m, url) == 1
+		       ? 0
+		       : 1 << 3;
+	srm_clear(ms);
+	res |= srm_size(ms) == 0 && !srm_count_s(ms, url1) ? 0 : 1 << 4;
+	/* Empty values are not taken as a failed value copy */
+	res |= srm_insert_ss(&ms, url, e) && srm_insert_ss(&ms, url1, NULL)
+			       && srm_size(ms) == 2
+			       && !ss_size(srm_at_ss(ms, url1))
+		       ? 0
+		       : 1 << 5;
+#ifdef S_USE_VA_ARGS
+	srm_free(&m, &ms, &mp);
+	ss_free(&k, &v, &o.last);
+#else
+	srm_free(&m);
+	srm_free(&ms);
+	srm_free(&mp);
+	ss_free(&k);
+	ss_free(&v);
+	ss_free(&o.last);
+#endif
+	return res;
+}
+
 static int test_sms()
 {
 	int i, res = 0;
@@ -6077,41 +8727,42 @@ static int test_alignment()
 
 static int test_lsb_msb()
 {
-	uint8_t tv8[9] = {0x00, 0x01, 0x0f, 0x01, 0x0f, 0x80, 0xf0, 0x80, 0xf0},
-		tv8l[9] = {0x00, 0x01, 0x01, 0x01, 0x01,
-			   0x80, 0x10, 0x80, 0x10},
-		tv8m[9] = {0x00, 0x01, 0x08, 0x01, 0x08,
-			   0x80, 0x80, 0x80, 0x80};
-	uint16_t tv16[9] = {0x0000, 0x0001, 0x000f, 0x0ff1, 0x0fff,
-			    0x8000, 0xf000, 0x8ff0, 0xfff0},
-		 tv16l[9] = {0x0000, 0x0001, 0x0001, 0x0001, 0x0001,
-			     0x8000, 0x1000, 0x0010, 0x0010},
-		 tv16m[9] = {0x0000, 0x0001, 0x0008, 0x0800, 0x0800,
-			     0x8000, 0x8000, 0x8000, 0x8000};
-	uint32_t tv32[9] = {0x00000000, 0x00000001, 0x0000000f,
-			    0x0ffffff1, 0x0fffffff, 0x80000000,
-			    0xf0000000, 0x8ffffff0, 0xfffffff0},
-		 tv32l[9] = {0x00000000, 0x00000001, 0x00000001,
-			     0x00000001, 0x00000001, 0x80000000,
-			     0x10000000, 0x00000010, 0x00000010},
-		 tv32m[9] = {0x00000000, 0x00000001, 0x00000008,
-			     0x08000000, 0x08000000, 0x80000000,
-			     0x80000000, 0x80000000, 0x80000000};
-	uint64_t tv64[9] = {0x0000000000000000LL, 0x0000000000000001LL,
-			    0x000000000000000fLL, 0x0ffffffffffffff1LL,
-			    0x0fffffffffffffffLL, 0x8000000000000000LL,
-			    0xf000000000000000LL, 0x8ffffffffffffff0LL,
-			    0xfffffffffffffff0LL},
-		 tv64l[9] = {0x0000000000000000LL, 0x0000000000000001LL,
-			     0x0000000000000001LL, 0x0000000000000001LL,
-			     0x0000000000000001LL, 0x8000000000000000LL,
-			     0x1000000000000000LL, 0x0000000000000010LL,
-			     0x0000000000000010LL},
-		 tv64m[9] = {0x0000000000000000LL, 0x0000000000000001LL,
-			     0x0000000000000008LL, 0x0800000000000000LL,
-			     0x0800000000000000LL, 0x8000000000000000LL,
-			     0x8000000000000000LL, 0x8000000000000000LL,
-			     0x8000000000000000LL};
+	uint8_t tv8[10] = {0x00, 0x01, 0x0f, 0x01, 0x0f,
+			   0x80, 0xf0, 0x80, 0xf0, 0x81},
+		tv8l[10] = {0x00, 0x01, 0x01, 0x01, 0x01,
+			    0x80, 0x10, 0x80, 0x10, 0x01},
+		tv8m[10] = {0x00, 0x01, 0x08, 0x01, 0x08,
+			    0x80, 0x80, 0x80, 0x80, 0x80};
+	uint16_t tv16[10] = {0x0000, 0x0001, 0x000f, 0x0ff1, 0x0fff,
+			     0x8000, 0xf000, 0x8ff0, 0xfff0, 0x8001},
+		 tv16l[10] = {0x0000, 0x0001, 0x0001, 0x0001, 0x0001,
+			      0x8000, 0x1000, 0x0010, 0x0010, 0x0001},
+		 tv16m[10] = {0x0000, 0x0001, 0x0008, 0x0800, 0x0800,
+			      0x8000, 0x8000, 0x8000, 0x8000, 0x8000};
+	uint32_t tv32[10] = {0x00000000, 0x00000001, 0x0000000f, 0x0ffffff1,
+			     0x0fffffff, 0x80000000, 0xf0000000, 0x8ffffff0,
+			     0xfffffff0, 0x80000001},
+		 tv32l[10] = {0x00000000, 0x00000001, 0x00000001, 0x00000001,
+			      0x00000001, 0x80000000, 0x10000000, 0x00000010,
+			      0x00000010, 0x00000001},
+		 tv32m[10] = {0x00000000, 0x00000001, 0x00000008, 0x08000000,
+			      0x08000000, 0x80000000, 0x80000000, 0x80000000,
+			      0x80000000, 0x80000000};
+	uint64_t tv64[10] = {0x0000000000000000LL, 0x0000000000000001LL,
+			     0x000000000000000fLL, 0x0ffffffffffffff1LL,
+			     0x0fffffffffffffffLL, 0x8000000000000000LL,
+			     0xf000000000000000LL, 0x8ffffffffffffff0LL,
+			     0xfffffffffffffff0LL, 0x8000000000000001LL},
+		 tv64l[10] = {0x0000000000000000LL, 0x0000000000000001LL,
+			      0x0000000000000001LL, 0x0000000000000001LL,
+			      0x0000000000000001LL, 0x8000000000000000LL,
+			      0x1000000000000000LL, 0x0000000000000010LL,
+			      0x0000000000000010LL, 0x0000000000000001LL},
+		 tv64m[10] = {0x0000000000000000LL, 0x0000000000000001LL,
+			      0x0000000000000008LL, 0x0800000000000000LL,
+			      0x0800000000000000LL, 0x8000000000000000LL,
+			      0x8000000000000000LL, 0x8000000000000000LL,
+			      0x8000000000000000LL, 0x8000000000000000LL};
 	int res = 0;
 	size_t i;
 #define LSBMSB_TEST(tvx, tvxl, tvxm, lsb, msb, err)                            \
@@ -6555,6 +9206,10 @@ int main()
 				     "who", "who are you? who are we?"));
 	STEST_ASSERT(test_ss_replace("who are you? who are we?", 0, "who",
 				     "where", "where are you? where are we?"));
+	STEST_ASSERT(test_ss_replace("who are you? who are we?", 4, "who",
+				     "where", "who are you? where are we?"));
+	STEST_ASSERT(test_ss_replace("where are you? where are we?", 5, "where",
+				     "who", "where are you? who are we?"));
 	STEST_ASSERT(test_ss_to_c(""));
 	STEST_ASSERT(test_ss_to_c("hello"));
 	STEST_ASSERT(test_ss_to_w(""));
@@ -6566,6 +9221,9 @@ int main()
 	STEST_ASSERT(test_ss_find("full text", "text", 5));
 	STEST_ASSERT(test_ss_find("full text", "hello", S_NPOS));
 	STEST_ASSERT(test_ss_find_misc());
+	STEST_ASSERT(test_ss_find_fl());
+	STEST_ASSERT(test_ss_find_p());
+	STEST_ASSERT(test_ss_find_mp());
 	STEST_ASSERT(test_ss_split());
 	STEST_ASSERT(test_ss_cmp("hello", "hello2", -1));
 	STEST_ASSERT(test_ss_cmp("hello2", "hello", 1));
@@ -6669,7 +9327,21 @@ int main()
 	STEST_ASSERT(test_sv_erase());
 	STEST_ASSERT(test_sv_resize());
 	STEST_ASSERT(test_sv_sort());
+	STEST_ASSERT(test_sv_sort_gen());
+	STEST_ASSERT(test_sv_sort_stable());
+	STEST_ASSERT(test_sv_argsort_permute());
+#ifndef S_MINIMAL
+	STEST_ASSERT(test_sv_sort_lsd());
+	STEST_ASSERT(test_sv_sort_fp());
+	STEST_ASSERT(test_sv_sort_parallel());
+#endif
 	STEST_ASSERT(test_sv_find());
+	STEST_ASSERT(test_sv_find_count_all());
+	STEST_ASSERT(test_sv_sorted_search());
+	STEST_ASSERT(test_sv_setops());
+	STEST_ASSERT(test_sv_select());
+	STEST_ASSERT(test_sv_ops());
+	STEST_ASSERT(test_sv_compress());
 	STEST_ASSERT(test_sv_push_pop_set());
 	STEST_ASSERT(test_sv_push_pop_set_u8());
 	STEST_ASSERT(test_sv_push_pop_set_i8());
@@ -6682,6 +9354,7 @@ int main()
 	STEST_ASSERT(test_sv_push_pop_set_f());
 	STEST_ASSERT(test_sv_push_pop_set_d());
 	STEST_ASSERT(test_sv_push_raw());
+	STEST_ASSERT(test_stb());
 	STEST_ASSERT(test_st_alloc());
 	STEST_ASSERT(test_st_insert_del());
 	STEST_ASSERT(test_st_traverse());
@@ -6718,10 +9391,29 @@ int main()
 	STEST_ASSERT(test_sm_itr());
 	STEST_ASSERT(test_sm_sort_to_vectors());
 	STEST_ASSERT(test_sm_double_rotation());
+	STEST_ASSERT(test_sm_bounds());
+	STEST_ASSERT(test_sm_range_split_join());
+	STEST_ASSERT(test_sm_snapshot());
+	STEST_ASSERT(test_sm_optimize());
+	STEST_ASSERT(test_sm_merge());
+	STEST_ASSERT(test_sm_wide());
+	STEST_ASSERT(test_sm_multi());
 	/*
 	 * Set
 	 */
 	STEST_ASSERT(test_sms());
+	/*
+	 * Radix map
+	 */
+	STEST_ASSERT(test_srm());
+	/*
+	 * Interval map
+	 */
+	STEST_ASSERT(test_sim());
+	/*
+	 * Flat map
+	 */
+	STEST_ASSERT(test_sfm());
 	/*
 	 * Hash map
 	 */